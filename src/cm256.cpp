@@ -27,6 +27,9 @@
 */
 
 #include "cm256.h"
+#include "trace.hpp"
+
+#include <limits.h>
 
 
 /*
@@ -248,18 +251,44 @@ struct CM256Decoder
     // Row indices that were erased
     uint8_t ErasuresIndices[256];
 
+    // Matrix elements for the m>1 case, from GenerateMatrix()
+    uint8_t* Elements; // Multiplier to eliminate each original block from each recovery block
+    uint8_t* Matrix_L;
+    uint8_t* Diag_D;
+    uint8_t* Matrix_U;
+
+    // Space for the matrix elements, allocated if they do not fit on the stack
+    static const int StackAllocSize = 2048;
+    uint8_t StackMatrix[StackAllocSize];
+    uint8_t* DynamicMatrix;
+
+    CM256Decoder()
+    {
+        DynamicMatrix = nullptr;
+    }
+    ~CM256Decoder()
+    {
+        delete[] DynamicMatrix;
+    }
+
     // Initialize the decoder
     bool Initialize(cm256_encoder_params& params, cm256_block* blocks);
 
-    // Decode m=1 case
-    void DecodeM1();
+    // Decode m=1 case for the bytes of each block from offset
+    void DecodeM1(int offset, int bytes);
+
+    // Generate the matrix elements for the m>1 case, which only depend on the blocks received
+    void GenerateMatrix();
 
-    // Decode for m>1 case
-    void Decode();
+    // Decode for m>1 case for the bytes of each block from offset, after GenerateMatrix()
+    void Decode(int offset, int bytes);
 
     // Generate the LU decomposition of the matrix
     void GenerateLDUDecomposition(uint8_t* matrix_L, uint8_t* diag_D, uint8_t* matrix_U);
 
+    // Label the recovery blocks with the original rows they now hold
+    void RecoverIndices();
+
     // Sort blocks back into the original order
     void SortBlocks(cm256_block* blocks);
 };
@@ -319,16 +348,18 @@ bool CM256Decoder::Initialize(cm256_encoder_params& params, cm256_block* blocks)
     return true;
 }
 
-void CM256Decoder::DecodeM1()
+void CM256Decoder::DecodeM1(int offset, int bytes)
 {
+    CAT_TRACE_SPAN(m1_span, "DecodeM1");
+
     // XOR all other blocks into the recovery block
-    uint8_t* outBlock = static_cast<uint8_t*>(Recovery[0]->Data);
+    uint8_t* outBlock = static_cast<uint8_t*>(Recovery[0]->Data) + offset;
     const uint8_t* inBlock = nullptr;
 
     // For each block:
     for (int ii = 0; ii < OriginalCount; ++ii)
     {
-        const uint8_t* inBlock2 = static_cast<const uint8_t*>(Original[ii]->Data);
+        const uint8_t* inBlock2 = static_cast<const uint8_t*>(Original[ii]->Data) + offset;
 
         if (!inBlock)
         {
@@ -337,7 +368,7 @@ void CM256Decoder::DecodeM1()
         else
         {
             // outBlock ^= inBlock ^ inBlock2
-            gf256_add2_mem(outBlock, inBlock, inBlock2, Params.BlockBytes);
+            gf256_add2_mem(outBlock, inBlock, inBlock2, bytes);
             inBlock = nullptr;
         }
     }
@@ -345,11 +376,16 @@ void CM256Decoder::DecodeM1()
     // Complete XORs
     if (inBlock)
     {
-        gf256_add_mem(outBlock, inBlock, Params.BlockBytes);
+        gf256_add_mem(outBlock, inBlock, bytes);
     }
+}
 
-    // Recover the index it corresponds to
-    Recovery[0]->Index = ErasuresIndices[0];
+void CM256Decoder::RecoverIndices()
+{
+    for (int i = 0; i < RecoveryCount; ++i)
+    {
+        Recovery[i]->Index = ErasuresIndices[i];
+    }
 }
 
 // Generate the LU decomposition of the matrix
@@ -462,7 +498,7 @@ void CM256Decoder::GenerateLDUDecomposition(uint8_t* matrix_L, uint8_t* diag_D,
     diag_D[N - 1] = gf256_div(gf256_mul(L_nn, U_nn), gf256_add(x_n, y_n));
 }
 
-void CM256Decoder::Decode()
+void CM256Decoder::GenerateMatrix()
 {
     // Matrix size is NxN, where N is the number of recovery blocks used.
     const int N = RecoveryCount;
@@ -470,35 +506,29 @@ void CM256Decoder::Decode()
     // Start the x_0 values arbitrarily from the original count.
     const uint8_t x_0 = static_cast<uint8_t>(Params.OriginalCount);
 
-    // Eliminate original data from the the recovery rows
+    // Allocate matrix
+    const int requiredSpace = OriginalCount * N + N * N;
+    uint8_t* matrix = StackMatrix;
+    if (requiredSpace > StackAllocSize)
+    {
+        DynamicMatrix = new uint8_t[requiredSpace];
+        matrix = DynamicMatrix;
+    }
+
+    // Elements that eliminate original data from the recovery rows
+    Elements = matrix;
     for (int originalIndex = 0; originalIndex < OriginalCount; ++originalIndex)
     {
-        const uint8_t* inBlock = static_cast<const uint8_t*>(Original[originalIndex]->Data);
-        const uint8_t inRow = Original[originalIndex]->Index;
+        const uint8_t y_j = Original[originalIndex]->Index;
 
         for (int recoveryIndex = 0; recoveryIndex < N; ++recoveryIndex)
         {
-            uint8_t* outBlock = static_cast<uint8_t*>(Recovery[recoveryIndex]->Data);
             const uint8_t x_i = Recovery[recoveryIndex]->Index;
-            const uint8_t y_j = inRow;
-            const uint8_t matrixElement = GetMatrixElement(x_i, x_0, y_j);
 
-            gf256_muladd_mem(outBlock, matrixElement, inBlock, Params.BlockBytes);
+            *matrix++ = GetMatrixElement(x_i, x_0, y_j);
         }
     }
 
-    // Allocate matrix
-    static const int StackAllocSize = 2048;
-    uint8_t stackMatrix[StackAllocSize];
-    uint8_t* dynamicMatrix = nullptr;
-    uint8_t* matrix = stackMatrix;
-    const int requiredSpace = N * N;
-    if (requiredSpace > StackAllocSize)
-    {
-        dynamicMatrix = new uint8_t[requiredSpace];
-        matrix = dynamicMatrix;
-    }
-
     /*
         Compute matrix decomposition:
 
@@ -508,58 +538,88 @@ void CM256Decoder::Decode()
         D is a diagonal matrix.
         U is upper-triangular, diagonal is all ones.
     */
-    uint8_t* matrix_U = matrix;
-    uint8_t* diag_D = matrix_U + (N - 1) * N / 2;
-    uint8_t* matrix_L = diag_D + N;
-    GenerateLDUDecomposition(matrix_L, diag_D, matrix_U);
+    Matrix_U = matrix;
+    Diag_D = Matrix_U + (N - 1) * N / 2;
+    Matrix_L = Diag_D + N;
+    CAT_TRACE_SPAN(ldu_span, "GenerateLDUDecomposition");
+    GenerateLDUDecomposition(Matrix_L, Diag_D, Matrix_U);
+    CAT_TRACE_END(ldu_span);
+}
+
+void CM256Decoder::Decode(int offset, int bytes)
+{
+    // Matrix size is NxN, where N is the number of recovery blocks used.
+    const int N = RecoveryCount;
+
+    // Eliminate original data from the the recovery rows
+    CAT_TRACE_SPAN(originals_span, "EliminateOriginals");
+    const uint8_t* elements = Elements;
+    for (int originalIndex = 0; originalIndex < OriginalCount; ++originalIndex)
+    {
+        const uint8_t* inBlock = static_cast<const uint8_t*>(Original[originalIndex]->Data) + offset;
+
+        for (int recoveryIndex = 0; recoveryIndex < N; ++recoveryIndex)
+        {
+            uint8_t* outBlock = static_cast<uint8_t*>(Recovery[recoveryIndex]->Data) + offset;
+
+            gf256_muladd_mem(outBlock, *elements++, inBlock, bytes);
+        }
+    }
+    CAT_TRACE_END(originals_span);
 
     /*
         Eliminate lower left triangle.
     */
+    CAT_TRACE_SPAN(lower_span, "EliminateLower");
+    const uint8_t* matrix_L = Matrix_L;
     // For each column:
     for (int j = 0; j < N - 1; ++j)
     {
-        const void* block_j = Recovery[j]->Data;
+        const uint8_t* block_j = static_cast<const uint8_t*>(Recovery[j]->Data) + offset;
 
         // For each row:
         for (int i = j + 1; i < N; ++i)
         {
-            void* block_i = Recovery[i]->Data;
+            uint8_t* block_i = static_cast<uint8_t*>(Recovery[i]->Data) + offset;
             const uint8_t c_ij = *matrix_L++; // Matrix elements are stored column-first, top-down.
 
-            gf256_muladd_mem(block_i, c_ij, block_j, Params.BlockBytes);
+            gf256_muladd_mem(block_i, c_ij, block_j, bytes);
         }
     }
 
+    CAT_TRACE_END(lower_span);
+
     /*
         Eliminate diagonal.
     */
+    CAT_TRACE_SPAN(diagonal_span, "EliminateDiagonal");
     for (int i = 0; i < N; ++i)
     {
-        void* block = Recovery[i]->Data;
-
-        Recovery[i]->Index = ErasuresIndices[i];
+        uint8_t* block = static_cast<uint8_t*>(Recovery[i]->Data) + offset;
 
-        gf256_div_mem(block, block, diag_D[i], Params.BlockBytes);
+        gf256_div_mem(block, block, Diag_D[i], bytes);
     }
 
+    CAT_TRACE_END(diagonal_span);
+
     /*
         Eliminate upper right triangle.
     */
+    CAT_TRACE_SPAN(upper_span, "EliminateUpper");
+    const uint8_t* matrix_U = Matrix_U;
     for (int j = N - 1; j >= 1; --j)
     {
-        const void* block_j = Recovery[j]->Data;
+        const uint8_t* block_j = static_cast<const uint8_t*>(Recovery[j]->Data) + offset;
 
         for (int i = j - 1; i >= 0; --i)
         {
-            void* block_i = Recovery[i]->Data;
+            uint8_t* block_i = static_cast<uint8_t*>(Recovery[i]->Data) + offset;
             const uint8_t c_ij = *matrix_U++; // Matrix elements are stored column-first, bottom-up.
 
-            gf256_muladd_mem(block_i, c_ij, block_j, Params.BlockBytes);
+            gf256_muladd_mem(block_i, c_ij, block_j, bytes);
         }
     }
-
-    delete[] dynamicMatrix;
+    CAT_TRACE_END(upper_span);
 }
 
 void CM256Decoder::SortBlocks(cm256_block* blocks)
@@ -617,6 +677,8 @@ extern "C" int cm256_decode(
         return 0;
     }
 
+    CAT_TRACE_SPAN(decode_span, "cm256_decode");
+
     CM256Decoder state;
     if (!state.Initialize(params, blocks))
     {
@@ -629,13 +691,190 @@ extern "C" int cm256_decode(
         // If m=1:
         if (params.RecoveryCount == 1)
         {
-            state.DecodeM1();
+            state.DecodeM1(0, params.BlockBytes);
         }
         else
         {
             // Decode for m>1
-            state.Decode();
+            state.GenerateMatrix();
+            state.Decode(0, params.BlockBytes);
         }
+
+        state.RecoverIndices();
+    }
+
+    // Sort blocks back into original order
+    state.SortBlocks(blocks);
+
+    return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Batching
+
+/*
+    Every step of the codec applies the same GF(256) operation at each byte
+    offset of a block, so a batch of interleaved messages is just one message
+    with wider blocks.  This lets the matrix elements be generated once for
+    many messages and keeps the bulk SIMD loops running over long buffers.
+
+    Sweeping the whole width at once would stream every block through memory
+    once per matrix element though, so the batch is processed in strips that
+    keep all of the blocks involved in L2 cache.
+*/
+
+// Bytes of all blocks in a strip, sized to fit in L2 cache
+static const int BatchStripCacheBytes = 128 * 1024;
+
+// Widen the block size to cover a batch, or return false if it is invalid
+static bool GetBatchBytes(const cm256_encoder_params& params, int batchCount, int& totalBytes)
+{
+    if (batchCount <= 0 || params.BlockBytes <= 0 ||
+        params.BlockBytes > INT_MAX / batchCount)
+    {
+        return false;
+    }
+
+    totalBytes = params.BlockBytes * batchCount;
+    return true;
+}
+
+// Bytes of each block to process per strip, a multiple of the SIMD width
+static int GetBatchStripBytes(const cm256_encoder_params& params)
+{
+    int stripBytes = BatchStripCacheBytes / (params.OriginalCount + params.RecoveryCount);
+
+    stripBytes &= ~63;
+    if (stripBytes < 64)
+    {
+        stripBytes = 64;
+    }
+
+    return stripBytes;
+}
+
+extern "C" int cm256_encode_batch(
+    cm256_encoder_params params, // Encoder parameters for each message
+    cm256_block* originals,      // Array of pointers to interleaved original blocks
+    int batchCount,              // Number of messages in the batch
+    void* recoveryBlocks)        // Output interleaved recovery blocks end-to-end
+{
+    int totalBytes;
+    if (!GetBatchBytes(params, batchCount, totalBytes))
+    {
+        return -1;
+    }
+    if (params.OriginalCount <= 0 ||
+        params.RecoveryCount <= 0)
+    {
+        return -1;
+    }
+    if (params.OriginalCount + params.RecoveryCount > 256)
+    {
+        return -2;
+    }
+    if (!originals || !recoveryBlocks)
+    {
+        return -3;
+    }
+
+    const int stripBytes = GetBatchStripBytes(params);
+    uint8_t* recoveryBlock = static_cast<uint8_t*>(recoveryBlocks);
+    cm256_block strip[256];
+
+    // For each strip of the interleaved blocks:
+    for (int offset = 0; offset < totalBytes; offset += stripBytes)
+    {
+        cm256_encoder_params stripParams = params;
+        stripParams.BlockBytes = (totalBytes - offset < stripBytes) ? totalBytes - offset : stripBytes;
+
+        for (int j = 0; j < params.OriginalCount; ++j)
+        {
+            strip[j].Data = static_cast<uint8_t*>(originals[j].Data) + offset;
+        }
+
+        for (int block = 0; block < params.RecoveryCount; ++block)
+        {
+            cm256_encode_block(stripParams, strip, (params.OriginalCount + block), recoveryBlock + (size_t)block * totalBytes + offset);
+        }
+    }
+
+    return 0;
+}
+
+extern "C" int cm256_decode_batch(
+    cm256_encoder_params params, // Encoder parameters for each message
+    cm256_block* blocks,         // Array of 'OriginalCount' interleaved blocks
+    int batchCount)              // Number of messages in the batch
+{
+    int totalBytes;
+    if (!GetBatchBytes(params, batchCount, totalBytes))
+    {
+        return -1;
+    }
+    if (params.OriginalCount <= 0 ||
+        params.RecoveryCount <= 0)
+    {
+        return -1;
+    }
+    if (params.OriginalCount + params.RecoveryCount > 256)
+    {
+        return -2;
+    }
+    if (!blocks)
+    {
+        return -3;
+    }
+
+    // If there is only one block:
+    if (params.OriginalCount == 1)
+    {
+        // It is the same block repeated
+        blocks[0].Index = 0;
+        return 0;
+    }
+
+    CAT_TRACE_SPAN(decode_span, "cm256_decode_batch");
+
+    // Decode the batch as one message with wide blocks
+    cm256_encoder_params batchParams = params;
+    batchParams.BlockBytes = totalBytes;
+
+    CM256Decoder state;
+    if (!state.Initialize(batchParams, blocks))
+    {
+        return -5;
+    }
+
+    // If recovery is needed:
+    if (state.RecoveryCount > 0)
+    {
+        // The matrix only depends on which blocks were received, so every strip shares it
+        if (params.RecoveryCount > 1)
+        {
+            state.GenerateMatrix();
+        }
+
+        const int stripBytes = GetBatchStripBytes(params);
+
+        // For each strip of the interleaved blocks:
+        int bytes;
+        for (int offset = 0; offset < totalBytes; offset += bytes)
+        {
+            bytes = (totalBytes - offset < stripBytes) ? totalBytes - offset : stripBytes;
+
+            if (params.RecoveryCount == 1)
+            {
+                state.DecodeM1(offset, bytes);
+            }
+            else
+            {
+                state.Decode(offset, bytes);
+            }
+        }
+
+        state.RecoverIndices();
     }
 
     // Sort blocks back into original order
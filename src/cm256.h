@@ -158,6 +158,45 @@ extern int cm256_decode(
     cm256_encoder_params params, // Encoder parameters
     cm256_block* blocks);        // Array of 'OriginalCount' blocks as described above
 
+/*
+ * Batched Cauchy MDS GF(256) encode
+ *
+ * This encodes 'batchCount' independent messages that share the same
+ * parameters in one pass, which is much faster than encoding many tiny
+ * messages one at a time because each matrix element is generated once and
+ * each bulk GF(256) operation runs over all of the messages together.
+ *
+ * The messages are interleaved: each entry in 'originals' points to
+ * batchCount * BlockBytes bytes holding that block index for every message
+ * end-to-end, so block j of message m is at originals[j].Data + m * BlockBytes.
+ * Recovery blocks are written the same way, so recovery block i of message m
+ * is at recoveryBlocks + (i * batchCount + m) * BlockBytes.
+ *
+ * A natural wire format sends each interleaved block as one packet, so that
+ * the messages in a batch are always lost and recovered together.
+ *
+ * Returns 0 on success, and any other code indicates failure.
+ */
+extern int cm256_encode_batch(
+    cm256_encoder_params params, // Encoder parameters for each message
+    cm256_block* originals,      // Array of pointers to interleaved original blocks
+    int batchCount,              // Number of messages in the batch
+    void* recoveryBlocks);       // Output interleaved recovery blocks end-to-end
+
+/*
+ * Batched Cauchy MDS GF(256) decode
+ *
+ * This recovers a batch of messages encoded with cm256_encode_batch().  The
+ * blocks are interleaved as described above, so every message in the batch
+ * must have received the same block indices.
+ *
+ * Returns 0 on success, and any other code indicates failure.
+ */
+extern int cm256_decode_batch(
+    cm256_encoder_params params, // Encoder parameters for each message
+    cm256_block* blocks,         // Array of 'OriginalCount' interleaved blocks
+    int batchCount);             // Number of messages in the batch
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,90 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "wh256_trace.h"
+
+#define WH256_TRACING /* Compile in phase tracing hooks, see wh256_trace.h */
+
+#if defined(WH256_TRACING)
+
+#include <atomic>
+
+// Installed hook and its context, or nullptr
+extern std::atomic<wh256_trace_hook> TraceHook;
+extern void* TraceHookContext;
+
+static inline void TraceEvent(const char* name, int begin)
+{
+    const wh256_trace_hook hook = TraceHook.load(std::memory_order_acquire);
+    if (hook)
+    {
+        hook(TraceHookContext, name, begin);
+    }
+}
+
+// Traces a phase until End() is called or it goes out of scope
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char* name)
+    {
+        Name = name;
+        TraceEvent(name, 1);
+    }
+    ~TraceSpan()
+    {
+        End();
+    }
+
+    void End()
+    {
+        if (Name)
+        {
+            TraceEvent(Name, 0);
+            Name = nullptr;
+        }
+    }
+
+private:
+    const char* Name;
+};
+
+#define CAT_TRACE_SPAN(var, name) TraceSpan var(name)
+#define CAT_TRACE_END(var) var.End()
+
+#else
+
+#define CAT_TRACE_SPAN(var, name)
+#define CAT_TRACE_END(var)
+
+#endif // WH256_TRACING
+
+#endif // TRACE_HPP
@@ -30,12 +30,43 @@
 
 #include "cm256.h"
 #include "wirehair_codec_8.hpp"
+#include "worker_pool.hpp"
+
+#include <new>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
 
 static bool m_init = false;
 
+// Collect solver statistics for states initialized while set
+static std::atomic<bool> m_stats_enabled(false);
+
 // Number of input blocks N to start using Wirehair at instead of CM256
 static const int WIREHAIR_THRESHOLD_N = 28;
 
+// Alignment of caller-provided arenas and each region carved from them
+static const uint64_t WH256_ARENA_ALIGN = 64;
+
+static inline uint64_t ArenaRoundUp(uint64_t bytes)
+{
+    return (bytes + WH256_ARENA_ALIGN - 1) & ~(WH256_ARENA_ALIGN - 1);
+}
+
 int wh256_init_(int expected_version)
 {
     // If version mismatch:
@@ -58,6 +89,228 @@ int wh256_init_(int expected_version)
 }
 
 
+//-----------------------------------------------------------------------------
+// Latency Histograms
+
+// Record API call latencies while set
+static std::atomic<bool> m_histograms_enabled(false);
+
+// Timestamp counter for latency histograms
+static inline uint64_t GetTimestamp()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/*
+    Log-linear buckets in the style of HdrHistogram: values below 32 ticks
+    each get a bucket, and every power of two above that is split into 16
+    buckets, so a bucket is never wider than 1/16 of its lower bound.
+    Values of 2^48 ticks or more share the last bucket.
+*/
+static const int HISTOGRAM_LINEAR = 32;
+static const int HISTOGRAM_SUB_BITS = 4;
+static const int HISTOGRAM_MAX_EXPONENT = 47;
+static const int HISTOGRAM_BUCKETS = HISTOGRAM_LINEAR +
+    (HISTOGRAM_MAX_EXPONENT - 5 + 1) * (1 << HISTOGRAM_SUB_BITS);
+
+static inline int HistogramBucket(uint64_t ticks)
+{
+    if (ticks < (uint64_t)HISTOGRAM_LINEAR)
+    {
+        return (int)ticks;
+    }
+
+    int exponent = 63;
+    while ((ticks >> exponent) == 0)
+    {
+        --exponent;
+    }
+
+    if (exponent > HISTOGRAM_MAX_EXPONENT)
+    {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+
+    const int mantissa = (int)(ticks >> (exponent - HISTOGRAM_SUB_BITS)) & ((1 << HISTOGRAM_SUB_BITS) - 1);
+    return HISTOGRAM_LINEAR + ((exponent - 5) << HISTOGRAM_SUB_BITS) + mantissa;
+}
+
+// Smallest value counted in a bucket
+static uint64_t HistogramBucketLow(int bucket)
+{
+    if (bucket < HISTOGRAM_LINEAR)
+    {
+        return (uint64_t)bucket;
+    }
+
+    const int exponent = ((bucket - HISTOGRAM_LINEAR) >> HISTOGRAM_SUB_BITS) + 5;
+    const uint64_t mantissa = (uint64_t)((bucket - HISTOGRAM_LINEAR) & ((1 << HISTOGRAM_SUB_BITS) - 1));
+    return ((1ULL << HISTOGRAM_SUB_BITS) + mantissa) << (exponent - HISTOGRAM_SUB_BITS);
+}
+
+// Smallest value counted in the next bucket
+static uint64_t HistogramBucketHigh(int bucket)
+{
+    if (bucket < HISTOGRAM_LINEAR)
+    {
+        return (uint64_t)bucket + 1;
+    }
+
+    const int exponent = ((bucket - HISTOGRAM_LINEAR) >> HISTOGRAM_SUB_BITS) + 5;
+    return HistogramBucketLow(bucket) + (1ULL << (exponent - HISTOGRAM_SUB_BITS));
+}
+
+/*
+    Threads are spread over a fixed number of histogram slots, so memory
+    stays bounded however many threads come and go.  Each thread keeps the
+    slot it was first given, and slots are shared round-robin once there are
+    more threads than slots.  Counters are updated with relaxed atomic adds,
+    so recording never takes a lock, and readers on other threads see whole
+    values.
+
+    The slots live in static storage and are zero before first use, so
+    untouched slots cost no memory in practice.
+*/
+static const int HISTOGRAM_SLOTS = 16;
+
+struct HistogramSlot
+{
+    std::atomic<uint64_t> Counts[WH256_OP_COUNT][WH256_BACKEND_COUNT][HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> Max[WH256_OP_COUNT][WH256_BACKEND_COUNT];
+
+    void Reset()
+    {
+        for (int op = 0; op < WH256_OP_COUNT; ++op)
+        {
+            for (int backend = 0; backend < WH256_BACKEND_COUNT; ++backend)
+            {
+                for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+                {
+                    Counts[op][backend][bucket].store(0, std::memory_order_relaxed);
+                }
+                Max[op][backend].store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+static HistogramSlot m_histogram_slots[HISTOGRAM_SLOTS];
+
+// Next slot to hand to a thread that has not recorded a call yet
+static std::atomic<unsigned> m_next_histogram_slot(0);
+
+// Slot of the calling thread, or -1 before its first call is recorded
+#if defined(_MSC_VER) && _MSC_VER < 1900
+static __declspec(thread) int m_thread_histogram_slot = -1;
+#else
+static thread_local int m_thread_histogram_slot = -1;
+#endif
+
+// Returns a timestamp to pass to RecordLatency(), or 0 if histograms are off
+static inline uint64_t StartLatency()
+{
+    return m_histograms_enabled.load(std::memory_order_relaxed) ? GetTimestamp() : 0;
+}
+
+static void RecordLatency(int op, bool wirehair, uint64_t start)
+{
+    const uint64_t ticks = GetTimestamp() - start;
+
+    int slot = m_thread_histogram_slot;
+    if (slot < 0)
+    {
+        slot = (int)(m_next_histogram_slot.fetch_add(1, std::memory_order_relaxed) % HISTOGRAM_SLOTS);
+        m_thread_histogram_slot = slot;
+    }
+
+    HistogramSlot& histograms = m_histogram_slots[slot];
+    const int backend = wirehair ? WH256_BACKEND_WIREHAIR : WH256_BACKEND_CM256;
+
+    histograms.Counts[op][backend][HistogramBucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+
+    std::atomic<uint64_t>& max = histograms.Max[op][backend];
+    uint64_t prev = max.load(std::memory_order_relaxed);
+    while (ticks > prev && !max.compare_exchange_weak(prev, ticks, std::memory_order_relaxed))
+    {
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+// Worker Pool
+
+// Started on first use so that only pipelined decoders and streams pay for the threads.
+// Function-local statics are not initialized thread-safely by VS2013, so use call_once.
+static std::unique_ptr<WorkerPool> m_worker_pool;
+static std::once_flag m_worker_pool_once;
+
+WorkerPool& GetWorkerPool()
+{
+    std::call_once(m_worker_pool_once, []() { m_worker_pool.reset(new WorkerPool); });
+    return *m_worker_pool;
+}
+
+
+//-----------------------------------------------------------------------------
+// Decode Pipeline
+
+enum PipelineState
+{
+    PIPELINE_PEELING,   // Receive thread is feeding blocks to the peeler
+    PIPELINE_SOLVING,   // Solver owns the codec and extra blocks are queued
+    PIPELINE_DONE,      // Decoding completed successfully
+    PIPELINE_FAILED     // Solver gave up
+};
+
+// Extra block received while the solver is running
+struct PendingBlock
+{
+    unsigned int Id;
+    const void* Data;
+    std::vector<uint8_t> Copy;
+};
+
+// Pipelined decoder state, protected by Lock
+struct DecodePipeline
+{
+    std::mutex Lock;
+    std::condition_variable Idle;
+
+    PipelineState State;
+
+    // A worker task is queued or running
+    bool Running;
+
+    // DecodeSolve() has been run
+    bool Solved;
+
+    std::deque<PendingBlock> Pending;
+
+    wh256_decode_callback Callback;
+    void* CallbackContext;
+
+    DecodePipeline()
+    {
+        State = PIPELINE_PEELING;
+        Running = false;
+        Solved = false;
+        Callback = nullptr;
+        CallbackContext = nullptr;
+    }
+
+    // Wait for any worker task to finish
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> locker(Lock);
+        Idle.wait(locker, [this]() { return !Running; });
+    }
+};
+
+
 //-----------------------------------------------------------------------------
 // Internal WH256 Codec State
 
@@ -66,6 +319,10 @@ struct CodecState
     bool UsingWirehair;
     wirehair::Codec* WirehairCodec;
 
+    // Wirehair state for N above CAT_WIREHAIR_MAX_N:
+    bool UsingLargeWirehair;
+    wirehair::LargeCodec* LargeWirehairCodec;
+
     // CM256 state:
     cm256_encoder_params EncoderParams;
     const uint8_t* OriginalMessage;
@@ -79,18 +336,164 @@ struct CodecState
     // Space allocated to store block data during decoding
     uint8_t* BlockWorkspace;
 
+    // Caller-provided message that received original blocks are decoded into, or nullptr
+    uint8_t* OutputMessage;
+
+    // Decoder references received original blocks instead of copying them
+    bool ZeroCopyInput;
+
+    // Progressive output callback, or nullptr
+    wh256_block_callback BlockCallback;
+    void* BlockCallbackContext;
+
+    // Space allocated to reconstruct lost blocks for the callback
+    uint8_t* CallbackBlock;
+
+    // Solver runs on the worker pool if not nullptr
+    DecodePipeline* Pipeline;
+
+    // Wait for the solver and stop pipelining
+    void ReleasePipeline()
+    {
+        if (Pipeline)
+        {
+            Pipeline->WaitIdle();
+            delete Pipeline;
+            Pipeline = nullptr;
+        }
+    }
+
+    // Wait for the solver before the codec is used by the caller
+    void WaitPipeline()
+    {
+        if (Pipeline)
+        {
+            Pipeline->WaitIdle();
+        }
+    }
+
+    // Block size of the decoder
+    int BlockBytes()
+    {
+        if (!UsingWirehair)
+        {
+            return EncoderParams.BlockBytes;
+        }
+
+        return (int)(UsingLargeWirehair ? LargeWirehairCodec->BlockBytes() : WirehairCodec->BlockBytes());
+    }
+
+    // Caller-provided memory holding this object followed by all codec state, or nullptr
+    uint8_t* Arena;
+    uint64_t ArenaBytes;
+
+    // Memory following this object in the arena
+    uint8_t* ArenaTail()
+    {
+        return Arena + ArenaRoundUp(sizeof(CodecState));
+    }
+    uint64_t ArenaTailBytes()
+    {
+        return ArenaBytes - ArenaRoundUp(sizeof(CodecState));
+    }
+
+    // Carve CM256 block space from the arena, or allocate it
+    uint8_t* AllocateBlocks(uint64_t bytes)
+    {
+        if (!Arena)
+        {
+            return new uint8_t[(size_t)bytes];
+        }
+
+        ReleaseArenaCodecs();
+
+        return (bytes <= ArenaTailBytes()) ? ArenaTail() : nullptr;
+    }
+
+    // Wirehair codecs in the arena share space with the CM256 blocks
+    void ReleaseArenaCodecs()
+    {
+        if (WirehairCodec)
+        {
+            WirehairCodec->~CodecT();
+            WirehairCodec = nullptr;
+        }
+        if (LargeWirehairCodec)
+        {
+            LargeWirehairCodec->~CodecT();
+            LargeWirehairCodec = nullptr;
+        }
+    }
+
     void ResetCM256()
     {
-        delete[] LastBlock;
+        if (!Arena)
+        {
+            delete[] LastBlock;
+            delete[] BlockWorkspace;
+        }
         LastBlock = nullptr;
-
-        delete[] BlockWorkspace;
         BlockWorkspace = nullptr;
 
+        OutputMessage = nullptr;
+        ZeroCopyInput = false;
         BlocksReceived = 0;
         LastBlockSize = 0;
     }
 
+    void SelectWirehair(int N)
+    {
+        UsingLargeWirehair = (N > CAT_WIREHAIR_MAX_N);
+
+        // If using caller-provided memory,
+        if (Arena)
+        {
+            ReleaseArenaCodecs();
+
+            // Place the codec after this object and give it the rest of the arena
+            const uint64_t codec_bytes = ArenaRoundUp(UsingLargeWirehair ?
+                sizeof(wirehair::LargeCodec) : sizeof(wirehair::Codec));
+            uint8_t* codec_memory = ArenaTail();
+            uint8_t* memory = codec_memory + codec_bytes;
+            const uint64_t bytes = (ArenaTailBytes() > codec_bytes) ? ArenaTailBytes() - codec_bytes : 0;
+
+            if (UsingLargeWirehair)
+            {
+                LargeWirehairCodec = new (codec_memory) wirehair::LargeCodec;
+                LargeWirehairCodec->UseMemory(memory, bytes);
+                LargeWirehairCodec->EnableStats(m_stats_enabled);
+            }
+            else
+            {
+                WirehairCodec = new (codec_memory) wirehair::Codec;
+                WirehairCodec->UseMemory(memory, bytes);
+                WirehairCodec->EnableStats(m_stats_enabled);
+            }
+            return;
+        }
+
+        if (UsingLargeWirehair)
+        {
+            if (!LargeWirehairCodec)
+            {
+                LargeWirehairCodec = new wirehair::LargeCodec;
+            }
+            LargeWirehairCodec->EnableStats(m_stats_enabled);
+        }
+        else
+        {
+            // Release the large codec workspace as soon as it is not needed
+            delete LargeWirehairCodec;
+            LargeWirehairCodec = nullptr;
+
+            if (!WirehairCodec)
+            {
+                WirehairCodec = new wirehair::Codec;
+            }
+            WirehairCodec->EnableStats(m_stats_enabled);
+        }
+    }
+
     CodecState()
     {
         UsingWirehair = false;
@@ -99,26 +502,157 @@ struct CodecState
             Blocks[i].Data = nullptr;
         }
         WirehairCodec = nullptr;
+        UsingLargeWirehair = false;
+        LargeWirehairCodec = nullptr;
         OriginalMessage = nullptr;
+        OutputMessage = nullptr;
+        ZeroCopyInput = false;
         BlocksReceived = 0;
         LastBlockSize = 0;
 
+        BlockCallback = nullptr;
+        BlockCallbackContext = nullptr;
+        CallbackBlock = nullptr;
+        Pipeline = nullptr;
+
         LastBlock = nullptr;
         BlockWorkspace = nullptr;
+
+        Arena = nullptr;
+        ArenaBytes = 0;
     }
     ~CodecState()
     {
-        delete WirehairCodec;
+        ReleasePipeline();
+
+        if (Arena)
+        {
+            ReleaseArenaCodecs();
+        }
+        else
+        {
+            delete WirehairCodec;
+            delete LargeWirehairCodec;
+            delete[] CallbackBlock;
+        }
 
         ResetCM256();
     }
 };
 
+// Release a state object, which may live in caller-provided memory
+static void FreeCodecState(CodecState* codec)
+{
+    if (codec && codec->Arena)
+    {
+        codec->~CodecState();
+    }
+    else
+    {
+        delete codec;
+    }
+}
+
+
+// Calculate block count N, or return 0 if it is out of range
+static int WH256BlockCount(uint64_t bytes, int block_bytes)
+{
+    const uint64_t N = (bytes + block_bytes - 1) / block_bytes;
+
+    if (N > CAT_WIREHAIR_MAX_N_32)
+    {
+        return 0;
+    }
+
+    return (int)N;
+}
 
 wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int bytes, int block_bytes)
 {
     // If input is invalid:
-    if (!m_init || !message || bytes < 1 || block_bytes < 1)
+    if (bytes < 1)
+    {
+        return nullptr;
+    }
+
+    return wh256_encoder_init64(reuse_E, message, (uint64_t)bytes, block_bytes);
+}
+
+// Point CM256 blocks into the segments, gathering blocks that straddle segments
+// or need padding into BlockWorkspace.  Returns the number of gathered blocks,
+// which are only written if store is true
+static int MapSegmentBlocks(CodecState* codec, const wh256_segment* segments, bool store)
+{
+    const int block_bytes = codec->EncoderParams.BlockBytes;
+    const int N = codec->EncoderParams.OriginalCount;
+    int staged_count = 0;
+    const wh256_segment* segment = segments;
+    uint64_t segment_start = 0; // Message offset of the segment
+
+    for (int i = 0; i < N; ++i)
+    {
+        const uint64_t block_start = (uint64_t)block_bytes * i;
+        const int copy_bytes = (i == N - 1) ? codec->LastBlockSize : block_bytes;
+        const uint64_t block_end = block_start + copy_bytes;
+
+        // Skip segments that end before this block
+        while (segment_start + segment->bytes <= block_start)
+        {
+            segment_start += segment->bytes;
+            ++segment;
+        }
+
+        // If the block is within one segment and does not need padding, reference it there
+        if (block_end <= segment_start + segment->bytes && copy_bytes == block_bytes)
+        {
+            if (store)
+            {
+                codec->Blocks[i].Data = (void*)(static_cast<const uint8_t*>(segment->data) + (block_start - segment_start));
+            }
+            continue;
+        }
+
+        // Otherwise gather the pieces into the next staging block
+        if (store)
+        {
+            uint8_t* dest = codec->BlockWorkspace + (size_t)block_bytes * staged_count;
+            codec->Blocks[i].Data = dest;
+
+            const wh256_segment* piece = segment;
+            uint64_t piece_start = segment_start;
+            for (uint64_t offset = block_start; offset < block_end; piece_start += piece->bytes, ++piece)
+            {
+                const uint64_t piece_end = piece_start + piece->bytes;
+                if (offset < piece_end)
+                {
+                    const size_t piece_bytes = (size_t)((piece_end < block_end ? piece_end : block_end) - offset);
+                    memcpy(dest, static_cast<const uint8_t*>(piece->data) + (offset - piece_start), piece_bytes);
+                    dest += piece_bytes;
+                    offset += piece_bytes;
+                }
+            }
+
+            // Pad the final block with zeroes
+            memset(dest, 0, block_bytes - copy_bytes);
+        }
+        ++staged_count;
+    }
+
+    return staged_count;
+}
+
+// Either message or segments is provided
+static wh256_state InitializeEncoderState(wh256_state reuse_E, const void* message, const wh256_segment* segments, int segment_count, uint64_t bytes, int block_bytes)
+{
+    // If input is invalid:
+    if (!m_init || (!message && !segments) || bytes < 1 || block_bytes < 1)
+    {
+        return nullptr;
+    }
+
+    // If block count is out of range:
+    const int N = WH256BlockCount(bytes, block_bytes);
+    if (N < 1)
     {
         return nullptr;
     }
@@ -130,9 +664,12 @@ wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int byt
     {
         codec = new CodecState;
     }
+    else
+    {
+        codec->ReleasePipeline();
+    }
 
     // Use CM256 up to a number of input blocks
-    int N = (bytes + block_bytes - 1) / block_bytes;
     codec->UsingWirehair = (N >= WIREHAIR_THRESHOLD_N);
 
     if (!codec->UsingWirehair)
@@ -144,6 +681,28 @@ wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int byt
         codec->EncoderParams.RecoveryCount = 256 - N;
         codec->EncoderParams.BlockBytes = block_bytes;
 
+        codec->LastBlockSize = (int)(bytes - (uint64_t)(N - 1) * block_bytes);
+
+        // If the message is split across segments:
+        if (segments)
+        {
+            // Only blocks that straddle segments or need padding are copied
+            const int staged_count = MapSegmentBlocks(codec, segments, false);
+            if (staged_count > 0)
+            {
+                assert(!codec->BlockWorkspace); // Should have been cleared by ResetCM256()
+                codec->BlockWorkspace = codec->AllocateBlocks((uint64_t)staged_count * block_bytes);
+                if (!codec->BlockWorkspace)
+                {
+                    FreeCodecState(codec);
+                    return nullptr;
+                }
+            }
+
+            MapSegmentBlocks(codec, segments, true);
+            return codec;
+        }
+
         const uint8_t* block = codec->OriginalMessage;
         for (int i = 0; i < N; ++i, block += block_bytes)
         {
@@ -154,19 +713,19 @@ wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int byt
         // length so sometimes we must pad the final input block with zeroes
         // out to the block length.
 
-        // If there is no need to pad out the last block:
-        codec->LastBlockSize = bytes - N * block_bytes;
-        if (codec->LastBlockSize <= 0)
-        {
-            codec->LastBlockSize = block_bytes;
-        }
-        else
+        // If the last block needs to be padded out:
+        if (codec->LastBlockSize < block_bytes)
         {
             assert(!codec->LastBlock); // Should have been cleared by ResetCM256()
-            codec->LastBlock = new uint8_t[block_bytes];
+            codec->LastBlock = codec->AllocateBlocks(block_bytes);
+            if (!codec->LastBlock)
+            {
+                FreeCodecState(codec);
+                return nullptr;
+            }
 
             // Copy the original data into the LastBlock workspace and pad it with zeroes
-            memcpy(codec->LastBlock, block, codec->LastBlockSize);
+            memcpy(codec->LastBlock, codec->OriginalMessage + (size_t)(N - 1) * block_bytes, codec->LastBlockSize);
             memset(codec->LastBlock + codec->LastBlockSize, 0, block_bytes - codec->LastBlockSize);
 
             codec->Blocks[N - 1].Data = codec->LastBlock;
@@ -174,24 +733,32 @@ wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int byt
     }
     else
     {
-        if (!codec->WirehairCodec)
-        {
-            codec->WirehairCodec = new wirehair::Codec;
-        }
+        codec->SelectWirehair(N);
 
         // Initialize codec
-        wirehair::Result r = codec->WirehairCodec->InitializeEncoder(bytes, block_bytes);
+        wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->InitializeEncoder(bytes, block_bytes) :
+            codec->WirehairCodec->InitializeEncoder(bytes, block_bytes);
 
-        if (r == wirehair::R_WIN)
+        // Feed message to codec
+        if (r == wirehair::R_WIN && segments)
+        {
+            const wirehair::Segment* codec_segments = reinterpret_cast<const wirehair::Segment*>(segments);
+            r = codec->UsingLargeWirehair ?
+                codec->LargeWirehairCodec->EncodeFeed(codec_segments, segment_count) :
+                codec->WirehairCodec->EncodeFeed(codec_segments, segment_count);
+        }
+        else if (r == wirehair::R_WIN)
         {
-            // Feed message to codec
-            r = codec->WirehairCodec->EncodeFeed(message);
+            r = codec->UsingLargeWirehair ?
+                codec->LargeWirehairCodec->EncodeFeed(message) :
+                codec->WirehairCodec->EncodeFeed(message);
         }
 
         // On failure:
         if (r != wirehair::R_WIN)
         {
-            delete codec;
+            FreeCodecState(codec);
             codec = nullptr;
         }
     }
@@ -199,6 +766,60 @@ wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int byt
     return codec;
 }
 
+// Shared by the encoder init functions: Either message or segments is provided
+static wh256_state EncoderInit(wh256_state reuse_E, const void* message, const wh256_segment* segments, int segment_count, uint64_t bytes, int block_bytes)
+{
+    const uint64_t start = StartLatency();
+
+    wh256_state E = InitializeEncoderState(reuse_E, message, segments, segment_count, bytes, block_bytes);
+
+    if (start && E)
+    {
+        RecordLatency(WH256_OP_ENCODER_INIT, reinterpret_cast<CodecState*>(E)->UsingWirehair, start);
+    }
+
+    return E;
+}
+
+wh256_state wh256_encoder_init64(wh256_state reuse_E, const void* message, uint64_t bytes, int block_bytes)
+{
+    // If input is invalid:
+    if (!message)
+    {
+        return nullptr;
+    }
+
+    return EncoderInit(reuse_E, message, nullptr, 0, bytes, block_bytes);
+}
+
+// The codec reads the segment list directly
+static_assert(sizeof(wh256_segment) == sizeof(wirehair::Segment) &&
+    offsetof(wh256_segment, data) == offsetof(wirehair::Segment, data) &&
+    offsetof(wh256_segment, bytes) == offsetof(wirehair::Segment, bytes),
+    "wh256_segment must match wirehair::Segment");
+
+wh256_state wh256_encoder_initv(wh256_state reuse_E, const wh256_segment* segments, int count, int block_bytes)
+{
+    // If input is invalid:
+    if (!segments || count < 1)
+    {
+        return nullptr;
+    }
+
+    // Message is the concatenation of the segments
+    uint64_t bytes = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!segments[i].data && segments[i].bytes > 0)
+        {
+            return nullptr;
+        }
+        bytes += segments[i].bytes;
+    }
+
+    return EncoderInit(reuse_E, nullptr, segments, count, bytes, block_bytes);
+}
+
 int wh256_count(wh256_state E)
 {
     // If input is invalid:
@@ -211,7 +832,9 @@ int wh256_count(wh256_state E)
 
     if (codec->UsingWirehair)
     {
-        return codec->WirehairCodec->BlockCount();
+        return codec->UsingLargeWirehair ?
+            (int)codec->LargeWirehairCodec->BlockCount() :
+            (int)codec->WirehairCodec->BlockCount();
     }
     else
     {
@@ -234,7 +857,7 @@ static inline int WH256IndexToCM256Index(const cm256_encoder_params& params, int
     return recoveryIndex + params.OriginalCount;
 }
 
-int wh256_encoder_write(wh256_state E, unsigned int id, void* block, int* bytes_written)
+static int EncoderWrite(wh256_state E, unsigned int id, void* block, int* bytes_written)
 {
     // Initialize bytes written to zero:
     if (!bytes_written)
@@ -251,7 +874,9 @@ int wh256_encoder_write(wh256_state E, unsigned int id, void* block, int* bytes_
 
     if (codec->UsingWirehair)
     {
-        const uint32_t wh_written = codec->WirehairCodec->Encode(id, block);
+        const uint32_t wh_written = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->Encode(id, block) :
+            codec->WirehairCodec->Encode(id, block);
         if (wh_written <= 0)
             return -2;
 
@@ -280,11 +905,44 @@ int wh256_encoder_write(wh256_state E, unsigned int id, void* block, int* bytes_
     return 0;
 }
 
-wh256_state wh256_decoder_init(wh256_state reuse_E, int bytes, int block_bytes)
+int wh256_encoder_write(wh256_state E, unsigned int id, void* block, int* bytes_written)
 {
-    // If input is invalid:
-    if (bytes < 1 || block_bytes < 1)
-    {
+    const uint64_t start = StartLatency();
+
+    const int r = EncoderWrite(E, id, block, bytes_written);
+
+    if (start && r == 0)
+    {
+        RecordLatency(WH256_OP_ENCODER_WRITE, reinterpret_cast<CodecState*>(E)->UsingWirehair, start);
+    }
+
+    return r;
+}
+
+wh256_state wh256_decoder_init(wh256_state reuse_E, int bytes, int block_bytes)
+{
+    // If input is invalid:
+    if (bytes < 1)
+    {
+        return nullptr;
+    }
+
+    return wh256_decoder_init64(reuse_E, (uint64_t)bytes, block_bytes);
+}
+
+// Shared by the decoder init functions
+static wh256_state DecoderInit(wh256_state reuse_E, uint64_t bytes, int block_bytes, bool zero_copy_input, void* message_out)
+{
+    // If input is invalid:
+    if (bytes < 1 || block_bytes < 1)
+    {
+        return nullptr;
+    }
+
+    // If block count is out of range:
+    const int N = WH256BlockCount(bytes, block_bytes);
+    if (N < 1)
+    {
         return nullptr;
     }
 
@@ -295,26 +953,28 @@ wh256_state wh256_decoder_init(wh256_state reuse_E, int bytes, int block_bytes)
     {
         codec = new CodecState;
     }
+    else
+    {
+        codec->ReleasePipeline();
+    }
 
     // Use CM256 up to a number of input blocks
-    int N = (bytes + block_bytes - 1) / block_bytes;
     codec->UsingWirehair = (N >= WIREHAIR_THRESHOLD_N);
 
     if (codec->UsingWirehair)
     {
-        if (!codec->WirehairCodec)
-        {
-            codec->WirehairCodec = new wirehair::Codec;
-        }
+        codec->SelectWirehair(N);
 
         // Allocate memory for decoding
-        wirehair::Result r = codec->WirehairCodec->InitializeDecoder(bytes, block_bytes);
+        wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->InitializeDecoder(bytes, block_bytes, zero_copy_input, message_out) :
+            codec->WirehairCodec->InitializeDecoder(bytes, block_bytes, zero_copy_input, message_out);
 
+        // If the heap or arena ran out, or the message is too large:
         if (r != wirehair::R_WIN)
         {
-            assert(false);
-            delete codec;
-            codec = nullptr;
+            FreeCodecState(codec);
+            return nullptr;
         }
     }
     else
@@ -326,179 +986,354 @@ wh256_state wh256_decoder_init(wh256_state reuse_E, int bytes, int block_bytes)
         codec->EncoderParams.OriginalCount = N;
         codec->EncoderParams.RecoveryCount = 256 - N; // Provide for as many unique recovery blocks as we can get
 
-        codec->LastBlockSize = bytes - N * block_bytes;
-        if (codec->LastBlockSize <= 0)
+        assert(!codec->BlockWorkspace); // Should have been cleared by ResetCM256()
+        uint8_t* workspace = codec->BlockWorkspace = codec->AllocateBlocks((uint64_t)N * block_bytes);
+        if (!workspace)
         {
-            codec->LastBlockSize = block_bytes;
+            FreeCodecState(codec);
+            return nullptr;
         }
-
-        assert(!codec->BlockWorkspace); // Should have been cleared by ResetCM256()
-        uint8_t* workspace = codec->BlockWorkspace = new uint8_t[N * block_bytes];
         for (int i = 0; i < N; ++i, workspace += block_bytes)
         {
             codec->Blocks[i].Data = workspace;
         }
     }
 
+    codec->OutputMessage = reinterpret_cast<uint8_t*>(message_out);
+    codec->ZeroCopyInput = zero_copy_input;
+    codec->LastBlockSize = (int)(bytes - (uint64_t)(N - 1) * block_bytes);
+    codec->BlockCallback = nullptr;
+    codec->BlockCallbackContext = nullptr;
+
     return codec;
 }
 
-int wh256_decoder_read(wh256_state E, unsigned int id, const void *block)
+wh256_state wh256_decoder_init64(wh256_state reuse_E, uint64_t bytes, int block_bytes)
+{
+    return DecoderInit(reuse_E, bytes, block_bytes, false, nullptr);
+}
+
+wh256_state wh256_decoder_init_zero_copy(wh256_state reuse_E, uint64_t bytes, int block_bytes)
+{
+    return DecoderInit(reuse_E, bytes, block_bytes, true, nullptr);
+}
+
+wh256_state wh256_decoder_init_output(wh256_state reuse_E, void* message, uint64_t bytes, int block_bytes)
 {
     // If input is invalid:
-    if (!E || !block)
+    if (!message)
     {
-        return -1;
+        return nullptr;
     }
 
-    CodecState* codec = reinterpret_cast<CodecState*>(E);
+    return DecoderInit(reuse_E, bytes, block_bytes, false, message);
+}
 
-    if (codec->UsingWirehair)
+// Hand an original block to the callback as it arrives
+static void DeliverReceivedBlock(CodecState* codec, unsigned int id, const void* block)
+{
+    const unsigned int N = (unsigned int)wh256_count(codec);
+
+    if (id < N)
     {
-        if (wirehair::R_WIN == codec->WirehairCodec->DecodeFeed(id, block))
+        int bytes = codec->BlockBytes();
+        if (id == N - 1)
         {
-            return 0;
+            bytes = codec->LastBlockSize;
         }
 
-        return -2;
+        codec->BlockCallback(codec->BlockCallbackContext, id, block, bytes);
     }
+}
 
-    id = WH256IndexToCM256Index(codec->EncoderParams, id);
+// Returns the number of blocks Wirehair needs before solving.  The caller must own the codec
+static inline uint32_t WirehairRowsNeeded(CodecState* codec)
+{
+    return codec->UsingLargeWirehair ?
+        codec->LargeWirehairCodec->PeelRowsNeeded() :
+        codec->WirehairCodec->PeelRowsNeeded();
+}
 
-    codec->Blocks[codec->BlocksReceived].Index = id;
+/*
+    Wirehair marks only the first N stored blocks as received, so only those
+    are handed to the callback as they arrive.  Original blocks that come in
+    after them, including any read while a pipelined solver runs, are not
+    marked and are reconstructed with the lost blocks once decoding completes.
+    This way each id is delivered exactly once, and a pipelined decoder only
+    calls back from the reading thread before the solver starts and from the
+    worker after it.
+*/
 
-    uint8_t* dest = reinterpret_cast<uint8_t*>(codec->Blocks[codec->BlocksReceived].Data);
+// Reconstruct and hand each lost original block to the callback after Wirehair decoding completes
+static void DeliverWirehairLostBlocks(CodecState* codec)
+{
+    const int block_bytes = codec->BlockBytes();
+    const int N = wh256_count(codec);
 
-    if (id == codec->EncoderParams.OriginalCount - 1)
-    {
-        // Copy partial last block and pad with zeroes
-        memcpy(dest, block, codec->LastBlockSize);
-        memset(dest + codec->LastBlockSize, 0, codec->EncoderParams.BlockBytes - codec->LastBlockSize);
-    }
-    else
-    {
-        memcpy(dest, block, codec->EncoderParams.BlockBytes);
-    }
+    const uint8_t* received = codec->UsingLargeWirehair ?
+        codec->LargeWirehairCodec->MarkReceivedRows() :
+        codec->WirehairCodec->MarkReceivedRows();
 
-    if (++codec->BlocksReceived == codec->EncoderParams.OriginalCount)
+    for (int i = 0; i < N; ++i)
     {
-        if (0 == cm256_decode(codec->EncoderParams, codec->Blocks))
+        if (received[i])
         {
-            return 0;
+            continue;
+        }
+
+        // Reconstruct at the final offset if decoding into the message
+        uint8_t* block = codec->OutputMessage ? codec->OutputMessage + (size_t)block_bytes * i : codec->CallbackBlock;
+
+        if (codec->UsingLargeWirehair)
+        {
+            codec->LargeWirehairCodec->ReconstructBlock(i, block);
         }
         else
         {
-            // Perhaps invalid input; dump it all and start over
-            assert(false);
-            codec->BlocksReceived = 0;
+            codec->WirehairCodec->ReconstructBlock((uint16_t)i, block);
         }
-    }
 
-    return -3;
+        codec->BlockCallback(codec->BlockCallbackContext, i, block, (i == N - 1) ? codec->LastBlockSize : block_bytes);
+    }
 }
 
-int wh256_decoder_reconstruct(wh256_state E, void *message)
+int wh256_decoder_set_callback(wh256_state E, wh256_block_callback callback, void* context)
 {
     // If input is invalid:
-    if (!E || !message)
+    if (!E)
     {
         return -1;
     }
 
     CodecState* codec = reinterpret_cast<CodecState*>(E);
 
-    if (codec->UsingWirehair)
+    // Wait for the solver to finish with the codec
+    codec->WaitPipeline();
+
+    // Wirehair reconstructs lost blocks into a separate block unless decoding into the message
+    if (callback && codec->UsingWirehair && !codec->OutputMessage)
     {
-        if (wirehair::R_WIN == codec->WirehairCodec->ReconstructOutput(message))
+        // Caller-provided memory has no room for it
+        if (codec->Arena)
         {
-            return 0;
+            return -2;
         }
 
-        return -2; // Decoding hasn't completed yet
+        delete[] codec->CallbackBlock;
+        codec->CallbackBlock = new uint8_t[codec->BlockBytes()];
     }
 
-    if (codec->BlocksReceived < codec->EncoderParams.OriginalCount)
+    codec->BlockCallback = callback;
+    codec->BlockCallbackContext = context;
+
+    return 0;
+}
+
+// Solve the matrix on a worker, then feed it the extra blocks queued meanwhile
+static void RunPipelinedSolve(void* context)
+{
+    CodecState* codec = reinterpret_cast<CodecState*>(context);
+    DecodePipeline* pipeline = codec->Pipeline;
+
+    wirehair::Result r = wirehair::R_MORE_BLOCKS;
+
+    if (!pipeline->Solved)
     {
-        return -3; // Decoding hasn't completed yet
-    }
+        pipeline->Solved = true;
 
-    uint8_t* blockOut = reinterpret_cast<uint8_t*>(message);
-    int copySizeBytes = codec->EncoderParams.BlockBytes;
+        // Solver runs are timed here rather than in the wh256_decoder_read() that queued them
+        const uint64_t start = StartLatency();
 
-    // For each original block to copy:
-    for (int i = 0; i < codec->EncoderParams.OriginalCount; ++i, blockOut += codec->EncoderParams.BlockBytes)
+        r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->DecodeSolve() :
+            codec->WirehairCodec->DecodeSolve();
+
+        if (start)
+        {
+            RecordLatency(WH256_OP_DECODER_SOLVE, true, start);
+        }
+    }
+
+    // While the solver wants more blocks:
+    while (r == wirehair::R_MORE_BLOCKS)
     {
-        // Block indices after cm256 decoding completes should be in order
-        int index = codec->Blocks[i].Index;
-        if (index != i)
+        PendingBlock block;
         {
-            assert(false);
-            return -4; // Software bug?
+            std::lock_guard<std::mutex> locker(pipeline->Lock);
+
+            // If none have arrived yet, the next wh256_decoder_read() resumes
+            if (pipeline->Pending.empty())
+            {
+                pipeline->Running = false;
+                pipeline->Idle.notify_all();
+                return;
+            }
+
+            block = std::move(pipeline->Pending.front());
+            pipeline->Pending.pop_front();
         }
 
-        // The last block can be smaller than the rest
-        if (index == codec->EncoderParams.OriginalCount - 1)
+        const uint64_t start = StartLatency();
+
+        r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->DecodeResume(block.Id, block.Data) :
+            codec->WirehairCodec->DecodeResume(block.Id, block.Data);
+
+        if (start)
         {
-            copySizeBytes = codec->LastBlockSize;
+            RecordLatency(WH256_OP_DECODER_SOLVE, true, start);
         }
+    }
 
-        const void* src = codec->Blocks[i].Data;
-        memcpy(blockOut, src, copySizeBytes);
+    if (r == wirehair::R_WIN && codec->BlockCallback)
+    {
+        DeliverWirehairLostBlocks(codec);
     }
 
-    return 0;
+    {
+        std::lock_guard<std::mutex> locker(pipeline->Lock);
+        pipeline->State = (r == wirehair::R_WIN) ? PIPELINE_DONE : PIPELINE_FAILED;
+        pipeline->Pending.clear();
+    }
+
+    if (pipeline->Callback)
+    {
+        pipeline->Callback(pipeline->CallbackContext, codec, (r == wirehair::R_WIN) ? 0 : -2);
+    }
+
+    // Notify under the lock since the pipeline may be freed as soon as it is released
+    std::lock_guard<std::mutex> locker(pipeline->Lock);
+    pipeline->Running = false;
+    pipeline->Idle.notify_all();
 }
 
-int wh256_decoder_reconstruct_block(wh256_state E, unsigned int id, void *blockOut)
+// Peel on the calling thread and hand the solver off to the worker pool
+static int PipelinedRead(CodecState* codec, unsigned int id, const void* block)
 {
-    // If input is invalid:
-    if (!E || !blockOut)
+    DecodePipeline* pipeline = codec->Pipeline;
+
+    std::unique_lock<std::mutex> locker(pipeline->Lock);
+
+    switch (pipeline->State)
     {
-        return -1;
-    }
+    case PIPELINE_DONE:
+        return 0;
 
-    CodecState* codec = reinterpret_cast<CodecState*>(E);
+    case PIPELINE_FAILED:
+        return -2;
 
-    if (codec->UsingWirehair)
+    case PIPELINE_SOLVING:
+    {
+        // Queue the block for the solver, which may have given the codec back
+        PendingBlock pending;
+        pending.Id = id;
+        if (codec->ZeroCopyInput)
+        {
+            pending.Data = block;
+        }
+        else
+        {
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(block);
+            pending.Copy.assign(data, data + codec->BlockBytes());
+            pending.Data = pending.Copy.data();
+        }
+        pipeline->Pending.push_back(std::move(pending));
+
+        if (pipeline->Running)
+        {
+            return -2;
+        }
+        pipeline->Running = true;
+        break;
+    }
+
+    default:
     {
-        if (wirehair::R_WIN == codec->WirehairCodec->ReconstructBlock(id, blockOut))
+        // Only the calling thread uses the codec while peeling
+        locker.unlock();
+
+        const uint32_t rows_needed = WirehairRowsNeeded(codec);
+
+        const wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->DecodePeel(id, block) :
+            codec->WirehairCodec->DecodePeel(id, block);
+
+        // Hand back original blocks that were stored for peeling
+        if (codec->BlockCallback && WirehairRowsNeeded(codec) < rows_needed)
         {
+            DeliverReceivedBlock(codec, id, block);
+        }
+
+        if (r == wirehair::R_WIN)
+        {
+            locker.lock();
+            pipeline->State = PIPELINE_DONE;
+            locker.unlock();
+
+            if (pipeline->Callback)
+            {
+                pipeline->Callback(pipeline->CallbackContext, codec, 0);
+            }
             return 0;
         }
 
-        return -2;
+        const bool peel_complete = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->PeelComplete() :
+            codec->WirehairCodec->PeelComplete();
+
+        if (r != wirehair::R_MORE_BLOCKS || !peel_complete)
+        {
+            return -2;
+        }
+
+        locker.lock();
+        pipeline->State = PIPELINE_SOLVING;
+        pipeline->Running = true;
+        break;
+    }
     }
 
-    // Verify that the cm256 decoder has finished
-    if (codec->BlocksReceived < codec->EncoderParams.OriginalCount)
+    locker.unlock();
+
+    GetWorkerPool().Submit(RunPipelinedSolve, codec);
+
+    return -2;
+}
+
+int wh256_decoder_pipeline(wh256_state E, wh256_decode_callback callback, void* context)
+{
+    // If input is invalid:
+    if (!E)
     {
-        return -3; // Called before enough data arrived
+        return -1;
     }
 
-    // Validate input is specifying original data and not recovery data
-    if (id >= (unsigned int)codec->EncoderParams.OriginalCount)
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    // Caller-provided memory has no room for the pipeline
+    if (codec->Arena)
     {
-        return -4;
+        return -2;
     }
 
-    // Block indices after cm256 decoding completes should be in order
-    const int index = codec->Blocks[id].Index;
-    if (index != id)
+    // Must be called before the solver starts
+    if (codec->Pipeline && codec->Pipeline->State != PIPELINE_PEELING)
     {
-        assert(false);
-        return -5; // Software bug?
+        return -2;
     }
 
-    // The last block may be smaller than the rest
-    int copyBytes = codec->EncoderParams.BlockBytes;
-    if (index == codec->EncoderParams.OriginalCount - 1)
-        copyBytes = codec->LastBlockSize;
+    if (!codec->Pipeline)
+    {
+        codec->Pipeline = new DecodePipeline;
+    }
+
+    codec->Pipeline->Callback = callback;
+    codec->Pipeline->CallbackContext = context;
 
-    memcpy(blockOut, codec->Blocks[index].Data, copyBytes);
     return 0;
 }
 
-int wh256_decoder_becomes_encoder(wh256_state E)
+int wh256_decoder_wait(wh256_state E)
 {
     // If input is invalid:
     if (!E)
@@ -508,20 +1343,825 @@ int wh256_decoder_becomes_encoder(wh256_state E)
 
     CodecState* codec = reinterpret_cast<CodecState*>(E);
 
-    if (codec->UsingWirehair)
+    if (!codec->Pipeline)
     {
-        wirehair::Result r = codec->WirehairCodec->InitializeEncoderFromDecoder();
-        return (r == wirehair::Result::R_WIN) ? 0 : -2;
+        return -1;
     }
 
-    // CM256 decoder is already initializing the Blocks[] array to what we need
-    // for the encoder.
-    return 0;
+    codec->Pipeline->WaitIdle();
+
+    std::lock_guard<std::mutex> locker(codec->Pipeline->Lock);
+    return (codec->Pipeline->State == PIPELINE_DONE) ? 0 : -2;
 }
 
-void wh256_free(wh256_state E)
+static int DecoderRead(wh256_state E, unsigned int id, const void *block)
 {
+    // If input is invalid:
+    if (!E || !block)
+    {
+        return -1;
+    }
+
     CodecState* codec = reinterpret_cast<CodecState*>(E);
 
-    delete codec;
+    if (codec->UsingWirehair)
+    {
+        if (codec->Pipeline)
+        {
+            return PipelinedRead(codec, id, block);
+        }
+
+        const uint32_t rows_needed = WirehairRowsNeeded(codec);
+
+        const wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->DecodeFeed(id, block) :
+            codec->WirehairCodec->DecodeFeed(id, block);
+
+        // Hand back original blocks that were stored for peeling
+        if (codec->BlockCallback && WirehairRowsNeeded(codec) < rows_needed)
+        {
+            DeliverReceivedBlock(codec, id, block);
+        }
+
+        if (r == wirehair::R_WIN)
+        {
+            if (codec->BlockCallback)
+            {
+                DeliverWirehairLostBlocks(codec);
+            }
+            return 0;
+        }
+
+        return -2;
+    }
+
+    id = WH256IndexToCM256Index(codec->EncoderParams, id);
+
+    const int block_bytes = codec->EncoderParams.BlockBytes;
+    const int N = codec->EncoderParams.OriginalCount;
+
+    // Hand back original blocks as they arrive
+    if (codec->BlockCallback)
+    {
+        DeliverReceivedBlock(codec, id, block);
+    }
+
+    codec->Blocks[codec->BlocksReceived].Index = id;
+
+    // If received blocks may be stored outside the workspace,
+    if (codec->OutputMessage || codec->ZeroCopyInput)
+    {
+        // Full original blocks are only read by cm256_decode() so they can be referenced
+        // in place or land at their final offset, while the rest use the workspace
+        uint8_t* data = codec->BlockWorkspace + (size_t)block_bytes * codec->BlocksReceived;
+        if ((int)id < N && (id != N - 1 || codec->LastBlockSize == block_bytes))
+        {
+            data = codec->OutputMessage ? codec->OutputMessage + (size_t)block_bytes * id : (uint8_t*)block;
+        }
+        codec->Blocks[codec->BlocksReceived].Data = data;
+    }
+
+    uint8_t* dest = reinterpret_cast<uint8_t*>(codec->Blocks[codec->BlocksReceived].Data);
+
+    if (dest == block)
+    {
+        // Referenced in place
+    }
+    else if (id == N - 1)
+    {
+        // Copy partial last block and pad with zeroes
+        memcpy(dest, block, codec->LastBlockSize);
+        memset(dest + codec->LastBlockSize, 0, block_bytes - codec->LastBlockSize);
+    }
+    else
+    {
+        memcpy(dest, block, block_bytes);
+    }
+
+    if (++codec->BlocksReceived == N)
+    {
+        // Remember which original blocks were received before they are reordered
+        uint8_t received[256];
+        if (codec->BlockCallback)
+        {
+            memset(received, 0, N);
+            for (int i = 0; i < N; ++i)
+            {
+                if (codec->Blocks[i].Index < N)
+                {
+                    received[codec->Blocks[i].Index] = 1;
+                }
+            }
+        }
+
+        if (0 == cm256_decode(codec->EncoderParams, codec->Blocks))
+        {
+            // Hand back the recovered original blocks
+            if (codec->BlockCallback)
+            {
+                for (int i = 0; i < N; ++i)
+                {
+                    if (!received[i])
+                    {
+                        const int bytes = (i == N - 1) ? codec->LastBlockSize : block_bytes;
+                        codec->BlockCallback(codec->BlockCallbackContext, i, codec->Blocks[i].Data, bytes);
+                    }
+                }
+            }
+
+            // CM256 is fast enough to solve on the calling thread
+            if (codec->Pipeline)
+            {
+                {
+                    std::lock_guard<std::mutex> locker(codec->Pipeline->Lock);
+                    codec->Pipeline->State = PIPELINE_DONE;
+                }
+                if (codec->Pipeline->Callback)
+                {
+                    codec->Pipeline->Callback(codec->Pipeline->CallbackContext, codec, 0);
+                }
+            }
+            return 0;
+        }
+        else
+        {
+            // Perhaps invalid input; dump it all and start over
+            assert(false);
+            codec->BlocksReceived = 0;
+        }
+    }
+
+    return -3;
+}
+
+// Returns the number of blocks Wirehair needs before solving, or 0 if it is not collecting them
+static uint32_t PeelRowsNeeded(CodecState* codec);
+
+int wh256_decoder_read(wh256_state E, unsigned int id, const void *block)
+{
+    const uint64_t start = StartLatency();
+
+    if (!start || !E || !block)
+    {
+        return DecoderRead(E, id, block);
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    // The Nth block and any after it run the solver, except that a pipelined
+    // Wirehair decoder only peels or queues blocks and the worker times the solver
+    const bool solving = codec->UsingWirehair ?
+        !codec->Pipeline && PeelRowsNeeded(codec) <= 1 :
+        codec->BlocksReceived + 1 >= codec->EncoderParams.OriginalCount;
+
+    const int r = DecoderRead(E, id, block);
+
+    RecordLatency(solving ? WH256_OP_DECODER_SOLVE : WH256_OP_DECODER_READ, codec->UsingWirehair, start);
+
+    return r;
+}
+
+static uint32_t PeelRowsNeeded(CodecState* codec)
+{
+    if (!codec->UsingWirehair)
+    {
+        return 0;
+    }
+
+    // The codec belongs to the solver once the pipeline leaves the peeling state
+    if (codec->Pipeline)
+    {
+        std::lock_guard<std::mutex> locker(codec->Pipeline->Lock);
+        if (codec->Pipeline->State != PIPELINE_PEELING)
+        {
+            return 0;
+        }
+    }
+
+    return WirehairRowsNeeded(codec);
+}
+
+int wh256_decoder_read_batch(wh256_state E, const unsigned int* ids, const void* const* blocks, int count)
+{
+    // If input is invalid:
+    if (!E || !ids || !blocks || count < 0)
+    {
+        return -1;
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    int result = -2;
+
+    // For each window of the batch:
+    for (int offset = 0; offset < count; offset += CAT_PEEL_ORDER_MAX)
+    {
+        const int window = (count - offset < CAT_PEEL_ORDER_MAX) ? count - offset : CAT_PEEL_ORDER_MAX;
+
+        // If this window completes the peeling matrix, choose the rows that peel well for it.
+        // Otherwise every row in the window is used regardless of order
+        int order[CAT_PEEL_ORDER_MAX];
+        const uint32_t needed = PeelRowsNeeded(codec);
+        if (needed > 0 && needed < (uint32_t)window)
+        {
+            if (codec->UsingLargeWirehair)
+            {
+                codec->LargeWirehairCodec->OrderForPeeling(ids + offset, window, order);
+            }
+            else
+            {
+                codec->WirehairCodec->OrderForPeeling(ids + offset, window, order);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < window; ++i)
+            {
+                order[i] = i;
+            }
+        }
+
+        for (int i = 0; i < window; ++i)
+        {
+            const int j = offset + order[i];
+
+            result = wh256_decoder_read(E, ids[j], blocks[j]);
+
+            // Stop at the first block that completes decoding
+            if (result == 0)
+            {
+                return 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int DecoderReconstruct(wh256_state E, void *message)
+{
+    // If input is invalid:
+    if (!E || !message)
+    {
+        return -1;
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    // Wait for the solver to finish with the codec
+    codec->WaitPipeline();
+
+    if (codec->UsingWirehair)
+    {
+        const wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->ReconstructOutput(message) :
+            codec->WirehairCodec->ReconstructOutput(message);
+
+        if (r == wirehair::R_WIN)
+        {
+            return 0;
+        }
+
+        return -2; // Decoding hasn't completed yet
+    }
+
+    if (codec->BlocksReceived < codec->EncoderParams.OriginalCount)
+    {
+        return -3; // Decoding hasn't completed yet
+    }
+
+    uint8_t* blockOut = reinterpret_cast<uint8_t*>(message);
+    int copySizeBytes = codec->EncoderParams.BlockBytes;
+
+    // For each original block to copy:
+    for (int i = 0; i < codec->EncoderParams.OriginalCount; ++i, blockOut += codec->EncoderParams.BlockBytes)
+    {
+        // Block indices after cm256 decoding completes should be in order
+        int index = codec->Blocks[i].Index;
+        if (index != i)
+        {
+            assert(false);
+            return -4; // Software bug?
+        }
+
+        // The last block can be smaller than the rest
+        if (index == codec->EncoderParams.OriginalCount - 1)
+        {
+            copySizeBytes = codec->LastBlockSize;
+        }
+
+        // If not already decoded in place,
+        const void* src = codec->Blocks[i].Data;
+        if (src != blockOut)
+        {
+            memcpy(blockOut, src, copySizeBytes);
+        }
+    }
+
+    return 0;
+}
+
+int wh256_decoder_reconstruct(wh256_state E, void *message)
+{
+    const uint64_t start = StartLatency();
+
+    const int r = DecoderReconstruct(E, message);
+
+    if (start && r == 0)
+    {
+        RecordLatency(WH256_OP_RECONSTRUCT, reinterpret_cast<CodecState*>(E)->UsingWirehair, start);
+    }
+
+    return r;
+}
+
+int wh256_decoder_reconstruct_block(wh256_state E, unsigned int id, void *blockOut)
+{
+    // If input is invalid:
+    if (!E || !blockOut)
+    {
+        return -1;
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    // Wait for the solver to finish with the codec
+    codec->WaitPipeline();
+
+    if (codec->UsingWirehair)
+    {
+        const wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->ReconstructBlock(id, blockOut) :
+            codec->WirehairCodec->ReconstructBlock((uint16_t)id, blockOut);
+
+        if (r == wirehair::R_WIN)
+        {
+            return 0;
+        }
+
+        return -2;
+    }
+
+    // Verify that the cm256 decoder has finished
+    if (codec->BlocksReceived < codec->EncoderParams.OriginalCount)
+    {
+        return -3; // Called before enough data arrived
+    }
+
+    // Validate input is specifying original data and not recovery data
+    if (id >= (unsigned int)codec->EncoderParams.OriginalCount)
+    {
+        return -4;
+    }
+
+    // Block indices after cm256 decoding completes should be in order
+    const int index = codec->Blocks[id].Index;
+    if (index != id)
+    {
+        assert(false);
+        return -5; // Software bug?
+    }
+
+    // The last block may be smaller than the rest
+    int copyBytes = codec->EncoderParams.BlockBytes;
+    if (index == codec->EncoderParams.OriginalCount - 1)
+        copyBytes = codec->LastBlockSize;
+
+    memcpy(blockOut, codec->Blocks[index].Data, copyBytes);
+    return 0;
+}
+
+const void* wh256_decoder_reconstruct_inplace(wh256_state E)
+{
+    // If input is invalid:
+    if (!E)
+    {
+        return nullptr;
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    // Wait for the solver to finish with the codec
+    codec->WaitPipeline();
+
+    if (codec->UsingWirehair)
+    {
+        const void* message = nullptr;
+        const wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->ReconstructOutputInPlace(&message) :
+            codec->WirehairCodec->ReconstructOutputInPlace(&message);
+
+        if (r == wirehair::R_WIN)
+        {
+            return message;
+        }
+
+        return nullptr;
+    }
+
+    if (codec->BlocksReceived < codec->EncoderParams.OriginalCount)
+    {
+        return nullptr; // Decoding hasn't completed yet
+    }
+
+    // If the blocks are not all in the workspace,
+    if (codec->OutputMessage || codec->ZeroCopyInput)
+    {
+        return nullptr;
+    }
+
+    const int block_bytes = codec->EncoderParams.BlockBytes;
+    const int N = codec->EncoderParams.OriginalCount;
+    uint8_t* workspace = codec->BlockWorkspace;
+
+    // Blocks are in order after cm256 decoding, but their data may not be:
+    // Swap each block's data into its slot in the workspace
+    for (int i = 0; i < N; ++i)
+    {
+        uint8_t* slot = workspace + (size_t)block_bytes * i;
+        uint8_t* data = reinterpret_cast<uint8_t*>(codec->Blocks[i].Data);
+        if (data == slot)
+        {
+            continue;
+        }
+
+        // Find the block whose data currently occupies this slot
+        for (int j = i + 1; j < N; ++j)
+        {
+            if (codec->Blocks[j].Data == slot)
+            {
+                codec->Blocks[j].Data = data;
+                break;
+            }
+        }
+
+        gf256_memswap(slot, data, block_bytes);
+        codec->Blocks[i].Data = slot;
+    }
+
+    return workspace;
+}
+
+int wh256_decoder_becomes_encoder(wh256_state E)
+{
+    // If input is invalid:
+    if (!E)
+    {
+        return -1;
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    // Wait for the solver to finish with the codec
+    codec->WaitPipeline();
+
+    if (codec->UsingWirehair)
+    {
+        wirehair::Result r = codec->UsingLargeWirehair ?
+            codec->LargeWirehairCodec->InitializeEncoderFromDecoder() :
+            codec->WirehairCodec->InitializeEncoderFromDecoder();
+        return (r == wirehair::Result::R_WIN) ? 0 : -2;
+    }
+
+    // CM256 decoder is already initializing the Blocks[] array to what we need
+    // for the encoder.
+    return 0;
+}
+
+void wh256_free(wh256_state E)
+{
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    FreeCodecState(codec);
+}
+
+
+//-----------------------------------------------------------------------------
+// Statistics
+
+static_assert(WH256_PHASE_COUNT == wirehair::PHASE_COUNT, "Phase lists must match");
+
+void wh256_enable_stats(int enabled)
+{
+    m_stats_enabled = (enabled != 0);
+}
+
+int wh256_get_stats(wh256_state E, wh256_stats* stats)
+{
+    // If input is invalid:
+    if (!E || !stats)
+    {
+        return -1;
+    }
+
+    CodecState* codec = reinterpret_cast<CodecState*>(E);
+
+    if (!codec->UsingWirehair)
+    {
+        return -2;
+    }
+
+    codec->WaitPipeline();
+
+    const wirehair::CodecStats& codec_stats = codec->UsingLargeWirehair ?
+        codec->LargeWirehairCodec->Stats() :
+        codec->WirehairCodec->Stats();
+
+    stats->block_count = codec->UsingLargeWirehair ?
+        codec->LargeWirehairCodec->BlockCount() :
+        codec->WirehairCodec->BlockCount();
+    stats->peeled_columns = codec_stats.PeeledColumns;
+    stats->deferred_columns = codec_stats.DeferredColumns;
+    stats->dense_rows = codec_stats.DenseRows;
+    stats->ge_rows = codec_stats.GERows;
+    stats->ge_columns = codec_stats.GEColumns;
+    stats->heavy_pivots = codec_stats.HeavyPivots;
+    stats->extra_rows = codec_stats.ExtraRows;
+
+    for (int i = 0; i < WH256_PHASE_COUNT; ++i)
+    {
+        stats->row_ops[i] = codec_stats.RowOps[i];
+        stats->heavy_ops[i] = codec_stats.HeavyOps[i];
+        stats->cycles[i] = codec_stats.Cycles[i];
+    }
+
+    return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Latency Histogram API
+
+static const char* const OP_NAMES[WH256_OP_COUNT] = {
+    "encoder_init", "encoder_write", "decoder_read", "decoder_solve", "reconstruct"
+};
+
+static const char* const BACKEND_NAMES[WH256_BACKEND_COUNT] = {
+    "cm256", "wirehair"
+};
+
+void wh256_enable_histograms(int enabled)
+{
+    m_histograms_enabled = (enabled != 0);
+}
+
+void wh256_reset_histograms(void)
+{
+    for (int slot = 0; slot < HISTOGRAM_SLOTS; ++slot)
+    {
+        m_histogram_slots[slot].Reset();
+    }
+}
+
+// Sum the histograms of every slot for one call and back end
+static void MergeHistograms(int op, int backend, std::vector<uint64_t>& counts, uint64_t& max)
+{
+    counts.assign(HISTOGRAM_BUCKETS, 0);
+    max = 0;
+
+    for (int slot = 0; slot < HISTOGRAM_SLOTS; ++slot)
+    {
+        const HistogramSlot& histograms = m_histogram_slots[slot];
+
+        for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+        {
+            counts[bucket] += histograms.Counts[op][backend][bucket].load(std::memory_order_relaxed);
+        }
+
+        const uint64_t slot_max = histograms.Max[op][backend].load(std::memory_order_relaxed);
+        if (slot_max > max)
+        {
+            max = slot_max;
+        }
+    }
+}
+
+// Fill in the percentiles from merged counts, reporting the middle of each bucket
+static void SummarizeHistogram(const std::vector<uint64_t>& counts, uint64_t max, wh256_latency* latency)
+{
+    uint64_t total = 0;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+    {
+        total += counts[bucket];
+    }
+
+    latency->count = total;
+    latency->max = max;
+
+    const double fractions[3] = { 0.5, 0.99, 0.999 };
+    uint64_t* outputs[3] = { &latency->p50, &latency->p99, &latency->p999 };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        *outputs[i] = 0;
+        if (total == 0)
+        {
+            continue;
+        }
+
+        // Nearest rank
+        uint64_t rank = (uint64_t)(fractions[i] * (double)total + 0.5);
+        if (rank < 1)
+        {
+            rank = 1;
+        }
+
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+        {
+            seen += counts[bucket];
+            if (seen >= rank)
+            {
+                const uint64_t low = HistogramBucketLow(bucket);
+                uint64_t value = low + (HistogramBucketHigh(bucket) - 1 - low) / 2;
+                if (value > max)
+                {
+                    value = max;
+                }
+                *outputs[i] = value;
+                break;
+            }
+        }
+    }
+}
+
+int wh256_get_latency(int op, int backend, wh256_latency* latency)
+{
+    // If input is invalid:
+    if (op < 0 || op >= WH256_OP_COUNT || backend < 0 || backend >= WH256_BACKEND_COUNT || !latency)
+    {
+        return -1;
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t max;
+    MergeHistograms(op, backend, counts, max);
+
+    SummarizeHistogram(counts, max, latency);
+
+    return 0;
+}
+
+int wh256_dump_histograms(const char* path)
+{
+    if (!path)
+    {
+        return -1;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        return -2;
+    }
+
+    fprintf(file, "# wh256 API latency in timestamp counter ticks\n");
+    fprintf(file, "# summary: call backend count p50 p99 p999 max\n");
+    fprintf(file, "# bucket: call backend low high count\n");
+
+    std::vector<uint64_t> counts;
+    for (int op = 0; op < WH256_OP_COUNT; ++op)
+    {
+        for (int backend = 0; backend < WH256_BACKEND_COUNT; ++backend)
+        {
+            uint64_t max;
+            MergeHistograms(op, backend, counts, max);
+
+            wh256_latency latency;
+            SummarizeHistogram(counts, max, &latency);
+            if (latency.count == 0)
+            {
+                continue;
+            }
+
+            fprintf(file, "summary %s %s %llu %llu %llu %llu %llu\n", OP_NAMES[op], BACKEND_NAMES[backend],
+                (unsigned long long)latency.count, (unsigned long long)latency.p50, (unsigned long long)latency.p99,
+                (unsigned long long)latency.p999, (unsigned long long)latency.max);
+
+            for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket)
+            {
+                if (counts[bucket] > 0)
+                {
+                    fprintf(file, "bucket %s %s %llu %llu %llu\n", OP_NAMES[op], BACKEND_NAMES[backend],
+                        (unsigned long long)HistogramBucketLow(bucket), (unsigned long long)HistogramBucketHigh(bucket),
+                        (unsigned long long)counts[bucket]);
+                }
+            }
+        }
+    }
+
+    const bool failed = (ferror(file) != 0);
+    if (fclose(file) != 0 || failed)
+    {
+        return -3;
+    }
+
+    return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Caller-Provided Memory
+
+uint64_t wh256_workspace_size(int N, int block_bytes, int mode)
+{
+    // If input is invalid:
+    if (N < 1 || N > CAT_WIREHAIR_MAX_N_32 || block_bytes < 1 ||
+        (mode != WH256_MODE_ENCODER && mode != WH256_MODE_DECODER &&
+         mode != (WH256_MODE_DECODER | WH256_MODE_ZERO_COPY)))
+    {
+        return 0;
+    }
+
+    const bool decoder = (mode & WH256_MODE_DECODER) != 0;
+    const bool zero_copy_input = (mode & WH256_MODE_ZERO_COPY) != 0;
+    uint64_t size = ArenaRoundUp(sizeof(CodecState));
+
+    if (N < WIREHAIR_THRESHOLD_N)
+    {
+        // Decoder stores all blocks, encoder may need to pad the last one
+        size += ArenaRoundUp(decoder ? (uint64_t)N * block_bytes : (uint64_t)block_bytes);
+    }
+    else
+    {
+        const uint64_t bytes = (uint64_t)N * block_bytes;
+        uint64_t codec_size;
+
+        if (N > CAT_WIREHAIR_MAX_N)
+        {
+            codec_size = wirehair::LargeCodec::MemorySize(bytes, block_bytes, decoder, zero_copy_input);
+            size += ArenaRoundUp(sizeof(wirehair::LargeCodec));
+        }
+        else
+        {
+            codec_size = wirehair::Codec::MemorySize(bytes, block_bytes, decoder, zero_copy_input);
+            size += ArenaRoundUp(sizeof(wirehair::Codec));
+        }
+
+        if (codec_size == 0)
+        {
+            return 0;
+        }
+
+        size += codec_size;
+    }
+
+    return size;
+}
+
+// Construct a state object at the start of a caller-provided arena
+static CodecState* InitializeArena(void* arena, uint64_t arena_bytes, uint64_t bytes, int block_bytes, int mode)
+{
+    // If arena is invalid:
+    if (!arena || ((uintptr_t)arena & (WH256_ARENA_ALIGN - 1)) != 0 || bytes < 1 || block_bytes < 1)
+    {
+        return nullptr;
+    }
+
+    // If arena is too small:
+    const uint64_t needed = wh256_workspace_size(WH256BlockCount(bytes, block_bytes), block_bytes, mode);
+    if (needed == 0 || arena_bytes < needed)
+    {
+        return nullptr;
+    }
+
+    CodecState* codec = new (arena) CodecState;
+    codec->Arena = reinterpret_cast<uint8_t*>(arena);
+    codec->ArenaBytes = arena_bytes;
+
+    return codec;
+}
+
+wh256_state wh256_encoder_init_arena(void* arena, uint64_t arena_bytes, const void* message, uint64_t bytes, int block_bytes)
+{
+    // If input is invalid:
+    if (!m_init || !message)
+    {
+        return nullptr;
+    }
+
+    CodecState* codec = InitializeArena(arena, arena_bytes, bytes, block_bytes, WH256_MODE_ENCODER);
+    if (!codec)
+    {
+        return nullptr;
+    }
+
+    return wh256_encoder_init64(codec, message, bytes, block_bytes);
+}
+
+wh256_state wh256_decoder_init_arena(void* arena, uint64_t arena_bytes, uint64_t bytes, int block_bytes, int mode)
+{
+    // If mode is not a decoder mode:
+    if ((mode & WH256_MODE_DECODER) == 0)
+    {
+        return nullptr;
+    }
+
+    CodecState* codec = InitializeArena(arena, arena_bytes, bytes, block_bytes, mode);
+    if (!codec)
+    {
+        return nullptr;
+    }
+
+    return DecoderInit(codec, bytes, block_bytes, (mode & WH256_MODE_ZERO_COPY) != 0, nullptr);
 }
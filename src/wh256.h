@@ -29,6 +29,8 @@
 #ifndef WH256_H
 #define WH256_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -57,21 +59,52 @@ typedef void* wh256_state;
  *
  * If N is too high or too low this function will fail.  In particular if N = 1, then
  * using this type of error correction does not make sense: Sending the same message
- * over and over is just as good.  And if N > 64000 then some internal variables will
- * start to overflow, so too many blocks is unsupported.  The most efficient values
- * for N are around 1000.
+ * over and over is just as good.  Above N = 64000 a codec with 32-bit internal
+ * indices is used, which supports up to N = 1048576 at the cost of more memory and
+ * a slower solver.  The most efficient values for N are around 1000.
  *
  * Pass 0 for reuse_E if you do not want to reuse a state object.
  *
  * Preconditions:
  *     N >= 1
- *     N <= 64000
+ *     N <= 1048576
  *
  * Returns a valid state object on success.
  * Returns nullptr(0) on failure.
  */
 extern wh256_state wh256_encoder_init(wh256_state reuse_E, const void* message, int bytes, int block_bytes);
 
+/*
+ * Same as wh256_encoder_init() but accepts messages larger than 2 GB.
+ *
+ * Messages that do not fit in the address space of the platform are rejected.
+ */
+extern wh256_state wh256_encoder_init64(wh256_state reuse_E, const void* message, uint64_t bytes, int block_bytes);
+
+/*
+ * One buffer of a message that is split across several buffers
+ */
+typedef struct wh256_segment_t
+{
+    const void* data;
+    uint64_t bytes;
+} wh256_segment;
+
+/*
+ * Same as wh256_encoder_init64() but the message is the concatenation of
+ * count segments, for messages assembled from several buffers.
+ *
+ * Blocks that lie within one segment are read where they are.  Only blocks
+ * that straddle a segment boundary are copied.  Empty segments are allowed.
+ *
+ * Preconditions:
+ *    Segments stay valid and unmodified while the state is used as an encoder
+ *
+ * Returns a valid state object on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_state wh256_encoder_initv(wh256_state reuse_E, const wh256_segment* segments, int count, int block_bytes);
+
 /*
  * Returns the number of blocks N in the encoded message.
  */
@@ -102,6 +135,52 @@ extern int wh256_encoder_write(wh256_state E, unsigned int id, void* block, int*
  */
 extern wh256_state wh256_decoder_init(wh256_state reuse_E, int bytes, int block_bytes);
 
+/*
+ * Same as wh256_decoder_init() but accepts messages larger than 2 GB.
+ */
+extern wh256_state wh256_decoder_init64(wh256_state reuse_E, uint64_t bytes, int block_bytes);
+
+/*
+ * Same as wh256_decoder_init64() but wh256_decoder_read() keeps a pointer to
+ * each block instead of copying it into the decoder.
+ *
+ * This saves a copy of every received block, which matters for large messages
+ * where the blocks already sit in a receive buffer.  Only the final block is
+ * copied if it is shorter than block_bytes.  Messages with N < 28 blocks are
+ * decoded in place by CM256, so only their recovery blocks are copied.
+ *
+ * Preconditions:
+ *    Every block passed to wh256_decoder_read() stays valid and unmodified until
+ *    wh256_decoder_reconstruct() or wh256_decoder_reconstruct_block() returns,
+ *    or until the state is reinitialized or freed
+ *
+ * Returns a valid state object on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_state wh256_decoder_init_zero_copy(wh256_state reuse_E, uint64_t bytes, int block_bytes);
+
+/*
+ * Same as wh256_decoder_init64() but decodes directly into the message buffer.
+ *
+ * wh256_decoder_read() copies each received original block to its final
+ * offset in the message instead of into the decoder, and
+ * wh256_decoder_reconstruct() called with the same message pointer only fills
+ * in the blocks that were lost.  This saves copying the whole message at the
+ * end of decoding.
+ *
+ * Preconditions:
+ *    Message contains enough space to store the entire decoded message (bytes)
+ *    Message stays valid and is not modified by the caller until
+ *    wh256_decoder_reconstruct() returns, or while the state is used as an
+ *    encoder after wh256_decoder_becomes_encoder()
+ *
+ * wh256_decoder_reconstruct_inplace() is not supported for this decoder.
+ *
+ * Returns a valid state object on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_state wh256_decoder_init_output(wh256_state reuse_E, void* message, uint64_t bytes, int block_bytes);
+
 /*
  * Feed a block to the decoder.
  *
@@ -116,6 +195,95 @@ extern wh256_state wh256_decoder_init(wh256_state reuse_E, int bytes, int block_
  */
 extern int wh256_decoder_read(wh256_state E, unsigned int id, const void* block);
 
+/*
+ * Feed a batch of count blocks to the decoder, where blocks[i] has the given ids[i].
+ *
+ * The decoder may feed the batch in any order.  While the first N blocks are
+ * being collected it feeds the blocks that are cheapest to peel first, so that
+ * a batch that crosses that point leaves less work for the matrix solver.
+ * Blocks after the one that completes decoding are not read.
+ *
+ * Preconditions:
+ *    Same as wh256_decoder_read() for each block
+ *
+ * Returns 0 when decoding is complete.
+ * Returns non-zero on invalid input or not enough data received yet.
+ */
+extern int wh256_decoder_read_batch(wh256_state E, const unsigned int* ids, const void* const* blocks, int count);
+
+/*
+ * Called with each original block of the message as soon as it is known.
+ *
+ * id is the block index < N, and bytes is block_bytes except for the final
+ * block.  The block pointer is only valid during the call.
+ */
+typedef void (*wh256_block_callback)(void* context, unsigned int id, const void* block, int bytes);
+
+/*
+ * Hand back original blocks from wh256_decoder_read() as they are decoded,
+ * so the caller can consume the message progressively.
+ *
+ * Original blocks among the first N blocks received are passed to the
+ * callback immediately.  The lost blocks, and any original blocks received
+ * after the first N, are passed to it after reading completes, from inside
+ * the wh256_decoder_read() call that returns 0.  Each id < N is delivered
+ * exactly once, so wh256_decoder_reconstruct() is not needed afterwards.
+ *
+ * Call after initializing the decoder, which clears the callback.  Pass
+ * nullptr(0) to clear it.
+ *
+ * Preconditions:
+ *    Must not call wh256_decoder_read() again after it returns 0
+ *
+ * Returns 0 on success.
+ * Returns non-zero on invalid input, or for an arena decoder of N >= 28 blocks
+ * without an output message, which has no room to reconstruct lost blocks.
+ */
+extern int wh256_decoder_set_callback(wh256_state E, wh256_block_callback callback, void* context);
+
+/*
+ * Called when a pipelined decoder finishes, with result 0 on success or
+ * non-zero if decoding failed.
+ */
+typedef void (*wh256_decode_callback)(void* context, wh256_state E, int result);
+
+/*
+ * Run the matrix solver for this decoder on a shared pool of worker threads.
+ *
+ * wh256_decoder_read() then only peels each block on the calling thread, and
+ * returns without blocking when the Nth block would start the solver.  Blocks
+ * that arrive while the solver runs are queued for it in case it needs more.
+ * The callback runs on the worker thread when decoding completes, and
+ * wh256_decoder_read() returns 0 from then on.  Progressive output callbacks
+ * for blocks read before the solver starts run from wh256_decoder_read(), and
+ * the rest run on the worker thread after solving, so they never overlap.
+ *
+ * Messages with N < 28 blocks are solved on the calling thread as usual and
+ * the callback runs from wh256_decoder_read().
+ *
+ * Call after initializing the decoder and before the Nth block is read.
+ * Reinitializing the state stops pipelining.
+ *
+ * Preconditions:
+ *    wh256_decoder_read() is only called from one thread at a time
+ *
+ * Returns 0 on success.
+ * Returns non-zero on invalid input or for an arena decoder.
+ */
+extern int wh256_decoder_pipeline(wh256_state E, wh256_decode_callback callback, void* context);
+
+/*
+ * Block until the worker pool is done with a pipelined decoder.
+ *
+ * The reconstruct functions, wh256_decoder_becomes_encoder() and
+ * wh256_free() wait for it as well.
+ *
+ * Returns 0 if decoding is complete.
+ * Returns non-zero if more blocks are needed, decoding failed, or the state
+ * is not pipelined.
+ */
+extern int wh256_decoder_wait(wh256_state E);
+
 /*
  * Reconstruct the message after reading is complete.
  *
@@ -139,6 +307,23 @@ extern int wh256_decoder_reconstruct(wh256_state E, void* message);
  */
 extern int wh256_decoder_reconstruct_block(wh256_state E, unsigned int id, void* block);
 
+/*
+ * Reconstruct the message inside the decoder after reading is complete.
+ *
+ * The blocks that the decoder already stores are reused for the output, so
+ * no separate message buffer is needed.  Received original blocks are moved
+ * into place and only the missing blocks are regenerated.  Later calls to
+ * wh256_decoder_reconstruct() copy out the same result.
+ *
+ * Not supported with wh256_decoder_init_zero_copy() or
+ * wh256_decoder_init_output(), since the decoder does not own those blocks.
+ *
+ * Returns a pointer to the decoded message (bytes long) on success, which
+ * stays valid until the state is reinitialized or freed.
+ * Returns nullptr(0) on failure.
+ */
+extern const void* wh256_decoder_reconstruct_inplace(wh256_state E);
+
 /*
 * Convert a decoder wh256_state into an encoder wh256_state after decoding
 * completes.  This enables you to receive a message and then retransmit it
@@ -153,10 +338,180 @@ extern int wh256_decoder_becomes_encoder(wh256_state E);
 
 /*
  * Free memory associated with a state object
+ *
+ * For a state created in a caller-provided arena this releases nothing,
+ * and the arena may be reused or released by the caller afterwards.
  */
 extern void wh256_free(wh256_state E);
 
 
+/*
+ * Statistics
+ *
+ * The Wirehair solver can report what it did for the last message, which
+ * helps explain decode latency outliers in production.  Collection is off
+ * by default and costs only a timestamp per phase when on.
+ */
+
+/* Solver phases reported by wh256_get_stats() */
+#define WH256_PHASE_PEEL 0             /* Greedy peeling once N blocks are stored */
+#define WH256_PHASE_COMPRESS 1         /* Building the Gaussian elimination (GE) matrix */
+#define WH256_PHASE_TRIANGLE 2         /* Gaussian elimination, including resumed attempts */
+#define WH256_PHASE_COLUMN_VALUES 3    /* Initializing GE column values */
+#define WH256_PHASE_DENSE_VALUES 4     /* Multiplying peeled values into dense rows */
+#define WH256_PHASE_SUBDIAGONAL 5      /* Eliminating below the GE diagonal */
+#define WH256_PHASE_BACK_SUBSTITUTE 6  /* Eliminating above the GE diagonal */
+#define WH256_PHASE_SUBSTITUTE 7       /* Regenerating the peeled columns */
+#define WH256_PHASE_COUNT 8
+
+typedef struct wh256_stats_t {
+    unsigned int block_count;       /* Number of blocks N in the message */
+    unsigned int peeled_columns;    /* Columns solved by peeling */
+    unsigned int deferred_columns;  /* Columns deferred to Gaussian elimination */
+    unsigned int dense_rows;        /* Dense rows added to the GE matrix */
+    unsigned int ge_rows;           /* Rows in the GE matrix, including heavy and extra rows */
+    unsigned int ge_columns;        /* Columns in the GE matrix */
+    unsigned int heavy_pivots;      /* GE columns solved by heavy rows */
+    unsigned int extra_rows;        /* Blocks consumed after the first N to finish solving */
+
+    uint64_t row_ops[WH256_PHASE_COUNT];    /* Block-sized XOR operations */
+    uint64_t heavy_ops[WH256_PHASE_COUNT];  /* Block-sized GF(256) multiply-add operations */
+    uint64_t cycles[WH256_PHASE_COUNT];     /* Elapsed timestamp counter ticks */
+} wh256_stats;
+
+/*
+ * Turn statistics collection on or off for states initialized afterwards.
+ */
+extern void wh256_enable_stats(int enabled);
+
+/*
+ * Get statistics for the message most recently encoded or decoded by a
+ * state.  Everything is zero if collection was off when it was initialized.
+ * Waits for a pipelined solve to finish first.
+ *
+ * Returns 0 on success.
+ * Returns -1 on invalid input.
+ * Returns -2 if the message used CM256, which has no solver phases.
+ */
+extern int wh256_get_stats(wh256_state E, wh256_stats* stats);
+
+
+/*
+ * Latency histograms
+ *
+ * The API calls below can each be timed with the timestamp counter and
+ * counted in a histogram for the back end that handled them, to find the
+ * p99 and p999 latency of a running service.  Threads record into a fixed
+ * set of histograms with atomic adds and no locks, so memory use does not
+ * grow with thread churn and collection can stay compiled in.  It is off
+ * by default and costs one flag load per call when off.
+ *
+ * Buckets are log-linear, so reported values are within 1/32 of the
+ * recorded ones.
+ */
+
+/* Calls timed by the latency histograms */
+#define WH256_OP_ENCODER_INIT 0     /* wh256_encoder_init*() */
+#define WH256_OP_ENCODER_WRITE 1    /* wh256_encoder_write() */
+#define WH256_OP_DECODER_READ 2     /* wh256_decoder_read() before the Nth block, or any read when pipelined */
+#define WH256_OP_DECODER_SOLVE 3    /* wh256_decoder_read() from the Nth block on, which runs the solver,
+                                       or each solver run on the worker when pipelined */
+#define WH256_OP_RECONSTRUCT 4      /* wh256_decoder_reconstruct() */
+#define WH256_OP_COUNT 5
+
+/* Back ends: CM256 handles N < 28 and Wirehair the rest */
+#define WH256_BACKEND_CM256 0
+#define WH256_BACKEND_WIREHAIR 1
+#define WH256_BACKEND_COUNT 2
+
+typedef struct wh256_latency_t {
+    uint64_t count; /* Calls recorded */
+    uint64_t p50;   /* Percentiles in timestamp counter ticks */
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;   /* Slowest call, exact */
+} wh256_latency;
+
+/*
+ * Turn latency recording on or off.  Takes effect for calls that start
+ * afterwards on any thread.
+ */
+extern void wh256_enable_histograms(int enabled);
+
+/*
+ * Clear the recorded latencies.  Calls that finish while this runs may
+ * still be counted.
+ */
+extern void wh256_reset_histograms(void);
+
+/*
+ * Get the latency percentiles for one call and back end, with op one of
+ * the WH256_OP_* values and backend one of the WH256_BACKEND_* values.
+ * Everything is zero if no calls were recorded.
+ *
+ * Returns 0 on success.
+ * Returns -1 on invalid input.
+ */
+extern int wh256_get_latency(int op, int backend, wh256_latency* latency);
+
+/*
+ * Write a text file with a summary line for each call and back end that
+ * has recorded calls, followed by the count in each non-empty bucket:
+ *
+ *     summary <call> <backend> <count> <p50> <p99> <p999> <max>
+ *     bucket <call> <backend> <low> <high> <count>
+ *
+ * where each bucket counts values from low up to but not including high.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if the file cannot be written.
+ */
+extern int wh256_dump_histograms(const char* path);
+
+
+/*
+ * Caller-provided memory
+ *
+ * The *_init_arena() functions place all of the codec state in a single
+ * arena owned by the caller, so that no memory is allocated during init or
+ * any later call.  The arena must be 64-byte aligned and at least as large
+ * as wh256_workspace_size() reports for the same N, block_bytes and mode.
+ * It must stay valid until the state is no longer used.
+ */
+
+#define WH256_MODE_ENCODER 0
+#define WH256_MODE_DECODER 1
+#define WH256_MODE_ZERO_COPY 2 /* Combine with WH256_MODE_DECODER, see wh256_decoder_init_zero_copy() */
+
+/*
+ * Returns the number of arena bytes needed for a message of N blocks.
+ *
+ * mode is WH256_MODE_ENCODER, WH256_MODE_DECODER or
+ * (WH256_MODE_DECODER | WH256_MODE_ZERO_COPY).
+ *
+ * Returns 0 on invalid input.
+ */
+extern uint64_t wh256_workspace_size(int N, int block_bytes, int mode);
+
+/*
+ * Same as wh256_encoder_init64() but uses the arena for all memory.
+ *
+ * Returns a valid state object located at the start of the arena on success.
+ * Returns nullptr(0) on failure, including when the arena is too small or misaligned.
+ */
+extern wh256_state wh256_encoder_init_arena(void* arena, uint64_t arena_bytes, const void* message, uint64_t bytes, int block_bytes);
+
+/*
+ * Same as wh256_decoder_init64() but uses the arena for all memory.
+ *
+ * mode is WH256_MODE_DECODER or (WH256_MODE_DECODER | WH256_MODE_ZERO_COPY).
+ *
+ * Returns a valid state object located at the start of the arena on success.
+ * Returns nullptr(0) on failure, including when the arena is too small or misaligned.
+ */
+extern wh256_state wh256_decoder_init_arena(void* arena, uint64_t arena_bytes, uint64_t bytes, int block_bytes, int mode);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,648 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wh256_stream.h"
+
+#include "worker_pool.hpp"
+
+#include <string.h>
+
+// Largest generation supported by a single codec
+static const int STREAM_MAX_GENERATION_BLOCKS = 1048576;
+
+
+//-----------------------------------------------------------------------------
+// Stream State
+
+struct StreamState;
+
+// Block received for a generation that the decoder task has not read yet
+struct StreamBlock
+{
+    unsigned int Id;
+    std::vector<uint8_t> Data;
+};
+
+// One generation of the stream, with its own codec
+struct StreamGeneration
+{
+    StreamState* Stream;
+    unsigned int Index;
+
+    // Message data for this generation
+    uint8_t* Data;
+    uint64_t Bytes;
+
+    wh256_state Codec;
+
+    // A worker task is queued or running for this generation
+    bool Running;
+
+    // Released by the stream while the task was running, so the task frees it
+    bool Released;
+
+    // Encoder: codec is initialized and the next block id to send
+    bool Ready;
+    unsigned int NextId;
+
+    // Decoder: blocks waiting for the task and whether decoding completed
+    std::deque<StreamBlock> Pending;
+    bool Complete;
+
+    StreamGeneration()
+    {
+        Stream = nullptr;
+        Index = 0;
+        Data = nullptr;
+        Bytes = 0;
+        Codec = nullptr;
+        Running = false;
+        Released = false;
+        Ready = false;
+        NextId = 0;
+        Complete = false;
+    }
+    ~StreamGeneration()
+    {
+        wh256_free(Codec);
+        delete[] Data;
+    }
+};
+
+struct StreamState
+{
+    bool Decoder;
+
+    uint64_t Bytes;
+    int BlockBytes;
+    int GenerationBlocks;
+    unsigned int GenerationCount;
+
+    // Generation g is held in Slots[g % Window]
+    std::vector<StreamGeneration*> Slots;
+    unsigned int Window;
+
+    // Protects everything below and the generations
+    std::mutex Lock;
+    std::condition_variable Idle;
+
+    // Number of generation tasks queued or running
+    int ActiveTasks;
+
+    // Encoder: a generation could not be encoded, so the stream cannot finish
+    bool Failed;
+
+    // Encoder: generation being filled by push, and the next one to write
+    StreamGeneration* Filling;
+    uint64_t FilledBytes;
+    unsigned int NextPush;
+    unsigned int NextWrite;
+
+    // Decoder: next generation to deliver
+    unsigned int Head;
+    bool Delivering;
+    wh256_stream_callback Callback;
+    void* CallbackContext;
+
+    // Decoder: block buffers returned by the tasks, reused for later packets
+    std::vector<std::vector<uint8_t>> SpareBlocks;
+
+    StreamState()
+    {
+        Decoder = false;
+        Bytes = 0;
+        BlockBytes = 0;
+        GenerationBlocks = 0;
+        GenerationCount = 0;
+        Window = 0;
+        ActiveTasks = 0;
+        Failed = false;
+        Filling = nullptr;
+        FilledBytes = 0;
+        NextPush = 0;
+        NextWrite = 0;
+        Head = 0;
+        Delivering = false;
+        Callback = nullptr;
+        CallbackContext = nullptr;
+    }
+    ~StreamState()
+    {
+        // Wait for the worker tasks that use the generations
+        {
+            std::unique_lock<std::mutex> locker(Lock);
+            Idle.wait(locker, [this]() { return ActiveTasks == 0; });
+        }
+
+        for (StreamGeneration* generation : Slots)
+        {
+            delete generation;
+        }
+    }
+
+    // Create generation g in its slot, or return nullptr if the slot is taken
+    StreamGeneration* CreateGeneration(unsigned int g)
+    {
+        StreamGeneration*& slot = Slots[g % Window];
+        if (slot)
+        {
+            return nullptr;
+        }
+
+        const uint64_t generation_bytes = (uint64_t)GenerationBlocks * BlockBytes;
+        const uint64_t offset = (uint64_t)g * generation_bytes;
+
+        StreamGeneration* generation = new StreamGeneration;
+        generation->Stream = this;
+        generation->Index = g;
+        generation->Bytes = (Bytes - offset < generation_bytes) ? Bytes - offset : generation_bytes;
+        generation->Data = new uint8_t[(size_t)generation->Bytes];
+
+        slot = generation;
+        return generation;
+    }
+
+    // Remove a generation from its slot, freeing it unless its task is still running
+    // Precondition: Lock is held
+    void ReleaseGeneration(StreamGeneration* generation)
+    {
+        Slots[generation->Index % Window] = nullptr;
+
+        if (generation->Running)
+        {
+            generation->Released = true;
+        }
+        else
+        {
+            delete generation;
+        }
+    }
+
+    // Return the buffers of blocks that will not be decoded for reuse
+    // Precondition: Lock is held
+    void RecycleBlocks(std::deque<StreamBlock>& blocks)
+    {
+        for (StreamBlock& block : blocks)
+        {
+            SpareBlocks.push_back(std::move(block.Data));
+        }
+        blocks.clear();
+    }
+
+    // Mark the task for a generation finished, freeing it if it was released meanwhile
+    // Precondition: Lock is held
+    void FinishTask(StreamGeneration* generation)
+    {
+        generation->Running = false;
+        if (generation->Released)
+        {
+            delete generation;
+        }
+
+        --ActiveTasks;
+        Idle.notify_all();
+    }
+};
+
+// Validate parameters and set up the common state
+static StreamState* CreateStream(uint64_t bytes, int block_bytes, int generation_blocks, int window)
+{
+    // If input is invalid:
+    if (bytes < 1 || block_bytes < 1 || generation_blocks < 1 || window < 1)
+    {
+        return nullptr;
+    }
+
+    // If a generation is too large for one codec:
+    if (generation_blocks > STREAM_MAX_GENERATION_BLOCKS)
+    {
+        return nullptr;
+    }
+
+    // If there are too many generations to number:
+    const uint64_t generation_bytes = (uint64_t)generation_blocks * block_bytes;
+    const uint64_t generation_count = (bytes + generation_bytes - 1) / generation_bytes;
+    if (generation_count > 0xffffffffULL)
+    {
+        return nullptr;
+    }
+
+    StreamState* stream = new StreamState;
+    stream->Bytes = bytes;
+    stream->BlockBytes = block_bytes;
+    stream->GenerationBlocks = generation_blocks;
+    stream->GenerationCount = (unsigned int)generation_count;
+    stream->Window = (unsigned int)window;
+    stream->Slots.resize(window, nullptr);
+
+    return stream;
+}
+
+int wh256_stream_count(wh256_stream S)
+{
+    // If input is invalid:
+    if (!S)
+    {
+        return 0;
+    }
+
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+
+    return (int)stream->GenerationCount;
+}
+
+void wh256_stream_free(wh256_stream S)
+{
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+
+    delete stream;
+}
+
+
+//-----------------------------------------------------------------------------
+// Stream Encoder
+
+// Initialize the encoder for a generation on the worker pool
+static void RunGenerationEncoder(void* context)
+{
+    StreamGeneration* generation = reinterpret_cast<StreamGeneration*>(context);
+    StreamState* stream = generation->Stream;
+
+    wh256_state codec = wh256_encoder_init64(0, generation->Data, generation->Bytes, stream->BlockBytes);
+
+    std::lock_guard<std::mutex> locker(stream->Lock);
+
+    generation->Codec = codec;
+    generation->Ready = (codec != nullptr);
+
+    // If the codec could not be created, report it and free the slot unless retired already:
+    if (!codec)
+    {
+        stream->Failed = true;
+        if (!generation->Released)
+        {
+            stream->ReleaseGeneration(generation);
+        }
+    }
+
+    stream->FinishTask(generation);
+}
+
+wh256_stream wh256_stream_encoder_create(uint64_t bytes, int block_bytes, int generation_blocks, int window)
+{
+    StreamState* stream = CreateStream(bytes, block_bytes, generation_blocks, window);
+
+    return stream;
+}
+
+uint64_t wh256_stream_encoder_push(wh256_stream S, const void* data, uint64_t bytes)
+{
+    // If input is invalid:
+    if (!S || !data)
+    {
+        return 0;
+    }
+
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+
+    uint64_t accepted = 0;
+
+    while (accepted < bytes)
+    {
+        StreamGeneration* generation;
+        {
+            std::lock_guard<std::mutex> locker(stream->Lock);
+
+            // If a generation failed to encode:
+            if (stream->Failed)
+            {
+                break;
+            }
+
+            // If starting the next generation:
+            if (!stream->Filling)
+            {
+                // If the stream is complete or the window is full:
+                if (stream->NextPush >= stream->GenerationCount ||
+                    !(stream->Filling = stream->CreateGeneration(stream->NextPush)))
+                {
+                    break;
+                }
+                stream->FilledBytes = 0;
+            }
+
+            generation = stream->Filling;
+        }
+
+        // Only push fills the generation until its task is submitted
+        uint64_t copy_bytes = generation->Bytes - stream->FilledBytes;
+        if (copy_bytes > bytes - accepted)
+        {
+            copy_bytes = bytes - accepted;
+        }
+
+        memcpy(generation->Data + stream->FilledBytes, src + accepted, (size_t)copy_bytes);
+        stream->FilledBytes += copy_bytes;
+        accepted += copy_bytes;
+
+        // If the generation is complete, encode it in the background:
+        if (stream->FilledBytes == generation->Bytes)
+        {
+            {
+                std::lock_guard<std::mutex> locker(stream->Lock);
+                stream->Filling = nullptr;
+                ++stream->NextPush;
+
+                generation->Running = true;
+                ++stream->ActiveTasks;
+            }
+
+            GetWorkerPool().Submit(RunGenerationEncoder, generation);
+        }
+    }
+
+    return accepted;
+}
+
+int wh256_stream_encoder_write(wh256_stream S, unsigned int* generation_out, unsigned int* id_out, void* block, int* bytes_written)
+{
+    // If input is invalid:
+    if (!S || !generation_out || !id_out || !block || !bytes_written)
+    {
+        return -1;
+    }
+
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+
+    *bytes_written = 0;
+
+    std::lock_guard<std::mutex> locker(stream->Lock);
+
+    // If a generation failed to encode:
+    if (stream->Failed)
+    {
+        return -1;
+    }
+
+    // Find the next generation in turn that is ready to send
+    for (unsigned int i = 0; i < stream->Window; ++i)
+    {
+        const unsigned int slot_i = (stream->NextWrite + i) % stream->Window;
+        StreamGeneration* generation = stream->Slots[slot_i];
+
+        if (!generation || !generation->Ready)
+        {
+            continue;
+        }
+
+        stream->NextWrite = slot_i + 1;
+
+        const unsigned int id = generation->NextId++;
+        if (wh256_encoder_write(generation->Codec, id, block, bytes_written))
+        {
+            return -1;
+        }
+
+        *generation_out = generation->Index;
+        *id_out = id;
+        return 0;
+    }
+
+    return -2;
+}
+
+int wh256_stream_encoder_retire(wh256_stream S, unsigned int g)
+{
+    // If input is invalid:
+    if (!S)
+    {
+        return -1;
+    }
+
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+
+    std::lock_guard<std::mutex> locker(stream->Lock);
+
+    // If the generation is not held or is still being pushed:
+    StreamGeneration* generation = stream->Slots[g % stream->Window];
+    if (!generation || generation->Index != g || generation == stream->Filling)
+    {
+        return -1;
+    }
+
+    stream->ReleaseGeneration(generation);
+
+    return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Stream Decoder
+
+// Hand completed generations to the callback in order
+static void DeliverGenerations(StreamState* stream)
+{
+    std::unique_lock<std::mutex> locker(stream->Lock);
+
+    // If another thread is delivering, it will see this generation
+    if (stream->Delivering)
+    {
+        return;
+    }
+    stream->Delivering = true;
+
+    for (;;)
+    {
+        StreamGeneration* generation = stream->Slots[stream->Head % stream->Window];
+        if (stream->Head >= stream->GenerationCount || !generation || !generation->Complete)
+        {
+            break;
+        }
+
+        locker.unlock();
+
+        if (stream->Callback)
+        {
+            stream->Callback(stream->CallbackContext, generation->Index, generation->Data, generation->Bytes);
+        }
+
+        locker.lock();
+
+        ++stream->Head;
+        stream->ReleaseGeneration(generation);
+    }
+
+    stream->Delivering = false;
+}
+
+// Feed queued blocks to the decoder for a generation on the worker pool
+static void RunGenerationDecoder(void* context)
+{
+    StreamGeneration* generation = reinterpret_cast<StreamGeneration*>(context);
+    StreamState* stream = generation->Stream;
+
+    std::unique_lock<std::mutex> locker(stream->Lock);
+
+    while (!generation->Complete && !generation->Pending.empty())
+    {
+        StreamBlock block = std::move(generation->Pending.front());
+        generation->Pending.pop_front();
+
+        locker.unlock();
+
+        bool complete = false;
+        if (0 == wh256_decoder_read(generation->Codec, block.Id, block.Data.data()))
+        {
+            // Only the lost blocks are filled in since the rest were decoded in place
+            complete = (0 == wh256_decoder_reconstruct(generation->Codec, generation->Data));
+        }
+
+        locker.lock();
+
+        stream->SpareBlocks.push_back(std::move(block.Data));
+
+        if (complete)
+        {
+            generation->Complete = true;
+            stream->RecycleBlocks(generation->Pending);
+
+            locker.unlock();
+            DeliverGenerations(stream);
+            locker.lock();
+        }
+    }
+
+    stream->FinishTask(generation);
+}
+
+wh256_stream wh256_stream_decoder_create(uint64_t bytes, int block_bytes, int generation_blocks, int window,
+    wh256_stream_callback callback, void* context)
+{
+    StreamState* stream = CreateStream(bytes, block_bytes, generation_blocks, window);
+    if (!stream)
+    {
+        return nullptr;
+    }
+
+    stream->Decoder = true;
+    stream->Callback = callback;
+    stream->CallbackContext = context;
+
+    return stream;
+}
+
+int wh256_stream_decoder_read(wh256_stream S, unsigned int g, unsigned int id, const void* block)
+{
+    // If input is invalid:
+    if (!S || !block)
+    {
+        return -1;
+    }
+
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+
+    if (!stream->Decoder || g >= stream->GenerationCount)
+    {
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> locker(stream->Lock);
+
+    // If the generation was already delivered:
+    if (g < stream->Head)
+    {
+        return 0;
+    }
+
+    // If the generation is past the window:
+    if (g - stream->Head >= stream->Window)
+    {
+        return -2;
+    }
+
+    StreamGeneration* generation = stream->Slots[g % stream->Window];
+    if (!generation)
+    {
+        generation = stream->CreateGeneration(g);
+
+        // Decode each generation straight into its message data
+        generation->Codec = wh256_decoder_init_output(0, generation->Data, generation->Bytes, stream->BlockBytes);
+        if (!generation->Codec)
+        {
+            stream->ReleaseGeneration(generation);
+            return -1;
+        }
+    }
+
+    if (generation->Complete)
+    {
+        return 0;
+    }
+
+    // Copy the block into a spare buffer if one is available
+    StreamBlock pending;
+    pending.Id = id;
+    if (!stream->SpareBlocks.empty())
+    {
+        pending.Data = std::move(stream->SpareBlocks.back());
+        stream->SpareBlocks.pop_back();
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(block);
+    pending.Data.assign(data, data + stream->BlockBytes);
+    generation->Pending.push_back(std::move(pending));
+
+    // If no task is feeding this generation, start one:
+    if (!generation->Running)
+    {
+        generation->Running = true;
+        ++stream->ActiveTasks;
+
+        locker.unlock();
+
+        GetWorkerPool().Submit(RunGenerationDecoder, generation);
+    }
+
+    return 0;
+}
+
+int wh256_stream_decoder_wait(wh256_stream S)
+{
+    // If input is invalid:
+    if (!S)
+    {
+        return -1;
+    }
+
+    StreamState* stream = reinterpret_cast<StreamState*>(S);
+
+    std::unique_lock<std::mutex> locker(stream->Lock);
+    stream->Idle.wait(locker, [stream]() { return stream->ActiveTasks == 0; });
+
+    return (stream->Head >= stream->GenerationCount) ? 0 : -2;
+}
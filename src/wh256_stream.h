@@ -0,0 +1,159 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WH256_STREAM_H
+#define WH256_STREAM_H
+
+#include "wh256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Streaming
+ *
+ * Messages above 1048576 blocks, or larger than a comfortable working set,
+ * are split into generations of generation_blocks blocks each.  Each
+ * generation is an independent wh256 codec, and the generations in flight
+ * are encoded and decoded concurrently on the shared worker pool.
+ *
+ * Each packet is identified by a generation number and a block id within
+ * that generation.  Generation g is held in one of window slots, and it can
+ * only start once generation g - window has been released.  This bounds
+ * memory to about window * generation_blocks * block_bytes on each side.
+ *
+ * wh256_init() must be called first.
+ */
+
+typedef void* wh256_stream;
+
+/*
+ * Returns the number of generations in the stream.
+ */
+extern int wh256_stream_count(wh256_stream S);
+
+/*
+ * Free memory associated with a stream after its worker tasks finish.
+ */
+extern void wh256_stream_free(wh256_stream S);
+
+
+/*
+ * Create an encoder for a stream of the given total bytes.
+ *
+ * Returns a valid stream on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_stream wh256_stream_encoder_create(uint64_t bytes, int block_bytes, int generation_blocks, int window);
+
+/*
+ * Append the next bytes of the stream.
+ *
+ * Each generation is copied into the stream and starts encoding on the
+ * worker pool as soon as all of its data has been pushed.
+ *
+ * Returns the number of bytes accepted.  This is less than bytes when the
+ * window is full, and more can be pushed after retiring a generation.
+ * Returns 0 once a generation has failed to encode.
+ */
+extern uint64_t wh256_stream_encoder_push(wh256_stream S, const void* data, uint64_t bytes);
+
+/*
+ * Write the next packet of the stream.
+ *
+ * Generations that have finished encoding take turns, so that a burst of
+ * loss is spread across them.  Each generation sends its original blocks
+ * and then recovery blocks until it is retired.
+ *
+ * Preconditions:
+ *    Block pointer has block_bytes of space available to store data
+ *
+ * Returns 0 on success and sets generation, id and bytes_written.
+ * Returns -1 on invalid input or once a generation has failed to encode,
+ * for example if its codec could not be allocated.  The stream cannot
+ * complete after that and should be freed.
+ * Returns -2 if no generation has finished encoding yet.
+ */
+extern int wh256_stream_encoder_write(wh256_stream S, unsigned int* generation, unsigned int* id, void* block, int* bytes_written);
+
+/*
+ * Stop sending a generation, for example once the receiver has decoded it,
+ * which makes room in the window.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if the generation is not held.
+ */
+extern int wh256_stream_encoder_retire(wh256_stream S, unsigned int generation);
+
+
+/*
+ * Called with each decoded generation in order.  The data pointer is only
+ * valid during the call.  It runs on a worker thread and must not call back
+ * into the stream.
+ */
+typedef void (*wh256_stream_callback)(void* context, unsigned int generation, const void* data, uint64_t bytes);
+
+/*
+ * Create a decoder for a stream of the given total bytes, with the same
+ * parameters as the encoder.
+ *
+ * Returns a valid stream on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_stream wh256_stream_decoder_create(uint64_t bytes, int block_bytes, int generation_blocks, int window,
+    wh256_stream_callback callback, void* context);
+
+/*
+ * Feed a packet to the stream decoder.
+ *
+ * The block is copied and decoded on the worker pool, so this does not
+ * block on the matrix solver.  A generation is released after it is
+ * delivered, which moves the window forward.
+ *
+ * Returns 0 if the block was accepted or its generation is already decoded.
+ * Returns non-zero on invalid input or if the generation is past the window,
+ * in which case the block is dropped.
+ */
+extern int wh256_stream_decoder_read(wh256_stream S, unsigned int generation, unsigned int id, const void* block);
+
+/*
+ * Block until the worker pool is done with the blocks read so far.
+ *
+ * Returns 0 if every generation has been delivered.
+ * Returns non-zero if more blocks are needed.
+ */
+extern int wh256_stream_decoder_wait(wh256_stream S);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WH256_STREAM_H
@@ -0,0 +1,261 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wh256_trace.h"
+#include "trace.hpp"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+// Trace Hook
+
+#if defined(WH256_TRACING)
+
+std::atomic<wh256_trace_hook> TraceHook(nullptr);
+void* TraceHookContext = nullptr;
+
+#endif // WH256_TRACING
+
+void wh256_set_trace_hook(wh256_trace_hook hook, void* context)
+{
+#if defined(WH256_TRACING)
+    TraceHook.store(nullptr, std::memory_order_release);
+    TraceHookContext = context;
+    TraceHook.store(hook, std::memory_order_release);
+#else
+    (void)hook;
+    (void)context;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// Chrome Trace Sink
+
+struct TraceRecord
+{
+    const char* Name;
+    bool Begin;
+    unsigned int ThreadId;
+    int64_t Nanoseconds;
+};
+
+// Sampling state for one thread, kept in thread-local storage so that
+// events which are not sampled never touch shared state
+struct TraceThread
+{
+    // Sink generation this state belongs to, reset when it changes
+    unsigned int Generation;
+    unsigned int Id;
+
+    // Depth of nested events, and whether the current top-level event is recorded
+    int Depth;
+    bool Sampled;
+
+    // Top-level events seen, for sampling
+    unsigned int Count;
+};
+
+struct TraceSink
+{
+    // Protects the records
+    std::mutex Lock;
+
+    // Ring buffer of the most recent records
+    std::vector<TraceRecord> Records;
+    size_t Next;
+    size_t Count;
+    std::chrono::steady_clock::time_point Start;
+
+    // Incremented by each wh256_trace_start() so threads drop their old state
+    std::atomic<unsigned int> Generation;
+    std::atomic<unsigned int> NextThreadId;
+    std::atomic<int> SampleInterval;
+
+    TraceSink()
+        : Generation(0)
+        , NextThreadId(0)
+        , SampleInterval(1)
+    {
+        Next = 0;
+        Count = 0;
+    }
+};
+
+static TraceSink m_sink;
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+static __declspec(thread) TraceThread m_trace_thread;
+#else
+static thread_local TraceThread m_trace_thread;
+#endif
+
+static void OnSinkEvent(void* context, const char* name, int begin)
+{
+    TraceSink* sink = reinterpret_cast<TraceSink*>(context);
+
+    TraceThread& thread = m_trace_thread;
+
+    // If this thread has not seen an event since the sink was started:
+    const unsigned int generation = sink->Generation.load(std::memory_order_acquire);
+    if (thread.Generation != generation)
+    {
+        thread.Generation = generation;
+        thread.Id = sink->NextThreadId.fetch_add(1, std::memory_order_relaxed) + 1;
+        thread.Depth = 0;
+        thread.Sampled = false;
+        thread.Count = 0;
+    }
+
+    // Decide whether to record each top-level event with everything inside it
+    if (begin)
+    {
+        if (thread.Depth++ == 0)
+        {
+            const int interval = sink->SampleInterval.load(std::memory_order_relaxed);
+            thread.Sampled = (thread.Count++ % interval) == 0;
+        }
+    }
+    else if (thread.Depth > 0)
+    {
+        --thread.Depth;
+    }
+    else
+    {
+        // End for an event that began before the sink was started
+        return;
+    }
+
+    if (!thread.Sampled)
+    {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> locker(sink->Lock);
+
+    if (sink->Records.empty())
+    {
+        return;
+    }
+
+    TraceRecord& record = sink->Records[sink->Next];
+    record.Name = name;
+    record.Begin = (begin != 0);
+    record.ThreadId = thread.Id;
+    record.Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now - sink->Start).count();
+
+    sink->Next = (sink->Next + 1) % sink->Records.size();
+    if (sink->Count < sink->Records.size())
+    {
+        ++sink->Count;
+    }
+}
+
+int wh256_trace_start(int capacity, int sample_interval)
+{
+    // If input is invalid:
+    if (capacity < 1 || sample_interval < 1)
+    {
+        return -1;
+    }
+
+    wh256_set_trace_hook(nullptr, nullptr);
+
+    {
+        std::lock_guard<std::mutex> locker(m_sink.Lock);
+
+        m_sink.Records.assign(capacity, TraceRecord());
+        m_sink.Next = 0;
+        m_sink.Count = 0;
+        m_sink.Start = std::chrono::steady_clock::now();
+    }
+
+    m_sink.SampleInterval.store(sample_interval, std::memory_order_relaxed);
+    m_sink.NextThreadId.store(0, std::memory_order_relaxed);
+    m_sink.Generation.fetch_add(1, std::memory_order_release);
+
+    wh256_set_trace_hook(OnSinkEvent, &m_sink);
+    return 0;
+}
+
+void wh256_trace_stop(void)
+{
+#if defined(WH256_TRACING)
+    // Only remove the hook if it is the built-in sink
+    if (TraceHook.load(std::memory_order_acquire) == OnSinkEvent)
+    {
+        wh256_set_trace_hook(nullptr, nullptr);
+    }
+#endif
+}
+
+int wh256_trace_write(const char* path)
+{
+    if (!path)
+    {
+        return -1;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        return -2;
+    }
+
+    std::lock_guard<std::mutex> locker(m_sink.Lock);
+
+    // Oldest record first
+    const size_t size = m_sink.Records.size();
+    const size_t first = (m_sink.Next + size - m_sink.Count) % (size ? size : 1);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < m_sink.Count; ++i)
+    {
+        const TraceRecord& record = m_sink.Records[(first + i) % size];
+
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"wh256\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+            i ? ",\n" : "", record.Name, record.Begin ? 'B' : 'E', record.ThreadId, record.Nanoseconds / 1000.0);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    const bool failed = (ferror(file) != 0);
+    if (fclose(file) != 0 || failed)
+    {
+        return -3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WH256_TRACE_H
+#define WH256_TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Phase tracing
+ *
+ * The Wirehair solver and the CM256 decoder report the start and end of
+ * each phase to a trace hook, so a slow decode can be broken down without
+ * rebuilding with debug output.  Events nest: each top-level call such as
+ * "SolveMatrix" or "cm256_decode" contains the phases it runs.
+ *
+ * The hooks are compiled in when WH256_TRACING is defined in trace.hpp, and
+ * cost one atomic load per phase while no hook is installed.
+ */
+
+/*
+ * Called at the start (begin = 1) and end (begin = 0) of each phase on the
+ * thread running it.  The name is a string literal.
+ */
+typedef void (*wh256_trace_hook)(void* context, const char* name, int begin);
+
+/*
+ * Install a trace hook, or remove it with nullptr(0).
+ *
+ * This should not be changed while codec calls are running on other threads.
+ */
+extern void wh256_set_trace_hook(wh256_trace_hook hook, void* context);
+
+
+/*
+ * Built-in Chrome trace sink
+ *
+ * Records events into a ring buffer of the given number of events, keeping
+ * the most recent ones.  Only one in sample_interval top-level calls on each
+ * thread is recorded, so it can stay on in production with little overhead.
+ *
+ * Returns 0 on success.
+ * Returns non-zero on invalid input.
+ */
+extern int wh256_trace_start(int capacity, int sample_interval);
+
+/*
+ * Stop recording and remove the built-in sink hook.  Recorded events are
+ * kept until the next wh256_trace_start().
+ */
+extern void wh256_trace_stop(void);
+
+/*
+ * Write the recorded events as Chrome trace-event JSON, which can be loaded
+ * into chrome://tracing or Perfetto.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if the file cannot be written.
+ */
+extern int wh256_trace_write(const char* path);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WH256_TRACE_H
@@ -0,0 +1,575 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "wh256_window.h"
+#include "gf256.h"
+
+#include <string.h>
+
+// Largest window supported, which bounds the elimination work per packet
+static const int WINDOW_MAX = 1024;
+
+// Largest source packet, limited by the 2-byte length prefix
+static const int WINDOW_MAX_BYTES = 65535;
+
+// Bytes of length prefix at the front of each symbol
+static const int WINDOW_PREFIX_BYTES = 2;
+
+
+//-----------------------------------------------------------------------------
+// Window State
+
+// Equation over the source packets in the window, in reduced row echelon form
+struct WindowRow
+{
+    bool Used;
+
+    // Lowest source packet with a nonzero coefficient, which is always 1
+    uint32_t Pivot;
+
+    // Coefficient for packet seq is at Coeffs[seq % Window]
+    uint8_t* Coeffs;
+
+    // Right hand side of the equation
+    uint8_t* Symbol;
+};
+
+struct WindowState
+{
+    bool Decoder;
+
+    int Window;
+    int MaxBytes;
+    int SymbolBytes;
+
+    // Single allocation backing the buffers below
+    uint8_t* Memory;
+
+    // Encoder: next source packet to add, and the last window of them
+    uint32_t NextSeq;
+    uint32_t NextSeed;
+    uint8_t* Sources;
+
+    // Decoder: rows indexed by pivot % Window, plus a scratch row
+    WindowRow* Rows;
+    WindowRow Scratch;
+
+    // Decoder: whether a packet has arrived yet, the newest packet seen, and
+    // the next packet to deliver
+    bool Started;
+    uint32_t Newest;
+    uint32_t Head;
+
+    wh256_window_callback Callback;
+    void* CallbackContext;
+
+    WindowState()
+    {
+        Decoder = false;
+        Window = 0;
+        MaxBytes = 0;
+        SymbolBytes = 0;
+        Memory = nullptr;
+        NextSeq = 0;
+        NextSeed = 0;
+        Sources = nullptr;
+        Rows = nullptr;
+        Scratch.Used = false;
+        Scratch.Pivot = 0;
+        Scratch.Coeffs = nullptr;
+        Scratch.Symbol = nullptr;
+        Started = false;
+        Newest = 0;
+        Head = 0;
+        Callback = nullptr;
+        CallbackContext = nullptr;
+    }
+    ~WindowState()
+    {
+        delete[] Rows;
+        delete[] Memory;
+    }
+
+    // Oldest source packet that a repair can still cover
+    uint32_t Oldest() const
+    {
+        return (Newest >= (uint32_t)Window) ? Newest - Window + 1 : 0;
+    }
+
+    // Write a source packet as a symbol with its length prefix
+    void WriteSymbol(uint8_t* symbol, const void* data, int bytes)
+    {
+        symbol[0] = (uint8_t)bytes;
+        symbol[1] = (uint8_t)(bytes >> 8);
+        if (bytes > 0)
+        {
+            memcpy(symbol + WINDOW_PREFIX_BYTES, data, bytes);
+        }
+        memset(symbol + WINDOW_PREFIX_BYTES + bytes, 0, SymbolBytes - WINDOW_PREFIX_BYTES - bytes);
+    }
+};
+
+// Coefficient for source packet seq in the repair with the given seed, never zero
+static uint8_t WindowCoefficient(uint32_t seed, uint32_t seq)
+{
+    uint32_t x = seed * 0x9E3779B1 + seq * 0x85EBCA77;
+    x ^= x >> 15;
+    x *= 0x2C1B3C6D;
+    x ^= x >> 12;
+    x *= 0x297A2D39;
+    x ^= x >> 15;
+
+    const uint8_t c = (uint8_t)x;
+    return c ? c : (uint8_t)(x >> 8) | 1;
+}
+
+static WindowState* CreateWindow(int window, int max_bytes)
+{
+    // If input is invalid:
+    if (window < 1 || window > WINDOW_MAX ||
+        max_bytes < 1 || max_bytes > WINDOW_MAX_BYTES)
+    {
+        return nullptr;
+    }
+
+    WindowState* state = new WindowState;
+    state->Window = window;
+    state->MaxBytes = max_bytes;
+    state->SymbolBytes = max_bytes + WINDOW_PREFIX_BYTES;
+
+    return state;
+}
+
+int wh256_window_symbol_bytes(wh256_window S)
+{
+    // If input is invalid:
+    if (!S)
+    {
+        return 0;
+    }
+
+    WindowState* state = reinterpret_cast<WindowState*>(S);
+
+    return state->SymbolBytes;
+}
+
+void wh256_window_free(wh256_window S)
+{
+    WindowState* state = reinterpret_cast<WindowState*>(S);
+
+    delete state;
+}
+
+
+//-----------------------------------------------------------------------------
+// Window Encoder
+
+wh256_window wh256_window_encoder_create(int window, int max_bytes)
+{
+    WindowState* state = CreateWindow(window, max_bytes);
+    if (!state)
+    {
+        return nullptr;
+    }
+
+    state->Memory = new uint8_t[(size_t)window * state->SymbolBytes];
+    state->Sources = state->Memory;
+
+    return reinterpret_cast<wh256_window>(state);
+}
+
+int wh256_window_encoder_add(wh256_window E, const void* data, int bytes, uint32_t* seq)
+{
+    WindowState* state = reinterpret_cast<WindowState*>(E);
+
+    // If input is invalid:
+    if (!state || state->Decoder || (!data && bytes != 0) || bytes < 0 || bytes > state->MaxBytes || !seq)
+    {
+        return -1;
+    }
+
+    const uint32_t next = state->NextSeq;
+    uint8_t* symbol = state->Sources + (size_t)(next % state->Window) * state->SymbolBytes;
+
+    state->WriteSymbol(symbol, data, bytes);
+
+    state->NextSeq = next + 1;
+    *seq = next;
+    return 0;
+}
+
+int wh256_window_encoder_repair(wh256_window E, void* symbol, uint32_t* first, int* count, uint32_t* seed)
+{
+    WindowState* state = reinterpret_cast<WindowState*>(E);
+
+    // If input is invalid:
+    if (!state || state->Decoder || !symbol || !first || !count || !seed ||
+        state->NextSeq == 0)
+    {
+        return -1;
+    }
+
+    const uint32_t window = (uint32_t)state->Window;
+    const uint32_t end = state->NextSeq;
+    const uint32_t start = (end > window) ? end - window : 0;
+    const uint32_t repair_seed = state->NextSeed++;
+
+    // Sum the window of source symbols, each scaled by its coefficient
+    memset(symbol, 0, state->SymbolBytes);
+    for (uint32_t seq = start; seq < end; ++seq)
+    {
+        const uint8_t* source = state->Sources + (size_t)(seq % window) * state->SymbolBytes;
+
+        gf256_muladd_mem(symbol, WindowCoefficient(repair_seed, seq), source, state->SymbolBytes);
+    }
+
+    *first = start;
+    *count = (int)(end - start);
+    *seed = repair_seed;
+    return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Window Decoder
+
+// Returns true if the row for packet seq has been solved
+static bool IsSolved(WindowState* state, uint32_t seq)
+{
+    const int window = state->Window;
+    const int column = (int)(seq % window);
+    const WindowRow& row = state->Rows[column];
+
+    if (!row.Used || row.Pivot != seq)
+    {
+        return false;
+    }
+
+    // Solved once the pivot is the only coefficient left
+    for (int i = 0; i < window; ++i)
+    {
+        if (i != column && row.Coeffs[i] != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Hand packet seq to the application, or report it lost if not solved
+static void EmitPacket(WindowState* state, uint32_t seq)
+{
+    if (IsSolved(state, seq))
+    {
+        const uint8_t* symbol = state->Rows[seq % state->Window].Symbol;
+        const int bytes = symbol[0] | ((int)symbol[1] << 8);
+
+        // If the length prefix is sane:
+        if (bytes <= state->MaxBytes)
+        {
+            state->Callback(state->CallbackContext, seq, symbol + WINDOW_PREFIX_BYTES, bytes);
+            return;
+        }
+    }
+
+    state->Callback(state->CallbackContext, seq, nullptr, 0);
+}
+
+// Deliver packets in order for as long as they are solved
+static void DeliverPackets(WindowState* state)
+{
+    while (state->Head <= state->Newest && IsSolved(state, state->Head))
+    {
+        EmitPacket(state, state->Head);
+        ++state->Head;
+    }
+}
+
+// Drop a column leaving the window, along with any rows that still use it
+static void RetireColumn(WindowState* state, uint32_t seq)
+{
+    const int column = (int)(seq % state->Window);
+
+    for (int i = 0; i < state->Window; ++i)
+    {
+        WindowRow& row = state->Rows[i];
+
+        if (row.Used && (row.Pivot == seq || row.Coeffs[column] != 0))
+        {
+            row.Used = false;
+        }
+    }
+}
+
+// Slide the window forward so that packet seq is in it
+static void AdvanceWindow(WindowState* state, uint32_t seq)
+{
+    if (!state->Started)
+    {
+        state->Started = true;
+        state->Newest = seq;
+
+        // Start from the first window seen, since the receiver may join mid-stream
+        state->Head = state->Oldest();
+        return;
+    }
+
+    if (seq <= state->Newest)
+    {
+        return;
+    }
+
+    const uint32_t old_oldest = state->Oldest();
+    const uint32_t old_end = state->Newest + 1;
+    const uint32_t window = (uint32_t)state->Window;
+    const uint32_t oldest = (seq >= window) ? seq - window + 1 : 0;
+
+    // Packets leaving the window can no longer be recovered by later repairs.
+    // Only a window of them are reported if seq jumps far ahead, covering
+    // every packet that was held.
+    if (state->Head < oldest)
+    {
+        const uint32_t emit_end = (oldest - state->Head > window) ? state->Head + window : oldest;
+        for (; state->Head < emit_end; ++state->Head)
+        {
+            EmitPacket(state, state->Head);
+        }
+        state->Head = oldest;
+    }
+
+    const uint32_t retire_end = (oldest < old_end) ? oldest : old_end;
+    for (uint32_t s = old_oldest; s < retire_end; ++s)
+    {
+        RetireColumn(state, s);
+    }
+
+    state->Newest = seq;
+}
+
+// Add the equation in the scratch row, keeping the rows in reduced row echelon form
+static void InsertScratchRow(WindowState* state)
+{
+    const int window = state->Window;
+    const int symbol_bytes = state->SymbolBytes;
+    WindowRow& scratch = state->Scratch;
+
+    const uint32_t oldest = state->Oldest();
+    const uint32_t end = state->Newest + 1;
+
+    // Eliminate every pivot column from the new row, including solved packets
+    for (uint32_t seq = oldest; seq < end; ++seq)
+    {
+        const int column = (int)(seq % window);
+        const uint8_t c = scratch.Coeffs[column];
+        const WindowRow& row = state->Rows[column];
+
+        if (c != 0 && row.Used)
+        {
+            gf256_muladd_mem(scratch.Coeffs, c, row.Coeffs, window);
+            gf256_muladd_mem(scratch.Symbol, c, row.Symbol, symbol_bytes);
+        }
+    }
+
+    // Find the new pivot, or stop if the row added no information
+    uint32_t pivot = oldest;
+    while (pivot < end && scratch.Coeffs[pivot % window] == 0)
+    {
+        ++pivot;
+    }
+    if (pivot >= end)
+    {
+        return;
+    }
+
+    const int pivot_column = (int)(pivot % window);
+    const uint8_t inverse = gf256_inv(scratch.Coeffs[pivot_column]);
+
+    gf256_mul_mem(scratch.Coeffs, scratch.Coeffs, inverse, window);
+    gf256_mul_mem(scratch.Symbol, scratch.Symbol, inverse, symbol_bytes);
+
+    // Eliminate the new pivot column from the other rows
+    for (int i = 0; i < window; ++i)
+    {
+        WindowRow& row = state->Rows[i];
+        const uint8_t c = row.Coeffs[pivot_column];
+
+        if (row.Used && c != 0)
+        {
+            gf256_muladd_mem(row.Coeffs, c, scratch.Coeffs, window);
+            gf256_muladd_mem(row.Symbol, c, scratch.Symbol, symbol_bytes);
+        }
+    }
+
+    // Swap the scratch buffers into the row for the pivot
+    WindowRow& row = state->Rows[pivot_column];
+    uint8_t* coeffs = row.Coeffs;
+    uint8_t* symbol = row.Symbol;
+
+    row.Used = true;
+    row.Pivot = pivot;
+    row.Coeffs = scratch.Coeffs;
+    row.Symbol = scratch.Symbol;
+
+    scratch.Coeffs = coeffs;
+    scratch.Symbol = symbol;
+}
+
+wh256_window wh256_window_decoder_create(int window, int max_bytes, wh256_window_callback callback, void* context)
+{
+    // If input is invalid:
+    if (!callback)
+    {
+        return nullptr;
+    }
+
+    WindowState* state = CreateWindow(window, max_bytes);
+    if (!state)
+    {
+        return nullptr;
+    }
+
+    const size_t row_bytes = (size_t)window + state->SymbolBytes;
+
+    state->Decoder = true;
+    state->Callback = callback;
+    state->CallbackContext = context;
+    state->Memory = new uint8_t[row_bytes * (window + 1)];
+    state->Rows = new WindowRow[window];
+
+    uint8_t* memory = state->Memory;
+    for (int i = 0; i <= window; ++i, memory += row_bytes)
+    {
+        WindowRow& row = (i < window) ? state->Rows[i] : state->Scratch;
+
+        row.Used = false;
+        row.Pivot = 0;
+        row.Coeffs = memory;
+        row.Symbol = memory + window;
+    }
+
+    return reinterpret_cast<wh256_window>(state);
+}
+
+int wh256_window_decoder_source(wh256_window D, uint32_t seq, const void* data, int bytes)
+{
+    WindowState* state = reinterpret_cast<WindowState*>(D);
+
+    // If input is invalid:
+    if (!state || !state->Decoder || (!data && bytes != 0) || bytes < 0 || bytes > state->MaxBytes)
+    {
+        return -1;
+    }
+
+    // If the packet was already delivered or lost:
+    if (state->Started && seq < state->Head)
+    {
+        return 0;
+    }
+
+    AdvanceWindow(state, seq);
+
+    // If the packet was recovered already:
+    if (IsSolved(state, seq))
+    {
+        return 0;
+    }
+
+    WindowRow& scratch = state->Scratch;
+    memset(scratch.Coeffs, 0, state->Window);
+    scratch.Coeffs[seq % state->Window] = 1;
+    state->WriteSymbol(scratch.Symbol, data, bytes);
+
+    InsertScratchRow(state);
+    DeliverPackets(state);
+
+    return 0;
+}
+
+int wh256_window_decoder_repair(wh256_window D, uint32_t first, int count, uint32_t seed, const void* symbol)
+{
+    WindowState* state = reinterpret_cast<WindowState*>(D);
+
+    // If input is invalid:
+    if (!state || !state->Decoder || !symbol ||
+        count < 1 || count > state->Window ||
+        first > UINT32_MAX - (uint32_t)(count - 1))
+    {
+        return -1;
+    }
+
+    const uint32_t last = first + (uint32_t)(count - 1);
+
+    // If every packet it covers was already delivered or lost:
+    if (state->Started && last < state->Head)
+    {
+        return 0;
+    }
+
+    AdvanceWindow(state, last);
+
+    // If part of the repair fell out of the window while it was delayed:
+    if (first < state->Oldest())
+    {
+        return 0;
+    }
+
+    WindowRow& scratch = state->Scratch;
+    memset(scratch.Coeffs, 0, state->Window);
+    for (uint32_t seq = first; seq <= last; ++seq)
+    {
+        scratch.Coeffs[seq % state->Window] = WindowCoefficient(seed, seq);
+    }
+    memcpy(scratch.Symbol, symbol, state->SymbolBytes);
+
+    InsertScratchRow(state);
+    DeliverPackets(state);
+
+    return 0;
+}
+
+int wh256_window_decoder_flush(wh256_window D)
+{
+    WindowState* state = reinterpret_cast<WindowState*>(D);
+
+    // If input is invalid:
+    if (!state || !state->Decoder)
+    {
+        return -1;
+    }
+
+    if (state->Started)
+    {
+        for (; state->Head <= state->Newest; ++state->Head)
+        {
+            EmitPacket(state, state->Head);
+        }
+    }
+
+    return 0;
+}
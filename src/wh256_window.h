@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WH256_WINDOW_H
+#define WH256_WINDOW_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Sliding-window FEC
+ *
+ * For interactive traffic that cannot wait for a whole message.  Source
+ * packets are sent as they are produced, and each repair packet is a random
+ * GF(256) combination of the last window source packets.  The decoder
+ * eliminates incrementally as packets arrive and delivers source packets in
+ * order as soon as they are known, so recovery latency is bounded by the
+ * window rather than by a message.
+ *
+ * Source packets are numbered from 0 by the encoder.  Each repair packet
+ * carries the range of source packets it covers and a seed that selects its
+ * coefficients, which the application sends along with it.
+ *
+ * wh256_init() must be called first.
+ */
+
+typedef void* wh256_window;
+
+/*
+ * Returns the size of a repair symbol, which is max_bytes plus a 2-byte
+ * length so that source packets of different sizes can be recovered.
+ */
+extern int wh256_window_symbol_bytes(wh256_window S);
+
+/*
+ * Free memory associated with an encoder or decoder
+ */
+extern void wh256_window_free(wh256_window S);
+
+
+/*
+ * Create an encoder that covers the last window source packets of up to
+ * max_bytes each.
+ *
+ * Preconditions:
+ *    window between 1 and 1024
+ *    max_bytes between 1 and 65535
+ *
+ * Returns a valid state object on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_window wh256_window_encoder_create(int window, int max_bytes);
+
+/*
+ * Add the next source packet, which the application sends as-is along with
+ * its sequence number.
+ *
+ * Returns 0 on success and sets seq.
+ * Returns non-zero on invalid input.
+ */
+extern int wh256_window_encoder_add(wh256_window E, const void* data, int bytes, uint32_t* seq);
+
+/*
+ * Write a repair symbol for the source packets in the window.
+ *
+ * Preconditions:
+ *    Symbol pointer has wh256_window_symbol_bytes() of space available
+ *
+ * Returns 0 on success and sets first, count and seed to send with it.
+ * Returns non-zero on invalid input or if no source packets were added.
+ */
+extern int wh256_window_encoder_repair(wh256_window E, void* symbol, uint32_t* first, int* count, uint32_t* seed);
+
+
+/*
+ * Called with each source packet in order.  data is nullptr(0) and bytes
+ * is 0 for a packet that can no longer be recovered.
+ */
+typedef void (*wh256_window_callback)(void* context, uint32_t seq, const void* data, int bytes);
+
+/*
+ * Create a decoder with the same window and max_bytes as the encoder.
+ *
+ * Returns a valid state object on success.
+ * Returns nullptr(0) on failure.
+ */
+extern wh256_window wh256_window_decoder_create(int window, int max_bytes, wh256_window_callback callback, void* context);
+
+/*
+ * Feed a received source packet.
+ *
+ * Packets are delivered to the callback from inside this call once every
+ * earlier packet is delivered or lost.  A packet is declared lost once a
+ * packet window or more places after it has arrived, since no later repair
+ * can cover it.
+ *
+ * Delivery starts from the window of the first packet seen, so a receiver
+ * can join mid-stream.  If a packet arrives more than a window ahead, only
+ * the window of packets after the last delivered one are declared lost and
+ * the rest of the gap is skipped.
+ *
+ * Returns 0 on success, including for late or duplicate packets.
+ * Returns non-zero on invalid input.
+ */
+extern int wh256_window_decoder_source(wh256_window D, uint32_t seq, const void* data, int bytes);
+
+/*
+ * Feed a received repair symbol with the values from wh256_window_encoder_repair().
+ *
+ * Returns 0 on success, including for repairs that add no information.
+ * Returns non-zero on invalid input.
+ */
+extern int wh256_window_decoder_repair(wh256_window D, uint32_t first, int count, uint32_t seed, const void* symbol);
+
+/*
+ * Deliver or declare lost every packet up to the newest one seen, for
+ * example at the end of a stream.
+ *
+ * Returns non-zero on invalid input.
+ */
+extern int wh256_window_decoder_flush(wh256_window D);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WH256_WINDOW_H
@@ -202,9 +202,18 @@
 
 #include "wirehair_codec_8.hpp"
 #include "gf256.h"
+#include "trace.hpp"
 
 #include <new>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
 
 //// Precompiler-conditional console output
 
@@ -220,14 +229,8 @@
 #define CAT_IF_DUMP(x)
 #endif
 
-#if defined(CAT_DUMP_ROWOP_COUNTERS)
-#define CAT_IF_ROWOP(x) x
-#else
-#define CAT_IF_ROWOP(x)
-#endif
-
 #if defined(CAT_DUMP_CODEC_DEBUG) || defined(CAT_DUMP_PIVOT_FAIL) || \
-    defined(CAT_DUMP_ROWOP_COUNTERS) || defined(CAT_DUMP_GE_MATRIX)
+    defined(CAT_DUMP_GE_MATRIX)
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -338,8 +341,11 @@ static uint16_t SquareRoot16(uint16_t x);
 // 16-bit Truncated Sieve of Eratosthenes Next Prime function
 static uint16_t NextPrime16(uint16_t n);
 
+// 32-bit Next Prime function
+static uint32_t NextPrime32(uint32_t n);
+
 // Peeling Row Weight Generator function
-static uint16_t GeneratePeelRowWeight(uint32_t rv, uint16_t peel_column_count);
+static uint16_t GeneratePeelRowWeight(uint32_t rv, uint32_t peel_column_count);
 
 // GF(2) Invertible Matrix Generator function
 static bool AddInvertibleGF2Matrix(uint64_t * GF256_RESTRICT matrix, int offset, int pitch, int n);
@@ -352,6 +358,11 @@ static void GeneratePeelRow(uint32_t id, uint32_t p_seed, uint16_t peel_column_c
     uint16_t & peel_weight, uint16_t & peel_a, uint16_t & peel_x0,
     uint16_t & mix_a, uint16_t & mix_x0);
 
+// 32-bit Peel Matrix Row Generator function
+static void GeneratePeelRow(uint32_t id, uint32_t p_seed, uint32_t peel_column_count, uint32_t mix_column_count,
+    uint32_t & peel_weight, uint32_t & peel_a, uint32_t & peel_x0,
+    uint32_t & mix_a, uint32_t & mix_x0);
+
 
 //// Utility: 16-bit Integer Square Root function
 
@@ -538,6 +549,47 @@ static uint16_t NextPrime16(uint16_t n)
 }
 
 
+//// Utility: 32-bit Next Prime function
+
+/*
+    Above the 16-bit range the truncated sieve runs out of primes to test,
+    so fall back to trial division by odd numbers.  This is only called
+    a couple of times per codec initialization, so it does not need to be
+    clever: For N in the millions it tests about a thousand divisors for
+    each of the ~20 candidates it typically visits.
+*/
+
+static uint32_t NextPrime32(uint32_t n)
+{
+    // Use the faster version when possible
+    if (n <= CAT_WIREHAIR_MAX_N)
+    {
+        return NextPrime16((uint16_t)n);
+    }
+
+    // For each odd number to try,
+    for (n |= 1;; n += 2)
+    {
+        // For each odd divisor to test up to square root,
+        uint32_t d = 3;
+        for (; (uint64_t)d * d <= n; d += 2)
+        {
+            // If composite, try next n
+            if (n % d == 0)
+            {
+                break;
+            }
+        }
+
+        // If no divisor was found we are done!
+        if ((uint64_t)d * d > n)
+        {
+            return n;
+        }
+    }
+}
+
+
 //// Utility: GF(2) Invertible Matrix Generator function
 
 /*
@@ -802,6 +854,25 @@ static GF256_FORCE_INLINE void IterateNextColumn(uint16_t &x, uint16_t b, uint16
     }
 }
 
+static GF256_FORCE_INLINE void IterateNextColumn(uint32_t &x, uint32_t b, uint32_t p, uint32_t a)
+{
+    x = (uint32_t)(((uint64_t)x + a) % p);
+
+    if (x >= b)
+    {
+        uint32_t distance = p - x;
+
+        if (a >= distance)
+        {
+            x = a - distance;
+        }
+        else // the rare case:
+        {
+            x = (uint32_t)((((uint64_t)a << 32) - distance) % a);
+        }
+    }
+}
+
 
 //// Utility: Peeling Row Weight Generator function
 
@@ -848,7 +919,7 @@ static const uint32_t WEIGHT_DIST[] = {
     0xfb823ee0, 0xfb9611a7, 0xfba93868, 0xfbbbbbbb, 0xfbcda3ac, 0xfbdef7bd, 0xfbefbefb, 0xffffffff
 };
 
-static uint16_t GeneratePeelRowWeight(uint32_t rv, uint16_t peel_column_count)
+static uint16_t GeneratePeelRowWeight(uint32_t rv, uint32_t peel_column_count)
 {
     // Unroll first 3 for speed (common case):
 
@@ -911,38 +982,77 @@ static void GeneratePeelRow(uint32_t id, uint32_t p_seed, uint16_t peel_column_c
     mix_x0 = (uint16_t)(rv >> 16) % mix_column_count;
 }
 
+/*
+    The 32-bit version draws a full PRNG output for each of the peeling
+    column parameters, since 16 bits are not enough to cover the columns.
+*/
 
-//// Data Structures
-
-#pragma pack(push)
-#pragma pack(1)
-struct Codec::PeelRow
+static void GeneratePeelRow(uint32_t id, uint32_t p_seed, uint32_t peel_column_count, uint32_t mix_column_count,
+    uint32_t & peel_weight, uint32_t & peel_a, uint32_t & peel_x0,
+    uint32_t & mix_a, uint32_t & mix_x0)
 {
-    uint16_t next;                    // Linkage in row list
-    uint32_t id;                        // Identifier for this row
+    // Initialize PRNG
+    Abyssinian prng;
+    prng.Initialize(id, p_seed);
 
-    // Peeling matrix: Column generator
-    uint16_t peel_weight, peel_a, peel_x0;
+    // Generate peeling matrix row weight
+    uint32_t weight = GeneratePeelRowWeight(prng.Next(), peel_column_count);
+    uint32_t max_weight = peel_column_count / 2; // Do not set more than N/2 at a time
+    peel_weight = (weight > max_weight) ? max_weight : weight;
 
-    // Mixing matrix: Column generator
-    uint16_t mix_a, mix_x0;
+    // Generate peeling matrix column selection parameters for row
+    peel_a = (prng.Next() % (peel_column_count - 1)) + 1;
+    peel_x0 = prng.Next() % peel_column_count;
+
+    // Generate mixing matrix column selection parameters
+    mix_a = (prng.Next() % (mix_column_count - 1)) + 1;
+    mix_x0 = prng.Next() % mix_column_count;
+}
+
+
+//// Data Structures
+
+/*
+    Peeling state is split by how often it is touched.  PeelRow holds the
+    fields walked during peeling and compression, while the row identifier
+    and mixing column generator live in PeelRowInfo.  Column marks and list
+    linkage are kept in their own arrays so that the column scan in
+    GreedyPeeling only reads a dense byte array.  All fields are naturally
+    aligned.
+*/
+
+template<typename IndexT>
+struct CodecT<IndexT>::PeelRow
+{
+    IndexT next;                    // Linkage in row list
 
     // Peeling state
-    uint16_t unmarked_count;            // Count of columns that have not been marked yet
+    IndexT unmarked_count;          // Count of columns that have not been marked yet
     union
     {
         // During peeling:
-        uint16_t unmarked[2];        // Final two unmarked column indices
+        IndexT unmarked[2];         // Final two unmarked column indices
 
         // After peeling:
         struct
         {
-            uint16_t peel_column;    // Peeling column that is solved by this row
-            uint8_t is_copied;        // Row value is copied yet?
+            IndexT peel_column;     // Peeling column that is solved by this row
+            uint8_t is_copied;      // Row value is copied yet?
         };
     };
+
+    // Peeling matrix: Column generator
+    IndexT peel_weight, peel_a, peel_x0;
+};
+
+template<typename IndexT>
+struct CodecT<IndexT>::PeelRowInfo
+{
+    uint32_t id;                    // Identifier for this row
+
+    // Mixing matrix: Column generator
+    IndexT mix_a, mix_x0;
 };
-#pragma pack(pop)
 
 // Marks for PeelColumn
 enum MarkTypes
@@ -952,31 +1062,29 @@ enum MarkTypes
     MARK_DEFER    // Deferred to Gaussian elimination
 };
 
-#pragma pack(push)
-#pragma pack(1)
-struct Codec::PeelColumn
+template<typename IndexT>
+struct CodecT<IndexT>::PeelColumn
 {
-    uint16_t next;            // Linkage in column list
-
     union
     {
-        uint16_t w2_refs;    // Number of weight-2 rows containing this column
-        uint16_t peel_row;    // Row that solves the column
-        uint16_t ge_column;    // Column that a deferred column is mapped to
+        IndexT w2_refs;     // Number of weight-2 rows containing this column
+        IndexT peel_row;    // Row that solves the column
+        IndexT ge_column;   // Column that a deferred column is mapped to
     };
-
-    uint8_t mark;            // One of the MarkTypes enumeration
 };
-#pragma pack(pop)
 
-#pragma pack(push)
-#pragma pack(1)
-struct Codec::PeelRefs
+/*
+    Column references are stored in fixed-size chunks.  The first N chunks
+    are the list heads for each column, so a walk usually touches a single
+    chunk.  Columns referenced by more than CAT_REF_CHUNK_ROWS rows are
+    continued in overflow chunks taken from the end of the same pool.
+*/
+template<typename IndexT>
+struct CodecT<IndexT>::PeelRefs
 {
-    uint16_t row_count;        // Number of rows containing this column
-    uint16_t rows[CAT_REF_LIST_MAX];
+    uint32_t next;                      // Index of next chunk for this column
+    IndexT rows[CAT_REF_CHUNK_ROWS];    // Rows containing this column
 };
-#pragma pack(pop)
 
 
 //// (1) Peeling:
@@ -1012,39 +1120,73 @@ struct Codec::PeelRefs
     row ID number and the peeling column generator parameters.
 */
 
-bool Codec::OpportunisticPeeling(uint32_t row_i, uint32_t id)
+template<typename IndexT>
+bool CodecT<IndexT>::OpportunisticPeeling(uint32_t row_i, uint32_t id)
 {
     PeelRow *row = &_peel_rows[row_i];
+    PeelRowInfo *info = &_peel_row_info[row_i];
 
-    row->id = id;
+    info->id = id;
     GeneratePeelRow(id, _p_seed, _block_count, _mix_count,
-        row->peel_weight, row->peel_a, row->peel_x0, row->mix_a, row->mix_x0);
+        row->peel_weight, row->peel_a, row->peel_x0, info->mix_a, info->mix_x0);
 
     CAT_IF_DUMP(cout << "Row " << id << " in slot " << row_i << " of weight " << row->peel_weight << " [a=" << row->peel_a << "] : ";)
 
+    // Count the columns whose last chunk is full, since only those link a new one
+    uint32_t new_chunks = 0;
+    {
+        IndexT weight = row->peel_weight;
+        IndexT column_i = row->peel_x0;
+        IndexT a = row->peel_a;
+        for (;;)
+        {
+            const IndexT ref_count = _peel_ref_counts[column_i];
+            if (ref_count > 0 && ref_count % CAT_REF_CHUNK_ROWS == 0)
+                ++new_chunks;
+
+            if (--weight <= 0) break;
+
+            IterateNextColumn(column_i, _block_count, _block_next_prime, a);
+        }
+    }
+
+    if (!ReserveRefChunks(new_chunks))
+    {
+        CAT_IF_DUMP(cout << "OpportunisticPeeling: Failure!  Unable to allocate more column reference chunks." << endl;)
+        return false;
+    }
+
     // Iterate columns in peeling matrix
-    uint16_t weight = row->peel_weight;
-    uint16_t column_i = row->peel_x0;
-    uint16_t a = row->peel_a;
-    uint16_t unmarked_count = 0;
-    uint16_t unmarked[2];
+    IndexT weight = row->peel_weight;
+    IndexT column_i = row->peel_x0;
+    IndexT a = row->peel_a;
+    IndexT unmarked_count = 0;
+    IndexT unmarked[2];
     for (;;)
     {
         CAT_IF_DUMP(cout << column_i << " ";)
 
+        // Find the last chunk for this column
+        IndexT ref_count = _peel_ref_counts[column_i]++;
         PeelRefs *refs = &_peel_col_refs[column_i];
-
-        // Add row reference to column
-        if (refs->row_count >= CAT_REF_LIST_MAX)
+        while (ref_count >= CAT_REF_CHUNK_ROWS)
         {
-            CAT_IF_DUMP(cout << "OpportunisticPeeling: Failure!  Ran out of space for row references.  CAT_REF_LIST_MAX must be increased!" << endl;)
-            FixPeelFailure(row, column_i);
-            return false;
+            ref_count -= CAT_REF_CHUNK_ROWS;
+
+            // If the last chunk is full, link a new one
+            if (ref_count == 0)
+            {
+                refs->next = _ref_chunk_count++;
+            }
+
+            refs = &_peel_col_refs[refs->next];
         }
-        refs->rows[refs->row_count++] = row_i;
+
+        // Add row reference to column
+        refs->rows[ref_count] = row_i;
 
         // If column is unmarked,
-        if (_peel_cols[column_i].mark == MARK_TODO)
+        if (_peel_col_marks[column_i] == MARK_TODO)
             unmarked[unmarked_count++ & 1] = column_i;
 
         if (--weight <= 0) break;
@@ -1084,36 +1226,49 @@ bool Codec::OpportunisticPeeling(uint32_t row_i, uint32_t id)
 }
 
 /*
-    FixPeelFailure
-
-        This function unreferences previous columns for a row where,
-    in one of the columns, the reference list overflowed.  This avoids
-    potential data corruption or more severe problems in case of
-    unusually distributed peeling matrices.
+    ReserveRefChunks
+
+        This function makes sure that at least the given number of column
+    reference chunks are available in the pool.  The pool starts out in
+    the workspace, sized for the average row weight.  If an unusual set of
+    rows exhausts it, the chunks are moved to a larger separate allocation.
+    Chunks are linked by index so moving them does not break the lists.
+    With caller-provided memory the pool cannot grow, so the row is
+    rejected instead, leaving the peeling state untouched.
 */
 
-void Codec::FixPeelFailure(PeelRow * GF256_RESTRICT row, uint16_t fail_column_i)
+template<typename IndexT>
+bool CodecT<IndexT>::ReserveRefChunks(uint32_t needed)
 {
-    CAT_IF_DUMP(cout << "!!Fixing Peel Failure!! Unreferencing columns, ending at " << fail_column_i << " :";)
-
-    // Iterate columns in peeling matrix
-    //uint16_t weight = row->peel_weight;
-    uint16_t column_i = row->peel_x0;
-    uint16_t a = row->peel_a;
-    while (column_i != fail_column_i)
+    if (_ref_chunk_count + needed <= _ref_chunk_capacity)
     {
-        CAT_IF_DUMP(cout << " " << column_i;)
+        return true;
+    }
 
-        PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[column_i];
+    // Caller-provided memory cannot grow
+    if (_arena)
+    {
+        return false;
+    }
 
-        // Subtract off row count - Invalidates row number that was written earlier
-        refs->row_count--;
+    const uint32_t capacity = _ref_chunk_capacity + _ref_chunk_capacity / 2 + needed;
 
-        // NOTE: Does not need to validate weight here since fail_column_i is guaranteed to come around
+    CAT_IF_DUMP(cout << "ReserveRefChunks: Growing column reference pool to " << capacity << " chunks" << endl;)
 
-        IterateNextColumn(column_i, _block_count, _block_next_prime, a);
+    uint8_t *grown = new(std::nothrow) uint8_t[sizeof(PeelRefs) * (size_t)capacity];
+    if (!grown)
+    {
+        return false;
     }
-    CAT_IF_DUMP(cout << endl;)
+
+    memcpy(grown, _peel_col_refs, sizeof(PeelRefs) * (size_t)_ref_chunk_count);
+
+    delete[]_ref_chunks_grown;
+    _ref_chunks_grown = grown;
+    _peel_col_refs = reinterpret_cast<PeelRefs *>( grown );
+    _ref_chunk_capacity = capacity;
+
+    return true;
 }
 
 /*
@@ -1128,24 +1283,32 @@ void Codec::FixPeelFailure(PeelRow * GF256_RESTRICT row, uint16_t fail_column_i)
     reused later during GreedyPeeling().
 */
 
-void Codec::PeelAvalanche(uint16_t column_i)
+template<typename IndexT>
+void CodecT<IndexT>::PeelAvalanche(IndexT column_i)
 {
     // Walk list of peeled rows referenced by this newly solved column
-    PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[column_i];
-    uint16_t ref_row_count = refs->row_count;
-    uint16_t * GF256_RESTRICT ref_rows = refs->rows;
-    while (ref_row_count--)
+    const PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[column_i];
+    IndexT ref_row_count = _peel_ref_counts[column_i];
+    const IndexT * GF256_RESTRICT ref_rows = refs->rows;
+    for (IndexT ref_i = 0; ref_i < ref_row_count; ++ref_i)
     {
+        // Continue with next chunk
+        if (ref_i > 0 && ref_i % CAT_REF_CHUNK_ROWS == 0)
+        {
+            refs = &_peel_col_refs[refs->next];
+            ref_rows = refs->rows;
+        }
+
         // Update unmarked row count for this referenced row
-        uint16_t ref_row_i = *ref_rows++;
+        IndexT ref_row_i = *ref_rows++;
         PeelRow * GF256_RESTRICT ref_row = &_peel_rows[ref_row_i];
-        uint16_t unmarked_count = --ref_row->unmarked_count;
+        IndexT unmarked_count = --ref_row->unmarked_count;
 
         // If row may be solving a column now,
         if (unmarked_count == 1)
         {
             // Find other column
-            uint16_t new_column_i = ref_row->unmarked[0];
+            IndexT new_column_i = ref_row->unmarked[0];
             if (new_column_i == column_i)
             {
                 new_column_i = ref_row->unmarked[1];
@@ -1158,7 +1321,7 @@ void Codec::PeelAvalanche(uint16_t column_i)
             */
 
             // If column is already solved,
-            if (_peel_cols[new_column_i].mark == MARK_TODO)
+            if (_peel_col_marks[new_column_i] == MARK_TODO)
             {
                 Peel(ref_row_i, ref_row, new_column_i);
             }
@@ -1174,22 +1337,20 @@ void Codec::PeelAvalanche(uint16_t column_i)
         else if (unmarked_count == 2)
         {
             // Regenerate the row columns to discover which are unmarked
-            uint16_t ref_weight = ref_row->peel_weight;
-            uint16_t ref_column_i = ref_row->peel_x0;
-            uint16_t ref_a = ref_row->peel_a;
-            uint16_t unmarked_count = 0;
+            IndexT ref_weight = ref_row->peel_weight;
+            IndexT ref_column_i = ref_row->peel_x0;
+            IndexT ref_a = ref_row->peel_a;
+            IndexT unmarked_count = 0;
             for (;;)
             {
-                PeelColumn * GF256_RESTRICT ref_col = &_peel_cols[ref_column_i];
-
                 // If column is unmarked,
-                if (ref_col->mark == MARK_TODO)
+                if (_peel_col_marks[ref_column_i] == MARK_TODO)
                 {
                     // Store the two unmarked columns in the row
                     ref_row->unmarked[unmarked_count++] = ref_column_i;
 
                     // Increment weight-2 reference count (cannot hurt even if not true)
-                    ref_col->w2_refs++;
+                    _peel_cols[ref_column_i].w2_refs++;
                 }
 
                 if (--ref_weight <= 0)
@@ -1236,14 +1397,13 @@ void Codec::PeelAvalanche(uint16_t column_i)
     a column during the peeling process.
 */
 
-void Codec::Peel(uint16_t row_i, PeelRow * GF256_RESTRICT row, uint16_t column_i)
+template<typename IndexT>
+void CodecT<IndexT>::Peel(IndexT row_i, PeelRow * GF256_RESTRICT row, IndexT column_i)
 {
     CAT_IF_DUMP(cout << "Peel: Solved column " << column_i << " with row " << row_i << endl;)
 
-    PeelColumn * GF256_RESTRICT column = &_peel_cols[column_i];
-
     // Mark this column as solved
-    column->mark = MARK_PEEL;
+    _peel_col_marks[column_i] = MARK_PEEL;
 
     // Remember which column it solves
     row->peel_column = column_i;
@@ -1267,7 +1427,7 @@ void Codec::Peel(uint16_t row_i, PeelRow * GF256_RESTRICT row, uint16_t column_i
     PeelAvalanche(column_i);
 
     // Remember which row solves the column, after done with rows list
-    column->peel_row = row_i;
+    _peel_cols[column_i].peel_row = row_i;
 }
 
 /*
@@ -1288,7 +1448,8 @@ void Codec::Peel(uint16_t row_i, PeelRow * GF256_RESTRICT row, uint16_t column_i
     columns must be deferred to Gaussian elimination using this greedy approach.
 */
 
-void Codec::GreedyPeeling()
+template<typename IndexT>
+void CodecT<IndexT>::GreedyPeeling()
 {
     CAT_IF_DUMP(cout << endl << "---- GreedyPeeling ----" << endl << endl;)
 
@@ -1299,22 +1460,22 @@ void Codec::GreedyPeeling()
     // Until all columns are marked,
     for (;;)
     {
-        uint16_t best_column_i = LIST_TERM;
-        uint16_t best_w2_refs = 0, best_row_count = 0;
+        IndexT best_column_i = LIST_TERM;
+        IndexT best_w2_refs = 0, best_row_count = 0;
 
         // For each column,
-        PeelColumn *column = _peel_cols;
-        for (uint16_t column_i = 0; column_i < _block_count; ++column_i, ++column)
+        const uint8_t * GF256_RESTRICT marks = _peel_col_marks;
+        for (IndexT column_i = 0; column_i < _block_count; ++column_i)
         {
             // If column is not marked yet,
-            if (column->mark == MARK_TODO)
+            if (marks[column_i] == MARK_TODO)
             {
                 // And if it may have the most weight-2 references
-                uint16_t w2_refs = column->w2_refs;
+                IndexT w2_refs = _peel_cols[column_i].w2_refs;
                 if (w2_refs >= best_w2_refs)
                 {
                     // Or if it has the largest row references overall,
-                    uint16_t row_count = _peel_col_refs[column_i].row_count;
+                    IndexT row_count = _peel_ref_counts[column_i];
                     if (w2_refs > best_w2_refs || row_count >= best_row_count)
                     {
                         // Use that one
@@ -1333,15 +1494,14 @@ void Codec::GreedyPeeling()
         }
 
         // Mark column as deferred
-        PeelColumn *best_column = &_peel_cols[best_column_i];
-        best_column->mark = MARK_DEFER;
+        _peel_col_marks[best_column_i] = MARK_DEFER;
         ++_defer_count;
 
         // Add at head of deferred list
-        best_column->next = _defer_head_columns;
+        _peel_col_next[best_column_i] = _defer_head_columns;
         _defer_head_columns = best_column_i;
 
-        CAT_IF_DUMP(cout << "Deferred column " << best_column_i << " for Gaussian elimination, which had " << best_column->w2_refs << " weight-2 row references" << endl;)
+        CAT_IF_DUMP(cout << "Deferred column " << best_column_i << " for Gaussian elimination, which had " << best_w2_refs << " weight-2 row references" << endl;)
 
         // Peel resuming from where this column left off
         PeelAvalanche(best_column_i);
@@ -1450,31 +1610,36 @@ void Codec::GreedyPeeling()
         Map GE column to this column.
 */
 
-void Codec::SetDeferredColumns()
+template<typename IndexT>
+void CodecT<IndexT>::SetDeferredColumns()
 {
     CAT_IF_DUMP(cout << endl << "---- SetDeferredColumns ----" << endl << endl;)
 
     // For each deferred column,
-    PeelColumn * GF256_RESTRICT column;
-    for (uint16_t ge_column_i = 0, defer_i = _defer_head_columns; defer_i != LIST_TERM; defer_i = column->next, ++ge_column_i)
+    for (IndexT ge_column_i = 0, defer_i = _defer_head_columns; defer_i != LIST_TERM; defer_i = _peel_col_next[defer_i], ++ge_column_i)
     {
-        column = &_peel_cols[defer_i];
-
         CAT_IF_DUMP(cout << "GE column " << ge_column_i << " mapped to matrix column " << defer_i << " :";)
 
         // Set bit for each row affected by this deferred column
         uint64_t *matrix_row_offset = _compress_matrix + (ge_column_i >> 6);
         uint64_t ge_mask = (uint64_t)1 << (ge_column_i & 63);
-        PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[defer_i];
-        uint16_t count = refs->row_count;
-        uint16_t *ref_row = refs->rows;
-        while (count--)
+        const PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[defer_i];
+        IndexT count = _peel_ref_counts[defer_i];
+        const IndexT *ref_row = refs->rows;
+        for (IndexT ref_i = 0; ref_i < count; ++ref_i)
         {
-            uint16_t row_i = *ref_row++;
+            // Continue with next chunk
+            if (ref_i > 0 && ref_i % CAT_REF_CHUNK_ROWS == 0)
+            {
+                refs = &_peel_col_refs[refs->next];
+                ref_row = refs->rows;
+            }
+
+            IndexT row_i = *ref_row++;
 
             CAT_IF_DUMP(cout << " " << row_i;)
 
-            matrix_row_offset[_ge_pitch * row_i] |= ge_mask;
+            matrix_row_offset[(size_t)_ge_pitch * row_i] |= ge_mask;
         }
 
         CAT_IF_DUMP(cout << endl;)
@@ -1483,14 +1648,14 @@ void Codec::SetDeferredColumns()
         _ge_col_map[ge_column_i] = defer_i;
 
         // Set reverse mapping also
-        column->ge_column = ge_column_i;
+        _peel_cols[defer_i].ge_column = ge_column_i;
     }
 
     // Set column map for each mix column
-    for (uint16_t added_i = 0; added_i < _mix_count; ++added_i)
+    for (IndexT added_i = 0; added_i < _mix_count; ++added_i)
     {
-        uint16_t ge_column_i = _defer_count + added_i;
-        uint16_t column_i = _block_count + added_i;
+        IndexT ge_column_i = _defer_count + added_i;
+        IndexT column_i = _block_count + added_i;
 
         CAT_IF_DUMP(cout << "GE column(mix) " << ge_column_i << " mapped to matrix column " << column_i << endl;)
 
@@ -1507,13 +1672,14 @@ void Codec::SetDeferredColumns()
     later it will be easy to check if it was deferred.
 */
 
-void Codec::SetMixingColumnsForDeferredRows()
+template<typename IndexT>
+void CodecT<IndexT>::SetMixingColumnsForDeferredRows()
 {
     CAT_IF_DUMP(cout << endl << "---- SetMixingColumnsForDeferredRows ----" << endl << endl;)
 
     // For each deferred row,
     PeelRow * GF256_RESTRICT row;
-    for (uint16_t defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM; defer_row_i = row->next)
+    for (IndexT defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM; defer_row_i = row->next)
     {
         row = &_peel_rows[defer_row_i];
 
@@ -1523,12 +1689,13 @@ void Codec::SetMixingColumnsForDeferredRows()
         row->peel_column = LIST_TERM;
 
         // Set up mixing column generator
-        uint64_t *ge_row = _compress_matrix + _ge_pitch * defer_row_i;
-        uint16_t a = row->mix_a;
-        uint16_t x = row->mix_x0;
+        uint64_t *ge_row = _compress_matrix + (size_t)_ge_pitch * defer_row_i;
+        const PeelRowInfo * GF256_RESTRICT info = &_peel_row_info[defer_row_i];
+        IndexT a = info->mix_a;
+        IndexT x = info->mix_x0;
 
         // Generate mixing column 1
-        uint16_t ge_column_i = _defer_count + x;
+        IndexT ge_column_i = _defer_count + x;
         ge_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
         CAT_IF_DUMP(cout << " " << ge_column_i;)
         IterateNextColumn(x, _mix_count, _mix_next_prime, a);
@@ -1570,7 +1737,8 @@ void Codec::SetMixingColumnsForDeferredRows()
                 Add row block value.
 */
 
-void Codec::PeelDiagonal()
+template<typename IndexT>
+void CodecT<IndexT>::PeelDiagonal()
 {
     CAT_IF_DUMP(cout << endl << "---- PeelDiagonal ----" << endl << endl;)
 
@@ -1580,26 +1748,27 @@ void Codec::PeelDiagonal()
         using the is_copied row member.
     */
 
-    CAT_IF_ROWOP(int rowops = 0;)
+    uint32_t rowops = 0;
 
     // For each peeled row in forward solution order,
     PeelRow * GF256_RESTRICT row;
-    for (uint16_t peel_row_i = _peel_head_rows; peel_row_i != LIST_TERM; peel_row_i = row->next)
+    for (IndexT peel_row_i = _peel_head_rows; peel_row_i != LIST_TERM; peel_row_i = row->next)
     {
         row = &_peel_rows[peel_row_i];
 
         // Lookup peeling results
-        uint16_t peel_column_i = row->peel_column;
-        uint64_t *ge_row = _compress_matrix + _ge_pitch * peel_row_i;
+        IndexT peel_column_i = row->peel_column;
+        uint64_t *ge_row = _compress_matrix + (size_t)_ge_pitch * peel_row_i;
 
         CAT_IF_DUMP(cout << "Peeled row " << peel_row_i << " for peeled column " << peel_column_i << " :";)
 
         // Set up mixing column generator
-        uint16_t a = row->mix_a;
-        uint16_t x = row->mix_x0;
+        const PeelRowInfo * GF256_RESTRICT info = &_peel_row_info[peel_row_i];
+        IndexT a = info->mix_a;
+        IndexT x = info->mix_x0;
 
         // Generate mixing column 1
-        uint16_t ge_column_i = _defer_count + x;
+        IndexT ge_column_i = _defer_count + x;
         ge_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
         CAT_IF_DUMP(cout << " " << ge_column_i;)
         IterateNextColumn(x, _mix_count, _mix_next_prime, a);
@@ -1616,13 +1785,13 @@ void Codec::PeelDiagonal()
         CAT_IF_DUMP(cout << " " << ge_column_i << endl;)
 
         // Lookup output block
-        uint8_t * GF256_RESTRICT temp_block_src = _recovery_blocks + _block_bytes * peel_column_i;
+        uint8_t * GF256_RESTRICT temp_block_src = _recovery_blocks + (size_t)_block_bytes * peel_column_i;
 
         // If row has not been copied yet,
         if (!row->is_copied)
         {
             // Copy it directly to the output block
-            const uint8_t * GF256_RESTRICT block_src = _input_blocks + _block_bytes * peel_row_i;
+            const uint8_t * GF256_RESTRICT block_src = InputRow(peel_row_i);
             if (peel_row_i != _block_count - 1)
                 memcpy(temp_block_src, block_src, _block_bytes);
             else
@@ -1630,7 +1799,7 @@ void Codec::PeelDiagonal()
                 memcpy(temp_block_src, block_src, _input_final_bytes);
                 memset(temp_block_src + _input_final_bytes, 0, _block_bytes - _input_final_bytes);
             }
-            CAT_IF_ROWOP(++rowops;)
+            ++rowops;
 
             CAT_IF_DUMP(cout << "-- Copied from " << peel_row_i << " because has not been copied yet.  Output block = " << (int)temp_block_src[0] << endl;)
 
@@ -1640,12 +1809,19 @@ void Codec::PeelDiagonal()
         CAT_IF_DUMP(cout << "++ Adding to referencing rows:";)
 
         // For each row that references this one,
-        PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[peel_column_i];
-        uint16_t count = refs->row_count;
-        uint16_t * GF256_RESTRICT ref_row = refs->rows;
-        while (count--)
+        const PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[peel_column_i];
+        IndexT count = _peel_ref_counts[peel_column_i];
+        const IndexT * GF256_RESTRICT ref_row = refs->rows;
+        for (IndexT ref_i = 0; ref_i < count; ++ref_i)
         {
-            uint16_t ref_row_i = *ref_row++;
+            // Continue with next chunk
+            if (ref_i > 0 && ref_i % CAT_REF_CHUNK_ROWS == 0)
+            {
+                refs = &_peel_col_refs[refs->next];
+                ref_row = refs->rows;
+            }
+
+            IndexT ref_row_i = *ref_row++;
 
             // Skip this row
             if (ref_row_i == peel_row_i) continue;
@@ -1653,16 +1829,16 @@ void Codec::PeelDiagonal()
             CAT_IF_DUMP(cout << " " << ref_row_i;)
 
             // Add GE row to referencing GE row
-            uint64_t * GF256_RESTRICT ge_ref_row = _compress_matrix + _ge_pitch * ref_row_i;
+            uint64_t * GF256_RESTRICT ge_ref_row = _compress_matrix + (size_t)_ge_pitch * ref_row_i;
             for (int ii = 0; ii < _ge_pitch; ++ii) ge_ref_row[ii] ^= ge_row[ii];
 
             // If row is peeled,
             PeelRow * GF256_RESTRICT ref_row = &_peel_rows[ref_row_i];
-            uint16_t ref_column_i = ref_row->peel_column;
+            IndexT ref_column_i = ref_row->peel_column;
             if (ref_column_i != LIST_TERM)
             {
                 // Generate temporary row block value:
-                uint8_t * GF256_RESTRICT temp_block_dest = _recovery_blocks + _block_bytes * ref_column_i;
+                uint8_t * GF256_RESTRICT temp_block_dest = _recovery_blocks + (size_t)_block_bytes * ref_column_i;
 
                 // If referencing row is already copied to the recovery blocks,
                 if (ref_row->is_copied)
@@ -1673,7 +1849,7 @@ void Codec::PeelDiagonal()
                 else
                 {
                     // Add this row block value with message block to it (optimization)
-                    const uint8_t * GF256_RESTRICT block_src = _input_blocks + _block_bytes * ref_row_i;
+                    const uint8_t * GF256_RESTRICT block_src = InputRow(ref_row_i);
                     if (ref_row_i != _block_count - 1)
                     {
                         gf256_addset_mem(temp_block_dest, temp_block_src, block_src, _block_bytes);
@@ -1686,14 +1862,14 @@ void Codec::PeelDiagonal()
 
                     ref_row->is_copied = 1;
                 }
-                CAT_IF_ROWOP(++rowops;)
+                ++rowops;
             } // end if referencing row is peeled
         } // next referencing row
 
         CAT_IF_DUMP(cout << endl;)
     } // next peeled row
 
-    CAT_IF_ROWOP(cout << "PeelDiagonal used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+    AddRowOps(PHASE_COMPRESS, rowops, 0);
 }
 
 /*
@@ -1704,19 +1880,20 @@ void Codec::PeelDiagonal()
     to the deferred rows.
 */
 
-void Codec::CopyDeferredRows()
+template<typename IndexT>
+void CodecT<IndexT>::CopyDeferredRows()
 {
     CAT_IF_DUMP(cout << endl << "---- CopyDeferredRows ----" << endl << endl;)
 
     // For each deferred row,
     uint64_t * GF256_RESTRICT ge_row = _ge_matrix + _ge_pitch * _dense_count;
-    for (uint16_t ge_row_i = _dense_count, defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM;
+    for (IndexT ge_row_i = _dense_count, defer_row_i = _defer_head_rows; defer_row_i != LIST_TERM;
         defer_row_i = _peel_rows[defer_row_i].next, ge_row += _ge_pitch, ++ge_row_i)
     {
         CAT_IF_DUMP(cout << "Peeled row " << defer_row_i << " for GE row " << ge_row_i << endl;)
 
         // Copy compress row to GE row
-        uint64_t * GF256_RESTRICT compress_row = _compress_matrix + _ge_pitch * defer_row_i;
+        uint64_t * GF256_RESTRICT compress_row = _compress_matrix + (size_t)_ge_pitch * defer_row_i;
         memcpy(ge_row, compress_row, _ge_pitch * sizeof(uint64_t));
 
         // Set row map for this deferred row
@@ -1832,7 +2009,8 @@ void Codec::CopyDeferredRows()
     in the MultiplyDenseValues() function after Triangle() succeeds.
 */
 
-void Codec::MultiplyDenseRows()
+template<typename IndexT>
+void CodecT<IndexT>::MultiplyDenseRows()
 {
     CAT_IF_DUMP(cout << endl << "---- MultiplyDenseRows ----" << endl << endl;)
 
@@ -1842,10 +2020,11 @@ void Codec::MultiplyDenseRows()
 
     // For each block of columns:
     PeelColumn * GF256_RESTRICT column = _peel_cols;
+    const uint8_t * GF256_RESTRICT mark = _peel_col_marks;
     uint64_t * GF256_RESTRICT temp_row = _ge_matrix + _ge_pitch * (_dense_count + _defer_count);
     const int dense_count = _dense_count;
-    uint16_t rows[CAT_MAX_DENSE_ROWS], bits[CAT_MAX_DENSE_ROWS];
-    for (uint16_t column_i = 0; column_i < _block_count; column_i += dense_count, column += dense_count)
+    uint16_t rows[MAX_DENSE_ROWS], bits[MAX_DENSE_ROWS];
+    for (IndexT column_i = 0; column_i < _block_count; column_i += dense_count, column += dense_count, mark += dense_count)
     {
         CAT_IF_DUMP(cout << "Shuffled dense matrix starting at column " << column_i << ":" << endl;)
 
@@ -1863,7 +2042,7 @@ void Codec::MultiplyDenseRows()
         const uint16_t * GF256_RESTRICT set_bits = bits;
         const uint16_t * GF256_RESTRICT clr_bits = set_bits + set_count;
 
-        CAT_IF_DUMP(uint64_t disp_row[(CAT_MAX_DENSE_ROWS + 63) / 64] = {};)
+        CAT_IF_DUMP(uint64_t disp_row[(MAX_DENSE_ROWS + 63) / 64] = {};)
 
         // Generate first row
         memset(temp_row, 0, _ge_pitch * sizeof(uint64_t));
@@ -1873,16 +2052,16 @@ void Codec::MultiplyDenseRows()
             int bit_i = set_bits[ii];
             if (bit_i < max_x)
             {
-                if (column[bit_i].mark == MARK_PEEL)
+                if (mark[bit_i] == MARK_PEEL)
                 {
                     // Add temp row value
-                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit_i].peel_row;
+                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + (size_t)_ge_pitch * column[bit_i].peel_row;
                     for (int jj = 0; jj < _ge_pitch; ++jj) temp_row[jj] ^= ge_source_row[jj];
                 }
                 else
                 {
                     // Set GE bit for deferred column
-                    uint16_t ge_column_i = column[bit_i].ge_column;
+                    IndexT ge_column_i = column[bit_i].ge_column;
                     temp_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
                 }
             }
@@ -1909,10 +2088,10 @@ void Codec::MultiplyDenseRows()
             // Flip bit 1
             if (bit0 < max_x)
             {
-                if (column[bit0].mark == MARK_PEEL)
+                if (mark[bit0] == MARK_PEEL)
                 {
                     // Add temp row value
-                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit0].peel_row;
+                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + (size_t)_ge_pitch * column[bit0].peel_row;
                     for (int jj = 0; jj < _ge_pitch; ++jj)
                     {
                         temp_row[jj] ^= ge_source_row[jj];
@@ -1921,7 +2100,7 @@ void Codec::MultiplyDenseRows()
                 else
                 {
                     // Set GE bit for deferred column
-                    uint16_t ge_column_i = column[bit0].ge_column;
+                    IndexT ge_column_i = column[bit0].ge_column;
                     temp_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
                 }
             }
@@ -1930,10 +2109,10 @@ void Codec::MultiplyDenseRows()
             // Flip bit 2
             if (bit1 < max_x)
             {
-                if (column[bit1].mark == MARK_PEEL)
+                if (mark[bit1] == MARK_PEEL)
                 {
                     // Add temp row value
-                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit1].peel_row;
+                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + (size_t)_ge_pitch * column[bit1].peel_row;
                     for (int jj = 0; jj < _ge_pitch; ++jj)
                     {
                         temp_row[jj] ^= ge_source_row[jj];
@@ -1942,7 +2121,7 @@ void Codec::MultiplyDenseRows()
                 else
                 {
                     // Set GE bit for deferred column
-                    uint16_t ge_column_i = column[bit1].ge_column;
+                    IndexT ge_column_i = column[bit1].ge_column;
                     temp_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
                 }
             }
@@ -1966,10 +2145,10 @@ void Codec::MultiplyDenseRows()
             // Flip bit 1
             if (bit0 < max_x)
             {
-                if (column[bit0].mark == MARK_PEEL)
+                if (mark[bit0] == MARK_PEEL)
                 {
                     // Add temp row value
-                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit0].peel_row;
+                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + (size_t)_ge_pitch * column[bit0].peel_row;
                     for (int jj = 0; jj < _ge_pitch; ++jj)
                     {
                         temp_row[jj] ^= ge_source_row[jj];
@@ -1978,7 +2157,7 @@ void Codec::MultiplyDenseRows()
                 else
                 {
                     // Set GE bit for deferred column
-                    uint16_t ge_column_i = column[bit0].ge_column;
+                    IndexT ge_column_i = column[bit0].ge_column;
                     temp_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
                 }
             }
@@ -1987,10 +2166,10 @@ void Codec::MultiplyDenseRows()
             // Flip bit 2
             if (bit1 < max_x)
             {
-                if (column[bit1].mark == MARK_PEEL)
+                if (mark[bit1] == MARK_PEEL)
                 {
                     // Add temp row value
-                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + _ge_pitch * column[bit1].peel_row;
+                    uint64_t * GF256_RESTRICT ge_source_row = _compress_matrix + (size_t)_ge_pitch * column[bit1].peel_row;
                     for (int jj = 0; jj < _ge_pitch; ++jj)
                     {
                         temp_row[jj] ^= ge_source_row[jj];
@@ -1999,7 +2178,7 @@ void Codec::MultiplyDenseRows()
                 else
                 {
                     // Set GE bit for deferred column
-                    uint16_t ge_column_i = column[bit1].ge_column;
+                    IndexT ge_column_i = column[bit1].ge_column;
                     temp_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
                 }
             }
@@ -2087,7 +2266,8 @@ static const uint8_t HeavyMatrix[CAT_HEAVY_ROWS][CAT_HEAVY_MAX_COLS] = {
     { 0xf4, 0xb2, 0x6a, 0xe9, 0xd3, 0xd9, 0xc5, 0x5a, 0x28, 0x42, 0x9d, 0x82, 0xa7, 0x47, 0xb5, 0x88, 0x53, 0x74 }
 };
 
-void Codec::SetHeavyRows()
+template<typename IndexT>
+void CodecT<IndexT>::SetHeavyRows()
 {
     CAT_IF_DUMP(cout << endl << "---- SetHeavyRows ----" << endl << endl;)
 
@@ -2165,13 +2345,14 @@ void Codec::SetHeavyRows()
     Initially it only contains non-heavy rows.
 */
 
-void Codec::SetupTriangle()
+template<typename IndexT>
+void CodecT<IndexT>::SetupTriangle()
 {
     CAT_IF_DUMP(cout << endl << "---- SetupTriangle ----" << endl << endl;)
 
     // Initialize pivot array to just non-heavy rows
-    const uint16_t pivot_count = _defer_count + _dense_count;
-    for (uint16_t pivot_i = 0; pivot_i < pivot_count; ++pivot_i)
+    const IndexT pivot_count = _defer_count + _dense_count;
+    for (IndexT pivot_i = 0; pivot_i < pivot_count; ++pivot_i)
     {
         _pivots[pivot_i] = pivot_i;
     }
@@ -2193,22 +2374,23 @@ void Codec::SetupTriangle()
         This function converts remaining extra rows to heavy rows and adds
     heavy rows to the GE matrix.
 */
-void Codec::InsertHeavyRows()
+template<typename IndexT>
+void CodecT<IndexT>::InsertHeavyRows()
 {
     CAT_IF_DUMP(cout << endl << "---- InsertHeavyRows ----" << endl << endl;)
 
     CAT_IF_DUMP(cout << "Converting remaining extra rows to heavy...";)
 
     // Initialize index of first heavy pivot
-    uint16_t first_heavy_pivot = _pivot_count;
+    IndexT first_heavy_pivot = _pivot_count;
 
     // For each remaining pivot in the list,
-    const uint16_t column_count = _defer_count + _mix_count;
-    const uint16_t first_heavy_row = _defer_count + _dense_count;
+    const IndexT column_count = _defer_count + _mix_count;
+    const IndexT first_heavy_row = _defer_count + _dense_count;
     for (int pivot_j = _pivot_count - 1; pivot_j >= 0; --pivot_j)
     {
         // If row is extra,
-        uint16_t ge_row_j = _pivots[pivot_j];
+        IndexT ge_row_j = _pivots[pivot_j];
         if (ge_row_j < first_heavy_row)
         {
             continue;
@@ -2228,7 +2410,7 @@ void Codec::InsertHeavyRows()
         // Copy heavy columns to heavy matrix row
         uint8_t * GF256_RESTRICT extra_row = _heavy_matrix + _heavy_pitch * (ge_row_j - first_heavy_row);
         uint64_t * GF256_RESTRICT ge_extra_row = _ge_matrix + _ge_pitch * ge_row_j;
-        for (uint16_t ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
+        for (IndexT ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
         {
             extra_row[ge_column_j - _first_heavy_column] = (ge_extra_row[ge_column_j >> 6] >> (ge_column_j & 63)) & 1;
         }
@@ -2240,7 +2422,7 @@ void Codec::InsertHeavyRows()
     _first_heavy_pivot = first_heavy_pivot;
 
     // Add heavy rows at the end to cause them to be selected last if given a choice
-    for (uint16_t heavy_i = 0; heavy_i < CAT_HEAVY_ROWS; ++heavy_i)
+    for (IndexT heavy_i = 0; heavy_i < CAT_HEAVY_ROWS; ++heavy_i)
     {
         // Use GE row index after extra count even if not all are used yet
         _pivots[_pivot_count + heavy_i] = first_heavy_row + _extra_count + heavy_i;
@@ -2259,15 +2441,16 @@ void Codec::InsertHeavyRows()
     heavy rows of the matrix to the pivot list.
 */
 
-bool Codec::TriangleNonHeavy()
+template<typename IndexT>
+bool CodecT<IndexT>::TriangleNonHeavy()
 {
     CAT_IF_DUMP(cout << endl << "---- TriangleNonHeavy ----" << endl << endl;)
 
-    const uint16_t pivot_count = _pivot_count;
-    const uint16_t first_heavy_column = _first_heavy_column;
+    const IndexT pivot_count = _pivot_count;
+    const IndexT first_heavy_column = _first_heavy_column;
 
     // For the columns that are not protected by heavy rows:
-    uint16_t pivot_i = _next_pivot;
+    IndexT pivot_i = _next_pivot;
     uint64_t ge_mask = (uint64_t)1 << (pivot_i & 63);
     for (; pivot_i < first_heavy_column; ++pivot_i)
     {
@@ -2277,10 +2460,10 @@ bool Codec::TriangleNonHeavy()
 
         // For each remaining GE row that might be the pivot:
         uint64_t * GF256_RESTRICT ge_matrix_offset = _ge_matrix + word_offset;
-        for (uint16_t pivot_j = pivot_i; pivot_j < pivot_count; ++pivot_j)
+        for (IndexT pivot_j = pivot_i; pivot_j < pivot_count; ++pivot_j)
         {
             // Determine if the row contains the bit we want
-            uint16_t ge_row_j = _pivots[pivot_j];
+            IndexT ge_row_j = _pivots[pivot_j];
 
             // If the bit was not found:
             uint64_t * GF256_RESTRICT ge_row = &ge_matrix_offset[_ge_pitch * ge_row_j];
@@ -2301,10 +2484,10 @@ bool Codec::TriangleNonHeavy()
             uint64_t row0 = (*ge_row & ~(ge_mask - 1)) ^ ge_mask;
 
             // For each remaining unused row:
-            for (uint16_t pivot_k = pivot_j + 1; pivot_k < pivot_count; ++pivot_k)
+            for (IndexT pivot_k = pivot_j + 1; pivot_k < pivot_count; ++pivot_k)
             {
                 // Determine if the row contains the bit we want
-                uint16_t ge_row_k = _pivots[pivot_k];
+                IndexT ge_row_k = _pivots[pivot_k];
                 uint64_t * GF256_RESTRICT rem_row = &ge_matrix_offset[_ge_pitch * ge_row_k];
 
                 // If the bit was found:
@@ -2382,11 +2565,12 @@ static uint32_t GF256_MULT_LOOKUP[16] = {
 
 #endif // CAT_HEAVY_WIN_MULT
 
-bool Codec::Triangle()
+template<typename IndexT>
+bool CodecT<IndexT>::Triangle()
 {
     CAT_IF_DUMP(cout << endl << "---- Triangle ----" << endl << endl;)
 
-    const uint16_t first_heavy_column = _first_heavy_column;
+    const IndexT first_heavy_column = _first_heavy_column;
 
     // If next pivot is not heavy:
     if (_next_pivot < first_heavy_column && !TriangleNonHeavy())
@@ -2394,27 +2578,27 @@ bool Codec::Triangle()
         return false;
     }
 
-    const uint16_t pivot_count = _pivot_count;
-    const uint16_t column_count = _defer_count + _mix_count;
-    const uint16_t first_heavy_row = _defer_count + _dense_count;
-    uint16_t first_heavy_pivot = _first_heavy_pivot;
+    const IndexT pivot_count = _pivot_count;
+    const IndexT column_count = _defer_count + _mix_count;
+    const IndexT first_heavy_row = _defer_count + _dense_count;
+    IndexT first_heavy_pivot = _first_heavy_pivot;
 
     // For each heavy pivot to determine:
     uint64_t ge_mask = (uint64_t)1 << (_next_pivot & 63);
-    for (uint16_t pivot_i = _next_pivot; pivot_i < column_count;
+    for (IndexT pivot_i = _next_pivot; pivot_i < column_count;
         ++pivot_i, ge_mask = CAT_ROL64(ge_mask, 1))
     {
-        const uint16_t heavy_col_i = pivot_i - first_heavy_column;
+        const IndexT heavy_col_i = pivot_i - first_heavy_column;
 
         // For each remaining GE row that might be the pivot:
         int word_offset = pivot_i >> 6;
         uint64_t * GF256_RESTRICT ge_matrix_offset = _ge_matrix + word_offset;
         bool found = false;
-        uint16_t pivot_j;
+        IndexT pivot_j;
         for (pivot_j = pivot_i; pivot_j < first_heavy_pivot; ++pivot_j)
         {
             // If the bit was not found:
-            uint16_t ge_row_j = _pivots[pivot_j];
+            IndexT ge_row_j = _pivots[pivot_j];
             uint64_t * GF256_RESTRICT ge_row = &ge_matrix_offset[_ge_pitch * ge_row_j];
             if (!(*ge_row & ge_mask))
             {
@@ -2433,11 +2617,11 @@ bool Codec::Triangle()
             uint64_t row0 = (*ge_row & ~(ge_mask - 1)) ^ ge_mask;
 
             // For each remaining light row:
-            uint16_t pivot_k = pivot_j + 1;
+            IndexT pivot_k = pivot_j + 1;
             for (; pivot_k < first_heavy_pivot; ++pivot_k)
             {
                 // Determine if the row contains the bit we want
-                uint16_t ge_row_k = _pivots[pivot_k];
+                IndexT ge_row_k = _pivots[pivot_k];
                 uint64_t * GF256_RESTRICT rem_row = &ge_matrix_offset[_ge_pitch * ge_row_k];
 
                 // If the bit was found:
@@ -2458,7 +2642,7 @@ bool Codec::Triangle()
             for (; pivot_k < pivot_count; ++pivot_k)
             {
                 // If the column is non-zero:
-                uint16_t heavy_row_k = _pivots[pivot_k] - first_heavy_row;
+                IndexT heavy_row_k = _pivots[pivot_k] - first_heavy_row;
                 uint8_t * GF256_RESTRICT rem_row = &_heavy_matrix[_heavy_pitch * heavy_row_k];
                 uint8_t code_value = rem_row[heavy_col_i];
                 if (!code_value)
@@ -2481,7 +2665,7 @@ bool Codec::Triangle()
                 }
 #else // CAT_HEAVY_WIN_MULT
                 // Unroll odd columns:
-                uint16_t odd_count = pivot_i & 3, ge_column_i = pivot_i + 1;
+                IndexT odd_count = pivot_i & 3, ge_column_i = pivot_i + 1;
                 uint64_t temp_mask = ge_mask;
                 switch (odd_count)
                 {
@@ -2540,8 +2724,8 @@ bool Codec::Triangle()
         if (!found) for (; pivot_j < _pivot_count; ++pivot_j)
         {
             // If heavy row doesn't have the pivot:
-            uint16_t ge_row_j = _pivots[pivot_j];
-            uint16_t heavy_row_j = ge_row_j - first_heavy_row;
+            IndexT ge_row_j = _pivots[pivot_j];
+            IndexT heavy_row_j = ge_row_j - first_heavy_row;
             uint8_t * GF256_RESTRICT pivot_row = &_heavy_matrix[_heavy_pitch * heavy_row_j];
             uint8_t code_value = pivot_row[heavy_col_i];
             if (!code_value)
@@ -2561,7 +2745,7 @@ bool Codec::Triangle()
             if (pivot_i < first_heavy_pivot)
             {
                 // Swap pivot j with first heavy pivot
-                uint16_t temp = _pivots[first_heavy_pivot];
+                IndexT temp = _pivots[first_heavy_pivot];
                 _pivots[first_heavy_pivot] = _pivots[pivot_j];
                 _pivots[pivot_j] = temp;
 
@@ -2570,15 +2754,15 @@ bool Codec::Triangle()
             }
 
             // If there are any remaining rows:
-            uint16_t pivot_k = pivot_j + 1;
+            IndexT pivot_k = pivot_j + 1;
             if (pivot_k < pivot_count)
             {
                 // For each remaining unused row:
                 // NOTE: All remaining rows are heavy rows by pivot array organization
                 for (; pivot_k < pivot_count; ++pivot_k)
                 {
-                    uint16_t ge_row_k = _pivots[pivot_k];
-                    uint16_t heavy_row_k = ge_row_k - first_heavy_row;
+                    IndexT ge_row_k = _pivots[pivot_k];
+                    IndexT heavy_row_k = ge_row_k - first_heavy_row;
                     uint8_t * GF256_RESTRICT rem_row = &_heavy_matrix[_heavy_pitch * heavy_row_k];
                     uint8_t rem_value = rem_row[heavy_col_i];
 
@@ -2644,23 +2828,24 @@ bool Codec::Triangle()
             Set the GE row map entry to LIST_TERM so it can be ignored later.
 */
 
-void Codec::InitializeColumnValues()
+template<typename IndexT>
+void CodecT<IndexT>::InitializeColumnValues()
 {
     CAT_IF_DUMP(cout << endl << "---- InitializeColumnValues ----" << endl << endl;)
 
-    CAT_IF_ROWOP(uint32_t rowops = 0;)
+    uint32_t rowops = 0;
 
-    const uint16_t first_heavy_row = _defer_count + _dense_count;
-    const uint16_t column_count = _defer_count + _mix_count;
+    const IndexT first_heavy_row = _defer_count + _dense_count;
+    const IndexT column_count = _defer_count + _mix_count;
 
     // For each pivot,
-    uint16_t pivot_i;
+    IndexT pivot_i;
     for (pivot_i = 0; pivot_i < column_count; ++pivot_i)
     {
         // Lookup pivot column, GE row, and destination buffer
-        uint16_t dest_column_i = _ge_col_map[pivot_i];
-        uint16_t ge_row_i = _pivots[pivot_i];
-        uint8_t * GF256_RESTRICT buffer_dest = _recovery_blocks + _block_bytes * dest_column_i;
+        IndexT dest_column_i = _ge_col_map[pivot_i];
+        IndexT ge_row_i = _pivots[pivot_i];
+        uint8_t * GF256_RESTRICT buffer_dest = _recovery_blocks + (size_t)_block_bytes * dest_column_i;
 
         CAT_IF_DUMP(cout << "Pivot " << pivot_i << " solving column " << dest_column_i << " with GE row " << ge_row_i << " : ";)
 
@@ -2675,14 +2860,14 @@ void Codec::InitializeColumnValues()
             _ge_row_map[ge_row_i] = dest_column_i;
 
             CAT_IF_DUMP(cout << "[0]" << endl;)
-            CAT_IF_ROWOP(++rowops;)
+            ++rowops;
 
             continue;
         }
 
         // Look up row and input value for GE row
-        uint16_t row_i = _ge_row_map[ge_row_i];
-        const uint8_t * GF256_RESTRICT combo = _input_blocks + _block_bytes * row_i;
+        IndexT row_i = _ge_row_map[ge_row_i];
+        const uint8_t * GF256_RESTRICT combo = InputRow(row_i);
         PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
 
         CAT_IF_DUMP(cout << "[" << (int)combo[0] << "]";)
@@ -2692,32 +2877,31 @@ void Codec::InitializeColumnValues()
         {
             memcpy(buffer_dest, combo, _input_final_bytes);
             memset(buffer_dest + _input_final_bytes, 0, _block_bytes - _input_final_bytes);
-            CAT_IF_ROWOP(++rowops;)
+            ++rowops;
             combo = 0;
         }
 
         // Eliminate peeled columns:
-        uint16_t column_i = row->peel_x0;
-        uint16_t a = row->peel_a;
-        uint16_t weight = row->peel_weight;
+        IndexT column_i = row->peel_x0;
+        IndexT a = row->peel_a;
+        IndexT weight = row->peel_weight;
         for (;;)
         {
             // If column is peeled,
-            PeelColumn * GF256_RESTRICT column = &_peel_cols[column_i];
-            if (column->mark == MARK_PEEL)
+            if (_peel_col_marks[column_i] == MARK_PEEL)
             {
                 // If combo unused,
                 if (!combo)
                 {
-                    gf256_add_mem(buffer_dest, _recovery_blocks + _block_bytes * column_i, _block_bytes);
+                    gf256_add_mem(buffer_dest, _recovery_blocks + (size_t)_block_bytes * column_i, _block_bytes);
                 }
                 else
                 {
                     // Use combo
-                    gf256_addset_mem(buffer_dest, combo, _recovery_blocks + _block_bytes * column_i, _block_bytes);
+                    gf256_addset_mem(buffer_dest, combo, _recovery_blocks + (size_t)_block_bytes * column_i, _block_bytes);
                     combo = 0;
                 }
-                CAT_IF_ROWOP(++rowops;)
+                ++rowops;
             }
 
             if (--weight <= 0)
@@ -2739,7 +2923,7 @@ void Codec::InitializeColumnValues()
     // For each remaining pivot,
     for (; pivot_i < _pivot_count; ++pivot_i)
     {
-        uint16_t ge_row_i = _pivots[pivot_i];
+        IndexT ge_row_i = _pivots[pivot_i];
 
         // If row is a dense row,
         if (ge_row_i < _dense_count ||
@@ -2756,7 +2940,7 @@ void Codec::InitializeColumnValues()
         }
     }
 
-    CAT_IF_ROWOP(cout << "InitializeColumnValues used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+    AddRowOps(PHASE_COLUMN_VALUES, rowops, 0);
 }
 
 /*
@@ -2771,11 +2955,12 @@ void Codec::InitializeColumnValues()
     design of the dense row structure.
 */
 
-void Codec::MultiplyDenseValues()
+template<typename IndexT>
+void CodecT<IndexT>::MultiplyDenseValues()
 {
     CAT_IF_DUMP(cout << endl << "---- MultiplyDenseValues ----" << endl << endl;)
 
-    CAT_IF_ROWOP(uint32_t rowops = 0;)
+    uint32_t rowops = 0;
 
     // Initialize PRNG
     Abyssinian prng;
@@ -2783,13 +2968,13 @@ void Codec::MultiplyDenseValues()
 
     // For each block of columns,
     const int dense_count = _dense_count;
-    uint8_t * GF256_RESTRICT temp_block = _recovery_blocks + _block_bytes * (_block_count + _mix_count);
+    uint8_t * GF256_RESTRICT temp_block = _recovery_blocks + (size_t)_block_bytes * (_block_count + _mix_count);
     const uint8_t * GF256_RESTRICT source_block = _recovery_blocks;
-    PeelColumn * GF256_RESTRICT column = _peel_cols;
-    uint16_t rows[CAT_MAX_DENSE_ROWS], bits[CAT_MAX_DENSE_ROWS];
-    const uint16_t block_count = _block_count;
-    for (uint16_t column_i = 0; column_i < block_count; column_i += dense_count,
-        column += dense_count, source_block += _block_bytes * dense_count)
+    const uint8_t * GF256_RESTRICT mark = _peel_col_marks;
+    uint16_t rows[MAX_DENSE_ROWS], bits[MAX_DENSE_ROWS];
+    const IndexT block_count = _block_count;
+    for (IndexT column_i = 0; column_i < block_count; column_i += dense_count,
+        mark += dense_count, source_block += (size_t)_block_bytes * dense_count)
     {
         // Handle final columns
         int max_x = dense_count;
@@ -2814,17 +2999,17 @@ void Codec::MultiplyDenseValues()
 
         // Generate first row
         const uint8_t * GF256_RESTRICT combo = 0;
-        CAT_IF_ROWOP(++rowops;)
+        ++rowops;
         for (int ii = 0; ii < set_count; ++ii)
         {
             // If bit is peeled,
             int bit_i = set_bits[ii];
-            if (bit_i < max_x && column[bit_i].mark == MARK_PEEL)
+            if (bit_i < max_x && mark[bit_i] == MARK_PEEL)
             {
                 CAT_IF_DUMP(cout << " " << column_i + bit_i;)
 
                 // If no combo used yet,
-                const uint8_t * GF256_RESTRICT src = source_block + _block_bytes * bit_i;
+                const uint8_t * GF256_RESTRICT src = source_block + (size_t)_block_bytes * bit_i;
                 if (!combo)
                 {
                     combo = src;
@@ -2833,13 +3018,13 @@ void Codec::MultiplyDenseValues()
                 {
                     // Else if combo has been used: XOR it in
                     gf256_add_mem(temp_block, src, _block_bytes);
-                    CAT_IF_ROWOP(++rowops;)
+                    ++rowops;
                 }
                 else
                 {
                     // Else if combo needs to be used: Combine into block
                     gf256_addset_mem(temp_block, combo, src, _block_bytes);
-                    CAT_IF_ROWOP(++rowops;)
+                    ++rowops;
                     combo = temp_block;
                 }
             }
@@ -2858,15 +3043,15 @@ void Codec::MultiplyDenseValues()
             if (combo != temp_block)
             {
                 memcpy(temp_block, combo, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                ++rowops;
             }
 
             // Store in destination column in recovery blocks
-            uint16_t dest_column_i = _ge_row_map[*row];
+            IndexT dest_column_i = _ge_row_map[*row];
             if (dest_column_i != LIST_TERM)
             {
-                gf256_add_mem(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                gf256_add_mem(_recovery_blocks + (size_t)_block_bytes * dest_column_i, temp_block, _block_bytes);
+                ++rowops;
             }
         }
         ++row;
@@ -2882,35 +3067,35 @@ void Codec::MultiplyDenseValues()
 
             // Add in peeled columns
             int bit0 = set_bits[ii], bit1 = clr_bits[ii];
-            if (bit0 < max_x && column[bit0].mark == MARK_PEEL)
+            if (bit0 < max_x && mark[bit0] == MARK_PEEL)
             {
-                if (bit1 < max_x && column[bit1].mark == MARK_PEEL)
+                if (bit1 < max_x && mark[bit1] == MARK_PEEL)
                 {
                     CAT_IF_DUMP(cout << " " << column_i + bit0 << "+" << column_i + bit1;)
-                    gf256_add2_mem(temp_block, source_block + _block_bytes * bit0, source_block + _block_bytes * bit1, _block_bytes);
+                    gf256_add2_mem(temp_block, source_block + (size_t)_block_bytes * bit0, source_block + (size_t)_block_bytes * bit1, _block_bytes);
                 }
                 else
                 {
                     CAT_IF_DUMP(cout << " " << column_i + bit0;)
-                    gf256_add_mem(temp_block, source_block + _block_bytes * bit0, _block_bytes);
+                    gf256_add_mem(temp_block, source_block + (size_t)_block_bytes * bit0, _block_bytes);
                 }
-                CAT_IF_ROWOP(++rowops;)
+                ++rowops;
             }
-            else if (bit1 < max_x && column[bit1].mark == MARK_PEEL)
+            else if (bit1 < max_x && mark[bit1] == MARK_PEEL)
             {
                 CAT_IF_DUMP(cout << " " << column_i + bit1;)
-                gf256_add_mem(temp_block, source_block + _block_bytes * bit1, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                gf256_add_mem(temp_block, source_block + (size_t)_block_bytes * bit1, _block_bytes);
+                ++rowops;
             }
 
             CAT_IF_DUMP(cout << endl;)
 
             // Store in destination column in recovery blocks
-            uint16_t dest_column_i = _ge_row_map[*row++];
+            IndexT dest_column_i = _ge_row_map[*row++];
             if (dest_column_i != LIST_TERM)
             {
-                gf256_add_mem(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                gf256_add_mem(_recovery_blocks + (size_t)_block_bytes * dest_column_i, temp_block, _block_bytes);
+                ++rowops;
             }
         }
 
@@ -2925,40 +3110,40 @@ void Codec::MultiplyDenseValues()
 
             // Add in peeled columns
             int bit0 = set_bits[ii], bit1 = clr_bits[ii];
-            if (bit0 < max_x && column[bit0].mark == MARK_PEEL)
+            if (bit0 < max_x && mark[bit0] == MARK_PEEL)
             {
-                if (bit1 < max_x && column[bit1].mark == MARK_PEEL)
+                if (bit1 < max_x && mark[bit1] == MARK_PEEL)
                 {
                     CAT_IF_DUMP(cout << " " << column_i + bit0 << "+" << column_i + bit1;)
-                    gf256_add2_mem(temp_block, source_block + _block_bytes * bit0, source_block + _block_bytes * bit1, _block_bytes);
+                    gf256_add2_mem(temp_block, source_block + (size_t)_block_bytes * bit0, source_block + (size_t)_block_bytes * bit1, _block_bytes);
                 }
                 else
                 {
                     CAT_IF_DUMP(cout << " " << column_i + bit0;)
-                    gf256_add_mem(temp_block, source_block + _block_bytes * bit0, _block_bytes);
+                    gf256_add_mem(temp_block, source_block + (size_t)_block_bytes * bit0, _block_bytes);
                 }
-                CAT_IF_ROWOP(++rowops;)
+                ++rowops;
             }
-            else if (bit1 < max_x && column[bit1].mark == MARK_PEEL)
+            else if (bit1 < max_x && mark[bit1] == MARK_PEEL)
             {
                 CAT_IF_DUMP(cout << " " << column_i + bit1;)
-                gf256_add_mem(temp_block, source_block + _block_bytes * bit1, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                gf256_add_mem(temp_block, source_block + (size_t)_block_bytes * bit1, _block_bytes);
+                ++rowops;
             }
 
             CAT_IF_DUMP(cout << endl;)
 
             // Store in destination column in recovery blocks
-            uint16_t dest_column_i = _ge_row_map[*row++];
+            IndexT dest_column_i = _ge_row_map[*row++];
             if (dest_column_i != LIST_TERM)
             {
-                gf256_add_mem(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                gf256_add_mem(_recovery_blocks + (size_t)_block_bytes * dest_column_i, temp_block, _block_bytes);
+                ++rowops;
             }
         }
     } // next column
 
-    CAT_IF_ROWOP(cout << "MultiplyDenseValues used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+    AddRowOps(PHASE_DENSE_VALUES, rowops, 0);
 }
 
 /*
@@ -2977,18 +3162,19 @@ void Codec::MultiplyDenseValues()
 #define CAT_UNDER_WIN_THRESH_6 (85 + 6)
 #define CAT_UNDER_WIN_THRESH_7 (138 + 7)
 
-void Codec::AddSubdiagonalValues()
+template<typename IndexT>
+void CodecT<IndexT>::AddSubdiagonalValues()
 {
     CAT_IF_DUMP(cout << endl << "---- AddSubdiagonalValues ----" << endl << endl;)
 
-    CAT_IF_ROWOP(uint32_t rowops = 0; int heavyops = 0;)
+    uint32_t rowops = 0, heavyops = 0;
 
     const int column_count = _defer_count + _mix_count;
     int pivot_i = 0;
-    const uint16_t first_heavy_row = _defer_count + _dense_count;
+    const IndexT first_heavy_row = _defer_count + _dense_count;
 
 #if defined(CAT_WINDOWED_LOWERTRI)
-    const uint16_t first_non_binary_row = first_heavy_row + _extra_count;
+    const IndexT first_non_binary_row = first_heavy_row + _extra_count;
 
     // Build temporary storage space if windowing is to be used
     if (column_count >= CAT_UNDER_WIN_THRESH_5)
@@ -3023,13 +3209,13 @@ void Codec::AddSubdiagonalValues()
         // NOTE: The peeled column values were previously used up until this point,
         // but now they are unused, and so they can be reused for temporary space.
         uint8_t * GF256_RESTRICT win_table[128];
-        PeelColumn * GF256_RESTRICT column = _peel_cols;
+        const uint8_t * GF256_RESTRICT mark = _peel_col_marks;
         uint8_t * GF256_RESTRICT column_src = _recovery_blocks;
         uint32_t jj = 1;
-        for (uint32_t count = _block_count; count > 0; --count, ++column, column_src += _block_bytes)
+        for (uint32_t count = _block_count; count > 0; --count, ++mark, column_src += _block_bytes)
         {
             // If column is peeled:
-            if (column->mark == MARK_PEEL)
+            if (*mark == MARK_PEEL)
             {
                 // Reuse the block value temporarily as window table space
                 win_table[jj] = column_src;
@@ -3050,7 +3236,7 @@ void Codec::AddSubdiagonalValues()
         if (jj >= win_lim) for (;;)
         {
             // Calculate first column in window
-            uint16_t final_i = pivot_i + w - 1;
+            IndexT final_i = pivot_i + w - 1;
 
             CAT_IF_DUMP(cout << "-- Windowing from " << pivot_i << " to " << final_i << " (inclusive)" << endl;)
 
@@ -3061,7 +3247,7 @@ void Codec::AddSubdiagonalValues()
             for (int src_pivot_i = pivot_i; src_pivot_i < final_i;
                 ++src_pivot_i, ge_mask = CAT_ROL64(ge_mask, 1))
             {
-                uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
+                uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[src_pivot_i];
 
                 CAT_IF_DUMP(cout << "Back-substituting small triangle from pivot " << src_pivot_i << "[" << (int)src[0] << "] :";)
 
@@ -3070,15 +3256,15 @@ void Codec::AddSubdiagonalValues()
                 for (int dest_pivot_i = src_pivot_i + 1; dest_pivot_i <= final_i; ++dest_pivot_i)
                 {
                     // If row is heavy:
-                    uint16_t dest_row_i = _pivots[dest_pivot_i];
+                    IndexT dest_row_i = _pivots[dest_pivot_i];
 
                     // If bit is set in that row:
                     if (ge_row[_ge_pitch * dest_row_i] & ge_mask)
                     {
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[dest_pivot_i];
                         gf256_add_mem(dest, src, _block_bytes);
-                        CAT_IF_ROWOP(++rowops;)
+                        ++rowops;
 
                         CAT_IF_DUMP(cout << " " << dest_pivot_i;)
                     }
@@ -3090,53 +3276,53 @@ void Codec::AddSubdiagonalValues()
             CAT_IF_DUMP(cout << "-- Generating window table with " << w << " bits" << endl;)
 
             // Generate window table: 2 bits
-            win_table[1] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
-            win_table[2] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 1];
+            win_table[1] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i];
+            win_table[2] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i + 1];
             gf256_addset_mem(win_table[3], win_table[1], win_table[2], _block_bytes);
-            CAT_IF_ROWOP(++rowops;)
+            ++rowops;
 
             // Generate window table: 3 bits
-            win_table[4] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 2];
+            win_table[4] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i + 2];
             gf256_addset_mem(win_table[5], win_table[1], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[6], win_table[2], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[7], win_table[1], win_table[6], _block_bytes);
-            CAT_IF_ROWOP(rowops += 3;)
+            rowops += 3;
 
             // Generate window table: 4 bits
-            win_table[8] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 3];
+            win_table[8] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i + 3];
             for (int ii = 1; ii < 8; ++ii)
             {
                 gf256_addset_mem(win_table[8 + ii], win_table[ii], win_table[8], _block_bytes);
             }
-            CAT_IF_ROWOP(rowops += 7;)
+            rowops += 7;
 
             // Generate window table: 5+ bits
             if (w >= 5)
             {
-                win_table[16] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 4];
+                win_table[16] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i + 4];
                 for (int ii = 1; ii < 16; ++ii)
                 {
                     gf256_addset_mem(win_table[16 + ii], win_table[ii], win_table[16], _block_bytes);
                 }
-                CAT_IF_ROWOP(rowops += 15;)
+                rowops += 15;
 
                 if (w >= 6)
                 {
-                    win_table[32] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 5];
+                    win_table[32] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i + 5];
                     for (int ii = 1; ii < 32; ++ii)
                     {
                         gf256_addset_mem(win_table[32 + ii], win_table[ii], win_table[32], _block_bytes);
                     }
-                    CAT_IF_ROWOP(rowops += 31;)
+                    rowops += 31;
 
                     if (w >= 7)
                     {
-                        win_table[64] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 6];
+                        win_table[64] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i + 6];
                         for (int ii = 1; ii < 64; ++ii)
                         {
                             gf256_addset_mem(win_table[64 + ii], win_table[ii], win_table[64], _block_bytes);
                         }
-                        CAT_IF_ROWOP(rowops += 63;)
+                        rowops += 63;
                     }
                 }
             }
@@ -3145,14 +3331,14 @@ void Codec::AddSubdiagonalValues()
             uint32_t first_word = pivot_i >> 6;
             uint32_t shift0 = pivot_i & 63;
             uint32_t last_word = final_i >> 6;
-            uint16_t * GF256_RESTRICT pivot_row = _pivots + final_i + 1;
+            IndexT * GF256_RESTRICT pivot_row = _pivots + final_i + 1;
             if (first_word == last_word)
             {
                 // For each pivot row:
-                for (uint16_t ge_below_i = final_i + 1; ge_below_i < column_count; ++ge_below_i)
+                for (IndexT ge_below_i = final_i + 1; ge_below_i < column_count; ++ge_below_i)
                 {
                     // If pivot row is heavy:
-                    uint16_t ge_row_i = *pivot_row++;
+                    IndexT ge_row_i = *pivot_row++;
                     if (ge_row_i >= first_non_binary_row)
                     {
                         continue;
@@ -3168,9 +3354,9 @@ void Codec::AddSubdiagonalValues()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << ge_below_i << endl;)
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_below_i];
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
-                        CAT_IF_ROWOP(++rowops;)
+                        ++rowops;
                     }
                 }
             }
@@ -3179,10 +3365,10 @@ void Codec::AddSubdiagonalValues()
                 uint32_t shift1 = 64 - shift0;
 
                 // For each pivot row:
-                for (uint16_t ge_below_i = final_i + 1; ge_below_i < column_count; ++ge_below_i)
+                for (IndexT ge_below_i = final_i + 1; ge_below_i < column_count; ++ge_below_i)
                 {
                     // If pivot row is heavy:
-                    uint16_t ge_row_i = *pivot_row++;
+                    IndexT ge_row_i = *pivot_row++;
                     if (ge_row_i >= first_non_binary_row)
                     {
                         continue;
@@ -3198,9 +3384,9 @@ void Codec::AddSubdiagonalValues()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << ge_below_i << endl;)
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_below_i];
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
-                        CAT_IF_ROWOP(++rowops;)
+                        ++rowops;
                     }
                 }
             }
@@ -3239,25 +3425,25 @@ void Codec::AddSubdiagonalValues()
 #endif // CAT_WINDOWED_LOWERTRI
 
     // For each row to eliminate:
-    for (uint16_t ge_column_i = pivot_i + 1; ge_column_i < column_count; ++ge_column_i)
+    for (IndexT ge_column_i = pivot_i + 1; ge_column_i < column_count; ++ge_column_i)
     {
         // Lookup pivot column, GE row, and destination buffer
-        uint16_t column_i = _ge_col_map[ge_column_i];
-        uint16_t ge_row_i = _pivots[ge_column_i];
-        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * column_i;
+        IndexT column_i = _ge_col_map[ge_column_i];
+        IndexT ge_row_i = _pivots[ge_column_i];
+        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * column_i;
 
         CAT_IF_DUMP(cout << "Pivot " << ge_column_i << " solving column " << column_i << "[" << (int)dest[0] << "] with GE row " << ge_row_i << " :";)
 
-        uint16_t ge_limit = ge_column_i;
+        IndexT ge_limit = ge_column_i;
 
         // If row is heavy or extra:
         if (ge_row_i >= first_heavy_row)
         {
-            uint16_t heavy_row_i = ge_row_i - first_heavy_row;
+            IndexT heavy_row_i = ge_row_i - first_heavy_row;
 
             // For each column up to the diagonal:
             uint8_t * GF256_RESTRICT heavy_row = _heavy_matrix + _heavy_pitch * heavy_row_i;
-            for (uint16_t sub_i = _first_heavy_column; sub_i < ge_limit; ++sub_i)
+            for (IndexT sub_i = _first_heavy_column; sub_i < ge_limit; ++sub_i)
             {
                 // If column is zero:
                 uint8_t code_value = heavy_row[sub_i - _first_heavy_column];
@@ -3267,10 +3453,10 @@ void Codec::AddSubdiagonalValues()
                 }
 
                 // Look up data source
-                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[sub_i];
+                const uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[sub_i];
 
                 gf256_muladd_mem(dest, code_value, src, _block_bytes);
-                CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
+                if (code_value == 1) ++rowops; else ++heavyops;
                 CAT_IF_DUMP(cout << " h" << ge_column_i << "=[" << (int)src[0] << "*" << (int)code_value << "]";)
             }
 
@@ -3293,16 +3479,16 @@ void Codec::AddSubdiagonalValues()
         // For each GE matrix bit in the row:
         uint64_t * GF256_RESTRICT ge_row = _ge_matrix + _ge_pitch * ge_row_i;
         uint64_t ge_mask = (uint64_t)1 << (pivot_i & 63);
-        for (uint16_t ge_sub_i = pivot_i; ge_sub_i < ge_limit; ++ge_sub_i, ge_mask = CAT_ROL64(ge_mask, 1))
+        for (IndexT ge_sub_i = pivot_i; ge_sub_i < ge_limit; ++ge_sub_i, ge_mask = CAT_ROL64(ge_mask, 1))
         {
             // If bit is non-zero:
             if (ge_row[ge_sub_i >> 6] & ge_mask)
             {
                 // Add pivot for non-zero bit to destination row value
-                uint16_t column_i = _ge_col_map[ge_sub_i];
-                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * column_i;
+                IndexT column_i = _ge_col_map[ge_sub_i];
+                const uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * column_i;
                 gf256_add_mem(dest, src, _block_bytes);
-                CAT_IF_ROWOP(++rowops;)
+                ++rowops;
 
                 CAT_IF_DUMP(cout << " " << ge_sub_i << "=[" << (int)src[0] << "]";)
             }
@@ -3311,7 +3497,7 @@ void Codec::AddSubdiagonalValues()
         CAT_IF_DUMP(cout << endl;)
     }
 
-    CAT_IF_ROWOP(cout << "AddSubdiagonalValues used " << rowops << " row ops = " << rowops / (double)_block_count << "*N and " << heavyops << " heavy ops" << endl;)
+    AddRowOps(PHASE_SUBDIAGONAL, rowops, heavyops);
 }
 
 /*
@@ -3393,16 +3579,17 @@ void Codec::AddSubdiagonalValues()
     completing solving for these columns.
 */
 
-void Codec::BackSubstituteAboveDiagonal()
+template<typename IndexT>
+void CodecT<IndexT>::BackSubstituteAboveDiagonal()
 {
     CAT_IF_DUMP(cout << endl << "---- BackSubstituteAboveDiagonal ----" << endl << endl;)
 
-    CAT_IF_ROWOP(uint32_t rowops = 0; int heavyops = 0;)
+    uint32_t rowops = 0, heavyops = 0;
 
     const int pivot_count = _defer_count + _mix_count;
     int pivot_i = pivot_count - 1;
-    const uint16_t first_heavy_row = _defer_count + _dense_count;
-    const uint16_t first_heavy_column = _first_heavy_column;
+    const IndexT first_heavy_row = _defer_count + _dense_count;
+    const IndexT first_heavy_column = _first_heavy_column;
 
 #if defined(CAT_WINDOWED_BACKSUB)
     // Build temporary storage space if windowing is to be used
@@ -3438,13 +3625,13 @@ void Codec::BackSubstituteAboveDiagonal()
         // NOTE: The peeled column values were previously used up until this point,
         // but now they are unused, and so they can be reused for temporary space.
         uint8_t * GF256_RESTRICT win_table[128];
-        PeelColumn * GF256_RESTRICT column = _peel_cols;
+        const uint8_t * GF256_RESTRICT mark = _peel_col_marks;
         uint8_t * GF256_RESTRICT column_src = _recovery_blocks;
         uint32_t jj = 1;
-        for (uint32_t count = _block_count; count > 0; --count, ++column, column_src += _block_bytes)
+        for (uint32_t count = _block_count; count > 0; --count, ++mark, column_src += _block_bytes)
         {
             // If column is peeled,
-            if (column->mark == MARK_PEEL)
+            if (*mark == MARK_PEEL)
             {
                 // Reuse the block value temporarily as window table space
                 win_table[jj] = column_src;
@@ -3465,7 +3652,7 @@ void Codec::BackSubstituteAboveDiagonal()
         if (jj >= win_lim) for (;;)
         {
             // Calculate first column in window
-            uint16_t backsub_i = pivot_i - w + 1;
+            IndexT backsub_i = pivot_i - w + 1;
 
             CAT_IF_DUMP(cout << "-- Windowing from " << backsub_i << " to " << pivot_i << " (inclusive)" << endl;)
 
@@ -3476,22 +3663,22 @@ void Codec::BackSubstituteAboveDiagonal()
             for (int src_pivot_i = pivot_i; src_pivot_i > backsub_i;
                 --src_pivot_i, ge_mask = CAT_ROR64(ge_mask, 1))
             {
-                uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
+                uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[src_pivot_i];
 
                 // If diagonal element is heavy,
-                uint16_t ge_row_i = _pivots[src_pivot_i];
+                IndexT ge_row_i = _pivots[src_pivot_i];
                 if (ge_row_i >= first_heavy_row && src_pivot_i >= first_heavy_column)
                 {
                     // Look up row value
-                    uint16_t heavy_row_i = ge_row_i - first_heavy_row;
-                    uint16_t heavy_col_i = src_pivot_i - first_heavy_column;
+                    IndexT heavy_row_i = ge_row_i - first_heavy_row;
+                    IndexT heavy_col_i = src_pivot_i - first_heavy_column;
                     uint8_t code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 
                     // Normalize code value, setting it to 1 (implicitly nonzero)
                     if (code_value != 1)
                     {
                         gf256_div_mem(src, src, code_value, _block_bytes);
-                        CAT_IF_ROWOP(++heavyops;)
+                        ++heavyops;
                     }
 
                     CAT_IF_DUMP(cout << "Normalized diagonal for heavy pivot " << pivot_i << endl;)
@@ -3504,12 +3691,12 @@ void Codec::BackSubstituteAboveDiagonal()
                 for (int dest_pivot_i = backsub_i; dest_pivot_i < src_pivot_i; ++dest_pivot_i)
                 {
                     // If row is heavy,
-                    uint16_t dest_row_i = _pivots[dest_pivot_i];
+                    IndexT dest_row_i = _pivots[dest_pivot_i];
                     if (dest_row_i >= first_heavy_row && src_pivot_i >= first_heavy_column)
                     {
                         // If column is zero,
-                        uint16_t heavy_row_i = dest_row_i - first_heavy_row;
-                        uint16_t heavy_col_i = src_pivot_i - first_heavy_column;
+                        IndexT heavy_row_i = dest_row_i - first_heavy_row;
+                        IndexT heavy_col_i = src_pivot_i - first_heavy_column;
                         uint8_t code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
                         if (!code_value)
                         {
@@ -3517,9 +3704,9 @@ void Codec::BackSubstituteAboveDiagonal()
                         }
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[dest_pivot_i];
                         gf256_muladd_mem(dest, code_value, src, _block_bytes);
-                        CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
+                        if (code_value == 1) ++rowops; else ++heavyops;
                         CAT_IF_DUMP(cout << " h" << dest_pivot_i;)
                     }
                     else
@@ -3528,9 +3715,9 @@ void Codec::BackSubstituteAboveDiagonal()
                         if (ge_row[_ge_pitch * dest_row_i] & ge_mask)
                         {
                             // Back-substitute
-                            uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+                            uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[dest_pivot_i];
                             gf256_add_mem(dest, src, _block_bytes);
-                            CAT_IF_ROWOP(++rowops;)
+                            ++rowops;
 
                             CAT_IF_DUMP(cout << " " << dest_pivot_i;)
                         }
@@ -3541,73 +3728,73 @@ void Codec::BackSubstituteAboveDiagonal()
             } // next pivot
 
             // Normalize the final diagonal element
-            uint16_t ge_row_i = _pivots[backsub_i];
+            IndexT ge_row_i = _pivots[backsub_i];
             if (ge_row_i >= first_heavy_row && backsub_i >= first_heavy_column)
             {
                 // Look up row value
-                uint16_t heavy_row_i = ge_row_i - first_heavy_row;
-                uint16_t heavy_col_i = backsub_i - first_heavy_column;
+                IndexT heavy_row_i = ge_row_i - first_heavy_row;
+                IndexT heavy_col_i = backsub_i - first_heavy_column;
                 uint8_t code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 
                 // Divide by this code value (implicitly nonzero)
                 if (code_value != 1)
                 {
-                    uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
+                    uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i];
                     gf256_div_mem(src, src, code_value, _block_bytes);
-                    CAT_IF_ROWOP(++heavyops;)
+                    ++heavyops;
                 }
             }
 
             CAT_IF_DUMP(cout << "-- Generating window table with " << w << " bits" << endl;)
 
             // Generate window table: 2 bits
-            win_table[1] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
-            win_table[2] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 1];
+            win_table[1] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i];
+            win_table[2] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i + 1];
             gf256_addset_mem(win_table[3], win_table[1], win_table[2], _block_bytes);
-            CAT_IF_ROWOP(++rowops;)
+            ++rowops;
 
             // Generate window table: 3 bits
-            win_table[4] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 2];
+            win_table[4] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i + 2];
             gf256_addset_mem(win_table[5], win_table[1], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[6], win_table[2], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[7], win_table[1], win_table[6], _block_bytes);
-            CAT_IF_ROWOP(rowops += 3;)
+            rowops += 3;
 
             // Generate window table: 4 bits
-            win_table[8] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 3];
+            win_table[8] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i + 3];
             for (int ii = 1; ii < 8; ++ii)
             {
                 gf256_addset_mem(win_table[8 + ii], win_table[ii], win_table[8], _block_bytes);
             }
-            CAT_IF_ROWOP(rowops += 7;)
+            rowops += 7;
 
             // Generate window table: 5+ bits
             if (w >= 5)
             {
-                win_table[16] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 4];
+                win_table[16] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i + 4];
                 for (int ii = 1; ii < 16; ++ii)
                 {
                     gf256_addset_mem(win_table[16 + ii], win_table[ii], win_table[16], _block_bytes);
                 }
-                CAT_IF_ROWOP(rowops += 15;)
+                rowops += 15;
 
                 if (w >= 6)
                 {
-                    win_table[32] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 5];
+                    win_table[32] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i + 5];
                     for (int ii = 1; ii < 32; ++ii)
                     {
                         gf256_addset_mem(win_table[32 + ii], win_table[ii], win_table[32], _block_bytes);
                     }
-                    CAT_IF_ROWOP(rowops += 31;)
+                    rowops += 31;
 
                     if (w >= 7)
                     {
-                        win_table[64] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 6];
+                        win_table[64] = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[backsub_i + 6];
                         for (int ii = 1; ii < 64; ++ii)
                         {
                             gf256_addset_mem(win_table[64 + ii], win_table[ii], win_table[64], _block_bytes);
                         }
-                        CAT_IF_ROWOP(rowops += 63;)
+                        rowops += 63;
                     }
                 }
             }
@@ -3616,20 +3803,20 @@ void Codec::BackSubstituteAboveDiagonal()
             if (pivot_i >= first_heavy_column)
             {
                 // For each pivot in the window,
-                uint16_t * GF256_RESTRICT pivot_row = _pivots;
-                for (uint16_t ge_above_i = 0; ge_above_i < backsub_i; ++ge_above_i)
+                IndexT * GF256_RESTRICT pivot_row = _pivots;
+                for (IndexT ge_above_i = 0; ge_above_i < backsub_i; ++ge_above_i)
                 {
                     // If row is not heavy,
-                    uint16_t ge_row_i = *pivot_row++;
+                    IndexT ge_row_i = *pivot_row++;
                     if (ge_row_i < first_heavy_row)
                     {
                         continue; // Skip it
                     }
 
-                    uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_above_i];
+                    uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_above_i];
 
                     // If the first column of window is not heavy,
-                    uint16_t ge_column_j = backsub_i;
+                    IndexT ge_column_j = backsub_i;
                     if (ge_column_j < first_heavy_column)
                     {
                         // For each non-heavy column in the extra row,
@@ -3640,16 +3827,16 @@ void Codec::BackSubstituteAboveDiagonal()
                             // If column is non-zero,
                             if (ge_row[ge_column_j >> 6] & ge_mask)
                             {
-                                const uint8_t *src = _recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
+                                const uint8_t *src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_column_j];
                                 gf256_add_mem(dest, src, _block_bytes);
-                                CAT_IF_ROWOP(++rowops;)
+                                ++rowops;
                             }
                         }
                     }
 
                     // For each heavy column,
-                    uint16_t heavy_row_i = ge_row_i - first_heavy_row;
-                    uint16_t heavy_col_j = ge_column_j - first_heavy_column;
+                    IndexT heavy_row_i = ge_row_i - first_heavy_row;
+                    IndexT heavy_col_j = ge_column_j - first_heavy_column;
                     uint8_t * GF256_RESTRICT heavy_row = &_heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_j];
                     for (; ge_column_j <= pivot_i; ++ge_column_j)
                     {
@@ -3661,28 +3848,28 @@ void Codec::BackSubstituteAboveDiagonal()
                         }
 
                         // Back-substitute
-                        const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
+                        const uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_column_j];
                         gf256_muladd_mem(dest, code_value, src, _block_bytes);
-                        CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
+                        if (code_value == 1) ++rowops; else ++heavyops;
                     } // next column in row
                 } // next pivot in window
             } // end if contains heavy
 
             // Only add window table entries for rows under this limit
-            uint16_t window_row_limit = (pivot_i >= first_heavy_column) ? first_heavy_row : 0x7fff;
+            IndexT window_row_limit = (pivot_i >= first_heavy_column) ? first_heavy_row : 0x7fff;
 
             // If not straddling words,
             uint32_t first_word = backsub_i >> 6;
             uint32_t shift0 = backsub_i & 63;
             uint32_t last_word = pivot_i >> 6;
-            uint16_t * GF256_RESTRICT pivot_row = _pivots;
+            IndexT * GF256_RESTRICT pivot_row = _pivots;
             if (first_word == last_word)
             {
                 // For each pivot row,
-                for (uint16_t above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
+                for (IndexT above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
                 {
                     // If pivot row is heavy,
-                    uint16_t ge_row_i = *pivot_row++;
+                    IndexT ge_row_i = *pivot_row++;
                     if (ge_row_i >= window_row_limit)
                     {
                         continue; // Skip it
@@ -3698,9 +3885,9 @@ void Codec::BackSubstituteAboveDiagonal()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << above_pivot_i << endl;)
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[above_pivot_i];
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
-                        CAT_IF_ROWOP(++rowops;)
+                        ++rowops;
                     }
                 }
             }
@@ -3709,10 +3896,10 @@ void Codec::BackSubstituteAboveDiagonal()
                 uint32_t shift1 = 64 - shift0;
 
                 // For each pivot row,
-                for (uint16_t above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
+                for (IndexT above_pivot_i = 0; above_pivot_i < backsub_i; ++above_pivot_i)
                 {
                     // If pivot row is heavy,
-                    uint16_t ge_row_i = *pivot_row++;
+                    IndexT ge_row_i = *pivot_row++;
                     if (ge_row_i >= window_row_limit)
                     {
                         continue; // Skip it
@@ -3728,9 +3915,9 @@ void Codec::BackSubstituteAboveDiagonal()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << above_pivot_i << endl;)
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[above_pivot_i];
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
-                        CAT_IF_ROWOP(++rowops;)
+                        ++rowops;
                     }
                 }
             }
@@ -3771,22 +3958,22 @@ void Codec::BackSubstituteAboveDiagonal()
     for (; pivot_i >= 0; --pivot_i, ge_mask = CAT_ROR64(ge_mask, 1))
     {
         // Calculate source
-        uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
+        uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[pivot_i];
 
         // If diagonal element is heavy,
-        uint16_t ge_row_i = _pivots[pivot_i];
+        IndexT ge_row_i = _pivots[pivot_i];
         if (ge_row_i >= first_heavy_row && pivot_i >= first_heavy_column)
         {
             // Look up row value
-            uint16_t heavy_row_i = ge_row_i - first_heavy_row;
-            uint16_t heavy_col_i = pivot_i - first_heavy_column;
+            IndexT heavy_row_i = ge_row_i - first_heavy_row;
+            IndexT heavy_col_i = pivot_i - first_heavy_column;
             uint8_t code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
 
             // Normalize code value, setting it to 1 (implicitly nonzero)
             if (code_value != 1)
             {
                 gf256_div_mem(src, src, code_value, _block_bytes);
-                CAT_IF_ROWOP(++heavyops;)
+                ++heavyops;
             }
 
             CAT_IF_DUMP(cout << "Normalized diagonal for heavy pivot " << pivot_i << endl;)
@@ -3799,12 +3986,12 @@ void Codec::BackSubstituteAboveDiagonal()
         for (int ge_up_i = 0; ge_up_i < pivot_i; ++ge_up_i)
         {
             // If element is heavy,
-            uint16_t up_row_i = _pivots[ge_up_i];
+            IndexT up_row_i = _pivots[ge_up_i];
             if (up_row_i >= first_heavy_row && ge_up_i >= first_heavy_column)
             {
                 // If column is zero,
-                uint16_t heavy_row_i = up_row_i - first_heavy_row;
-                uint16_t heavy_col_i = pivot_i - first_heavy_column;
+                IndexT heavy_row_i = up_row_i - first_heavy_row;
+                IndexT heavy_col_i = pivot_i - first_heavy_column;
                 uint8_t code_value = _heavy_matrix[_heavy_pitch * heavy_row_i + heavy_col_i];
                 if (!code_value)
                 {
@@ -3812,9 +3999,9 @@ void Codec::BackSubstituteAboveDiagonal()
                 }
 
                 // Back-substitute
-                uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
+                uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_up_i];
                 gf256_muladd_mem(dest, code_value, src, _block_bytes);
-                CAT_IF_ROWOP(if (code_value == 1) ++rowops; else ++heavyops;)
+                if (code_value == 1) ++rowops; else ++heavyops;
                 CAT_IF_DUMP(cout << " h" << up_row_i;)
             }
             else
@@ -3823,9 +4010,9 @@ void Codec::BackSubstituteAboveDiagonal()
                 if (ge_row[_ge_pitch * up_row_i] & ge_mask)
                 {
                     // Back-substitute
-                    uint8_t *dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
+                    uint8_t *dest = _recovery_blocks + (size_t)_block_bytes * _ge_col_map[ge_up_i];
                     gf256_add_mem(dest, src, _block_bytes);
-                    CAT_IF_ROWOP(++rowops;)
+                    ++rowops;
 
                     CAT_IF_DUMP(cout << " " << up_row_i;)
                 }
@@ -3835,7 +4022,7 @@ void Codec::BackSubstituteAboveDiagonal()
         CAT_IF_DUMP(cout << endl;)
     }
 
-    CAT_IF_ROWOP(cout << "BackSubstituteAboveDiagonal used " << rowops << " row ops = " << rowops / (double)_block_count << "*N and " << heavyops << " heavy ops" << endl;)
+    AddRowOps(PHASE_BACK_SUBSTITUTE, rowops, heavyops);
 }
 
 /*
@@ -3856,29 +4043,31 @@ void Codec::BackSubstituteAboveDiagonal()
     the rows from scratch and throw away those results.
 */
 
-void Codec::Substitute()
+template<typename IndexT>
+void CodecT<IndexT>::Substitute()
 {
     CAT_IF_DUMP(cout << endl << "---- Substitute ----" << endl << endl;)
 
-    CAT_IF_ROWOP(uint32_t rowops = 0;)
+    uint32_t rowops = 0;
 
     // For each column that has been peeled,
     PeelRow * GF256_RESTRICT row;
-    for (uint16_t row_i = _peel_head_rows; row_i != LIST_TERM; row_i = row->next)
+    for (IndexT row_i = _peel_head_rows; row_i != LIST_TERM; row_i = row->next)
     {
         row = &_peel_rows[row_i];
-        uint16_t dest_column_i = row->peel_column;
-        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * dest_column_i;
+        IndexT dest_column_i = row->peel_column;
+        uint8_t * GF256_RESTRICT dest = _recovery_blocks + (size_t)_block_bytes * dest_column_i;
 
         CAT_IF_DUMP(cout << "Generating column " << dest_column_i << ":";)
 
-        const uint8_t * GF256_RESTRICT input_src = _input_blocks + _block_bytes * row_i;
+        const uint8_t * GF256_RESTRICT input_src = InputRow(row_i);
         CAT_IF_DUMP(cout << " " << row_i << ":[" << (int)input_src[0] << "]";)
 
         // Set up mixing column generator
-        uint16_t mix_a = row->mix_a;
-        uint16_t mix_x = row->mix_x0;
-        const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+        const PeelRowInfo * GF256_RESTRICT info = &_peel_row_info[row_i];
+        IndexT mix_a = info->mix_a;
+        IndexT mix_x = info->mix_x0;
+        const uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
 
         // If copying from final block,
         if (row_i != _block_count - 1)
@@ -3890,36 +4079,36 @@ void Codec::Substitute()
             gf256_addset_mem(dest, src, input_src, _input_final_bytes);
             memcpy(dest + _input_final_bytes, src + _input_final_bytes, _block_bytes - _input_final_bytes);
         }
-        CAT_IF_ROWOP(++rowops;)
+        ++rowops;
 
         // Add next two mixing columns in
         IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-        const uint8_t * GF256_RESTRICT src0 = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+        const uint8_t * GF256_RESTRICT src0 = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
         IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-        const uint8_t * GF256_RESTRICT src1 = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+        const uint8_t * GF256_RESTRICT src1 = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
         gf256_add2_mem(dest, src0, src1, _block_bytes);
-        CAT_IF_ROWOP(++rowops;)
+        ++rowops;
 
         // If at least two peeling columns are set,
-        uint16_t weight = row->peel_weight;
+        IndexT weight = row->peel_weight;
         if (weight >= 2) // common case:
         {
-            uint16_t a = row->peel_a;
-            uint16_t column0 = row->peel_x0;
+            IndexT a = row->peel_a;
+            IndexT column0 = row->peel_x0;
             --weight;
 
-            uint16_t column_i = column0;
+            IndexT column_i = column0;
             IterateNextColumn(column_i, _block_count, _block_next_prime, a);
 
             // Common case:
             if (column0 != dest_column_i)
             {
-                const uint8_t * GF256_RESTRICT peel0 = _recovery_blocks + _block_bytes * column0;
+                const uint8_t * GF256_RESTRICT peel0 = _recovery_blocks + (size_t)_block_bytes * column0;
 
                 // Common case:
                 if (column_i != dest_column_i)
                 {
-                    gf256_add2_mem(dest, peel0, _recovery_blocks + _block_bytes * column_i, _block_bytes);
+                    gf256_add2_mem(dest, peel0, _recovery_blocks + (size_t)_block_bytes * column_i, _block_bytes);
                 }
                 else // rare:
                 {
@@ -3928,15 +4117,15 @@ void Codec::Substitute()
             }
             else // rare:
             {
-                gf256_add_mem(dest, _recovery_blocks + _block_bytes * column_i, _block_bytes);
+                gf256_add_mem(dest, _recovery_blocks + (size_t)_block_bytes * column_i, _block_bytes);
             }
-            CAT_IF_ROWOP(++rowops;)
+            ++rowops;
 
             // For each remaining column,
             while (--weight > 0)
             {
                 IterateNextColumn(column_i, _block_count, _block_next_prime, a);
-                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * column_i;
+                const uint8_t * GF256_RESTRICT src = _recovery_blocks + (size_t)_block_bytes * column_i;
 
                 CAT_IF_DUMP(cout << " " << column_i;)
 
@@ -3944,7 +4133,7 @@ void Codec::Substitute()
                 if (column_i != dest_column_i)
                 {
                     gf256_add_mem(dest, src, _block_bytes);
-                    CAT_IF_ROWOP(++rowops;)
+                    ++rowops;
                     CAT_IF_DUMP(cout << "[" << (int)src[0] << "]";)
                 }
                 else
@@ -3957,7 +4146,7 @@ void Codec::Substitute()
         CAT_IF_DUMP(cout << endl;)
     }
 
-    CAT_IF_ROWOP(cout << "Substitute used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+    AddRowOps(PHASE_SUBSTITUTE, rowops, 0);
 }
 
 
@@ -4123,47 +4312,285 @@ static const uint16_t SMALL_PEEL_SEEDS[262] = {
     2, 4, 39, 6, 22, 7, 12, 6, 14, 0, 5, 12, 15, 5, 19, 1
 };
 
+/*
+    Above D = 486 (N > 85600, 32-bit indices only) the dense rows are so
+    numerous that the seed matters much less.  Searching D in windows of 256
+    up to N = 1048576, the first seed tried made the encoder succeed at both
+    ends of every window, so a single seed is used for all of them.
+*/
+
+static const uint32_t LARGE_DENSE_SEED = 1;
+
 // 8KB bitfield table for seeds that cause the encoder to choke
 static const uint64_t EXCEPT_TABLE[1000] = {
-    // FIXME: We need to run this for 64K values of N...
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000040000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x2000000000000080ULL,
+    0x8000008000000000ULL, 0x4000000000000000ULL, 0x0000001010000000ULL, 0x0000000000040000ULL,
+    0x0000000200000000ULL, 0x0004000000000008ULL, 0x0080000000000080ULL, 0x0002002000200000ULL,
+    0x0000000000000000ULL, 0x0000020400000800ULL, 0x0000002000000400ULL, 0x0000000000000000ULL,
+    0x0800000000000100ULL, 0x0000000000040000ULL, 0x0000400040000000ULL, 0x0000100000000000ULL,
+    0x1000200000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000100000000ULL,
+    0x0000000000000000ULL, 0x0010000000000040ULL, 0x0000100000000000ULL, 0x0000004000000000ULL,
+    0x0000001000000000ULL, 0x0080000040000000ULL, 0x0040000000000000ULL, 0x8000000008000000ULL,
+    0x0000010000000000ULL, 0x0020000000000400ULL, 0x0000004000000000ULL, 0x0000000000000000ULL,
+    0x0000000002000000ULL, 0x0010000000000000ULL, 0x0000000028000000ULL, 0x0000000000020001ULL,
+    0x0000000000000820ULL, 0x0000080000000000ULL, 0x0000000000000000ULL, 0x4000000000000000ULL,
+    0x0000000000000000ULL, 0x1000000000000000ULL, 0x0000000000400000ULL, 0x0048800000000000ULL,
+    0x0010100000800000ULL, 0x0000000000000000ULL, 0x0000000000040080ULL, 0x0000008020010000ULL,
+    0x0001000001001000ULL, 0x0000000000000000ULL, 0x0000100000000000ULL, 0x0000000200000001ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000080000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000002081ULL, 0x0000000010040000ULL, 0x0000000080000000ULL,
+    0x0000040000004000ULL, 0x0000002000000080ULL, 0x0000000000008000ULL, 0x0048060080000000ULL,
+    0x0000000000200000ULL, 0x0000000000002000ULL, 0x0000010000040000ULL, 0x0000000000000001ULL,
+    0x0000000000000100ULL, 0x0000000000000000ULL, 0x00000000000a0000ULL, 0x0000000000040000ULL,
+    0x0000000000200100ULL, 0x2000800000000000ULL, 0x0000000000000008ULL, 0x0000000000000000ULL,
+    0x0000010000000000ULL, 0x0040000000000005ULL, 0x0000000000000400ULL, 0x0800000080004006ULL,
+    0x0000004000020000ULL, 0x0000500008002080ULL, 0x0000000000000100ULL, 0x0000000000000000ULL,
+    0x0000000000001000ULL, 0x0000000000080000ULL, 0x0000000004000000ULL, 0x0000000000000002ULL,
+    0x0000000001000000ULL, 0x0000000000001000ULL, 0x0000000000000100ULL, 0x0000000000000000ULL,
+    0x0000020000200008ULL, 0x0000002000000000ULL, 0x0020000020000000ULL, 0x0000000000000000ULL,
+    0x0000000000000100ULL, 0x0000000000000000ULL, 0x0008000000000000ULL, 0x0000000000200000ULL,
+    0x0100000000000000ULL, 0x0800000080001200ULL, 0x0004002000000000ULL, 0x0001004000000000ULL,
+    0x0000000000000400ULL, 0x0000000000000008ULL, 0x0000000000004010ULL, 0x0000010000000800ULL,
+    0x0000000000000000ULL, 0x0000800000000900ULL, 0x0000400000000000ULL, 0x8000800000000040ULL,
+    0x0010000000000800ULL, 0x0000000000040000ULL, 0x0000000002000000ULL, 0x0000000000000000ULL,
+    0x0100000000000000ULL, 0x0000000000000000ULL, 0x0400000208000000ULL, 0x4000000000000000ULL,
+    0x0000000100000001ULL, 0x1000000400000000ULL, 0x4006000100000010ULL, 0x0202000002000000ULL,
+    0x0000000000008000ULL, 0x0000000000000000ULL, 0x0000000000100000ULL, 0x0080820000000000ULL,
+    0x0000000000000000ULL, 0x0000100004000000ULL, 0x0010000000000000ULL, 0x0000000001000000ULL,
+    0x0000000008000000ULL, 0x0000000000000200ULL, 0x0000000000000404ULL, 0x0000000000000080ULL,
+    0x2000020000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0040000000000004ULL,
+    0x0000800000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0001000000001000ULL,
+    0x0800000000800000ULL, 0x0000040020000000ULL, 0x00000c0000000000ULL, 0x0000000005000002ULL,
+    0x0000000000000000ULL, 0x0000040000000000ULL, 0x0000000000000000ULL, 0x0040000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0100002000000000ULL,
+    0x0000000000102000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000080000000ULL,
+    0x0000000002040800ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x8000000000004020ULL, 0x0000100000000000ULL, 0x0000000000000040ULL, 0x4000000080000000ULL,
+    0x0000000000000000ULL, 0x0004000000000000ULL, 0x0000000000000100ULL, 0x0200000000000200ULL,
+    0x0200000000900000ULL, 0x1000000000000000ULL, 0x0002100000000000ULL, 0x0000000000010000ULL,
+    0x0024000020000000ULL, 0x0000000000000002ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0400000000004000ULL, 0x0000000000000020ULL, 0x0420000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000010ULL, 0x0000000080001000ULL, 0x0200000000002000ULL,
+    0x0000000200000000ULL, 0x0000080000000001ULL, 0x0000000000000000ULL, 0x0000000020000010ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000082008000000ULL, 0x0500000000200000ULL,
+    0x0000000100000000ULL, 0x0000000000000000ULL, 0x0040000101000080ULL, 0x0000000020000020ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000002ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000080000000ULL, 0x0000000400000000ULL, 0x0000000000000000ULL,
+    0x0200000000000000ULL, 0x2000000000000000ULL, 0x0000000000000000ULL, 0x0020000000000000ULL,
+    0x0000000000400004ULL, 0x0000000040000000ULL, 0x0000002000000000ULL, 0x0000080000000000ULL,
+    0x0000000800000000ULL, 0x0002000000000200ULL, 0x0401000000000000ULL, 0x2200002800002000ULL,
+    0x0000000000000000ULL, 0x0040000002000000ULL, 0x0000000000020000ULL, 0x0000000040000160ULL,
+    0x0000400000000020ULL, 0x0000000001080000ULL, 0x0000080000000000ULL, 0x4000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000001ULL, 0x0200000000000000ULL, 0x0000200000002000ULL,
+    0x0000400000000000ULL, 0x0000000010080000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000080010ULL, 0x0000000000200000ULL, 0x0800000040000000ULL, 0x0000000000000000ULL,
+    0x0100000000000102ULL, 0x0001000100000000ULL, 0x0000004000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000400ULL, 0x0001000000001000ULL, 0x0000000000000000ULL, 0x0000000020000000ULL,
+    0x0001000000000000ULL, 0x0000000000000000ULL, 0x0000000800000000ULL, 0x0000000000000000ULL,
+    0x0000000000000040ULL, 0x0004000000000000ULL, 0x0000000000008200ULL, 0x4000800000000400ULL,
+    0x0000001100000000ULL, 0x0000001000000000ULL, 0x0100000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000008ULL, 0x0000002002000000ULL, 0x0000000000000000ULL, 0x0000000008000000ULL,
+    0x0000000000001000ULL, 0x8008100000000000ULL, 0x0000000000000000ULL, 0x0000000004000100ULL,
+    0x0000102000000000ULL, 0x0000000000000000ULL, 0x0000001010000000ULL, 0x1000000000020000ULL,
+    0x0000000000000000ULL, 0x0000008000000000ULL, 0x0000000400000000ULL, 0x0020000040000000ULL,
+    0x0020000000010001ULL, 0x2000000000020000ULL, 0x0200000000000000ULL, 0x0100010000100840ULL,
+    0x0000000000400200ULL, 0x0001000000000400ULL, 0x0200000000000200ULL, 0x0008004000000000ULL,
+    0x0004000002004000ULL, 0x0000000000000000ULL, 0x0000000000008000ULL, 0x1000800000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000080000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0004000000000000ULL, 0x0000001000000200ULL,
+    0x0002000000000040ULL, 0x0000000000000040ULL, 0x0000000000004000ULL, 0x0000000020000100ULL,
+    0x0000000000000000ULL, 0x0000000000000010ULL, 0x0000000000000000ULL, 0x0000000080000002ULL,
+    0x0000040000000000ULL, 0x0800000004100000ULL, 0x0000000000000000ULL, 0x0000000000000001ULL,
+    0x0000000000040000ULL, 0x0000000400000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000040ULL, 0x0000000000800000ULL, 0x0000000000408000ULL,
+    0x0000400000000000ULL, 0x0000000000000000ULL, 0x0001000000008004ULL, 0x0000004000000000ULL,
+    0x0000000002000000ULL, 0x0000000000004000ULL, 0x0000000000000020ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000800000000ULL, 0x0000000000020000ULL, 0x0100000010000400ULL,
+    0x0000000008200000ULL, 0x0000001000000000ULL, 0x1000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000004000000ULL, 0x0000000004020000ULL, 0x0000020002000000ULL, 0x1200000200000000ULL,
+    0x0000000000000000ULL, 0x0000200000000000ULL, 0x0000000000000008ULL, 0x0000088000000000ULL,
+    0x0000000200000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000003ULL,
+    0x0008000000000100ULL, 0x0000080000000100ULL, 0x0000800000000004ULL, 0x0000008008000000ULL,
+    0x0000000000000020ULL, 0x0002000000100000ULL, 0x0000010000000000ULL, 0x0000000000000000ULL,
+    0x0000000000002400ULL, 0x0000400010000020ULL, 0x0000000010000000ULL, 0x0000000000000001ULL,
+    0x0000000000004011ULL, 0x0001800000000000ULL, 0x0000000000080000ULL, 0x0000000008100000ULL,
+    0x0000010000000000ULL, 0x2060000000000000ULL, 0x0100000000000000ULL, 0x0000000000000000ULL,
+    0x0000000200000000ULL, 0x0000600000000000ULL, 0x0010000000400080ULL, 0x0000000010808200ULL,
+    0x0000040000000002ULL, 0x0000010000000000ULL, 0x0020000000000000ULL, 0x0000000000002000ULL,
+    0x0000000000000000ULL, 0x0000080021000000ULL, 0x0400000200000000ULL, 0x0000000000000100ULL,
+    0x0000000000000000ULL, 0x0800008100000020ULL, 0x0000000000000200ULL, 0x0000000012001000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000400008ULL, 0x2000040000080000ULL,
+    0x0000800000000000ULL, 0x0020400000000008ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000100000004000ULL, 0x0400000000000000ULL, 0x1000000000040000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0020000000000000ULL,
+    0x0000000000000000ULL, 0x0000400000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0080000000000000ULL, 0x0000000000000000ULL, 0x0800000004000000ULL, 0x0000000000000040ULL,
+    0x0000000000000000ULL, 0x1000000400000000ULL, 0x0010800000000008ULL, 0x0001000820000000ULL,
+    0x0100000000000000ULL, 0x0000000000000080ULL, 0x0000000000000000ULL, 0x0004040000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000108000ULL, 0x0800000081000000ULL, 0x0000000200000000ULL, 0x4000000000000000ULL,
+    0x0000000000000000ULL, 0x0000006000000000ULL, 0x0460000000002000ULL, 0x8000000000000000ULL,
+    0x0000000000000000ULL, 0x0000002000000002ULL, 0x0000000000000000ULL, 0x0000000000000001ULL,
+    0x0000000000000000ULL, 0x0000040200000000ULL, 0x0000000000000004ULL, 0x0080000000000000ULL,
+    0x4000000000000000ULL, 0x0000000000000000ULL, 0x0000000001000000ULL, 0x0100000000020000ULL,
+    0x0000000000800000ULL, 0x0000000000000000ULL, 0x0000000000001000ULL, 0x1000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000001000200ULL, 0x0000000000002000ULL, 0x0010000000000000ULL,
+    0x0000000000000000ULL, 0x8000000000000000ULL, 0x0000000000040000ULL, 0x0000000000000001ULL,
+    0x000c020000000800ULL, 0x0000000000081000ULL, 0x0804000000000000ULL, 0x0000000000000800ULL,
+    0x0000010000000080ULL, 0x0000010000000000ULL, 0x0000000000000000ULL, 0x8000000000000000ULL,
+    0x0000020000000000ULL, 0x0000000810002800ULL, 0x0000000000000200ULL, 0x0002000000000000ULL,
+    0x4000002000000040ULL, 0x0000000000000000ULL, 0x0400000000000002ULL, 0x0000400000100000ULL,
+    0x0000000108000000ULL, 0x0000000000000000ULL, 0x0000000000000800ULL, 0x0000000010000000ULL,
+    0x0000000000000000ULL, 0x8000000001000000ULL, 0x0000300000100000ULL, 0x0000002000000000ULL,
+    0x0000200000000021ULL, 0x0000080100000200ULL, 0x0080100002000000ULL, 0x0000008000080000ULL,
+    0x0000080080000000ULL, 0x0000000000000000ULL, 0x8000000000000020ULL, 0x0800000000000100ULL,
+    0x0000040000000000ULL, 0x0000110000000000ULL, 0x0000000060000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0004000000000000ULL, 0x0002000000000000ULL,
+    0x0000000000200000ULL, 0x0000000000000000ULL, 0x0004000000000000ULL, 0x0000000000040000ULL,
+    0x0004020000000800ULL, 0x0000000000000000ULL, 0x8000020000000000ULL, 0x0000000020000000ULL,
+    0x0010000000100000ULL, 0x0000200000000001ULL, 0x0000000000000000ULL, 0x0000000008000000ULL,
+    0x0000000010000000ULL, 0x0000000800000000ULL, 0x0010000000000002ULL, 0x0000000000002000ULL,
+    0x0000000000000020ULL, 0x0000000000000000ULL, 0x0000000000040000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0100000000004000ULL, 0x0000000080000008ULL,
+    0x0000000000000000ULL, 0x0000000600000100ULL, 0x0000000000000000ULL, 0x1000000002000820ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000001000ULL, 0x0000000008000800ULL,
+    0x0020000020080000ULL, 0x0000000400000000ULL, 0x0000000000000000ULL, 0x0010000000000000ULL,
+    0x0000000000000000ULL, 0x0004000000020000ULL, 0x0002000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000002000ULL, 0x0000200000000000ULL, 0x0000000000400000ULL, 0x0010000000000000ULL,
+    0x0000000400000000ULL, 0x0000000000000400ULL, 0x0000000200002000ULL, 0x0000000000000000ULL,
+    0x0000000000000020ULL, 0x0000000000000000ULL, 0x0000000000004000ULL, 0x0000008000002000ULL,
+    0x0000280000000000ULL, 0x0000002000000000ULL, 0x0000000000000100ULL, 0x0000000400000000ULL,
+    0x0008000000020000ULL, 0x0000000000000000ULL, 0x0000000000100000ULL, 0x0000000000000000ULL,
+    0x0020002000000400ULL, 0x0000000000200210ULL, 0x0040000000000000ULL, 0x0000000000000020ULL,
+    0x0008000000000000ULL, 0x0000000000001200ULL, 0x0080000000000000ULL, 0x0000000000080000ULL,
+    0x0000000000000100ULL, 0x0000000000000000ULL, 0x0020002000020000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000080040ULL, 0x0000000000000000ULL,
+    0x000d000000280001ULL, 0x0000000000000000ULL, 0x0000000008000002ULL, 0x0000000000000000ULL,
+    0x0000400000000000ULL, 0x2000000000000000ULL, 0x0000001000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0800010000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000200000ULL,
+    0x0000000000000000ULL, 0x1000000000001000ULL, 0x0001000010100020ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000008000000000ULL, 0x0000000000080080ULL, 0x0040000000000020ULL,
+    0x0000000000000000ULL, 0x2200000000000000ULL, 0x0004000040000040ULL, 0x0400000000000002ULL,
+    0x0000000000000024ULL, 0x0000000000000000ULL, 0x0000000400000000ULL, 0x0000000000001000ULL,
+    0x0000000000040000ULL, 0x0000000000000000ULL, 0x0100000000000000ULL, 0x0000000000000000ULL,
+    0x8006000000000004ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000001ULL,
+    0x0000440000000c00ULL, 0x0000000008000000ULL, 0x0000000000400000ULL, 0x0100000000000000ULL,
+    0x0000100400000000ULL, 0x0001000000000000ULL, 0x0020000000000000ULL, 0x0000008000000000ULL,
+    0x0000000800000000ULL, 0x0040000080000000ULL, 0x0000100000000000ULL, 0x0000000000000000ULL,
+    0x0000020100000000ULL, 0x0000000000000200ULL, 0x0000010000000000ULL, 0x0000000010000000ULL,
+    0x0000000000002000ULL, 0x0000000000000000ULL, 0x0010200002000000ULL, 0x0000000000000008ULL,
+    0x0000000800000000ULL, 0x0020000000000000ULL, 0x0100000000000000ULL, 0x0000000400000004ULL,
+    0x0000000000000000ULL, 0x0000000200000000ULL, 0x0400000000001000ULL, 0x0000000000040000ULL,
+    0x0040000008000000ULL, 0x0000000000000000ULL, 0x0000100000000000ULL, 0x0000000800000000ULL,
+    0x0000000000000020ULL, 0x0000000000000000ULL, 0x0800000000000000ULL, 0x0004000010000000ULL,
+    0x0004000000000000ULL, 0x0000000000008000ULL, 0x0018000000000200ULL, 0x0100800000000200ULL,
+    0x0000000000000011ULL, 0x0000100000000020ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000002800ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000001000000000ULL, 0x0000000100000001ULL, 0x0000000000000000ULL, 0x0800100000100000ULL,
+    0x0000000000008000ULL, 0x0000000080000000ULL, 0x000004040000000aULL, 0x4000000000800000ULL,
+    0x0200000000040808ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000002000000000ULL,
+    0x0000020020000000ULL, 0x0000000000000080ULL, 0x0000000000000010ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000080000000000ULL, 0x2000000000000000ULL, 0x0040000000000000ULL,
+    0x0000000000000000ULL, 0x0000004000000000ULL, 0x0000000000000000ULL, 0x0000000004000000ULL,
+    0x8000000400000000ULL, 0x4080300000000000ULL, 0x0000008000000000ULL, 0x0100000000000020ULL,
+    0x0000000000800000ULL, 0x1008000000000110ULL, 0x2000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000010000000ULL, 0x0000001000000000ULL, 0x0000a00000000800ULL,
+    0x4000000000000800ULL, 0x0000000000000000ULL, 0x0008000000002000ULL, 0x4080000000000000ULL,
+    0x1200000800000000ULL, 0x9000000200000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0001000040000000ULL, 0x0000000000000000ULL, 0x0000400000000000ULL,
+    0x0002006002000000ULL, 0x0100000040000000ULL, 0x0000000020040000ULL, 0x0000002000000000ULL,
+    0x0002000000000000ULL, 0x0000000000000000ULL, 0x0000000200240040ULL, 0x0000000000010080ULL,
+    0x0000002000000000ULL, 0x0000000000100000ULL, 0x0000400000020000ULL, 0x0000100000000000ULL,
+    0x0000000000000400ULL, 0x0000000000200002ULL, 0x0000002000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000200000ULL, 0x1000000000000000ULL, 0x8000800000002000ULL,
+    0x0000000000000000ULL, 0x0000000000801000ULL, 0x0000000000000000ULL, 0x0000040000000000ULL,
+    0x0000000000802000ULL, 0x0000200000000000ULL, 0x0000000008000004ULL, 0x0000000010000000ULL,
+    0x0800000000000000ULL, 0x1004000000000040ULL, 0x0000004000000000ULL, 0x0000000002000002ULL,
+    0x0000000002000000ULL, 0x0000040000200000ULL, 0x0000801000000000ULL, 0x0000000000000000ULL,
+    0x0020800000000000ULL, 0x4000100000100000ULL, 0x0000000000000000ULL, 0x0000000000040000ULL,
+    0x0000080000001000ULL, 0x0800000040000000ULL, 0x0000000000002000ULL, 0x0002000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000200000000000ULL, 0x0000000000000000ULL,
+    0x1000000200400000ULL, 0x0000008020008000ULL, 0x0010000000000800ULL, 0x0000000000000000ULL,
+    0x0020000000000000ULL, 0x0010000000000000ULL, 0x0000000000022000ULL, 0x0000000000040100ULL,
+    0x0000000000200800ULL, 0x0000084000000000ULL, 0x0001000000000000ULL, 0x0000000000000000ULL,
+    0x0010002002000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000100000000ULL,
+    0x0000100200000000ULL, 0x0000000000010000ULL, 0x0000408000000000ULL, 0x1000000000000000ULL,
+    0x040000000b001000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000020000000040ULL,
+    0x0000000400200201ULL, 0x0000000000000000ULL, 0x0000020000280000ULL, 0x0000000000020100ULL,
+    0x0000000200000000ULL, 0x0000000800000000ULL, 0x0000000000000000ULL, 0x0004000000000000ULL,
+    0x0000000000000400ULL, 0x0000000000000008ULL, 0x0000000004000000ULL, 0x0000000000000000ULL,
+    0x0000000040000000ULL, 0x0000000000000010ULL, 0x0008000000000000ULL, 0x0000000040100400ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0010000000000000ULL,
+    0x0000000008000000ULL, 0x0000000000080800ULL, 0x0010000800000000ULL, 0x0000002000000800ULL,
+    0x0001000000000800ULL, 0x4000000000000400ULL, 0x0000000010000000ULL, 0x0000000000000000ULL,
+    0x0400000000000000ULL, 0x0000020008030000ULL, 0x0000100000000000ULL, 0x0000100020000000ULL,
+    0x0000000000000000ULL, 0x0008000000000010ULL, 0x0000008000000000ULL, 0x0000000000001000ULL,
+    0x0004000000000000ULL, 0x0000000000000000ULL, 0x0000001004000000ULL, 0x0000010000000000ULL,
+    0x0000000100000000ULL, 0x0000000000000020ULL, 0x0000000000000000ULL, 0x000000000000000cULL,
+    0x0000000000000408ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL,
+    0x0800040000100000ULL, 0x0402000000000000ULL, 0x0000000000000020ULL, 0x0420000000000000ULL,
+    0x0000000000000000ULL, 0x0000000400008080ULL, 0x0800000100800000ULL, 0x4000000002000000ULL,
+    0x0002000000000100ULL, 0x0000040000200000ULL, 0x0000140000000080ULL, 0x4000000000000000ULL,
+    0x0000200000000000ULL, 0x0000000000000000ULL, 0x0000004008000000ULL, 0x0000000000000000ULL,
+    0x0800400000020002ULL, 0x0000000000000000ULL, 0x0000000000000040ULL, 0x0000008000008800ULL,
+    0x0000000000020000ULL, 0x0000000200040000ULL, 0x0800000200080028ULL, 0x0000000000000000ULL,
+    0x0000040000000000ULL, 0x0020000000000000ULL, 0x0000800008000000ULL, 0x0030000010000000ULL,
+    0x0000000000000000ULL, 0x0000000000000040ULL, 0x2002000000400000ULL, 0x0400000000000000ULL,
+    0x0010000000000000ULL, 0x0002000000000000ULL, 0x0000000004000008ULL, 0x0000400000000000ULL,
+    0x0000000040001010ULL, 0x0000000000040000ULL, 0x0000000000000000ULL, 0x0001000000000800ULL,
+    0x0000000000000000ULL, 0x0000000000401000ULL, 0x0000000000020000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000400000080000ULL, 0x0000400080000000ULL, 0x4000000000000000ULL,
+    0x0200000000000000ULL, 0x0000000000000000ULL, 0x0040800000004000ULL, 0x0000000010000000ULL,
+    0x0000000000000000ULL, 0x0000000001000000ULL, 0x0000000000000400ULL, 0x0000000000100010ULL,
+    0x0000000000000000ULL, 0x0080000000000000ULL, 0x0000000200000000ULL, 0x0020000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000200000000000ULL, 0x1000000003000000ULL,
+    0x0000000030000000ULL, 0x0000000008000008ULL, 0x0000000000000000ULL, 0x0020000002000010ULL,
+    0x0000000000000000ULL, 0x1000020000000000ULL, 0x0001000004000400ULL, 0x0000000800000000ULL,
+    0x0800001000000000ULL, 0x0000000000000000ULL, 0x0080000000000000ULL, 0x0010000000020200ULL,
+    0x0008000100000000ULL, 0x0200000000000000ULL, 0x0000000000000000ULL, 0x0800800000008000ULL,
+    0x0000001000000000ULL, 0x0000000001000000ULL, 0x0040000000000000ULL, 0x0000000000000000ULL,
+    0x0000000000004000ULL, 0x0400000020008000ULL, 0x0000000400000000ULL, 0x0000000020000000ULL,
+    0x0000000090400000ULL, 0x0000004000000000ULL, 0x0000000400000000ULL, 0x0000000040004001ULL,
+    0x0000000000000000ULL, 0x0000000000000040ULL, 0x0000000000000004ULL, 0x0204010010000020ULL,
+    0x0000002000000000ULL, 0x0000000000000004ULL, 0x0000021000000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000020ULL, 0x0000000000000000ULL, 0x0000080000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0001000000000000ULL, 0x0000008000000000ULL,
+    0x0000000800000000ULL, 0x0000004000000000ULL, 0x0000010000000220ULL, 0x0020000000000000ULL,
+    0x0000000080000000ULL, 0x0000000000000000ULL, 0x0020000000800000ULL, 0x0000000000000000ULL,
+    0x0000000001000080ULL, 0x0000000000020008ULL, 0x0000000010000000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0100000000000000ULL, 0x0000010000200000ULL,
+    0x0000080002000000ULL, 0x0000000000000000ULL, 0x010000100000a000ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000400000ULL, 0x0000000008000000ULL,
+    0x0000000000000000ULL, 0x0100000000000000ULL, 0x0000000000000002ULL, 0x0004000000000000ULL,
+    0x0100000000000000ULL, 0x0000800000000000ULL, 0x0000040000000001ULL, 0x0000000000000000ULL,
+    0x0000400400000081ULL, 0x0002000408000000ULL, 0x0000200000000120ULL, 0x0000000040000000ULL,
+    0x0008000000000000ULL, 0x0000000000000000ULL, 0x0000001000000020ULL, 0x0100000000000800ULL,
+    0x0000000002000000ULL, 0x0000000000000080ULL, 0x0000000000000000ULL, 0x0004001000000000ULL,
+    0x0000180010000000ULL, 0x0000001000002004ULL, 0x0000000000000004ULL, 0x0000002080000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000080000000ULL,
+    0x0000000000000000ULL, 0x0000080000000000ULL, 0x0002100000000008ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000001000500ULL, 0x0000000100000000ULL, 0x0040000000000000ULL,
+    0x0000000010000000ULL, 0x0000001000000000ULL, 0x0400010001000000ULL, 0x0000000400000000ULL
 };
 
 
 /*
-    ChooseMatrix
+    DenseRowCount
 
-        This function determines the check matrix to use based on the
-    given message bytes and bytes per block.
+        This function determines the number of dense rows D in the check
+    matrix for a given block count, which also selects the dense seed.
 */
 
-Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
+template<typename IndexT>
+uint32_t CodecT<IndexT>::DenseRowCount(uint32_t block_count)
 {
-    CAT_IF_DUMP(cout << endl << "---- ChooseMatrix ----" << endl << endl;)
-
-    // Validate input
-    if (message_bytes < 1 || block_bytes < 1)
-    {
-        return R_BAD_INPUT;
-    }
-
-    // Calculate message block count
-    _block_bytes = block_bytes;
-    _block_count = (message_bytes + _block_bytes - 1) / _block_bytes;
-    _block_next_prime = NextPrime16(_block_count);
-
-    // Validate block count
-    if (_block_count < CAT_WIREHAIR_MIN_N)
-    {
-        return R_TOO_SMALL;
-    }
-    if (_block_count > CAT_WIREHAIR_MAX_N)
+    if (block_count < CAT_WIREHAIR_MIN_N || block_count > MAX_N)
     {
-        return R_TOO_LARGE;
+        return 0;
     }
 
-    CAT_IF_DUMP(cout << "Total message = " << message_bytes << " bytes.  Block bytes = " << _block_bytes << endl;)
-    CAT_IF_DUMP(cout << "Block count = " << _block_count << " +Prime=" << _block_next_prime << endl;)
-
     /*
         Calculate the number of dense rows
 
@@ -4182,47 +4609,57 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
     */
 
     // If N is small,
-    uint16_t dense_count;
-    if (_block_count < 256)
+    uint32_t dense_count;
+    if (block_count < 256)
     {
         // Calculate dense count from math expression
-        if (_block_count == 2)
+        if (block_count == 2)
         {
             dense_count = 2;
         }
-        else if (_block_count == 3)
+        else if (block_count == 3)
         {
             dense_count = 6;
         }
         else
         {
-            dense_count = 10 + SquareRoot16(_block_count) / 2 + (_block_count / 50);
+            dense_count = 10 + SquareRoot16((uint16_t)block_count) / 2 + (block_count / 50);
         }
     }
-    else if (_block_count <= 4096) // Medium N:
+    else if (block_count <= 4096) // Medium N:
     {
         // Square root-dominant region
-        dense_count = 18 + SquareRoot16(_block_count) + (uint16_t)(_block_count / 300);
+        dense_count = 18 + SquareRoot16((uint16_t)block_count) + (block_count / 300);
     }
-    else if (_block_count <= 32768)
+    else if (block_count <= 32768)
     {
         // Linear-dominant region
-        dense_count = 22 + (_block_count / 100);
+        dense_count = 22 + (block_count / 100);
     }
-    else if (_block_count <= 44000)
+    else if (block_count <= 44000)
     {
         // Linear-dominant region
-        dense_count = 26 + (_block_count / 114);
+        dense_count = 26 + (block_count / 114);
     }
-    else if (_block_count <= 52500)
+    else if (block_count <= 52500)
     {
         // Linear-dominant region
-        dense_count = 74 + (_block_count / 128);
+        dense_count = 74 + (block_count / 128);
     }
-    else
+    else if (block_count <= CAT_WIREHAIR_MAX_N)
     {
         // Avalanche-dominant region
-        dense_count = 880 - (_block_count / 128);
+        dense_count = 880 - (block_count / 128);
+    }
+    else // Large N (32-bit indices only):
+    {
+        /*
+            Past 64000 the number of deferred columns after greedy peeling
+            grows linearly at about N / 210, and the GE matrix only stays
+            solvable with a dense row count that keeps pace with it, so
+            this region is linear-dominant again.
+        */
+        dense_count = 380 + (block_count - CAT_WIREHAIR_MAX_N) / 200;
     }
 
     // Round up to the next D s.t. D Mod 4 = 2 (see above)
@@ -4234,6 +4671,122 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
     case 3: dense_count += 3; break;
     }
 
+    return dense_count;
+}
+
+
+/*
+    TablePeelSeed
+
+        This function looks up the peel seed for a given block count.
+    Most N use N itself, and the exceptions table flags the N where that
+    seed does not give a full rank check matrix.
+*/
+
+template<typename IndexT>
+uint32_t CodecT<IndexT>::TablePeelSeed(uint32_t block_count)
+{
+    // If N is small,
+    if (block_count <= SMALL_SEED_MAX)
+    {
+        // Lookup seeds from table
+        return SMALL_PEEL_SEEDS[block_count];
+    }
+    else
+    {
+        // If default seed doesn't work,
+        if (block_count < CAT_WIREHAIR_MAX_N &&
+            (EXCEPT_TABLE[block_count >> 6] & ((uint64_t)1 << (block_count & 63))))
+        {
+            switch (block_count)
+            {
+            case 5627:
+            case 12740:
+            case 14315:
+            case 22012:
+            case 29074:
+            case 29737:
+            case 33755:
+            case 33811:
+            case 34162:
+            case 34413:
+            case 37991:
+            case 42658:
+            case 45776:
+            case 52135:
+            case 52675:
+            case 54075:
+            case 54354:
+            case 57005:
+            case 58589:
+            case 63912:
+                // Use backup seed 3
+                return 3;
+            case 51467:
+                // Use backup seed 2
+                return 2;
+            default:
+                // Use secondary backup seed
+                return 1;
+            }
+        }
+        else
+        {
+            // Use default seed
+            return block_count;
+        }
+    }
+}
+
+
+/*
+    ChooseMatrix
+
+        This function determines the check matrix to use based on the
+    given message bytes and bytes per block.
+*/
+
+template<typename IndexT>
+Result CodecT<IndexT>::ChooseMatrix(uint64_t message_bytes, int block_bytes)
+{
+    CAT_IF_DUMP(cout << endl << "---- ChooseMatrix ----" << endl << endl;)
+
+    // Validate input
+    if (message_bytes < 1 || block_bytes < 1)
+    {
+        return R_BAD_INPUT;
+    }
+
+    // Calculate message block count
+    _block_bytes = block_bytes;
+    const uint64_t block_count = (message_bytes + _block_bytes - 1) / _block_bytes;
+
+    // Validate block count before it is truncated to the index type
+    if (block_count < CAT_WIREHAIR_MIN_N)
+    {
+        return R_TOO_SMALL;
+    }
+    if (block_count > MAX_N)
+    {
+        return R_TOO_LARGE;
+    }
+
+    // Validate that the recovery blocks are addressable on this platform
+    const uint64_t recovery_bytes = (block_count + MAX_DENSE_ROWS + CAT_HEAVY_ROWS + 1) * _block_bytes;
+    if (recovery_bytes != (size_t)recovery_bytes)
+    {
+        return R_TOO_LARGE;
+    }
+
+    _block_count = (IndexT)block_count;
+    _block_next_prime = (IndexT)NextPrime32(_block_count);
+
+    CAT_IF_DUMP(cout << "Total message = " << message_bytes << " bytes.  Block bytes = " << _block_bytes << endl;)
+    CAT_IF_DUMP(cout << "Block count = " << _block_count << " +Prime=" << _block_next_prime << endl;)
+
+    // Calculate the number of dense rows, which affects the seeding
+    IndexT dense_count = (IndexT)DenseRowCount(_block_count);
+
     if (dense_count < 14)
     {
         switch (dense_count)
@@ -4245,12 +4798,20 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
     }
     else
     {
-        if (dense_count > 486)
+        if (dense_count > MAX_DENSE_ROWS)
             return R_BAD_DENSE_SEED;
 
-        // Lookup dense seed given D
-        // FIXME: Dense seed for dense_count = 70 is terrible
-        _d_seed = DENSE_SEEDS[(dense_count - 14) / 4];
+        if (dense_count <= 486)
+        {
+            // Lookup dense seed given D
+            // FIXME: Dense seed for dense_count = 70 is terrible
+            _d_seed = DENSE_SEEDS[(dense_count - 14) / 4];
+        }
+        else
+        {
+            // Use the seed that works for all larger D
+            _d_seed = LARGE_DENSE_SEED;
+        }
     }
 
     _dense_count = dense_count;
@@ -4267,68 +4828,18 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
         since tuning is more important for these cases.
     */
 
-    // If N is small,
-    if (_block_count <= SMALL_SEED_MAX)
-    {
-        // Lookup seeds from table
-        _p_seed = SMALL_PEEL_SEEDS[_block_count];
-    }
-    else
-    {
-        // If default seed doesn't work,
-        if (EXCEPT_TABLE[_block_count >> 6] & ((uint64_t)1 << (_block_count & 63)))
-        {
-#if 0
-            // FIXME: Identify these too
-            switch (_block_count)
-            {
-            case 3046:
-            case 3370:
-            case 4758:
-            case 5753:
-            case 10833:
-            case 13411:
-            case 13727:
-            case 15639:
-            case 16586:
-            case 26350:
-            case 26445:
-            case 28262:
-            case 31195:
-            case 31521:
-            case 32309:
-            case 36259:
-            case 39419:
-            case 43147:
-            case 45347:
-            case 45849:
-            case 46161:
-            case 47123:
-            case 48069:
-            case 48952:
-            case 54406:
-            case 56803:
-            case 60007:
-                // Use tertiary backup seed
-                _p_seed = 3;
-                break;
-            default:
-                // Use secondary backup seed
-                _p_seed = 1;
-            }
-#endif
-        }
-        else
-        {
-            // Use default seed
-            _p_seed = _block_count;
-        }
-    }
+    _p_seed = TablePeelSeed(_block_count);
+
+    // Seeds under evaluation by the seed search replace the table choices
+    if (_p_seed_override != SEED_FROM_TABLE)
+        _p_seed = _p_seed_override;
+    if (_d_seed_override != SEED_FROM_TABLE)
+        _d_seed = _d_seed_override;
 
     CAT_IF_DUMP(cout << "Peel seed = " << _p_seed << "  Dense seed = " << _d_seed << endl;)
 
     _mix_count = _dense_count + CAT_HEAVY_ROWS;
-    _mix_next_prime = NextPrime16(_mix_count);
+    _mix_next_prime = (IndexT)NextPrime32(_mix_count);
 
     CAT_IF_DUMP(cout << "Mix count = " << _mix_count << " +Prime=" << _mix_next_prime << endl;)
 
@@ -4374,11 +4885,19 @@ Result Codec::ChooseMatrix(int message_bytes, int block_bytes)
         Triangle()
 */
 
-Result Codec::SolveMatrix()
+template<typename IndexT>
+Result CodecT<IndexT>::SolveMatrix()
 {
+    CAT_TRACE_SPAN(solve_span, "SolveMatrix");
+    uint64_t timestamp = StartPhase();
+
     // (1) Peeling
 
+    CAT_TRACE_SPAN(peel_span, "GreedyPeeling");
     GreedyPeeling();
+    CAT_TRACE_END(peel_span);
+
+    EndPhase(PHASE_PEEL, timestamp);
 
     CAT_IF_DUMP( PrintPeeled(); )
     CAT_IF_DUMP( PrintDeferredRows(); )
@@ -4386,6 +4905,8 @@ Result Codec::SolveMatrix()
 
     // (2) Compression
 
+    CAT_TRACE_SPAN(compress_span, "Compress");
+
     if (!AllocateMatrix())
         return R_OUT_OF_MEMORY;
 
@@ -4400,6 +4921,9 @@ Result Codec::SolveMatrix()
     if (!AddInvertibleGF2Matrix(_ge_matrix, _defer_count, _ge_pitch, _dense_count))
         return R_TOO_SMALL;
 
+    CAT_TRACE_END(compress_span);
+    EndPhase(PHASE_COMPRESS, timestamp);
+
 #if defined(CAT_DUMP_CODEC_DEBUG) || defined(CAT_DUMP_GE_MATRIX)
     cout << "After Compress:" << endl;
     PrintGEMatrix();
@@ -4408,8 +4932,14 @@ Result Codec::SolveMatrix()
 
     // (3) Gaussian Elimination
 
+    CAT_TRACE_SPAN(triangle_span, "Triangle");
     SetupTriangle();
-    if (!Triangle())
+    const bool solved = Triangle();
+    CAT_TRACE_END(triangle_span);
+
+    EndPhase(PHASE_TRIANGLE, timestamp);
+
+    if (!solved)
     {
         CAT_IF_DUMP( cout << "After Triangle FAILED:" << endl; )
         CAT_IF_DUMP( PrintGEMatrix(); )
@@ -4452,15 +4982,40 @@ Result Codec::SolveMatrix()
             Substitute()
 */
 
-void Codec::GenerateRecoveryBlocks()
+template<typename IndexT>
+void CodecT<IndexT>::GenerateRecoveryBlocks()
 {
+    CAT_TRACE_SPAN(generate_span, "GenerateRecoveryBlocks");
+    RecordSolveStats();
+
+    uint64_t timestamp = StartPhase();
+
     // (4) Substitution
 
+    CAT_TRACE_SPAN(column_span, "InitializeColumnValues");
     InitializeColumnValues();
+    CAT_TRACE_END(column_span);
+    EndPhase(PHASE_COLUMN_VALUES, timestamp);
+
+    CAT_TRACE_SPAN(dense_span, "MultiplyDenseValues");
     MultiplyDenseValues();
+    CAT_TRACE_END(dense_span);
+    EndPhase(PHASE_DENSE_VALUES, timestamp);
+
+    CAT_TRACE_SPAN(subdiagonal_span, "AddSubdiagonalValues");
     AddSubdiagonalValues();
+    CAT_TRACE_END(subdiagonal_span);
+    EndPhase(PHASE_SUBDIAGONAL, timestamp);
+
+    CAT_TRACE_SPAN(back_span, "BackSubstituteAboveDiagonal");
     BackSubstituteAboveDiagonal();
+    CAT_TRACE_END(back_span);
+    EndPhase(PHASE_BACK_SUBSTITUTE, timestamp);
+
+    CAT_TRACE_SPAN(substitute_span, "Substitute");
     Substitute();
+    CAT_TRACE_END(substitute_span);
+    EndPhase(PHASE_SUBSTITUTE, timestamp);
 }
 
 /*
@@ -4477,25 +5032,26 @@ void Codec::GenerateRecoveryBlocks()
     matrix after they get into range of the heavy columns.
 */
 
-Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
+template<typename IndexT>
+Result CodecT<IndexT>::ResumeSolveMatrix(uint32_t id, const void *block)
 {
     CAT_IF_DUMP(cout << endl << "---- ResumeSolveMatrix ----" << endl << endl;)
 
     if (!block) return R_BAD_INPUT;
 
     // If there is no room for it:
-    uint16_t row_i, ge_row_i, new_pivot_i;
+    IndexT row_i, ge_row_i, new_pivot_i;
     if (_row_count >= _block_count + _extra_count)
     {
-        const uint16_t first_heavy_row = _defer_count + _dense_count;
+        const IndexT first_heavy_row = _defer_count + _dense_count;
 
         new_pivot_i = 0;
 
         // For each pivot in the list:
-        for (uint16_t pivot_i = _next_pivot; pivot_i < _pivot_count; ++pivot_i)
+        for (IndexT pivot_i = _next_pivot; pivot_i < _pivot_count; ++pivot_i)
         {
             // If unused row is extra:
-            uint16_t ge_row_i = _pivots[pivot_i];
+            IndexT ge_row_i = _pivots[pivot_i];
             if (ge_row_i >= first_heavy_row && ge_row_i < (first_heavy_row + _extra_count))
             {
                 // Re-use it
@@ -4536,23 +5092,17 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
 
     // Update row data needed at this point
     PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
-    row->id = id;
+    PeelRowInfo * GF256_RESTRICT info = &_peel_row_info[row_i];
+    info->id = id;
 
     // Copy new block to input blocks
-    uint8_t * GF256_RESTRICT block_store_dest = _input_blocks + _block_bytes * row_i;
-    if (id != _block_count - 1)
-        memcpy(block_store_dest, block, _block_bytes);
-    else
-    {
-        memcpy(block_store_dest, block, _output_final_bytes);
-        memset(block_store_dest + _output_final_bytes, 0, _block_bytes - _output_final_bytes);
-    }
+    StoreInputRow(row_i, id, block);
 
     // Generate new GE row
     uint64_t * GF256_RESTRICT ge_new_row = _ge_matrix + _ge_pitch * ge_row_i;
     memset(ge_new_row, 0, _ge_pitch * sizeof(uint64_t));
 
-    uint16_t peel_weight, peel_a, peel_x, mix_a, mix_x;
+    IndexT peel_weight, peel_a, peel_x, mix_a, mix_x;
     GeneratePeelRow(id, _p_seed, _block_count, _mix_count,
         peel_weight, peel_a, peel_x, mix_a, mix_x);
 
@@ -4560,11 +5110,11 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
     row->peel_weight = peel_weight;
     row->peel_a = peel_a;
     row->peel_x0 = peel_x;
-    row->mix_a = mix_a;
-    row->mix_x0 = mix_x;
+    info->mix_a = mix_a;
+    info->mix_x0 = mix_x;
 
     // Generate mixing bits in GE row
-    uint16_t ge_column_i = mix_x + _defer_count;
+    IndexT ge_column_i = mix_x + _defer_count;
     ge_new_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
     IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
     ge_column_i = mix_x + _defer_count;
@@ -4577,18 +5127,18 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
     for (;;)
     {
         // If column is peeled:
-        PeelColumn * GF256_RESTRICT ref_col = &_peel_cols[peel_x];
-        if (ref_col->mark == MARK_PEEL)
+        const PeelColumn * GF256_RESTRICT ref_col = &_peel_cols[peel_x];
+        if (_peel_col_marks[peel_x] == MARK_PEEL)
         {
             // Add compress row to the new GE row
-            uint16_t row_i = ref_col->peel_row;
-            const uint64_t * GF256_RESTRICT ge_src_row = _compress_matrix + _ge_pitch * row_i;
+            IndexT row_i = ref_col->peel_row;
+            const uint64_t * GF256_RESTRICT ge_src_row = _compress_matrix + (size_t)_ge_pitch * row_i;
             for (int ii = 0; ii < _ge_pitch; ++ii) ge_new_row[ii] ^= ge_src_row[ii];
         }
         else
         {
             // Set bit for this deferred column
-            uint16_t ge_column_i = ref_col->ge_column;
+            IndexT ge_column_i = ref_col->ge_column;
             ge_new_row[ge_column_i >> 6] ^= (uint64_t)1 << (ge_column_i & 63);
         }
 
@@ -4599,7 +5149,7 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
 
     // For each pivot-found column up to the start of the heavy columns:
     uint64_t ge_mask = 1;
-    for (uint16_t pivot_j = 0; pivot_j < _next_pivot && pivot_j < _first_heavy_column;
+    for (IndexT pivot_j = 0; pivot_j < _next_pivot && pivot_j < _first_heavy_column;
         ++pivot_j, ge_mask = CAT_ROL64(ge_mask, 1))
     {
         // If bit is set:
@@ -4607,7 +5157,7 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
         uint64_t * GF256_RESTRICT rem_row = &ge_new_row[word_offset];
         if (*rem_row & ge_mask)
         {
-            uint16_t ge_row_j = _pivots[pivot_j];
+            IndexT ge_row_j = _pivots[pivot_j];
             uint64_t * GF256_RESTRICT ge_pivot_row = _ge_matrix + word_offset + _ge_pitch * ge_row_j;
             uint64_t row0 = (*ge_pivot_row & ~(ge_mask - 1)) ^ ge_mask;
 
@@ -4631,15 +5181,15 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
     }
     else
     {
-        const uint16_t column_count = _defer_count + _mix_count;
-        const uint16_t first_heavy_row = _dense_count + _defer_count;
-        uint16_t heavy_row_i = ge_row_i - first_heavy_row;
+        const IndexT column_count = _defer_count + _mix_count;
+        const IndexT first_heavy_row = _dense_count + _defer_count;
+        IndexT heavy_row_i = ge_row_i - first_heavy_row;
         uint8_t * GF256_RESTRICT heavy_row = _heavy_matrix + _heavy_pitch * heavy_row_i;
 
         // For each heavy column:
-        for (uint16_t ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
+        for (IndexT ge_column_j = _first_heavy_column; ge_column_j < column_count; ++ge_column_j)
         {
-            uint16_t heavy_col_j = ge_column_j - _first_heavy_column;
+            IndexT heavy_col_j = ge_column_j - _first_heavy_column;
             uint8_t bit_j = (uint8_t)(ge_new_row[ge_column_j >> 6] >> (ge_column_j & 63)) & 1;
 
             // Copy bit into column byte
@@ -4647,23 +5197,23 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
         }
 
         // For each pivot-found column in the heavy columns:
-        for (uint16_t pivot_j = _first_heavy_column; pivot_j < _next_pivot; ++pivot_j)
+        for (IndexT pivot_j = _first_heavy_column; pivot_j < _next_pivot; ++pivot_j)
         {
             // If column is zero:
-            uint16_t heavy_col_j = pivot_j - _first_heavy_column;
+            IndexT heavy_col_j = pivot_j - _first_heavy_column;
             uint8_t code_value = heavy_row[heavy_col_j];
             if (!code_value)
                 continue; // Skip it
 
             // If previous row is heavy:
-            uint16_t ge_row_j = _pivots[pivot_j];
+            IndexT ge_row_j = _pivots[pivot_j];
             if (ge_row_j >= first_heavy_row)
             {
                 // Calculate coefficient of elimination
-                uint16_t heavy_row_j = ge_row_j - first_heavy_row;
+                IndexT heavy_row_j = ge_row_j - first_heavy_row;
                 uint8_t * GF256_RESTRICT pivot_row = _heavy_matrix + _heavy_pitch * heavy_row_j;
                 uint8_t pivot_code = pivot_row[heavy_col_j];
-                const uint16_t start_column = heavy_col_j + 1;
+                const IndexT start_column = heavy_col_j + 1;
 
                 // heavy[m+] += exist[m+] * (code_value / pivot_code)
                 if (pivot_code == 1)
@@ -4686,7 +5236,7 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
             else
             {
                 uint64_t * GF256_RESTRICT other_row = _ge_matrix + _ge_pitch * ge_row_j;
-                uint16_t ge_column_k = pivot_j + 1;
+                IndexT ge_column_k = pivot_j + 1;
                 uint64_t ge_mask = (uint64_t)1 << (ge_column_k & 63);
 
                 // For each remaining column:
@@ -4703,7 +5253,7 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
         } // next column
 
         // If the next pivot was not found on this heavy row:
-        uint16_t next_heavy_col = _next_pivot - _first_heavy_column;
+        IndexT next_heavy_col = _next_pivot - _first_heavy_column;
         if (!heavy_row[next_heavy_col])
             return R_MORE_BLOCKS; // Maybe next time...
 
@@ -4748,19 +5298,20 @@ Result Codec::ResumeSolveMatrix(uint32_t id, const void *block)
     have been received.
 */
 
-bool Codec::IsAllOriginalData()
+template<typename IndexT>
+bool CodecT<IndexT>::IsAllOriginalData()
 {
     // Re-purpose and initialize an array to store whether or not each row id needs to be regenerated
     uint8_t * GF256_RESTRICT copied_rows = reinterpret_cast<uint8_t*>( _recovery_blocks );
     memset(copied_rows, 0, _block_count);
 
     // Copy any original message rows that were received:
-    PeelRow * GF256_RESTRICT row = _peel_rows;
+    const PeelRowInfo * GF256_RESTRICT info = _peel_row_info;
     uint32_t seen_rows = 0;
     // For each row:
-    for (uint16_t row_i = 0; row_i < _row_count; ++row_i, ++row)
+    for (IndexT row_i = 0; row_i < _row_count; ++row_i, ++info)
     {
-        uint32_t id = row->id;
+        uint32_t id = info->id;
 
         // If the row identifier indicates it is part of the original message data:
         if (id < _block_count)
@@ -4790,7 +5341,8 @@ bool Codec::IsAllOriginalData()
     Precondition: DecodeFeed() has returned success
 */
 
-Result Codec::ReconstructBlock(uint16_t row_i, void * GF256_RESTRICT dest)
+template<typename IndexT>
+Result CodecT<IndexT>::ReconstructBlock(IndexT row_i, void * GF256_RESTRICT dest)
 {
     CAT_IF_DUMP(cout << endl << "---- ReconstructBlock ----" << endl << endl;)
 
@@ -4812,12 +5364,12 @@ Result Codec::ReconstructBlock(uint16_t row_i, void * GF256_RESTRICT dest)
 
     CAT_IF_DUMP(cout << "Regenerating row " << row_i << ":";)
 
-    uint16_t peel_weight, peel_a, peel_x, mix_a, mix_x;
+    IndexT peel_weight, peel_a, peel_x, mix_a, mix_x;
     GeneratePeelRow(row_i, _p_seed, _block_count, _mix_count,
         peel_weight, peel_a, peel_x, mix_a, mix_x);
 
     // Remember first column (there is always at least one)
-    uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
+    uint8_t * GF256_RESTRICT first = _recovery_blocks + (size_t)_block_bytes * peel_x;
 
     CAT_IF_DUMP(cout << " " << peel_x;)
 
@@ -4831,7 +5383,7 @@ Result Codec::ReconstructBlock(uint16_t row_i, void * GF256_RESTRICT dest)
         CAT_IF_DUMP(cout << " " << peel_x;)
 
         // Combine first two columns into output buffer (faster than memcpy + memxor)
-        gf256_addset_mem(dest, first, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+        gf256_addset_mem(dest, first, _recovery_blocks + (size_t)_block_bytes * peel_x, block_bytes);
 
         // For each remaining peeler column:
         while (--peel_weight > 0)
@@ -4841,27 +5393,27 @@ Result Codec::ReconstructBlock(uint16_t row_i, void * GF256_RESTRICT dest)
             CAT_IF_DUMP(cout << " " << peel_x;)
 
             // Mix in each column
-            gf256_add_mem(dest, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+            gf256_add_mem(dest, _recovery_blocks + (size_t)_block_bytes * peel_x, block_bytes);
         }
 
         // Mix first mixer block in directly
-        gf256_add_mem(dest, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+        gf256_add_mem(dest, _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x), block_bytes);
     }
     else
     {
         // Mix first with first mixer block (faster than memcpy + memxor)
-        gf256_addset_mem(dest, first, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+        gf256_addset_mem(dest, first, _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x), block_bytes);
     }
 
     CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
     // Combine remaining two mixer columns together:
     IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-    const uint8_t * mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+    const uint8_t * mix0_src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
     CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
     IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-    const uint8_t * mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+    const uint8_t * mix1_src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
     CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
     gf256_add2_mem(dest, mix0_src, mix1_src, block_bytes);
@@ -4882,7 +5434,8 @@ Result Codec::ReconstructBlock(uint16_t row_i, void * GF256_RESTRICT dest)
     Precondition: DecodeFeed() has returned success
 */
 
-Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
+template<typename IndexT>
+Result CodecT<IndexT>::ReconstructOutput(void * GF256_RESTRICT message_out)
 {
     CAT_IF_DUMP(cout << endl << "---- ReconstructOutput ----" << endl << endl;)
 
@@ -4893,27 +5446,39 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
     }
     uint8_t * GF256_RESTRICT output_blocks = reinterpret_cast<uint8_t *>( message_out );
 
+    // If output was already reconstructed in place, copy it out
+    if (_output_in_place)
+    {
+        memcpy(output_blocks, _input_blocks, (size_t)_block_bytes * (_block_count - 1) + _output_final_bytes);
+        return R_WIN;
+    }
+
 #if defined(CAT_COPY_FIRST_N)
     // Re-purpose and initialize an array to store whether or not each row id needs to be regenerated
     uint8_t * GF256_RESTRICT copied_rows = reinterpret_cast<uint8_t*>( _peel_cols );
     memset(copied_rows, 0, _block_count);
 
     // Copy any original message rows that were received:
-    PeelRow * GF256_RESTRICT row = _peel_rows;
-    const uint8_t * GF256_RESTRICT src = _input_blocks;
+    const PeelRowInfo * GF256_RESTRICT info = _peel_row_info;
     // For each row:
-    for (uint16_t row_i = 0; row_i < _row_count; ++row_i, ++row, src += _block_bytes)
+    for (IndexT row_i = 0; row_i < _row_count; ++row_i, ++info)
     {
-        uint32_t id = row->id;
+        uint32_t id = info->id;
 
         // If the row identifier indicates it is part of the original message data:
         if (id < _block_count)
         {
             CAT_IF_DUMP(cout << "Copying received row " << id << endl;)
 
-            uint8_t * GF256_RESTRICT dest = output_blocks + _block_bytes * id;
+            uint8_t * GF256_RESTRICT dest = output_blocks + (size_t)_block_bytes * id;
             int bytes = (id != _block_count - 1) ? _block_bytes : _output_final_bytes;
-            memcpy(dest, src, bytes);
+            const uint8_t * GF256_RESTRICT src = InputRow(row_i);
+
+            // If not already stored in place by DecodeFeed(),
+            if (src != dest)
+            {
+                memcpy(dest, src, bytes);
+            }
 
             copied_rows[id] = 1;
         }
@@ -4927,7 +5492,7 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
 #if defined(CAT_COPY_FIRST_N)
     uint8_t * GF256_RESTRICT copied_row = copied_rows;
     // For each row:
-    for (uint16_t row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes, ++copied_row)
+    for (IndexT row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes, ++copied_row)
     {
         // If already copied, skip it
         if (*copied_row)
@@ -4935,7 +5500,7 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
             continue;
         }
 #else
-    for (uint16_t row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes)
+    for (IndexT row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes)
     {
 #endif
         // For last row, use final byte count
@@ -4946,12 +5511,12 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
 
         CAT_IF_DUMP(cout << "Regenerating row " << row_i << ":";)
 
-        uint16_t peel_weight, peel_a, peel_x, mix_a, mix_x;
+        IndexT peel_weight, peel_a, peel_x, mix_a, mix_x;
         GeneratePeelRow(row_i, _p_seed, _block_count, _mix_count,
             peel_weight, peel_a, peel_x, mix_a, mix_x);
 
         // Remember first column (there is always at least one)
-        uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
+        uint8_t * GF256_RESTRICT first = _recovery_blocks + (size_t)_block_bytes * peel_x;
 
         CAT_IF_DUMP(cout << " " << peel_x;)
 
@@ -4965,7 +5530,7 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
             CAT_IF_DUMP(cout << " " << peel_x;)
 
             // Combine first two columns into output buffer (faster than memcpy + memxor)
-            gf256_addset_mem(dest, first, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+            gf256_addset_mem(dest, first, _recovery_blocks + (size_t)_block_bytes * peel_x, block_bytes);
 
             // For each remaining peeler column:
             while (--peel_weight > 0)
@@ -4975,27 +5540,27 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
                 CAT_IF_DUMP(cout << " " << peel_x;)
 
                 // Mix in each column
-                gf256_add_mem(dest, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+                gf256_add_mem(dest, _recovery_blocks + (size_t)_block_bytes * peel_x, block_bytes);
             }
 
             // Mix first mixer block in directly
-            gf256_add_mem(dest, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+            gf256_add_mem(dest, _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x), block_bytes);
         }
         else
         {
             // Mix first with first mixer block (faster than memcpy + memxor)
-            gf256_addset_mem(dest, first, _recovery_blocks + _block_bytes * (_block_count + mix_x), block_bytes);
+            gf256_addset_mem(dest, first, _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x), block_bytes);
         }
 
         CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
         // Combine remaining two mixer columns together:
         IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-        const uint8_t *mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+        const uint8_t *mix0_src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
         CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
         IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-        const uint8_t *mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+        const uint8_t *mix1_src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
         CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
         gf256_add2_mem(dest, mix0_src, mix1_src, block_bytes);
@@ -5006,14 +5571,166 @@ Result Codec::ReconstructOutput(void * GF256_RESTRICT message_out)
     return R_WIN;
 }
 
+/*
+    MarkReceivedRows
+
+        This function flags the original message rows that were received,
+    so that only the other rows need to be regenerated by ReconstructBlock().
+    The flags are stored in the peeling columns, which are no longer needed
+    once the recovery blocks are generated.
+
+    Precondition: DecodeFeed() has returned success
+*/
+
+template<typename IndexT>
+const uint8_t *CodecT<IndexT>::MarkReceivedRows()
+{
+    // Re-purpose and initialize an array to store whether or not each row id was received
+    uint8_t * GF256_RESTRICT received = reinterpret_cast<uint8_t*>( _peel_cols );
+    memset(received, 0, _block_count);
+
+#if defined(CAT_COPY_FIRST_N)
+    const PeelRowInfo * GF256_RESTRICT info = _peel_row_info;
+    // For each row:
+    for (IndexT row_i = 0; row_i < _row_count; ++row_i, ++info)
+    {
+        // If the row identifier indicates it is part of the original message data:
+        if (info->id < _block_count)
+        {
+            received[info->id] = 1;
+        }
+    }
+#endif // CAT_COPY_FIRST_N
+
+    return received;
+}
+
+/*
+    ReconstructOutputInPlace
+
+        This function reconstructs the output inside the input blocks
+    so that the decoder does not need a separate message-sized buffer.
+
+        The solver regenerates peeled columns from the input rows in
+    Substitute(), so the input rows stay live until the recovery blocks
+    are complete.  After that point they are only needed for the
+    original message rows that were received.  Those rows are moved into
+    their final position by swapping, which consumes the rows that were
+    in the way, and the remaining rows are regenerated from the recovery
+    blocks.  The row identifiers are updated to follow the swaps.
+
+    Precondition: DecodeFeed() has returned success
+*/
+
+template<typename IndexT>
+Result CodecT<IndexT>::ReconstructOutputInPlace(const void ** message_out)
+{
+    CAT_IF_DUMP(cout << endl << "---- ReconstructOutputInPlace ----" << endl << endl;)
+
+    // Validate input
+    if (!message_out || _input_rows)
+    {
+        return R_BAD_INPUT;
+    }
+
+    // If already done,
+    if (_output_in_place)
+    {
+        *message_out = _input_blocks;
+        return R_WIN;
+    }
+
+#if defined(CAT_COPY_FIRST_N)
+    // Re-purpose and initialize an array to store whether or not each row id needs to be regenerated
+    uint8_t * GF256_RESTRICT copied_rows = reinterpret_cast<uint8_t*>( _peel_cols );
+    memset(copied_rows, 0, _block_count);
+
+    // For each row:
+    PeelRowInfo * GF256_RESTRICT info = _peel_row_info;
+    for (IndexT row_i = 0; row_i < _row_count; ++row_i)
+    {
+        // While the row holds an original message row that is out of place:
+        uint32_t id;
+        while ((id = info[row_i].id) < _block_count && id != row_i)
+        {
+            uint8_t * GF256_RESTRICT src = _input_blocks + (size_t)_block_bytes * row_i;
+            uint8_t * GF256_RESTRICT dest = _input_blocks + (size_t)_block_bytes * id;
+
+            // If its final position is past the stored rows, it is unused
+            if (id >= _row_count)
+            {
+                CAT_IF_DUMP(cout << "Moving received row " << id << " from " << row_i << endl;)
+
+                memcpy(dest, src, _block_bytes);
+                copied_rows[id] = 1;
+                info[row_i].id = LIST_TERM;
+                break;
+            }
+
+            // If its final position already holds a copy of it, drop this one
+            if (info[id].id == id)
+            {
+                info[row_i].id = LIST_TERM;
+                break;
+            }
+
+            CAT_IF_DUMP(cout << "Swapping received row " << id << " from " << row_i << endl;)
+
+            // Swap it into place and continue with the row that was in the way
+            gf256_memswap(dest, src, _block_bytes);
+            info[row_i].id = info[id].id;
+            info[id].id = id;
+            copied_rows[id] = 1;
+        }
+
+        // If the row was already in place,
+        if (id == row_i)
+        {
+            copied_rows[id] = 1;
+        }
+    }
+#endif // CAT_COPY_FIRST_N
+
+    // Regenerate any rows that got lost:
+
+    uint8_t * GF256_RESTRICT dest = _input_blocks;
+    // For each row:
+    for (IndexT row_i = 0; row_i < _block_count; ++row_i, dest += _block_bytes)
+    {
+#if defined(CAT_COPY_FIRST_N)
+        // If already in place, skip it
+        if (copied_rows[row_i])
+        {
+            continue;
+        }
+#endif
+
+        ReconstructBlock(row_i, dest);
+    }
+
+    _output_in_place = true;
+    *message_out = _input_blocks;
+    return R_WIN;
+}
+
 
 //// Memory Management
 
-Codec::Codec()
+// Alignment of each region carved from caller-provided memory
+static const size_t ARENA_ALIGN = 64;
+
+static GF256_FORCE_INLINE size_t ArenaRoundUp(size_t bytes)
+{
+    return (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+template<typename IndexT>
+CodecT<IndexT>::CodecT()
 {
     // Workspace
     _recovery_blocks = 0;
     _workspace_allocated = 0;
+    _ref_chunks_grown = 0;
 
     // Matrix
     _compress_matrix = 0;
@@ -5022,55 +5739,322 @@ Codec::Codec()
     // Input
     _input_blocks = 0;
     _input_allocated = 0;
+    _input_rows = 0;
+    _zero_copy_input = false;
+    _output_blocks = 0;
+    _staged_count = 0;
+    _segmented_input = false;
+    _output_in_place = false;
+
+    // Caller-provided memory
+    _arena = 0;
+    _arena_bytes = 0;
+    _arena_used = 0;
+
+    // Statistics
+    _stats_enabled = false;
+    ResetStats();
+
+    // Seed search
+    _p_seed_override = SEED_FROM_TABLE;
+    _d_seed_override = SEED_FROM_TABLE;
 }
 
-Codec::~Codec()
+template<typename IndexT>
+CodecT<IndexT>::~CodecT()
 {
     FreeWorkspace();
     FreeMatrix();
     FreeInput();
 }
 
-void Codec::SetInput(const void * GF256_RESTRICT message_in)
+template<typename IndexT>
+uint64_t CodecT<IndexT>::MemorySize(uint64_t message_bytes, int block_bytes, bool decoder, bool zero_copy_input)
+{
+    CodecT<IndexT> codec;
+
+    if (codec.ChooseMatrix(message_bytes, block_bytes) != R_WIN)
+    {
+        return 0;
+    }
+
+    codec._extra_count = decoder ? CAT_MAX_EXTRA_ROWS : 0;
+    codec._zero_copy_input = decoder && zero_copy_input;
+
+    // The number of deferred columns is only known after peeling.  It stays
+    // near the dense row count, so the GE matrix is given twice that.
+    uint32_t defer_budget = 2 * (uint32_t)codec._dense_count + 64;
+    if (defer_budget > codec._block_count)
+    {
+        defer_budget = codec._block_count;
+    }
+
+    uint64_t size = ArenaRoundUp(codec.WorkspaceBytes()) + ArenaRoundUp(codec.MatrixBytes(defer_budget));
+    if (decoder)
+    {
+        size += ArenaRoundUp(codec.InputBytes());
+    }
+
+    return size;
+}
+
+template<typename IndexT>
+void CodecT<IndexT>::UseMemory(void * GF256_RESTRICT memory, uint64_t bytes)
+{
+    // Release any regions allocated before
+    FreeWorkspace();
+    FreeMatrix();
+    FreeInput();
+
+    _arena = reinterpret_cast<uint8_t *>( memory );
+    _arena_bytes = (size_t)bytes;
+    _arena_used = 0;
+}
+
+template<typename IndexT>
+uint8_t * CodecT<IndexT>::CarveArena(size_t bytes)
+{
+    bytes = ArenaRoundUp(bytes);
+
+    if (_arena_bytes - _arena_used < bytes)
+    {
+        return 0;
+    }
+
+    uint8_t * region = _arena + _arena_used;
+    _arena_used += bytes;
+    return region;
+}
+
+template<typename IndexT>
+size_t CodecT<IndexT>::InputBytes()
+{
+    const size_t row_count = (size_t)_block_count + _extra_count;
+
+    // Row pointers and one block for padding the final block
+    if (_zero_copy_input)
+    {
+        return row_count * sizeof(const uint8_t *) + _block_bytes;
+    }
+
+    // Row pointers and blocks for rows gathered from several segments
+    if (_segmented_input)
+    {
+        return row_count * sizeof(const uint8_t *) + (size_t)_staged_count * _block_bytes;
+    }
+
+    // Row pointers and blocks for rows that are not stored in the output
+    if (_output_blocks)
+    {
+        return row_count * (sizeof(const uint8_t *) + _block_bytes);
+    }
+
+    return row_count * _block_bytes;
+}
+
+template<typename IndexT>
+void CodecT<IndexT>::SetInput(const void * GF256_RESTRICT message_in)
 {
     FreeInput();
 
     // Set input blocks to the input message
     _input_blocks = (uint8_t*)message_in;
     _input_allocated = 0;
+    _input_rows = 0;
+    _segmented_input = false;
 }
 
-bool Codec::AllocateInput()
+template<typename IndexT>
+bool CodecT<IndexT>::AllocateInput()
 {
     CAT_IF_DUMP(cout << endl << "---- AllocateInput ----" << endl << endl;)
 
-    // If need to allocate more,
-    uint32_t size = (_block_count + _extra_count) * _block_bytes;
-    if (_input_allocated < size)
-    {
-        FreeInput();
+    const size_t size = InputBytes();
 
-        // Allocate input blocks
-        _input_blocks = new(std::nothrow) uint8_t[size];
+    // If using caller-provided memory,
+    if (_arena)
+    {
+        _input_blocks = CarveArena(size);
+        _input_allocated = 0;
         if (!_input_blocks) return false;
-        _input_allocated = size;
+    }
+    else
+    {
+        // Rewind to the start of the allocation if it began with row pointers
+        if (_input_rows && _input_allocated > 0)
+        {
+            _input_blocks = reinterpret_cast<uint8_t *>( _input_rows );
+        }
+
+        // If need to allocate more,
+        if (_input_allocated < size)
+        {
+            FreeInput();
+
+            // Allocate input blocks
+            _input_blocks = new(std::nothrow) uint8_t[size];
+            if (!_input_blocks) return false;
+            _input_allocated = size;
+        }
+    }
+
+    // If registering rows by pointer,
+    if (_zero_copy_input || _output_blocks || _segmented_input)
+    {
+        // Row pointers come first, followed by the blocks
+        _input_rows = reinterpret_cast<const uint8_t **>( _input_blocks );
+        _input_blocks += ((size_t)_block_count + _extra_count) * sizeof(const uint8_t *);
+    }
+    else
+    {
+        _input_rows = 0;
     }
 
     return true;
 }
 
-void Codec::FreeInput()
+template<typename IndexT>
+void CodecT<IndexT>::FreeInput()
 {
     if (_input_allocated > 0 && _input_blocks)
     {
-        delete []_input_blocks;
-        _input_blocks = 0;
+        // The allocation starts at the row pointers if there are any
+        uint8_t * GF256_RESTRICT input = _input_rows ? reinterpret_cast<uint8_t *>( _input_rows ) : _input_blocks;
+        delete []input;
     }
 
+    _input_blocks = 0;
+    _input_rows = 0;
     _input_allocated = 0;
 }
 
-bool Codec::AllocateMatrix()
+template<typename IndexT>
+IndexT CodecT<IndexT>::MapSegments(const Segment * GF256_RESTRICT segments, bool store)
+{
+    IndexT staged_count = 0;
+    const Segment * GF256_RESTRICT segment = segments;
+    uint64_t segment_start = 0; // Message offset of the segment
+
+    // For each row:
+    for (IndexT row_i = 0; row_i < _block_count; ++row_i)
+    {
+        const uint64_t block_start = (uint64_t)_block_bytes * row_i;
+        const uint32_t block_bytes = (row_i == _block_count - 1) ? _input_final_bytes : _block_bytes;
+        const uint64_t block_end = block_start + block_bytes;
+
+        // Skip segments that end before this row
+        while (segment_start + segment->bytes <= block_start)
+        {
+            segment_start += segment->bytes;
+            ++segment;
+        }
+
+        // If the row is within one segment, reference it there
+        if (block_end <= segment_start + segment->bytes)
+        {
+            if (store)
+            {
+                _input_rows[row_i] = reinterpret_cast<const uint8_t *>( segment->data ) + (block_start - segment_start);
+            }
+            continue;
+        }
+
+        // Otherwise gather the pieces into the next staging block
+        if (store)
+        {
+            uint8_t * GF256_RESTRICT block_dest = _input_blocks + (size_t)_block_bytes * staged_count;
+            _input_rows[row_i] = block_dest;
+
+            const Segment * GF256_RESTRICT piece = segment;
+            uint64_t piece_start = segment_start;
+            for (uint64_t offset = block_start; offset < block_end; piece_start += piece->bytes, ++piece)
+            {
+                const uint64_t piece_end = piece_start + piece->bytes;
+                if (offset < piece_end)
+                {
+                    const size_t copy_bytes = (size_t)((piece_end < block_end ? piece_end : block_end) - offset);
+                    memcpy(block_dest, reinterpret_cast<const uint8_t *>( piece->data ) + (offset - piece_start), copy_bytes);
+                    block_dest += copy_bytes;
+                    offset += copy_bytes;
+                }
+            }
+        }
+        ++staged_count;
+    }
+
+    return staged_count;
+}
+
+template<typename IndexT>
+void CodecT<IndexT>::StoreInputRow(IndexT row_i, uint32_t id, const void * GF256_RESTRICT block_in)
+{
+    const uint8_t * GF256_RESTRICT block = reinterpret_cast<const uint8_t *>( block_in );
+    const bool final_partial = (id == _block_count - 1) && (_output_final_bytes < _block_bytes);
+
+    // If original rows are stored at their final offset in the output,
+    if (_output_blocks && id < _block_count && !final_partial)
+    {
+        uint8_t * GF256_RESTRICT block_dest = _output_blocks + (size_t)_block_bytes * id;
+        memcpy(block_dest, block, _block_bytes);
+        _input_rows[row_i] = block_dest;
+        return;
+    }
+
+    // If registering rows by pointer,
+    if (_zero_copy_input)
+    {
+        // Only the final block is copied, since it must be padded with zeroes
+        if (final_partial)
+        {
+            memcpy(_input_blocks, block, _output_final_bytes);
+            memset(_input_blocks + _output_final_bytes, 0, _block_bytes - _output_final_bytes);
+            block = _input_blocks;
+        }
+
+        _input_rows[row_i] = block;
+        return;
+    }
+
+    uint8_t * GF256_RESTRICT block_store = _input_blocks + (size_t)_block_bytes * row_i;
+
+    // If this is the last block id:
+    if (final_partial)
+    {
+        // Copy the new row data into the input block area
+        memcpy(block_store, block, _output_final_bytes);
+
+        // Pad with zeroes
+        memset(block_store + _output_final_bytes, 0, _block_bytes - _output_final_bytes);
+    }
+    else
+    {
+        // Copy the new row data into the input block area
+        memcpy(block_store, block, _block_bytes);
+    }
+
+    if (_input_rows)
+    {
+        _input_rows[row_i] = block_store;
+    }
+}
+
+template<typename IndexT>
+size_t CodecT<IndexT>::MatrixBytes(uint32_t defer_count)
+{
+    const int ge_cols = defer_count + _mix_count;
+    const int ge_rows = defer_count + _dense_count + _extra_count + 1; // One extra for workspace
+    const int ge_pitch = (ge_cols + 63) / 64;
+    const int pivot_count = ge_cols + _extra_count;
+    const int heavy_cols = _mix_count < CAT_HEAVY_MAX_COLS ? _mix_count : CAT_HEAVY_MAX_COLS;
+    const int heavy_pitch = (heavy_cols + 3 + 3) & ~3;
+
+    return ((size_t)ge_rows + _block_count) * ge_pitch * sizeof(uint64_t)
+        + (pivot_count * 2 + ge_cols) * sizeof(IndexT)
+        + heavy_pitch * (CAT_HEAVY_ROWS + _extra_count);
+}
+
+template<typename IndexT>
+bool CodecT<IndexT>::AllocateMatrix()
 {
     CAT_IF_DUMP(cout << endl << "---- AllocateMatrix ----" << endl << endl;)
 
@@ -5078,15 +6062,14 @@ bool Codec::AllocateMatrix()
     const int ge_cols = _defer_count + _mix_count;
     const int ge_rows = _defer_count + _dense_count + _extra_count + 1; // One extra for workspace
     const int ge_pitch = (ge_cols + 63) / 64;
-    const uint32_t ge_matrix_words = ge_rows * ge_pitch;
+    const size_t ge_matrix_words = (size_t)ge_rows * ge_pitch;
 
     // Compression matrix
     const int compress_rows = _block_count;
-    const uint32_t compress_matrix_words = compress_rows * ge_pitch;
+    const size_t compress_matrix_words = (size_t)compress_rows * ge_pitch;
 
     // Pivots
     const int pivot_count = ge_cols + _extra_count;
-    const int pivot_words = pivot_count * 2 + ge_cols;
 
     // Heavy
     const int heavy_rows = CAT_HEAVY_ROWS + _extra_count;
@@ -5095,10 +6078,18 @@ bool Codec::AllocateMatrix()
     const int heavy_bytes = heavy_pitch * heavy_rows;
 
     // Calculate buffer size
-    uint32_t size = ge_matrix_words * sizeof(uint64_t) + compress_matrix_words * sizeof(uint64_t) + pivot_words * sizeof(uint16_t) + heavy_bytes;
+    const size_t size = MatrixBytes(_defer_count);
 
+    // If using caller-provided memory,
+    if (_arena)
+    {
+        // Matrix is carved last, so it may use whatever remains
+        _compress_matrix = reinterpret_cast<uint64_t *>( CarveArena(size) );
+        if (!_compress_matrix) return false;
+        _ge_allocated = 0;
+    }
     // If need to allocate more:
-    if (_ge_allocated < size)
+    else if (_ge_allocated < size)
     {
         FreeMatrix();
 
@@ -5115,13 +6106,13 @@ bool Codec::AllocateMatrix()
     _heavy_columns = heavy_cols;
     _first_heavy_column = _defer_count + _mix_count - heavy_cols;
     _heavy_matrix = reinterpret_cast<uint8_t *>( _ge_matrix + ge_matrix_words );
-    _pivots = reinterpret_cast<uint16_t *>( _heavy_matrix + heavy_bytes );
+    _pivots = reinterpret_cast<IndexT *>( _heavy_matrix + heavy_bytes );
     _ge_row_map = _pivots + pivot_count;
     _ge_col_map = _ge_row_map + pivot_count;
 
     CAT_IF_DUMP(cout << "GE matrix is " << ge_rows << " x " << ge_cols << " with pitch " << ge_pitch << " consuming " << ge_matrix_words * sizeof(uint64_t) << " bytes" << endl;)
     CAT_IF_DUMP(cout << "Compress matrix is " << compress_rows << " x " << ge_cols << " with pitch " << ge_pitch << " consuming " << compress_matrix_words * sizeof(uint64_t) << " bytes" << endl;)
-    CAT_IF_DUMP(cout << "Allocated " << pivot_count << " pivots, consuming " << pivot_words*2 << " bytes" << endl;)
+    CAT_IF_DUMP(cout << "Allocated " << pivot_count << " pivots, consuming " << pivot_count*2 << " bytes" << endl;)
     CAT_IF_DUMP(cout << "Allocated " << CAT_HEAVY_ROWS << " heavy rows, consuming " << heavy_bytes << " bytes" << endl;)
 
     // Clear entire Compression matrix
@@ -5133,31 +6124,60 @@ bool Codec::AllocateMatrix()
     return true;
 }
 
-void Codec::FreeMatrix()
+template<typename IndexT>
+void CodecT<IndexT>::FreeMatrix()
 {
-    if (_compress_matrix)
+    if (_ge_allocated > 0 && _compress_matrix)
     {
         uint8_t * GF256_RESTRICT matrix = reinterpret_cast<uint8_t *>( _compress_matrix );
         delete []matrix;
-        _compress_matrix = 0;
     }
 
+    _compress_matrix = 0;
     _ge_allocated = 0;
 }
 
-bool Codec::AllocateWorkspace()
+template<typename IndexT>
+size_t CodecT<IndexT>::WorkspaceBytes()
+{
+    const size_t recovery_size = ((size_t)_block_count + _mix_count + 1) * _block_bytes; // +1 for temporary space
+    const size_t row_count = (size_t)_block_count + _extra_count;
+    const size_t column_count = _block_count;
+
+    // One head chunk per column, plus overflow chunks for columns with more references than average
+    // and room for the heaviest possible row (64 columns)
+    const size_t chunk_count = column_count + column_count / 2 + 64;
+
+    // Arrays are ordered by decreasing alignment after the recovery blocks
+    return ((recovery_size + 7) & ~(size_t)7) + sizeof(PeelRefs) * chunk_count
+        + sizeof(PeelRowInfo) * row_count + sizeof(PeelRow) * row_count
+        + (sizeof(IndexT) * 2 + sizeof(PeelColumn) + 1) * column_count;
+}
+
+template<typename IndexT>
+bool CodecT<IndexT>::AllocateWorkspace()
 {
     CAT_IF_DUMP(cout << endl << "---- AllocateWorkspace ----" << endl << endl;)
 
     // Count needed rows and columns
-    const uint32_t recovery_size = (_block_count + _mix_count + 1) * _block_bytes; // +1 for temporary space
+    const size_t recovery_size = ((size_t)_block_count + _mix_count + 1) * _block_bytes; // +1 for temporary space
     const uint32_t row_count = _block_count + _extra_count;
     const uint32_t column_count = _block_count;
+    const uint32_t chunk_count = column_count + column_count / 2 + 64;
+    const size_t refs_offset = (recovery_size + 7) & ~(size_t)7;
 
     // Calculate size
-    uint32_t size = recovery_size + sizeof(PeelRow) * row_count
-        + sizeof(PeelColumn) * column_count + sizeof(PeelRefs) * column_count;
-    if (_workspace_allocated < size)
+    const size_t size = WorkspaceBytes();
+
+    // If using caller-provided memory,
+    if (_arena)
+    {
+        _recovery_blocks = CarveArena(size);
+        if (!_recovery_blocks)
+            return false;
+        _workspace_allocated = 0;
+    }
+    else if (_workspace_allocated < size)
     {
         FreeWorkspace();
 
@@ -5168,29 +6188,46 @@ bool Codec::AllocateWorkspace()
         _workspace_allocated = size;
     }
 
+    // Release any reference chunks grown for a previous message
+    delete[]_ref_chunks_grown;
+    _ref_chunks_grown = 0;
+
     // Set pointers
-    _peel_rows = reinterpret_cast<PeelRow *>( _recovery_blocks + recovery_size );
+    _peel_col_refs = reinterpret_cast<PeelRefs *>( _recovery_blocks + refs_offset );
+    _peel_row_info = reinterpret_cast<PeelRowInfo *>( _peel_col_refs + chunk_count );
+    _peel_rows = reinterpret_cast<PeelRow *>( _peel_row_info + row_count );
     _peel_cols = reinterpret_cast<PeelColumn *>( _peel_rows + row_count );
-    _peel_col_refs = reinterpret_cast<PeelRefs *>( _peel_cols + column_count );
+    _peel_ref_counts = reinterpret_cast<IndexT *>( _peel_cols + column_count );
+    _peel_col_next = _peel_ref_counts + column_count;
+    _peel_col_marks = reinterpret_cast<uint8_t *>( _peel_col_next + column_count );
+    _ref_chunk_count = column_count;
+    _ref_chunk_capacity = chunk_count;
 
     CAT_IF_DUMP(cout << "Memory overhead for workspace = " << size << " bytes" << endl;)
 
     // Initialize columns
-    for (int ii = 0; ii < _block_count; ++ii)
+    for (uint32_t ii = 0; ii < column_count; ++ii)
     {
-        _peel_col_refs[ii].row_count = 0;
+        _peel_ref_counts[ii] = 0;
         _peel_cols[ii].w2_refs = 0;
-        _peel_cols[ii].mark = MARK_TODO;
     }
+    memset(_peel_col_marks, MARK_TODO, column_count);
 
     return true;
 }
 
-void Codec::FreeWorkspace()
+template<typename IndexT>
+void CodecT<IndexT>::FreeWorkspace()
 {
-    delete[]_recovery_blocks;
+    if (_workspace_allocated > 0)
+    {
+        delete[]_recovery_blocks;
+    }
     _recovery_blocks = nullptr;
     _workspace_allocated = 0;
+
+    delete[]_ref_chunks_grown;
+    _ref_chunks_grown = 0;
 }
 
 
@@ -5198,7 +6235,8 @@ void Codec::FreeWorkspace()
 
 #if defined(CAT_DUMP_CODEC_DEBUG) || defined(CAT_DUMP_GE_MATRIX)
 
-void Codec::PrintGEMatrix()
+template<typename IndexT>
+void CodecT<IndexT>::PrintGEMatrix()
 {
     const int rows = _dense_count + _defer_count;
     const int cols = _defer_count + _mix_count;
@@ -5233,28 +6271,29 @@ void Codec::PrintGEMatrix()
     cout << endl;
 }
 
-void Codec::PrintExtraMatrix()
+template<typename IndexT>
+void CodecT<IndexT>::PrintExtraMatrix()
 {
     cout << endl << "Extra rows: " << endl;
 
     // For each pivot,
     int extra_count = 0;
-    const uint16_t column_count = _defer_count + _mix_count;
-    const uint16_t first_heavy_row = _defer_count + _dense_count;
-    for (uint16_t pivot_i = 0; pivot_i < _pivot_count; ++pivot_i)
+    const IndexT column_count = _defer_count + _mix_count;
+    const IndexT first_heavy_row = _defer_count + _dense_count;
+    for (IndexT pivot_i = 0; pivot_i < _pivot_count; ++pivot_i)
     {
         // If row is extra,
-        uint16_t ge_row_i = _pivots[pivot_i];
+        IndexT ge_row_i = _pivots[pivot_i];
         if (ge_row_i >= first_heavy_row && ge_row_i < first_heavy_row + _extra_count)
         {
             uint64_t * GF256_RESTRICT ge_row = _ge_matrix + _ge_pitch * ge_row_i;
-            uint16_t heavy_row_i = ge_row_i - first_heavy_row;
+            IndexT heavy_row_i = ge_row_i - first_heavy_row;
             uint8_t * GF256_RESTRICT heavy_row = _heavy_matrix + _heavy_pitch * heavy_row_i;
 
             cout << "row=" << ge_row_i << " : light={ ";
 
             // For each non-heavy column,
-            for (uint16_t ge_column_i = 0; ge_column_i < _first_heavy_column; ++ge_column_i)
+            for (IndexT ge_column_i = 0; ge_column_i < _first_heavy_column; ++ge_column_i)
             {
                 // If column is non-zero,
                 uint64_t ge_mask = (uint64_t)1 << (ge_column_i & 63);
@@ -5271,9 +6310,9 @@ void Codec::PrintExtraMatrix()
             cout << " } heavy=(";
 
             // For each heavy column,
-            for (uint16_t ge_column_i = _first_heavy_column; ge_column_i < column_count; ++ge_column_i)
+            for (IndexT ge_column_i = _first_heavy_column; ge_column_i < column_count; ++ge_column_i)
             {
-                uint16_t heavy_col_i = ge_column_i - _first_heavy_column;
+                IndexT heavy_col_i = ge_column_i - _first_heavy_column;
                 uint8_t code_value = heavy_row[heavy_col_i];
 
                 cout << " " << hex << setfill('0') << setw(2) << (int)code_value << dec;
@@ -5288,7 +6327,8 @@ void Codec::PrintExtraMatrix()
     cout << "Number of extra rows is " << extra_count << endl << endl;
 }
 
-void Codec::PrintCompressMatrix()
+template<typename IndexT>
+void CodecT<IndexT>::PrintCompressMatrix()
 {
     const int rows = _block_count;
     const int cols = _defer_count + _mix_count;
@@ -5299,7 +6339,7 @@ void Codec::PrintCompressMatrix()
     {
         for (int jj = 0; jj < cols; ++jj)
         {
-            if (_compress_matrix[_ge_pitch * ii + (jj >> 6)] & ((uint64_t)1 << (jj & 63)))
+            if (_compress_matrix[(size_t)_ge_pitch * ii + (jj >> 6)] & ((uint64_t)1 << (jj & 63)))
                 cout << '1';
             else
                 cout << '0';
@@ -5310,11 +6350,12 @@ void Codec::PrintCompressMatrix()
     cout << endl;
 }
 
-void Codec::PrintPeeled()
+template<typename IndexT>
+void CodecT<IndexT>::PrintPeeled()
 {
     cout << "Peeled elements :";
 
-    uint16_t row_i = _peel_head_rows;
+    IndexT row_i = _peel_head_rows;
     while (row_i != LIST_TERM)
     {
         PeelRow *row = &_peel_rows[row_i];
@@ -5327,11 +6368,12 @@ void Codec::PrintPeeled()
     cout << endl;
 }
 
-void Codec::PrintDeferredRows()
+template<typename IndexT>
+void CodecT<IndexT>::PrintDeferredRows()
 {
     cout << "Deferred rows :";
 
-    uint16_t row_i = _defer_head_rows;
+    IndexT row_i = _defer_head_rows;
     while (row_i != LIST_TERM)
     {
         PeelRow *row = &_peel_rows[row_i];
@@ -5344,18 +6386,17 @@ void Codec::PrintDeferredRows()
     cout << endl;
 }
 
-void Codec::PrintDeferredColumns()
+template<typename IndexT>
+void CodecT<IndexT>::PrintDeferredColumns()
 {
     cout << "Deferred columns :";
 
-    uint16_t column_i = _defer_head_columns;
+    IndexT column_i = _defer_head_columns;
     while (column_i != LIST_TERM)
     {
-        PeelColumn *column = &_peel_cols[column_i];
-
         cout << " " << column_i;
 
-        column_i = column->next;
+        column_i = _peel_col_next[column_i];
     }
 
     cout << endl;
@@ -5364,15 +6405,82 @@ void Codec::PrintDeferredColumns()
 #endif // CAT_DUMP_CODEC_DEBUG
 
 
+//// Statistics
+
+// Timestamp counter for phase statistics
+static GF256_FORCE_INLINE uint64_t GetTimestamp()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+template<typename IndexT>
+void CodecT<IndexT>::ResetStats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+template<typename IndexT>
+void CodecT<IndexT>::RecordSolveStats()
+{
+    if (!_stats_enabled)
+    {
+        return;
+    }
+
+    const IndexT column_count = _defer_count + _mix_count;
+    const IndexT first_heavy_row = _defer_count + _dense_count + _extra_count;
+
+    _stats.PeeledColumns = _block_count - _defer_count;
+    _stats.DeferredColumns = _defer_count;
+    _stats.DenseRows = _dense_count;
+    _stats.GERows = _pivot_count;
+    _stats.GEColumns = column_count;
+
+    // Count the pivots that were found in the heavy rows rather than extra rows
+    _stats.HeavyPivots = 0;
+    for (IndexT pivot_i = 0; pivot_i < column_count; ++pivot_i)
+    {
+        if (_pivots[pivot_i] >= first_heavy_row)
+        {
+            ++_stats.HeavyPivots;
+        }
+    }
+}
+
+template<typename IndexT>
+uint64_t CodecT<IndexT>::StartPhase()
+{
+    return _stats_enabled ? GetTimestamp() : 0;
+}
+
+template<typename IndexT>
+void CodecT<IndexT>::EndPhase(StatsPhase phase, uint64_t &timestamp)
+{
+    if (_stats_enabled)
+    {
+        const uint64_t now = GetTimestamp();
+        _stats.Cycles[phase] += now - timestamp;
+        timestamp = now;
+    }
+}
+
+
 //// Encoder Mode
 
-Result Codec::InitializeEncoder(int message_bytes, int block_bytes)
+template<typename IndexT>
+Result CodecT<IndexT>::InitializeEncoder(uint64_t message_bytes, int block_bytes)
 {
+    ResetStats();
+
     Result r = ChooseMatrix(message_bytes, block_bytes);
     if (r == R_WIN)
     {
         // Calculate partial final bytes
-        uint32_t partial_final_bytes = message_bytes % _block_bytes;
+        uint32_t partial_final_bytes = (uint32_t)(message_bytes % _block_bytes);
         if (partial_final_bytes <= 0) partial_final_bytes = _block_bytes;
 
         // Encoder-specific
@@ -5380,6 +6488,11 @@ Result Codec::InitializeEncoder(int message_bytes, int block_bytes)
         _output_final_bytes = _block_bytes;
         _extra_count = 0;
         _encoder_was_decoder = false;
+        _zero_copy_input = false;
+        _output_blocks = 0;
+        _segmented_input = false;
+        _output_in_place = false;
+        _arena_used = 0;
 
         if (!AllocateWorkspace())
             r = R_OUT_OF_MEMORY;
@@ -5399,9 +6512,14 @@ Result Codec::InitializeEncoder(int message_bytes, int block_bytes)
         In practice, the solver should always succeed because the
     encoder should be looking up its check matrix parameters from
     a table, which guarantees the matrix is invertible.
+
+        The message may also be given as a list of segments.  Rows that
+    fall inside one segment are referenced where they are, and only the
+    rows that straddle a segment boundary are gathered into a block.
 */
 
-Result Codec::EncodeFeed(const void *message_in)
+template<typename IndexT>
+Result CodecT<IndexT>::EncodeFeed(const void *message_in)
 {
     CAT_IF_DUMP(cout << endl << "---- EncodeFeed ----" << endl << endl;)
 
@@ -5413,8 +6531,54 @@ Result Codec::EncodeFeed(const void *message_in)
 
     SetInput(message_in);
 
+    return EncodeRows();
+}
+
+template<typename IndexT>
+Result CodecT<IndexT>::EncodeFeed(const Segment * GF256_RESTRICT segments, int segment_count)
+{
+    CAT_IF_DUMP(cout << endl << "---- EncodeFeed (segments) ----" << endl << endl;)
+
+    // Validate input
+    if (!segments || segment_count < 1)
+    {
+        return R_BAD_INPUT;
+    }
+
+    // Segments must add up to the message size
+    uint64_t total_bytes = 0;
+    for (int ii = 0; ii < segment_count; ++ii)
+    {
+        if (!segments[ii].data && segments[ii].bytes > 0)
+        {
+            return R_BAD_INPUT;
+        }
+        total_bytes += segments[ii].bytes;
+    }
+    if (total_bytes != (uint64_t)_block_bytes * (_block_count - 1) + _input_final_bytes)
+    {
+        return R_BAD_INPUT;
+    }
+
+    // Size the staging area, then reference or gather each row
+    _segmented_input = true;
+    _staged_count = MapSegments(segments, false);
+    if (!AllocateInput())
+    {
+        return R_OUT_OF_MEMORY;
+    }
+    MapSegments(segments, true);
+
+    CAT_IF_DUMP(cout << "Gathered " << _staged_count << " rows that straddle segments" << endl;)
+
+    return EncodeRows();
+}
+
+template<typename IndexT>
+Result CodecT<IndexT>::EncodeRows()
+{
     // For each input row:
-    for (uint16_t id = 0; id < _block_count; ++id)
+    for (IndexT id = 0; id < _block_count; ++id)
     {
         if (!OpportunisticPeeling(id, id))
         {
@@ -5445,7 +6609,8 @@ Result Codec::EncodeFeed(const void *message_in)
     sum together recovery blocks to produce the new block.
 */
 
-uint32_t Codec::Encode(uint32_t id, void *block_out)
+template<typename IndexT>
+uint32_t CodecT<IndexT>::Encode(uint32_t id, void *block_out)
 {
     if (!block_out)
     {
@@ -5460,7 +6625,7 @@ uint32_t Codec::Encode(uint32_t id, void *block_out)
     if (id < _block_count && !_encoder_was_decoder)
     {
         // Until the final block in message blocks:
-        const uint8_t * GF256_RESTRICT src = _input_blocks + _block_bytes * id;
+        const uint8_t * GF256_RESTRICT src = InputRow(id);
         if ((int)id == _block_count - 1)
         {
             // For the final block, copy partial block
@@ -5476,12 +6641,12 @@ uint32_t Codec::Encode(uint32_t id, void *block_out)
 
     CAT_IF_DUMP(cout << "Encode: Generating row " << id << ":";)
 
-    uint16_t peel_weight, peel_a, peel_x, mix_a, mix_x;
+    IndexT peel_weight, peel_a, peel_x, mix_a, mix_x;
     GeneratePeelRow(id, _p_seed, _block_count, _mix_count,
         peel_weight, peel_a, peel_x, mix_a, mix_x);
 
     // Remember first column (there is always at least one)
-    uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_bytes * peel_x;
+    uint8_t * GF256_RESTRICT first = _recovery_blocks + (size_t)_block_bytes * peel_x;
 
     CAT_IF_DUMP(cout << " " << peel_x;)
 
@@ -5495,7 +6660,7 @@ uint32_t Codec::Encode(uint32_t id, void *block_out)
         CAT_IF_DUMP(cout << " " << peel_x;)
 
         // Combine first two columns into output buffer (faster than memcpy + memxor)
-        gf256_addset_mem(block, first, _recovery_blocks + _block_bytes * peel_x, _block_bytes);
+        gf256_addset_mem(block, first, _recovery_blocks + (size_t)_block_bytes * peel_x, _block_bytes);
 
         // For each remaining peeler column:
         while (--peel_weight > 0)
@@ -5505,16 +6670,16 @@ uint32_t Codec::Encode(uint32_t id, void *block_out)
             CAT_IF_DUMP(cout << " " << peel_x;)
 
             // Mix in each column
-            gf256_add_mem(block, _recovery_blocks + _block_bytes * peel_x, _block_bytes);
+            gf256_add_mem(block, _recovery_blocks + (size_t)_block_bytes * peel_x, _block_bytes);
         }
 
         // Mix first mixer block in directly
-        gf256_add_mem(block, _recovery_blocks + _block_bytes * (_block_count + mix_x), _block_bytes);
+        gf256_add_mem(block, _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x), _block_bytes);
     }
     else
     {
         // Mix first with first mixer block (faster than memcpy + memxor)
-        gf256_addset_mem(block, first, _recovery_blocks + _block_bytes * (_block_count + mix_x), _block_bytes);
+        gf256_addset_mem(block, first, _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x), _block_bytes);
     }
 
     CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
@@ -5522,11 +6687,11 @@ uint32_t Codec::Encode(uint32_t id, void *block_out)
     // Add in remaining 2 mixer columns:
 
     IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-    const uint8_t * mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+    const uint8_t * mix0_src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
     CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
     IterateNextColumn(mix_x, _mix_count, _mix_next_prime, mix_a);
-    const uint8_t * mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix_x);
+    const uint8_t * mix1_src = _recovery_blocks + (size_t)_block_bytes * (_block_count + mix_x);
     CAT_IF_DUMP(cout << " " << (_block_count + mix_x);)
 
     gf256_add2_mem(block, mix0_src, mix1_src, _block_bytes);
@@ -5539,13 +6704,16 @@ uint32_t Codec::Encode(uint32_t id, void *block_out)
 
 //// Decoder Mode
 
-Result Codec::InitializeDecoder(int message_bytes, int block_bytes)
+template<typename IndexT>
+Result CodecT<IndexT>::InitializeDecoder(uint64_t message_bytes, int block_bytes, bool zero_copy_input, void * GF256_RESTRICT message_out)
 {
+    ResetStats();
+
     Result r = ChooseMatrix(message_bytes, block_bytes);
     if (r == R_WIN)
     {
         // Calculate partial final bytes
-        uint32_t partial_final_bytes = message_bytes % _block_bytes;
+        uint32_t partial_final_bytes = (uint32_t)(message_bytes % _block_bytes);
         if (partial_final_bytes <= 0)
         {
             partial_final_bytes = _block_bytes;
@@ -5564,6 +6732,11 @@ Result Codec::InitializeDecoder(int message_bytes, int block_bytes)
         _all_original = true;
 #endif
         _encoder_was_decoder = true;
+        _zero_copy_input = zero_copy_input;
+        _output_blocks = zero_copy_input ? 0 : reinterpret_cast<uint8_t *>( message_out );
+        _segmented_input = false;
+        _output_in_place = false;
+        _arena_used = 0;
 
         if (!AllocateInput() || !AllocateWorkspace())
         {
@@ -5574,7 +6747,8 @@ Result Codec::InitializeDecoder(int message_bytes, int block_bytes)
     return r;
 }
 
-Result Codec::InitializeEncoderFromDecoder()
+template<typename IndexT>
+Result CodecT<IndexT>::InitializeEncoderFromDecoder()
 {
 #if defined(CAT_ALL_ORIGINAL)
     // If all original data, return success (common case)
@@ -5606,81 +6780,161 @@ Result Codec::InitializeEncoderFromDecoder()
     is attempted.  After N blocks, ResumeSolveMatrix() is used.
 */
 
-Result Codec::DecodeFeed(uint32_t id, const void * block_in)
+template<typename IndexT>
+Result CodecT<IndexT>::DecodeFeed(uint32_t id, const void * block_in)
 {
-    // Validate input
-    if (block_in == 0)
-    {
-        return R_BAD_INPUT;
-    }
-
     // If less than N rows stored:
-    uint16_t row_i = _row_count;
-    if (row_i < _block_count)
+    if (_row_count < _block_count)
     {
-#if defined(CAT_ALL_ORIGINAL)
-        // If provided a block of non-original data, mark all original as false
-        if (id >= _block_count)
+        Result r = DecodePeel(id, block_in);
+
+        // If just acquired N blocks that are not all original:
+        if (r == R_MORE_BLOCKS && _row_count == _block_count)
         {
-            _all_original = false;
+            // Attempt to solve the matrix and generate recovery blocks
+            r = DecodeSolve();
         }
-#endif
 
-        // If opportunistic peeling succeeded:
-        if (OpportunisticPeeling(row_i, id))
-        {
-            uint8_t *block_store = _input_blocks + _block_bytes * row_i;
+        return r;
+    }
 
-            // If this is the last block id:
-            if (id == _block_count - 1)
-            {
-                const uint32_t final_bytes = _output_final_bytes;
+    return DecodeResume(id, block_in);
+}
 
-                // Copy the new row data into the input block area
-                memcpy(block_store, block_in, final_bytes);
+/*
+    DecodePeel
 
-                // Pad with zeroes
-                memset(block_store + final_bytes, 0, _block_bytes - final_bytes);
-            }
-            else
-            {
-                // Copy the new row data into the input block area
-                memcpy(block_store, block_in, _block_bytes);
-            }
+        This function is the first half of DecodeFeed(), which only
+    stores and peels the new block.  It is cheap enough to run on the
+    receive path.  Once N blocks are stored, DecodeSolve() must be run
+    before any more blocks are fed with DecodeResume().  This allows the
+    solver to run on another thread.
+*/
+
+template<typename IndexT>
+Result CodecT<IndexT>::DecodePeel(uint32_t id, const void * block_in)
+{
+    // Validate input
+    if (block_in == 0 || _row_count >= _block_count)
+    {
+        return R_BAD_INPUT;
+    }
+
+    IndexT row_i = _row_count;
 
-            // If just acquired N blocks:
-            if (++_row_count == _block_count)
-            {
 #if defined(CAT_ALL_ORIGINAL)
-                // If all original data, return success (common case)
-                if (_all_original && IsAllOriginalData())
-                {
-                    return R_WIN;
-                }
+    // If provided a block of non-original data, mark all original as false
+    if (id >= _block_count)
+    {
+        _all_original = false;
+    }
 #endif
 
-                // Attempt to solve the matrix and generate recovery blocks
-                Result r = SolveMatrix();
-                if (r == R_WIN)
-                {
-                    Codec::GenerateRecoveryBlocks();
-                }
-                return r;
+    // If opportunistic peeling succeeded:
+    if (OpportunisticPeeling(row_i, id))
+    {
+        StoreInputRow(row_i, id, block_in);
+
+        // If just acquired N blocks:
+        if (++_row_count == _block_count)
+        {
+#if defined(CAT_ALL_ORIGINAL)
+            // If all original data, return success (common case)
+            if (_all_original && IsAllOriginalData())
+            {
+                return R_WIN;
             }
-        } // end if opportunistic peeling succeeded
+#endif
+        }
+    } // end if opportunistic peeling succeeded
 
-        return R_MORE_BLOCKS;
+    return R_MORE_BLOCKS;
+}
+
+template<typename IndexT>
+Result CodecT<IndexT>::DecodeSolve()
+{
+    Result r = SolveMatrix();
+    if (r == R_WIN)
+    {
+        GenerateRecoveryBlocks();
     }
 
+    return r;
+}
+
+template<typename IndexT>
+Result CodecT<IndexT>::DecodeResume(uint32_t id, const void * block_in)
+{
+    uint64_t timestamp = StartPhase();
+
     // Resume GE from this row
+    CAT_TRACE_SPAN(resume_span, "ResumeSolveMatrix");
     Result r = ResumeSolveMatrix(id, block_in);
+    CAT_TRACE_END(resume_span);
+
+    EndPhase(PHASE_TRIANGLE, timestamp);
+    if (_stats_enabled && r != R_BAD_INPUT)
+    {
+        ++_stats.ExtraRows;
+    }
+
     if (r == R_WIN)
     {
-        Codec::GenerateRecoveryBlocks();
+        GenerateRecoveryBlocks();
     }
 
     return r;
 }
 
+/*
+    OrderForPeeling
+
+        This function orders a batch of received blocks before they are
+    fed to the decoder.  Only the first N rows are used for peeling, so
+    when a batch crosses that point the rows it ends with are the ones
+    that make up the peeling matrix.  Feeding the rows of lowest peeling
+    weight first keeps the matrix sparse, which lets more columns peel
+    and leaves fewer deferred columns for Gaussian elimination.  Original
+    message rows are preferred among rows of the same weight since they
+    do not need to be regenerated on output.  Otherwise the batch keeps
+    its arrival order.
+*/
+
+template<typename IndexT>
+void CodecT<IndexT>::OrderForPeeling(const uint32_t * GF256_RESTRICT ids, int count, int * GF256_RESTRICT order)
+{
+    // Sort key for each position: weight, then original before recovery
+    uint32_t keys[CAT_PEEL_ORDER_MAX];
+
+    // For each block in the batch:
+    for (int ii = 0; ii < count; ++ii)
+    {
+        IndexT peel_weight, peel_a, peel_x, mix_a, mix_x;
+        GeneratePeelRow(ids[ii], _p_seed, _block_count, _mix_count,
+            peel_weight, peel_a, peel_x, mix_a, mix_x);
+
+        const uint32_t key = ((uint32_t)peel_weight << 1) | (ids[ii] >= _block_count ? 1 : 0);
+
+        // Insertion sort keeps arrival order for equal keys
+        int jj = ii;
+        while (jj > 0 && keys[jj - 1] > key)
+        {
+            keys[jj] = keys[jj - 1];
+            order[jj] = order[jj - 1];
+            --jj;
+        }
+        keys[jj] = key;
+        order[jj] = ii;
+    }
+}
+
+
+
+//// Explicit instantiations
+
+template class CodecT<uint16_t>;
+template class CodecT<uint32_t>;
+
 
 } // namespace wirehair
@@ -33,16 +33,20 @@
 
 // Debugging:
 //#define CAT_DUMP_CODEC_DEBUG    /* Turn on debug output for decoder */
-//#define CAT_DUMP_ROWOP_COUNTERS /* Dump row operations counters to console */
 //#define CAT_DUMP_PIVOT_FAIL     /* Dump pivot failure to console */
 //#define CAT_DUMP_GE_MATRIX      /* Dump GE matrix to console */
 
 // Limits:
-#define CAT_REF_LIST_MAX 32      /* Tune to be as small as possible and still succeed */
+#define CAT_REF_CHUNK_ROWS 6     /* Row references per column reference chunk - Near the average row weight */
 #define CAT_MAX_DENSE_ROWS 500   /* Maximum check row count */
 #define CAT_MAX_EXTRA_ROWS 32    /* Maximum number of extra rows to support before reusing existing rows */
-#define CAT_WIREHAIR_MAX_N 64000 /* Largest N value to allow */
+#define CAT_WIREHAIR_MAX_N 64000 /* Largest N value to allow with 16-bit indices */
 #define CAT_WIREHAIR_MIN_N 2     /* Smallest N value to allow */
+#define CAT_PEEL_ORDER_MAX 256   /* Largest batch of blocks to reorder for peeling at once */
+
+// Limits for the 32-bit index codec:
+#define CAT_WIREHAIR_MAX_N_32 1048576 /* Largest N value to allow with 32-bit indices */
+#define CAT_MAX_DENSE_ROWS_32 6000    /* Maximum check row count with 32-bit indices */
 
 // Optimization options:
 #define CAT_COPY_FIRST_N      /* Copy the first N rows from the input (faster) */
@@ -80,64 +84,138 @@ const char *GetResultString(Result r);
 
 extern GF256_ALIGNED gf256_ctx GF256Ctx;
 
+// One buffer of a message that is split across several buffers
+struct Segment
+{
+    const void *data;
+    uint64_t bytes;
+};
+
+// Solver phases that statistics are collected for
+enum StatsPhase
+{
+    PHASE_PEEL,             // GreedyPeeling()
+    PHASE_COMPRESS,         // Building the GE matrix, including PeelDiagonal() row ops
+    PHASE_TRIANGLE,         // Triangle(), including resumed attempts with extra rows
+    PHASE_COLUMN_VALUES,    // InitializeColumnValues()
+    PHASE_DENSE_VALUES,     // MultiplyDenseValues()
+    PHASE_SUBDIAGONAL,      // AddSubdiagonalValues()
+    PHASE_BACK_SUBSTITUTE,  // BackSubstituteAboveDiagonal()
+    PHASE_SUBSTITUTE,       // Substitute()
+
+    PHASE_COUNT
+};
+
+// Statistics collected since the last Initialize*() call while enabled
+struct CodecStats
+{
+    uint32_t PeeledColumns;             // Columns solved by peeling
+    uint32_t DeferredColumns;           // Columns deferred to Gaussian elimination
+    uint32_t DenseRows;                 // Dense rows added to the GE matrix
+    uint32_t GERows;                    // Rows in the GE matrix, including heavy and extra rows
+    uint32_t GEColumns;                 // Columns in the GE matrix
+    uint32_t HeavyPivots;               // GE columns solved by heavy rows
+    uint32_t ExtraRows;                 // Blocks fed to resume solving after the first N
+    uint64_t RowOps[PHASE_COUNT];       // Block-sized XOR operations
+    uint64_t HeavyOps[PHASE_COUNT];     // Block-sized GF(256) multiply-add operations
+    uint64_t Cycles[PHASE_COUNT];       // Elapsed timestamp counter ticks
+};
+
 
 //// Encoder/Decoder Combined Implementation
 
-class Codec
+/*
+    The codec is templated on the type used to index rows and columns.
+
+    Codec (uint16_t) is the compact version used for N up to CAT_WIREHAIR_MAX_N.
+    LargeCodec (uint32_t) doubles the size of the peeling state but supports
+    N up to CAT_WIREHAIR_MAX_N_32.  The two produce different check matrices,
+    so the encoder and decoder must agree on the version based on N.
+*/
+
+template<typename IndexT>
+class CodecT
 {
+    // Limits for this index type
+    static const uint32_t MAX_N = (sizeof(IndexT) == 2) ? CAT_WIREHAIR_MAX_N : CAT_WIREHAIR_MAX_N_32;
+    static const uint32_t MAX_DENSE_ROWS = (sizeof(IndexT) == 2) ? CAT_MAX_DENSE_ROWS : CAT_MAX_DENSE_ROWS_32;
+
     // Parameters
     uint32_t _block_bytes;                      // Number of bytes in a block
-    uint16_t _block_count;                      // Number of blocks in the message
-    uint16_t _block_next_prime;                 // Next prime number at or above block count
+    IndexT _block_count;                        // Number of blocks in the message
+    IndexT _block_next_prime;                   // Next prime number at or above block count
     uint16_t _extra_count;                      // Number of extra rows to allocate
     uint32_t _p_seed;                           // Seed for peeled rows of check matrix
     uint32_t _d_seed;                           // Seed for dense rows of check matrix
-    uint16_t _row_count;                        // Number of stored rows
-    uint16_t _mix_count;                        // Number of mix columns
-    uint16_t _mix_next_prime;                   // Next prime number at or above dense count
-    uint16_t _dense_count;                      // Number of added dense code rows
+    uint32_t _p_seed_override;                  // Peel seed to use instead of the tables, or SEED_FROM_TABLE
+    uint32_t _d_seed_override;                  // Dense seed to use instead of the tables, or SEED_FROM_TABLE
+    IndexT _row_count;                          // Number of stored rows
+    IndexT _mix_count;                          // Number of mix columns
+    IndexT _mix_next_prime;                     // Next prime number at or above dense count
+    IndexT _dense_count;                        // Number of added dense code rows
     uint8_t * GF256_RESTRICT _recovery_blocks;  // Recovery blocks
     uint8_t * GF256_RESTRICT _input_blocks;     // Input message blocks
     uint32_t _input_final_bytes;                // Number of bytes in final block of input
     uint32_t _output_final_bytes;               // Number of bytes in final block of output
-    uint32_t _input_allocated;                  // Number of bytes allocated for input, or 0 if referenced
+    size_t _input_allocated;                    // Number of bytes allocated for input, or 0 if referenced
+    const uint8_t ** GF256_RESTRICT _input_rows; // Decoder rows registered by pointer, or 0 if rows are copied
+    bool _zero_copy_input;                      // Boolean: Decoder registers rows by pointer instead of copying
+    uint8_t * GF256_RESTRICT _output_blocks;    // Decoder stores original rows at their final offset here, or 0
+    IndexT _staged_count;                       // Number of encoder rows gathered because they straddle segments
+    bool _segmented_input;                      // Boolean: Encoder rows are referenced in segments by pointer
+    bool _output_in_place;                      // Boolean: Input blocks hold the output after ReconstructOutputInPlace()
 #if defined(CAT_ALL_ORIGINAL)
     bool _all_original;                         // Boolean: Only seen original data block identifiers
 #endif
     bool _encoder_was_decoder;                  // Boolean: Encoder was originally a decoder
+    bool _stats_enabled;                        // Boolean: Collect statistics in _stats
+    CodecStats _stats;                          // Statistics since the last Initialize*() call
 
-    // Peeling state
+    // Peeling state: Hot fields are kept apart from fields used only after peeling
     struct PeelRow;
+    struct PeelRowInfo;
     struct PeelColumn;
     struct PeelRefs;
     PeelRow * GF256_RESTRICT _peel_rows;        // Array of N peeling matrix rows
+    PeelRowInfo * GF256_RESTRICT _peel_row_info; // Array of N row identifiers and mixing column generators
     PeelColumn * GF256_RESTRICT _peel_cols;     // Array of N peeling matrix columns
-    PeelRefs * GF256_RESTRICT _peel_col_refs;   // List of column references
+    uint8_t * GF256_RESTRICT _peel_col_marks;   // Array of N column marks: One of the MarkTypes enumeration
+    IndexT * GF256_RESTRICT _peel_col_next;     // Array of N column list linkages
+    PeelRefs * GF256_RESTRICT _peel_col_refs;   // Column reference chunks: First N are list heads, then overflow
+    IndexT * GF256_RESTRICT _peel_ref_counts;   // Number of rows referencing each column
+    uint32_t _ref_chunk_count;                  // Number of reference chunks in use
+    uint32_t _ref_chunk_capacity;               // Number of reference chunks available
+    uint8_t * GF256_RESTRICT _ref_chunks_grown; // Reference chunks allocated after outgrowing the workspace, or 0
     PeelRow * GF256_RESTRICT _peel_tail_rows;   // Tail of peeling solved rows list
-    uint32_t _workspace_allocated;              // Number of bytes allocated for workspace
-    static const uint16_t LIST_TERM = 0xffff;
-    uint16_t _peel_head_rows;                   // Head of peeling solved rows list
-    uint16_t _defer_head_columns;               // Head of peeling deferred columns list
-    uint16_t _defer_head_rows;                  // Head of peeling deferred rows list
-    uint16_t _defer_count;                      // Count of deferred rows
+    size_t _workspace_allocated;                // Number of bytes allocated for workspace
+    static const IndexT LIST_TERM = (IndexT)~(IndexT)0;
+    IndexT _peel_head_rows;                     // Head of peeling solved rows list
+    IndexT _defer_head_columns;                 // Head of peeling deferred columns list
+    IndexT _defer_head_rows;                    // Head of peeling deferred rows list
+    IndexT _defer_count;                        // Count of deferred rows
 
     // Gaussian elimination state
     uint64_t * GF256_RESTRICT _ge_matrix;       // Gaussian elimination matrix
-    uint32_t _ge_allocated;                     // Number of bytes allocated to GE matrix
+    size_t _ge_allocated;                       // Number of bytes allocated to GE matrix
     uint64_t * GF256_RESTRICT _compress_matrix; // Gaussian elimination compression matrix
     int _ge_pitch;                              // Words per row of GE matrix and compression matrix
-    uint16_t * GF256_RESTRICT _pivots;          // Pivots for each column of the GE matrix
-    uint16_t _pivot_count;                      // Number of pivots in the pivot list
-    uint16_t * GF256_RESTRICT _ge_col_map;      // Map of GE columns to conceptual matrix columns
-    uint16_t * GF256_RESTRICT _ge_row_map;      // Map of GE rows to conceptual matrix rows
-    uint16_t _next_pivot;                       // Pivot to resume Triangle() on after it fails
+    IndexT * GF256_RESTRICT _pivots;            // Pivots for each column of the GE matrix
+    IndexT _pivot_count;                        // Number of pivots in the pivot list
+    IndexT * GF256_RESTRICT _ge_col_map;        // Map of GE columns to conceptual matrix columns
+    IndexT * GF256_RESTRICT _ge_row_map;        // Map of GE rows to conceptual matrix rows
+    IndexT _next_pivot;                         // Pivot to resume Triangle() on after it fails
 
     // Heavy rows
     uint8_t * GF256_RESTRICT _heavy_matrix;     // Heavy rows of GE matrix
     int _heavy_pitch;                           // Bytes per heavy matrix row
     uint16_t _heavy_columns;                    // Number of heavy matrix columns
-    uint16_t _first_heavy_column;               // First heavy column that is non-zero
-    uint16_t _first_heavy_pivot;                // First heavy pivot in the list
+    IndexT _first_heavy_column;                 // First heavy column that is non-zero
+    IndexT _first_heavy_pivot;                  // First heavy pivot in the list
+
+    // Caller-provided memory
+    uint8_t * GF256_RESTRICT _arena;            // Memory to carve all regions from instead of allocating, or 0
+    size_t _arena_bytes;                        // Number of bytes of caller-provided memory
+    size_t _arena_used;                         // Number of bytes carved so far
 
 #if defined(CAT_DUMP_CODEC_DEBUG) || defined(CAT_DUMP_GE_MATRIX)
     void PrintGEMatrix();
@@ -149,16 +227,41 @@ class Codec
 #endif
 
 
+    //// Statistics
+
+    // Clear statistics for a new message
+    void ResetStats();
+
+    // Record the shape of the solved matrix
+    void RecordSolveStats();
+
+    // Start timing a phase, returning 0 if statistics are disabled
+    uint64_t StartPhase();
+
+    // Add the time since the timestamp to a phase and restart the timestamp
+    void EndPhase(StatsPhase phase, uint64_t &timestamp);
+
+    // Add the row operations counted by a phase
+    GF256_FORCE_INLINE void AddRowOps(StatsPhase phase, uint32_t rowops, uint32_t heavyops)
+    {
+        if (_stats_enabled)
+        {
+            _stats.RowOps[phase] += rowops;
+            _stats.HeavyOps[phase] += heavyops;
+        }
+    }
+
+
     //// (1) Peeling
 
     // Avalanche peeling from the newly solved column to others
-    void PeelAvalanche(uint16_t column_i);
+    void PeelAvalanche(IndexT column_i);
 
     // Peel a row using the given column
-    void Peel(uint16_t row_i, PeelRow * GF256_RESTRICT row, uint16_t column_i);
+    void Peel(IndexT row_i, PeelRow * GF256_RESTRICT row, IndexT column_i);
 
-    // If a peel reference list overflows at fail_column_i, this function will unreference the row for previous columns
-    void FixPeelFailure(PeelRow * GF256_RESTRICT row, uint16_t fail_column_i);
+    // Make room for a number of new column reference chunks
+    bool ReserveRefChunks(uint32_t needed);
 
     // Walk forward through rows and solve as many as possible before deferring any
     bool OpportunisticPeeling(uint32_t row_i, uint32_t id);
@@ -224,7 +327,7 @@ class Codec
     //// Main Driver
 
     // Choose matrix to use based on message bytes
-    Result ChooseMatrix(int message_bytes, int block_bytes);
+    Result ChooseMatrix(uint64_t message_bytes, int block_bytes);
 
     // Solve matrix so that recovery blocks can be generated
     Result SolveMatrix();
@@ -240,10 +343,34 @@ class Codec
 
     //// Memory Management
 
+    // Region sizes for the chosen matrix
+    size_t InputBytes();
+    size_t WorkspaceBytes();
+    size_t MatrixBytes(uint32_t defer_count);
+
+    // Take the next region from caller-provided memory, or return 0 if it does not fit
+    uint8_t * CarveArena(size_t bytes);
+
     void SetInput(const void * GF256_RESTRICT message_in);
     bool AllocateInput();
     void FreeInput();
 
+    // Point encoder rows into the segments, gathering those that straddle segments
+    // Returns the number of gathered rows, which are only written if store is true
+    IndexT MapSegments(const Segment * GF256_RESTRICT segments, bool store);
+
+    // Peel the encoder rows and solve for the recovery blocks
+    Result EncodeRows();
+
+    // Store or register a received block as the input for a row
+    void StoreInputRow(IndexT row_i, uint32_t id, const void * GF256_RESTRICT block_in);
+
+    // Input data for a row, wherever it is stored
+    GF256_FORCE_INLINE const uint8_t *InputRow(uint32_t row_i)
+    {
+        return _input_rows ? _input_rows[row_i] : _input_blocks + (size_t)_block_bytes * row_i;
+    }
+
     bool AllocateMatrix();
     void FreeMatrix();
 
@@ -251,8 +378,8 @@ class Codec
     void FreeWorkspace();
 
 public:
-    Codec();
-    ~Codec();
+    CodecT();
+    ~CodecT();
 
 
     //// Accessors
@@ -260,16 +387,61 @@ public:
     GF256_FORCE_INLINE uint32_t PSeed() { return _p_seed; }
     GF256_FORCE_INLINE uint32_t CSeed() { return _d_seed; }
     GF256_FORCE_INLINE uint32_t BlockCount() { return _block_count; }
+    GF256_FORCE_INLINE uint32_t BlockBytes() { return _block_bytes; }
+    GF256_FORCE_INLINE uint32_t DeferCount() { return _defer_count; }
+    GF256_FORCE_INLINE uint32_t DenseCount() { return _dense_count; }
+
+    // Dense row count D that ChooseMatrix() picks for N blocks, or 0 if N is out of range
+    static uint32_t DenseRowCount(uint32_t block_count);
+
+    // Peel seed that ChooseMatrix() picks from the tables for N blocks
+    static uint32_t TablePeelSeed(uint32_t block_count);
+
+
+    //// Seed search
+
+    // Pass to SetSeedOverride() to keep the seed from the tables
+    static const uint32_t SEED_FROM_TABLE = 0xffffffff;
+
+    // Use these seeds instead of the tables in the following Initialize*() calls.
+    // This is for the offline seed search; the encoder and decoder must agree
+    GF256_FORCE_INLINE void SetSeedOverride(uint32_t p_seed, uint32_t d_seed)
+    {
+        _p_seed_override = p_seed;
+        _d_seed_override = d_seed;
+    }
+
+
+    //// Statistics
+
+    // Turn statistics collection on or off, which Initialize*() calls do not change
+    GF256_FORCE_INLINE void EnableStats(bool enabled) { _stats_enabled = enabled; }
+
+    // Statistics since the last Initialize*() call, all zero unless enabled
+    GF256_FORCE_INLINE const CodecStats &Stats() { return _stats; }
+
+
+    //// Caller-Provided Memory
+
+    // Calculate the bytes of memory needed by UseMemory() for a message, or 0 if the parameters are invalid
+    static uint64_t MemorySize(uint64_t message_bytes, int block_bytes, bool decoder, bool zero_copy_input);
+
+    // Carve all regions from the given memory instead of allocating, starting with the next Initialize*() call
+    // Precondition: memory is 64-byte aligned and at least MemorySize() bytes
+    void UseMemory(void * GF256_RESTRICT memory, uint64_t bytes);
 
 
     //// Encoder Mode
 
     // Initialize encoder mode
-    Result InitializeEncoder(int message_bytes, int block_bytes);
+    Result InitializeEncoder(uint64_t message_bytes, int block_bytes);
 
     // Feed encoder a message
     Result EncodeFeed(const void * GF256_RESTRICT message_in);
 
+    // Feed encoder a message split across segments, which must stay valid while encoding
+    Result EncodeFeed(const Segment * GF256_RESTRICT segments, int segment_count);
+
     // Encode a block, returning number of bytes written
     uint32_t Encode(uint32_t id, void * GF256_RESTRICT block_out);
 
@@ -277,25 +449,61 @@ public:
     //// Decoder Mode
 
     // Initialize decoder mode
-    Result InitializeDecoder(int message_bytes, int block_bytes);
+    // With zero_copy_input, DecodeFeed() keeps a pointer to each block instead of copying it,
+    // so the blocks must stay valid and unmodified until ReconstructOutput() completes
+    // With message_out, DecodeFeed() copies original blocks to their final offset in it,
+    // and ReconstructOutput(message_out) only fills in the missing blocks
+    Result InitializeDecoder(uint64_t message_bytes, int block_bytes, bool zero_copy_input, void * GF256_RESTRICT message_out);
 
     // Feed decoder a block
     Result DecodeFeed(uint32_t id, const void * GF256_RESTRICT block_in);
 
+    // DecodeFeed() split in two so that the solver can run on another thread:
+    // DecodePeel() stores and peels each block, returning R_MORE_BLOCKS until N blocks are stored,
+    // or R_WIN if they are all original.  Then DecodeSolve() runs once, followed by DecodeResume()
+    // for each further block while the result is R_MORE_BLOCKS
+    Result DecodePeel(uint32_t id, const void * GF256_RESTRICT block_in);
+    Result DecodeSolve();
+    Result DecodeResume(uint32_t id, const void * GF256_RESTRICT block_in);
+
+    // Returns true once N blocks are stored and DecodeSolve() is needed
+    GF256_FORCE_INLINE bool PeelComplete() { return _row_count >= _block_count; }
+
+    // Returns the number of blocks still needed before DecodeSolve()
+    GF256_FORCE_INLINE uint32_t PeelRowsNeeded() { return PeelComplete() ? 0 : _block_count - _row_count; }
+
+    // Order a batch of up to CAT_PEEL_ORDER_MAX block ids so that rows likely to peel are fed first,
+    // writing the batch positions to order
+    void OrderForPeeling(const uint32_t * GF256_RESTRICT ids, int count, int * GF256_RESTRICT order);
+
     // Use matrix solution to generate recovery blocks
     void GenerateRecoveryBlocks();
 
     // Generate output blocks from the recovery blocks
     Result ReconstructOutput(void * GF256_RESTRICT message_out);
 
+    // Generate output blocks in the input blocks and return a pointer to them
+    // Precondition: Input rows were copied rather than registered by pointer
+    Result ReconstructOutputInPlace(const void ** message_out);
+
     // Reconstruct a single original block from the recovery blocks
-    Result ReconstructBlock(uint16_t id, void * GF256_RESTRICT block_out);
+    Result ReconstructBlock(IndexT id, void * GF256_RESTRICT block_out);
+
+    // Flag each original block that was received, returning N flags valid until the next ReconstructOutput*()
+    // Precondition: DecodeFeed() succeeded with R_WIN
+    const uint8_t *MarkReceivedRows();
 
     // Transition from decoder to encoder mode
     // Precondition: DecodeFeed() succeeded with R_WIN
     Result InitializeEncoderFromDecoder();
 };
 
+// Compact codec for N <= CAT_WIREHAIR_MAX_N
+typedef CodecT<uint16_t> Codec;
+
+// Large codec for N <= CAT_WIREHAIR_MAX_N_32
+typedef CodecT<uint32_t> LargeCodec;
+
 
 } // namespace wirehair
 
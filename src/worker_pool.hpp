@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*WorkerTask)(void* context);
+
+// Threads shared by pipelined decoders and streams to run codec work off the caller thread
+class WorkerPool
+{
+public:
+    WorkerPool()
+    {
+        Stopping = false;
+
+        unsigned thread_count = std::thread::hardware_concurrency();
+        if (thread_count < 1)
+        {
+            thread_count = 1;
+        }
+
+        for (unsigned i = 0; i < thread_count; ++i)
+        {
+            Threads.emplace_back(&WorkerPool::Loop, this);
+        }
+    }
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> locker(Lock);
+            Stopping = true;
+        }
+        Wake.notify_all();
+
+        for (std::thread& thread : Threads)
+        {
+            thread.join();
+        }
+    }
+
+    void Submit(WorkerTask task, void* context)
+    {
+        {
+            std::lock_guard<std::mutex> locker(Lock);
+            Tasks.push_back(Task{ task, context });
+        }
+        Wake.notify_one();
+    }
+
+private:
+    struct Task
+    {
+        WorkerTask Function;
+        void* Context;
+    };
+
+    std::mutex Lock;
+    std::condition_variable Wake;
+    std::deque<Task> Tasks;
+    std::vector<std::thread> Threads;
+    bool Stopping;
+
+    void Loop()
+    {
+        std::unique_lock<std::mutex> locker(Lock);
+
+        // Finish queued tasks before stopping so no decoder is left waiting
+        for (;;)
+        {
+            if (!Tasks.empty())
+            {
+                Task task = Tasks.front();
+                Tasks.pop_front();
+
+                locker.unlock();
+                task.Function(task.Context);
+                locker.lock();
+            }
+            else if (Stopping)
+            {
+                break;
+            }
+            else
+            {
+                Wake.wait(locker);
+            }
+        }
+    }
+};
+
+// Returns the process-wide pool, which is started on first use
+extern WorkerPool& GetWorkerPool();
+
+#endif // WORKER_POOL_HPP
@@ -0,0 +1,336 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_BENCH_TOOLS_HPP
+#define CAT_BENCH_TOOLS_HPP
+
+#include "Clock.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace cat {
+
+
+/*
+    Shared helpers for the benchmark tools under test/.
+
+    Samples collects raw measurements and reports order statistics, and
+    BenchReport collects one row per configuration and writes it out as
+    JSON or CSV so that runs can be compared across library versions.
+*/
+
+
+// Parse a comma-separated list of integers, such as "32,256,1000"
+inline std::vector<int> ParseIntList(const char *text)
+{
+    std::vector<int> list;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            list.push_back(atoi(item.c_str()));
+    }
+    return list;
+}
+
+// Parse a comma-separated list of reals, such as "0,0.05,0.2"
+inline std::vector<double> ParseRealList(const char *text)
+{
+    std::vector<double> list;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            list.push_back(atof(item.c_str()));
+    }
+    return list;
+}
+
+// Parse a comma-separated list of words, such as "wirehair,cm256"
+inline std::vector<std::string> ParseWordList(const char *text)
+{
+    std::vector<std::string> list;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+            list.push_back(item);
+    }
+    return list;
+}
+
+
+//// Samples
+
+class Samples
+{
+    std::vector<double> _values;
+    bool _sorted;
+
+    void Sort()
+    {
+        if (!_sorted)
+        {
+            std::sort(_values.begin(), _values.end());
+            _sorted = true;
+        }
+    }
+
+public:
+    Samples() : _sorted(true) {}
+
+    void Clear() { _values.clear(); _sorted = true; }
+    void Add(double value) { _values.push_back(value); _sorted = false; }
+    void Append(const Samples &other)
+    {
+        _values.insert(_values.end(), other._values.begin(), other._values.end());
+        _sorted = false;
+    }
+
+    int Count() const { return (int)_values.size(); }
+    const std::vector<double> &Values() const { return _values; }
+
+    // Nearest-rank percentile for p in [0, 100], or 0 if there are no samples
+    double Percentile(double p)
+    {
+        if (_values.empty())
+            return 0.;
+        Sort();
+        size_t rank = (size_t)(p / 100. * (double)_values.size() + 0.5);
+        if (rank > 0)
+            --rank;
+        if (rank >= _values.size())
+            rank = _values.size() - 1;
+        return _values[rank];
+    }
+
+    double Median() { return Percentile(50.); }
+
+    double Mean() const
+    {
+        if (_values.empty())
+            return 0.;
+        double sum = 0.;
+        for (size_t ii = 0; ii < _values.size(); ++ii)
+            sum += _values[ii];
+        return sum / (double)_values.size();
+    }
+};
+
+
+//// BenchReport
+
+/*
+    Each row is an ordered list of named columns.  Every row added to a
+    report should have the same columns in the same order, so that the CSV
+    header written from the first row describes all of them.
+
+    Values added with AddNumber() are written bare in JSON, and values added
+    with AddText() are quoted.  A metric with no samples is written as null
+    in JSON and left empty in CSV.
+*/
+class BenchReport
+{
+    struct Column
+    {
+        std::string Name;
+        std::string Value;
+        bool Quoted;
+        bool Empty;
+    };
+
+    typedef std::vector<Column> Row;
+
+    std::vector<std::pair<std::string, std::string> > _meta;
+    std::vector<Row> _rows;
+
+    static std::string FormatNumber(double value)
+    {
+        std::ostringstream ss;
+        ss.precision(10);
+        ss << value;
+        return ss.str();
+    }
+
+    static void WriteJSONString(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for (size_t ii = 0; ii < text.size(); ++ii)
+        {
+            char ch = text[ii];
+            if (ch == '"' || ch == '\\')
+                out << '\\';
+            out << ch;
+        }
+        out << '"';
+    }
+
+public:
+    // Describe the run as a whole, such as the measured cycle rate
+    void AddMeta(const std::string &name, const std::string &value)
+    {
+        _meta.push_back(std::make_pair(name, value));
+    }
+    void AddMeta(const std::string &name, double value)
+    {
+        AddMeta(name, FormatNumber(value));
+    }
+
+    void BeginRow() { _rows.push_back(Row()); }
+
+    void AddText(const std::string &name, const std::string &value)
+    {
+        Column column = { name, value, true, false };
+        _rows.back().push_back(column);
+    }
+    void AddNumber(const std::string &name, double value)
+    {
+        Column column = { name, FormatNumber(value), false, false };
+        _rows.back().push_back(column);
+    }
+    // Adds a column with no value, such as a counter that is not available
+    void AddEmpty(const std::string &name)
+    {
+        Column column = { name, std::string(), false, true };
+        _rows.back().push_back(column);
+    }
+
+    // Adds name_median, name_p99 and name_mean columns for the samples
+    void AddSamples(const std::string &name, Samples &samples)
+    {
+        const bool empty = samples.Count() <= 0;
+        Column median = { name + "_median", FormatNumber(samples.Median()), false, empty };
+        Column p99 = { name + "_p99", FormatNumber(samples.Percentile(99.)), false, empty };
+        Column mean = { name + "_mean", FormatNumber(samples.Mean()), false, empty };
+        _rows.back().push_back(median);
+        _rows.back().push_back(p99);
+        _rows.back().push_back(mean);
+    }
+
+    int RowCount() const { return (int)_rows.size(); }
+
+    bool WriteJSON(const char *path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+
+        out << "{" << std::endl;
+        for (size_t ii = 0; ii < _meta.size(); ++ii)
+        {
+            out << "  ";
+            WriteJSONString(out, _meta[ii].first);
+            out << ": ";
+            WriteJSONString(out, _meta[ii].second);
+            out << "," << std::endl;
+        }
+        out << "  \"results\": [";
+        for (size_t ii = 0; ii < _rows.size(); ++ii)
+        {
+            const Row &row = _rows[ii];
+            out << (ii > 0 ? "," : "") << std::endl << "    {";
+            for (size_t jj = 0; jj < row.size(); ++jj)
+            {
+                if (jj > 0)
+                    out << ", ";
+                WriteJSONString(out, row[jj].Name);
+                out << ": ";
+                if (row[jj].Empty)
+                    out << "null";
+                else if (row[jj].Quoted)
+                    WriteJSONString(out, row[jj].Value);
+                else
+                    out << row[jj].Value;
+            }
+            out << "}";
+        }
+        out << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+        return !out.fail();
+    }
+
+    bool WriteCSV(const char *path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+
+        if (!_rows.empty())
+        {
+            const Row &header = _rows[0];
+            for (size_t jj = 0; jj < header.size(); ++jj)
+                out << (jj > 0 ? "," : "") << header[jj].Name;
+            out << std::endl;
+        }
+
+        for (size_t ii = 0; ii < _rows.size(); ++ii)
+        {
+            const Row &row = _rows[ii];
+            for (size_t jj = 0; jj < row.size(); ++jj)
+            {
+                if (jj > 0)
+                    out << ",";
+                if (!row[jj].Empty)
+                    out << row[jj].Value;
+            }
+            out << std::endl;
+        }
+
+        return !out.fail();
+    }
+};
+
+
+// Estimate the rate of Clock::cycles() in cycles per microsecond
+inline double MeasureCyclesPerUsec(Clock &clock)
+{
+    double t0 = clock.usec();
+    u32 c0 = Clock::cycles();
+    Clock::sleep(100);
+    u32 c1 = Clock::cycles();
+    double t1 = clock.usec();
+
+    if (t1 <= t0)
+        return 0.;
+    return (double)(u32)(c1 - c0) / (t1 - t0);
+}
+
+
+} // namespace cat
+
+#endif // CAT_BENCH_TOOLS_HPP
@@ -0,0 +1,292 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_CHANNEL_MODEL_HPP
+#define CAT_CHANNEL_MODEL_HPP
+
+#include "AbyssinianPRNG.hpp"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace cat {
+
+
+/*
+    Simulated lossy channel for the test tools
+
+    Blocks are passed in with Send() in the order they are transmitted, and
+    come out in the order they are received.  Each channel has its own
+    generator, so a channel given the same seed and parameters always drops
+    and reorders the same blocks.
+
+    Loss models:
+
+        iid     : Each block is lost independently with probability Loss
+        gilbert : Gilbert-Elliott model with a good and a bad state, which
+                  lose blocks with probability GoodLoss and BadLoss.  The
+                  bad state lasts Burst blocks on average, and the chain is
+                  set up so that the long-run loss rate is Loss.  With the
+                  default GoodLoss = 0 and BadLoss = 1 this is the simple
+                  Gilbert model where every block in a burst is lost.
+        outage  : Periodic outages where the last OutageLength blocks of
+                  every OutagePeriod are lost, starting at a random phase
+
+    Reordering is applied after loss: each block that gets through is held
+    back with probability Reorder, and delivered after up to ReorderDepth
+    later blocks have been sent.
+*/
+
+enum ChannelModelType
+{
+    CHANNEL_IID,
+    CHANNEL_GILBERT,
+    CHANNEL_OUTAGE
+};
+
+inline const char *ChannelModelName(ChannelModelType model)
+{
+    switch (model)
+    {
+    case CHANNEL_GILBERT: return "gilbert";
+    case CHANNEL_OUTAGE: return "outage";
+    default: return "iid";
+    }
+}
+
+// Returns false if the name is not a known model
+inline bool ParseChannelModel(const std::string &name, ChannelModelType &model)
+{
+    if (name == "iid")
+        model = CHANNEL_IID;
+    else if (name == "gilbert")
+        model = CHANNEL_GILBERT;
+    else if (name == "outage")
+        model = CHANNEL_OUTAGE;
+    else
+        return false;
+    return true;
+}
+
+struct ChannelParams
+{
+    ChannelModelType Model;
+    double Loss;        // Long-run loss rate for iid and gilbert
+    double Burst;       // Mean length of the gilbert bad state in blocks
+    double GoodLoss;    // Loss rate in the gilbert good state
+    double BadLoss;     // Loss rate in the gilbert bad state
+    int OutagePeriod;   // Blocks from the start of one outage to the next
+    int OutageLength;   // Blocks lost in each outage
+    double Reorder;     // Fraction of delivered blocks that are delayed
+    int ReorderDepth;   // Most later blocks a delayed block can fall behind
+
+    ChannelParams()
+    {
+        Model = CHANNEL_IID;
+        Loss = 0.;
+        Burst = 4.;
+        GoodLoss = 0.;
+        BadLoss = 1.;
+        OutagePeriod = 100;
+        OutageLength = 10;
+        Reorder = 0.;
+        ReorderDepth = 8;
+    }
+};
+
+class ChannelSimulator
+{
+    Abyssinian _prng;
+    ChannelParams _params;
+
+    uint32_t _loss;         // iid loss threshold
+    uint32_t _enter_bad;    // Good to bad transition threshold
+    uint32_t _leave_bad;    // Bad to good transition threshold
+    uint32_t _good_loss;    // Loss threshold in the good state
+    uint32_t _bad_loss;     // Loss threshold in the bad state
+    uint32_t _bad_share;    // Long-run fraction of time in the bad state
+    uint32_t _reorder;      // Reordering threshold
+    bool _bad;
+
+    uint64_t _sent;         // Blocks sent, used as the outage and reorder clock
+    int _phase;             // Outage phase
+
+    struct HeldBlock
+    {
+        uint64_t Release;   // Delivered once this many blocks have been sent
+        uint32_t Id;
+    };
+    std::vector<HeldBlock> _held;
+
+    static uint32_t Threshold(double p)
+    {
+        if (p <= 0.)
+            return 0;
+        if (p >= 1.)
+            return 0xffffffff;
+        return (uint32_t)(p * 4294967296.);
+    }
+
+    // Draw against a threshold, without using the generator when the outcome is certain
+    bool Chance(uint32_t threshold)
+    {
+        if (threshold == 0)
+            return false;
+        if (threshold == 0xffffffff)
+            return true;
+        return _prng.Next() < threshold;
+    }
+
+public:
+    void Initialize(uint32_t seed, const ChannelParams &params)
+    {
+        _prng.Initialize(seed);
+        _params = params;
+        _loss = Threshold(params.Loss);
+        _good_loss = Threshold(params.GoodLoss);
+        _bad_loss = Threshold(params.BadLoss);
+        _reorder = Threshold(params.Reorder);
+
+        // The bad state is occupied a fraction s = (Loss - GoodLoss) / (BadLoss - GoodLoss)
+        // of the time.  With mean burst length B the chain leaves the bad
+        // state with probability 1/B and enters it with s / (B * (1 - s))
+        double share = 0.;
+        if (params.BadLoss > params.GoodLoss)
+            share = (params.Loss - params.GoodLoss) / (params.BadLoss - params.GoodLoss);
+        if (share < 0.)
+            share = 0.;
+        if (share > 1.)
+            share = 1.;
+
+        double burst = params.Burst;
+        if (burst < 1.)
+            burst = 1.;
+        _bad_share = Threshold(share);
+        _leave_bad = Threshold(1. / burst);
+        _enter_bad = share < 1. ? Threshold(share / (burst * (1. - share))) : 0xffffffff;
+
+        _bad = false;
+        _phase = 0;
+        _sent = 0;
+        _held.clear();
+    }
+
+    // Start a new transfer, with the channel state drawn from its long-run mix
+    void Reset()
+    {
+        _bad = false;
+        if (_params.Model == CHANNEL_GILBERT)
+            _bad = _prng.Next() < _bad_share;
+
+        _phase = 0;
+        if (_params.Model == CHANNEL_OUTAGE && _params.OutagePeriod > 0)
+            _phase = (int)(_prng.Next() % (uint32_t)_params.OutagePeriod);
+
+        _sent = 0;
+        _held.clear();
+    }
+
+    // Runs the loss process for the next block.  Returns true if it is lost
+    bool Drop()
+    {
+        const uint64_t position = _sent++;
+
+        switch (_params.Model)
+        {
+        case CHANNEL_GILBERT:
+            if (_bad)
+            {
+                if (_prng.Next() < _leave_bad)
+                    _bad = false;
+            }
+            else if (_prng.Next() < _enter_bad)
+                _bad = true;
+            return Chance(_bad ? _bad_loss : _good_loss);
+
+        case CHANNEL_OUTAGE:
+            if (_params.OutagePeriod <= 0)
+                return false;
+            return (int)((position + _phase) % (uint64_t)_params.OutagePeriod) >= _params.OutagePeriod - _params.OutageLength;
+
+        default:
+            return _prng.Next() < _loss;
+        }
+    }
+
+    /*
+        Send the next block through the channel.  Appends the blocks that
+        arrive as a result to delivered, which may be none if the block was
+        lost or held back, or several if earlier blocks are released.
+    */
+    void Send(uint32_t id, std::vector<uint32_t> &delivered)
+    {
+        const bool lost = Drop();
+
+        if (!lost)
+        {
+            if (_params.ReorderDepth > 0 && Chance(_reorder))
+            {
+                HeldBlock held;
+                held.Release = _sent + 1 + _prng.Next() % (uint32_t)_params.ReorderDepth;
+                held.Id = id;
+                _held.push_back(held);
+            }
+            else
+                delivered.push_back(id);
+        }
+
+        // Release held blocks that have fallen far enough behind
+        for (size_t ii = 0; ii < _held.size();)
+        {
+            if (_held[ii].Release <= _sent)
+            {
+                delivered.push_back(_held[ii].Id);
+                _held[ii] = _held.back();
+                _held.pop_back();
+            }
+            else
+                ++ii;
+        }
+    }
+
+    // Deliver any blocks still held back, as at the end of a transfer
+    void Flush(std::vector<uint32_t> &delivered)
+    {
+        for (size_t ii = 0; ii < _held.size(); ++ii)
+            delivered.push_back(_held[ii].Id);
+        _held.clear();
+    }
+
+    Abyssinian &PRNG() { return _prng; }
+};
+
+
+} // namespace cat
+
+#endif // CAT_CHANNEL_MODEL_HPP
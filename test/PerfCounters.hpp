@@ -0,0 +1,266 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_PERF_COUNTERS_HPP
+#define CAT_PERF_COUNTERS_HPP
+
+#include "BenchTools.hpp"
+
+#include <string>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cat {
+
+
+/*
+    Hardware performance counters for the benchmark tools
+
+    Counts cycles, instructions, L1 data cache read misses, last-level cache
+    misses and branch misses for the calling thread, using perf_event_open()
+    on Linux.  The counters are opened as one group so they are read in a
+    single system call and always cover the same instructions.
+
+    Counters are often unavailable: in containers without CAP_PERFMON, under
+    virtual machines without a virtual PMU, with kernel.perf_event_paranoid
+    set to 3, and on every platform other than Linux.  Open() then returns
+    false and the tools leave the counter columns out.  A counter the CPU
+    does not support is left out of the group and reads as zero, and its
+    columns are written as empty.
+
+    When the kernel multiplexes more events than the PMU has registers, the
+    counts are scaled up by the fraction of time the group was scheduled.
+*/
+
+enum PerfCounterType
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+
+    PERF_COUNTER_COUNT
+};
+
+static const char *PERF_COUNTER_NAMES[PERF_COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "branch_misses"
+};
+
+// Counter values at one point in time, or the difference between two
+struct PerfSample
+{
+    uint64_t Values[PERF_COUNTER_COUNT];
+
+    PerfSample() { memset(Values, 0, sizeof(Values)); }
+
+    void Accumulate(const PerfSample &begin, const PerfSample &end)
+    {
+        for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+            Values[ii] += end.Values[ii] - begin.Values[ii];
+    }
+
+    void Add(const PerfSample &other)
+    {
+        for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+            Values[ii] += other.Values[ii];
+    }
+};
+
+class PerfCounters
+{
+    int _fds[PERF_COUNTER_COUNT];   // -1 if the counter could not be opened
+    int _slots[PERF_COUNTER_COUNT]; // Position of each counter in a group read
+    int _open_count;
+
+public:
+    PerfCounters() : _open_count(0)
+    {
+        for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+            _fds[ii] = _slots[ii] = -1;
+    }
+    ~PerfCounters() { Close(); }
+
+    // Open the counters for the calling thread.  Returns false if none are available
+    bool Open()
+    {
+        Close();
+
+#if defined(__linux__)
+        static const uint32_t types[PERF_COUNTER_COUNT] = {
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE
+        };
+        static const uint64_t configs[PERF_COUNTER_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        // The cycle counter leads the group, so without it nothing is counted
+        for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+        {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[ii];
+            attr.config = configs[ii];
+            attr.disabled = ii == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            const int group_fd = ii == 0 ? -1 : _fds[PERF_CYCLES];
+            const int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+            if (fd < 0)
+            {
+                if (ii == 0)
+                    return false;
+                continue;
+            }
+
+            _fds[ii] = fd;
+            _slots[ii] = _open_count++;
+        }
+
+        ioctl(_fds[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(_fds[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Close()
+    {
+#if defined(__linux__)
+        for (int ii = PERF_COUNTER_COUNT - 1; ii >= 0; --ii)
+        {
+            if (_fds[ii] >= 0)
+                close(_fds[ii]);
+        }
+#endif
+        for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+            _fds[ii] = _slots[ii] = -1;
+        _open_count = 0;
+    }
+
+    bool IsOpen() const { return _open_count > 0; }
+
+    // Returns true if the given counter is being counted
+    bool Has(int counter) const { return _slots[counter] >= 0; }
+
+    // Read the current counts.  Returns false if the counters are not open
+    bool Read(PerfSample &sample) const
+    {
+        if (_open_count <= 0)
+            return false;
+
+#if defined(__linux__)
+        uint64_t data[3 + PERF_COUNTER_COUNT];
+        const ssize_t expected = (ssize_t)((3 + _open_count) * sizeof(uint64_t));
+        if (read(_fds[PERF_CYCLES], data, sizeof(data)) != expected)
+            return false;
+
+        // data = { count, time_enabled, time_running, values... }
+        const uint64_t enabled = data[1], running = data[2];
+        for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+        {
+            uint64_t value = 0;
+            if (_slots[ii] >= 0)
+            {
+                value = data[3 + _slots[ii]];
+                if (running > 0 && running < enabled)
+                    value = (uint64_t)((double)value * (double)enabled / (double)running);
+            }
+            sample.Values[ii] = value;
+        }
+        return true;
+#else
+        (void)sample;
+        return false;
+#endif
+    }
+};
+
+
+/*
+    Adds the counter columns for a measured region to a report row:
+    each counter in total, then ipc, and the bytes processed per L1 and LLC
+    miss.  Counters that could not be opened are written as empty.
+*/
+inline void AddPerfColumns(BenchReport &report, const std::string &prefix, const PerfCounters &counters,
+    const PerfSample &total, double bytes)
+{
+    for (int ii = 0; ii < PERF_COUNTER_COUNT; ++ii)
+    {
+        if (counters.Has(ii))
+            report.AddNumber(prefix + PERF_COUNTER_NAMES[ii], (double)total.Values[ii]);
+        else
+            report.AddEmpty(prefix + PERF_COUNTER_NAMES[ii]);
+    }
+
+    const uint64_t cycles = total.Values[PERF_CYCLES];
+    if (counters.Has(PERF_INSTRUCTIONS) && cycles > 0)
+        report.AddNumber(prefix + "ipc", (double)total.Values[PERF_INSTRUCTIONS] / cycles);
+    else
+        report.AddEmpty(prefix + "ipc");
+
+    const uint64_t l1d = total.Values[PERF_L1D_MISSES];
+    if (counters.Has(PERF_L1D_MISSES) && l1d > 0)
+        report.AddNumber(prefix + "bytes_per_l1d_miss", bytes / l1d);
+    else
+        report.AddEmpty(prefix + "bytes_per_l1d_miss");
+
+    const uint64_t llc = total.Values[PERF_LLC_MISSES];
+    if (counters.Has(PERF_LLC_MISSES) && llc > 0)
+        report.AddNumber(prefix + "bytes_per_llc_miss", bytes / llc);
+    else
+        report.AddEmpty(prefix + "bytes_per_llc_miss");
+}
+
+
+} // namespace cat
+
+#endif // CAT_PERF_COUNTERS_HPP
@@ -0,0 +1,445 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../src/gf256.h"
+
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+#include "BenchTools.hpp"
+#include "PerfCounters.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+using namespace std;
+using namespace cat;
+
+static Clock m_clock;
+
+
+/*
+    gf256_bench: GF(256) bulk kernel microbenchmark
+
+    Times each of the bulk memory kernels in gf256.h by itself, for buffer
+    sizes from 16 bytes to 16 MB in steps of 4x:
+
+        add      : gf256_add_mem       x[] += y[]
+        add2     : gf256_add2_mem      z[] += x[] + y[]
+        addset   : gf256_addset_mem    z[] = x[] + y[]
+        muladd   : gf256_muladd_mem    z[] += x[] * y
+        mul      : gf256_mul_mem       z[] = x[] * y
+        memswap  : gf256_memswap       x[] <-> y[]
+
+    Every size is run with the buffers 64-byte aligned, and again with each
+    buffer at a different odd offset.  "hot" runs reuse the same buffers so
+    that they stay in cache, while "cold" runs step through an arena larger
+    than the last-level cache so that each call starts on memory that was
+    evicted since it was last touched.
+
+    gf256.cpp has a single SSSE3 code path with no runtime dispatch, so the
+    library kernels are reported as the "ssse3" back end.  The "scalar" back
+    end is a byte-at-a-time version of each kernel using the GF256Ctx tables,
+    as a baseline for the vector code.
+
+    Throughput is reported in GB/s and cycles per byte of buffer length,
+    using the median over repeated batches of calls.
+
+    With --perf 1 the hardware performance counters (see PerfCounters.hpp)
+    are read around each timed batch, and each row gets hw_ columns with
+    the counts summed over the batches, the IPC, and the buffer bytes
+    processed per L1 and LLC miss.  This shows whether a kernel is limited
+    by memory or by the shuffle units.  If the counters cannot be opened,
+    a note is printed and the columns are left out.
+
+    Usage:
+
+        gf256_bench [--kernel add,muladd,...] [--backend ssse3,scalar]
+                    [--min-bytes 16] [--max-bytes 16777216] [--arena-mb 64]
+                    [--perf 0] [--json out.json] [--csv out.csv]
+*/
+
+
+//// Kernels
+
+enum Kernel
+{
+    KERNEL_ADD,
+    KERNEL_ADD2,
+    KERNEL_ADDSET,
+    KERNEL_MULADD,
+    KERNEL_MUL,
+    KERNEL_MEMSWAP,
+
+    KERNEL_COUNT
+};
+
+static const char *KERNEL_NAMES[KERNEL_COUNT] = {
+    "add",
+    "add2",
+    "addset",
+    "muladd",
+    "mul",
+    "memswap"
+};
+
+// Constant used for the multiplication kernels, chosen to avoid the y <= 1 shortcuts
+static const uint8_t KERNEL_Y = 0x5b;
+
+static void RunKernel(Kernel kernel, uint8_t *z, uint8_t *x, uint8_t *y, int bytes)
+{
+    switch (kernel)
+    {
+    case KERNEL_ADD: gf256_add_mem(z, x, bytes); break;
+    case KERNEL_ADD2: gf256_add2_mem(z, x, y, bytes); break;
+    case KERNEL_ADDSET: gf256_addset_mem(z, x, y, bytes); break;
+    case KERNEL_MULADD: gf256_muladd_mem(z, KERNEL_Y, x, bytes); break;
+    case KERNEL_MUL: gf256_mul_mem(z, x, KERNEL_Y, bytes); break;
+    case KERNEL_MEMSWAP: gf256_memswap(z, x, bytes); break;
+    default: break;
+    }
+}
+
+static void RunScalarKernel(Kernel kernel, uint8_t *z, uint8_t *x, uint8_t *y, int bytes)
+{
+    switch (kernel)
+    {
+    case KERNEL_ADD:
+        for (int ii = 0; ii < bytes; ++ii)
+            z[ii] ^= x[ii];
+        break;
+    case KERNEL_ADD2:
+        for (int ii = 0; ii < bytes; ++ii)
+            z[ii] ^= x[ii] ^ y[ii];
+        break;
+    case KERNEL_ADDSET:
+        for (int ii = 0; ii < bytes; ++ii)
+            z[ii] = x[ii] ^ y[ii];
+        break;
+    case KERNEL_MULADD:
+        for (int ii = 0; ii < bytes; ++ii)
+            z[ii] ^= gf256_mul(x[ii], KERNEL_Y);
+        break;
+    case KERNEL_MUL:
+        for (int ii = 0; ii < bytes; ++ii)
+            z[ii] = gf256_mul(x[ii], KERNEL_Y);
+        break;
+    case KERNEL_MEMSWAP:
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            uint8_t t = z[ii];
+            z[ii] = x[ii];
+            x[ii] = t;
+        }
+        break;
+    default: break;
+    }
+}
+
+
+//// Measurement
+
+// Number of timed batches per configuration
+static const int SAMPLE_COUNT = 31;
+
+// Minimum bytes processed per timed batch, so that small sizes are not
+// dominated by the cost of reading the timestamp counter
+static const int BATCH_BYTES = 256 * 1024;
+
+struct KernelConfig
+{
+    Kernel Kern;
+    bool Scalar;
+    int Bytes;
+    bool Aligned;
+    bool Cold;
+};
+
+class KernelBench
+{
+    vector<uint8_t> _arena;
+    uint8_t *_base;
+    size_t _arena_bytes;
+    PerfCounters _counters;
+
+public:
+    // Returns false if the counters are not available
+    bool EnablePerf() { return _counters.Open(); }
+    const PerfCounters &Counters() const { return _counters; }
+
+    bool Initialize(size_t arena_bytes, int max_bytes)
+    {
+        // Room for three buffers of the largest size plus alignment slack
+        _arena_bytes = arena_bytes;
+        const size_t minimum = 3 * ((size_t)max_bytes + 128);
+        if (_arena_bytes < minimum)
+            _arena_bytes = minimum;
+
+        _arena.resize(_arena_bytes + 64);
+        _base = &_arena[0] + ((64 - ((uintptr_t)&_arena[0] & 63)) & 63);
+
+        Abyssinian prng;
+        prng.Initialize(1);
+        for (size_t ii = 0; ii < _arena_bytes; ++ii)
+            _base[ii] = (uint8_t)prng.Next();
+
+        return true;
+    }
+
+    // Number of calls in each timed batch
+    static int BatchCalls(int bytes)
+    {
+        const int calls = BATCH_BYTES / bytes;
+        return calls < 1 ? 1 : calls;
+    }
+
+    // Adds the counts for the recorded batches to perf if counting is enabled
+    void Measure(const KernelConfig &config, Samples &cycles_per_byte, PerfSample &perf)
+    {
+        const int bytes = config.Bytes;
+
+        // Each call uses three buffers laid out back to back
+        const size_t stride = 3 * (((size_t)bytes + 127) & ~(size_t)63);
+        const size_t slots = _arena_bytes / stride;
+
+        const int calls = BatchCalls(bytes);
+
+        // Unaligned buffers are each shifted by a different odd amount
+        const int z_offset = config.Aligned ? 0 : 1;
+        const int x_offset = config.Aligned ? 0 : 3;
+        const int y_offset = config.Aligned ? 0 : 7;
+        const size_t buffer_stride = stride / 3;
+
+        size_t slot = 0;
+
+        for (int sample = -1; sample < SAMPLE_COUNT; ++sample)
+        {
+            PerfSample perf_begin, perf_end;
+            _counters.Read(perf_begin);
+
+            u32 c0 = Clock::cycles();
+
+            for (int call = 0; call < calls; ++call)
+            {
+                uint8_t *z = _base + slot * stride;
+                uint8_t *x = z + buffer_stride;
+                uint8_t *y = x + buffer_stride;
+
+                if (config.Scalar)
+                    RunScalarKernel(config.Kern, z + z_offset, x + x_offset, y + y_offset, bytes);
+                else
+                    RunKernel(config.Kern, z + z_offset, x + x_offset, y + y_offset, bytes);
+
+                if (config.Cold && ++slot >= slots)
+                    slot = 0;
+            }
+
+            u32 c1 = Clock::cycles();
+
+            _counters.Read(perf_end);
+
+            // The first batch warms up the buffers and is not recorded
+            if (sample >= 0)
+            {
+                cycles_per_byte.Add((u32)(c1 - c0) / ((double)calls * bytes));
+                perf.Accumulate(perf_begin, perf_end);
+            }
+        }
+    }
+};
+
+
+//// Entrypoint
+
+static void PrintUsage()
+{
+    cout << "Usage: gf256_bench [--kernel list] [--backend list] [--min-bytes bytes]" << endl;
+    cout << "                   [--max-bytes bytes] [--arena-mb megabytes]" << endl;
+    cout << "                   [--perf 0|1] [--json path] [--csv path]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    m_clock.OnInitialize();
+
+    vector<string> kernel_list = ParseWordList("add,add2,addset,muladd,mul,memswap");
+    vector<string> backend_list = ParseWordList("ssse3,scalar");
+    int min_bytes = 16, max_bytes = 16 * 1024 * 1024, arena_mb = 64;
+    bool perf = false;
+    const char *json_path = 0, *csv_path = 0;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char *arg = argv[ii];
+        const char *value = ii + 1 < argc ? argv[ii + 1] : 0;
+
+        if (!value)
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++ii;
+
+        if (!strcmp(arg, "--kernel"))
+            kernel_list = ParseWordList(value);
+        else if (!strcmp(arg, "--backend"))
+            backend_list = ParseWordList(value);
+        else if (!strcmp(arg, "--min-bytes"))
+            min_bytes = atoi(value);
+        else if (!strcmp(arg, "--max-bytes"))
+            max_bytes = atoi(value);
+        else if (!strcmp(arg, "--arena-mb"))
+            arena_mb = atoi(value);
+        else if (!strcmp(arg, "--perf"))
+            perf = atoi(value) != 0;
+        else if (!strcmp(arg, "--json"))
+            json_path = value;
+        else if (!strcmp(arg, "--csv"))
+            csv_path = value;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (min_bytes < 1 || max_bytes < min_bytes || arena_mb < 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (gf256_init())
+    {
+        cout << "GF256 initialization failed" << endl;
+        return 1;
+    }
+
+    const double cycles_per_usec = MeasureCyclesPerUsec(m_clock);
+
+    KernelBench bench;
+    bench.Initialize((size_t)arena_mb * 1024 * 1024, max_bytes);
+
+    BenchReport report;
+    report.AddMeta("tool", "gf256_bench");
+    report.AddMeta("gf256_version", GF256_VERSION);
+    report.AddMeta("cycles_per_usec", cycles_per_usec);
+
+    if (perf && !bench.EnablePerf())
+    {
+        cout << "Hardware performance counters are not available, so they will not be reported" << endl;
+        perf = false;
+    }
+
+    cout << "Clock::cycles() runs at about " << setprecision(5) << cycles_per_usec << " cycles/usec" << endl;
+    cout << " kernel backend     bytes  align cache  cycles/byte     GB/s" << endl;
+
+    for (size_t ki = 0; ki < kernel_list.size(); ++ki)
+    {
+        int kernel = 0;
+        while (kernel < KERNEL_COUNT && kernel_list[ki] != KERNEL_NAMES[kernel])
+            ++kernel;
+        if (kernel >= KERNEL_COUNT)
+        {
+            cout << "Unknown kernel: " << kernel_list[ki] << endl;
+            return 1;
+        }
+
+        for (size_t bi = 0; bi < backend_list.size(); ++bi)
+        {
+            const bool scalar = backend_list[bi] == "scalar";
+            if (!scalar && backend_list[bi] != "ssse3")
+            {
+                cout << "Unknown back end: " << backend_list[bi] << endl;
+                return 1;
+            }
+
+            for (int bytes = min_bytes; bytes <= max_bytes; bytes *= 4)
+            {
+                for (int aligned = 1; aligned >= 0; --aligned)
+                {
+                    for (int cold = 0; cold <= 1; ++cold)
+                    {
+                        KernelConfig config;
+                        config.Kern = (Kernel)kernel;
+                        config.Scalar = scalar;
+                        config.Bytes = bytes;
+                        config.Aligned = aligned != 0;
+                        config.Cold = cold != 0;
+
+                        Samples cycles_per_byte;
+                        PerfSample counts;
+                        bench.Measure(config, cycles_per_byte, counts);
+
+                        const double median = cycles_per_byte.Median();
+                        const double gbps = median > 0. ? cycles_per_usec / median / 1000. : 0.;
+
+                        report.BeginRow();
+                        report.AddText("kernel", KERNEL_NAMES[kernel]);
+                        report.AddText("backend", backend_list[bi]);
+                        report.AddNumber("bytes", bytes);
+                        report.AddText("alignment", aligned ? "aligned" : "unaligned");
+                        report.AddText("cache", cold ? "cold" : "hot");
+                        report.AddSamples("cycles_per_byte", cycles_per_byte);
+                        report.AddNumber("GBps_median", gbps);
+                        if (perf)
+                        {
+                            const double total_bytes = (double)cycles_per_byte.Count() * bench.BatchCalls(bytes) * bytes;
+                            AddPerfColumns(report, "hw_", bench.Counters(), counts, total_bytes);
+                        }
+
+                        cout << setw(7) << KERNEL_NAMES[kernel] << setw(8) << backend_list[bi]
+                            << setw(10) << bytes << setw(7) << (aligned ? "yes" : "no")
+                            << setw(6) << (cold ? "cold" : "hot")
+                            << setw(13) << setprecision(4) << median
+                            << setw(9) << setprecision(4) << gbps << endl;
+                    }
+                }
+
+                // Avoid overflow when stepping past the largest size
+                if (bytes > max_bytes / 4)
+                    break;
+            }
+        }
+    }
+
+    if (json_path && !report.WriteJSON(json_path))
+    {
+        cout << "Failed to write " << json_path << endl;
+        return 1;
+    }
+    if (csv_path && !report.WriteCSV(csv_path))
+    {
+        cout << "Failed to write " << csv_path << endl;
+        return 1;
+    }
+
+    return 0;
+}
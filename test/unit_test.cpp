@@ -1,8 +1,14 @@
 #include "../src/wh256.h"
+#include "../src/cm256.h"
+#include "../src/wh256_stream.h"
+#include "../src/wh256_window.h"
+#include "../src/wh256_trace.h"
+#include "../src/wirehair_codec_8.hpp"
 
 #include "Clock.hpp"
 #include "AbyssinianPRNG.hpp"
 
+#include <atomic>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -21,6 +27,7 @@ const uint32_t SEED = 1;
 const int TRIALS = 1000;
 
 #include <vector>
+#include <thread>
 std::vector<int> ExceptionList;
 
 void GenTable()
@@ -157,6 +164,1929 @@ static void TestBlockSizes()
     cout << "Verified that different block sizes all work" << endl;
 }
 
+static void TestLargeN()
+{
+    const int block_bytes = 4;
+    uint8_t block[block_bytes];
+
+    wh256_state encoder = 0, decoder = 0;
+    Abyssinian prng;
+
+    // Values of N that require 32-bit indices in the Wirehair codec
+    static const int NValues[] = {
+        64001, 65536, 100000, 250000
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        double t0 = m_clock.usec();
+
+        // Initialize encoder
+        encoder = wh256_encoder_init(encoder, message_in, bytes, block_bytes);
+        if (!encoder)
+        {
+            cout << "*** Large N test failed during encoder init for N=" << N << endl;
+            assert(false);
+            continue;
+        }
+
+        double t1 = m_clock.usec();
+
+        assert(N == wh256_count(encoder));
+
+        // Initialize decoder
+        decoder = wh256_decoder_init(decoder, bytes, block_bytes);
+        assert(decoder);
+
+        assert(N == wh256_count(decoder));
+
+        // Simulate transmission
+        int blocks_needed = 0;
+        for (uint32_t id = 0;; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            ++blocks_needed;
+
+            // Write a block
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                // If message is decoded:
+                if (0 == wh256_decoder_reconstruct(decoder, message_out))
+                {
+                    if (memcmp(message_in, message_out, bytes))
+                    {
+                        cout << "*** Decode failure for large N=" << N << endl;
+                        assert(false);
+                    }
+
+                    // Done with transmission simulation
+                    break;
+                }
+            }
+        }
+
+        double t2 = m_clock.usec();
+
+        cout << "Verified large N=" << N << " with overhead " << blocks_needed - N << " blocks, encode " << (t1 - t0) << " usec, transfer " << (t2 - t1) << " usec" << endl;
+
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    wh256_free(encoder);
+    wh256_free(decoder);
+
+    cout << "Verified that large N values all work" << endl;
+}
+
+
+static void TestArena()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        // Over-allocate so that the arenas can be aligned to 64 bytes
+        const uint64_t encoder_size = wh256_workspace_size(N, block_bytes, WH256_MODE_ENCODER);
+        const uint64_t decoder_size = wh256_workspace_size(N, block_bytes, WH256_MODE_DECODER);
+        assert(encoder_size > 0 && decoder_size > 0);
+        uint8_t *encoder_memory = new uint8_t[(size_t)encoder_size + 63];
+        uint8_t *decoder_memory = new uint8_t[(size_t)decoder_size + 63];
+        void *encoder_arena = (void*)(((uintptr_t)encoder_memory + 63) & ~(uintptr_t)63);
+        void *decoder_arena = (void*)(((uintptr_t)decoder_memory + 63) & ~(uintptr_t)63);
+
+        wh256_state encoder = wh256_encoder_init_arena(encoder_arena, encoder_size, message_in, bytes, block_bytes);
+        assert(encoder == encoder_arena);
+
+        wh256_state decoder = wh256_decoder_init_arena(decoder_arena, decoder_size, bytes, block_bytes, WH256_MODE_DECODER);
+        assert(decoder == decoder_arena);
+
+        // Simulate transmission
+        for (uint32_t id = 0;; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+                assert(0 == reconstructResult);
+
+                if (memcmp(message_in, message_out, bytes))
+                {
+                    cout << "*** Arena decode failure for N=" << N << endl;
+                    assert(false);
+                }
+
+                break;
+            }
+        }
+
+        cout << "Verified arena N=" << N << " with encoder " << encoder_size << " bytes and decoder " << decoder_size << " bytes" << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]encoder_memory;
+        delete[]decoder_memory;
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    cout << "Verified that caller-provided arenas work" << endl;
+}
+
+static void TestArenaSweep()
+{
+    const int block_bytes = 8;
+    const int N_max = 12000;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+    prng.Initialize(SEED);
+
+    uint8_t *message_in = new uint8_t[N_max * block_bytes];
+    uint8_t *message_out = new uint8_t[N_max * block_bytes];
+
+    // Fill input message with random data
+    for (int ii = 0; ii < N_max * block_bytes; ++ii)
+    {
+        message_in[ii] = (uint8_t)prng.Next();
+    }
+
+    // Every N, since running out of reference chunks depends on the exact rows
+    for (int N = 28; N <= N_max; ++N)
+    {
+        const int bytes = block_bytes * N;
+
+        const uint64_t encoder_size = wh256_workspace_size(N, block_bytes, WH256_MODE_ENCODER);
+        const uint64_t decoder_size = wh256_workspace_size(N, block_bytes, WH256_MODE_DECODER);
+        uint8_t *encoder_memory = new uint8_t[(size_t)encoder_size + 63];
+        uint8_t *decoder_memory = new uint8_t[(size_t)decoder_size + 63];
+        void *encoder_arena = (void*)(((uintptr_t)encoder_memory + 63) & ~(uintptr_t)63);
+        void *decoder_arena = (void*)(((uintptr_t)decoder_memory + 63) & ~(uintptr_t)63);
+
+        wh256_state encoder = wh256_encoder_init_arena(encoder_arena, encoder_size, message_in, bytes, block_bytes);
+        if (!encoder)
+        {
+            cout << "*** Arena encoder init failure for N=" << N << endl;
+            assert(false);
+        }
+
+        // Arena and heap decoders must need the same blocks, so no row is dropped for lack of memory
+        wh256_state decoder = wh256_decoder_init_arena(decoder_arena, decoder_size, bytes, block_bytes, WH256_MODE_DECODER);
+        wh256_state heap_decoder = wh256_decoder_init(0, bytes, block_bytes);
+        assert(decoder == decoder_arena && heap_decoder);
+
+        bool decoded = false, heap_decoded = false;
+
+        // Simulate transmission
+        for (uint32_t id = 0; !decoded || !heap_decoded; ++id)
+        {
+            // 30% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 30)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            const bool read = (0 == wh256_decoder_read(decoder, id, block));
+            const bool heap_read = (0 == wh256_decoder_read(heap_decoder, id, block));
+            if (read != heap_read || decoded != heap_decoded)
+            {
+                cout << "*** Arena decoder overhead differs for N=" << N << endl;
+                assert(false);
+            }
+            decoded = decoded || read;
+            heap_decoded = heap_decoded || heap_read;
+        }
+
+        int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+        assert(0 == reconstructResult);
+
+        if (memcmp(message_in, message_out, bytes))
+        {
+            cout << "*** Arena decode failure for N=" << N << endl;
+            assert(false);
+        }
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+        wh256_free(heap_decoder);
+
+        delete[]encoder_memory;
+        delete[]decoder_memory;
+    }
+
+    delete[]message_in;
+    delete[]message_out;
+
+    cout << "Verified that arenas sized by wh256_workspace_size() work for every N up to " << N_max << endl;
+}
+
+static void TestZeroCopyDecoder()
+{
+    const int block_bytes = 100;
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        // Every received block keeps its own slot since the decoder only holds pointers
+        const int max_blocks = N * 3 + 100;
+        uint8_t *received = new uint8_t[(size_t)max_blocks * block_bytes];
+        int received_count = 0;
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state decoder = wh256_decoder_init_zero_copy(0, bytes, block_bytes);
+        assert(decoder);
+
+        // Simulate transmission
+        for (uint32_t id = 0; received_count < max_blocks; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            uint8_t *block = received + (size_t)block_bytes * received_count++;
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+                assert(0 == reconstructResult);
+
+                if (memcmp(message_in, message_out, bytes))
+                {
+                    cout << "*** Zero-copy decode failure for N=" << N << endl;
+                    assert(false);
+                }
+
+                break;
+            }
+        }
+
+        cout << "Verified zero-copy decoder N=" << N << " after " << received_count << " blocks" << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]received;
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    cout << "Verified that zero-copy decoder input works" << endl;
+}
+
+static void TestInPlaceDecode()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+        assert(decoder);
+
+        // Simulate transmission
+        for (uint32_t id = 0;; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                const void *message_out = wh256_decoder_reconstruct_inplace(decoder);
+                assert(message_out);
+
+                if (memcmp(message_in, message_out, bytes))
+                {
+                    cout << "*** In-place decode failure for N=" << N << endl;
+                    assert(false);
+                }
+
+                break;
+            }
+        }
+
+        cout << "Verified in-place decode N=" << N << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]message_in;
+    }
+
+    cout << "Verified that in-place decoding works" << endl;
+}
+
+static void TestDecodeIntoOutput()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state decoder = wh256_decoder_init_output(0, message_out, bytes, block_bytes);
+        assert(decoder);
+
+        // Simulate transmission
+        for (uint32_t id = 0;; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                // Fills in only the lost blocks
+                int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+                assert(0 == reconstructResult);
+
+                if (memcmp(message_in, message_out, bytes))
+                {
+                    cout << "*** Output buffer decode failure for N=" << N << endl;
+                    assert(false);
+                }
+
+                break;
+            }
+        }
+
+        cout << "Verified decoding into output N=" << N << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    cout << "Verified that decoding into the output buffer works" << endl;
+}
+
+static void TestSegmentedEncoder()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+    uint8_t block_v[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        // Split the message into segments that do not line up with blocks
+        wh256_segment segments[16];
+        int segment_count = 0;
+        for (int offset = 0; offset < bytes; ++segment_count)
+        {
+            int segment_bytes = (segment_count < 15) ? 1 + (int)(prng.Next() % (bytes / 8 + 1)) : bytes;
+            if (segment_bytes > bytes - offset)
+            {
+                segment_bytes = bytes - offset;
+            }
+
+            segments[segment_count].data = message_in + offset;
+            segments[segment_count].bytes = segment_bytes;
+            offset += segment_bytes;
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state encoder_v = wh256_encoder_initv(0, segments, segment_count, block_bytes);
+        assert(encoder_v);
+
+        // Both encoders must produce the same blocks
+        for (uint32_t id = 0; id < (uint32_t)N + 100; ++id)
+        {
+            int bytes_written, bytes_written_v;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+            writeResult = wh256_encoder_write(encoder_v, id, block_v, &bytes_written_v);
+            assert(0 == writeResult);
+
+            if (bytes_written != bytes_written_v || memcmp(block, block_v, bytes_written))
+            {
+                cout << "*** Segmented encoder mismatch for N=" << N << " id=" << id << endl;
+                assert(false);
+            }
+        }
+
+        cout << "Verified segmented encoder N=" << N << " with " << segment_count << " segments" << endl;
+
+        wh256_free(encoder);
+        wh256_free(encoder_v);
+
+        delete[]message_in;
+    }
+
+    cout << "Verified that segmented encoder input works" << endl;
+}
+
+struct ProgressiveOutput
+{
+    uint8_t *message;
+    int block_bytes;
+    int delivered;
+};
+
+static void OnDecodedBlock(void* context, unsigned int id, const void* block, int bytes)
+{
+    ProgressiveOutput *output = reinterpret_cast<ProgressiveOutput *>(context);
+
+    memcpy(output->message + (size_t)output->block_bytes * id, block, bytes);
+    ++output->delivered;
+}
+
+static void TestProgressiveDecode()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+        assert(decoder);
+
+        ProgressiveOutput output;
+        output.message = message_out;
+        output.block_bytes = block_bytes;
+        output.delivered = 0;
+
+        int callbackResult = wh256_decoder_set_callback(decoder, OnDecodedBlock, &output);
+        assert(0 == callbackResult);
+
+        // Simulate transmission
+        for (uint32_t id = 0;; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                // Every block was handed back without calling wh256_decoder_reconstruct()
+                if (output.delivered != N || memcmp(message_in, message_out, bytes))
+                {
+                    cout << "*** Progressive decode failure for N=" << N << endl;
+                    assert(false);
+                }
+
+                break;
+            }
+        }
+
+        cout << "Verified progressive decoding N=" << N << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    cout << "Verified that progressive decoding works" << endl;
+}
+
+static void OnDecodeComplete(void* context, wh256_state E, int result)
+{
+    int *complete_result = reinterpret_cast<int *>(context);
+
+    *complete_result = result;
+}
+
+static void TestPipelinedDecode()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        2, 27, 28, 1000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+        assert(decoder);
+
+        int complete_result = -1;
+        int pipelineResult = wh256_decoder_pipeline(decoder, OnDecodeComplete, &complete_result);
+        assert(0 == pipelineResult);
+
+        // Simulate transmission while the solver runs on a worker
+        for (uint32_t id = 0; id < (uint32_t)N * 2 + 100; ++id)
+        {
+            // 50% packetloss to randomize received message IDs
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                break;
+            }
+        }
+
+        int waitResult = wh256_decoder_wait(decoder);
+        assert(0 == waitResult);
+        assert(0 == complete_result);
+
+        int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+        assert(0 == reconstructResult);
+
+        if (memcmp(message_in, message_out, bytes))
+        {
+            cout << "*** Pipelined decode failure for N=" << N << endl;
+            assert(false);
+        }
+
+        cout << "Verified pipelined decoding N=" << N << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    cout << "Verified that pipelined decoding works" << endl;
+}
+
+struct PipelinedOutput
+{
+    uint8_t *message;
+    int block_bytes;
+    std::vector<int> counts;    // Deliveries of each block id
+    std::atomic<int> active;    // Callbacks running right now
+    bool overlapped;            // Two callbacks ran at the same time
+};
+
+static void OnPipelinedBlock(void* context, unsigned int id, const void* block, int bytes)
+{
+    PipelinedOutput *output = reinterpret_cast<PipelinedOutput *>(context);
+
+    if (output->active.fetch_add(1) != 0)
+    {
+        output->overlapped = true;
+    }
+
+    memcpy(output->message + (size_t)output->block_bytes * id, block, bytes);
+    ++output->counts[id];
+
+    output->active.fetch_sub(1);
+}
+
+static void TestPipelinedProgressiveDecode()
+{
+    const int block_bytes = 100;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+
+    // Values of N covering CM256, Wirehair and large Wirehair
+    static const int NValues[] = {
+        27, 1000, 64000, 64001
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+
+        const int bytes = block_bytes * N - 1;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        // Send originals and recovery blocks shuffled together, so that
+        // original blocks keep arriving while the solver runs
+        std::vector<uint32_t> ids(N * 2);
+        for (int ii = 0; ii < N * 2; ++ii)
+        {
+            ids[ii] = ii;
+        }
+        for (int ii = N * 2 - 1; ii > 0; --ii)
+        {
+            std::swap(ids[ii], ids[prng.Next() % (ii + 1)]);
+        }
+
+        wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+        assert(decoder);
+
+        PipelinedOutput output;
+        output.message = message_out;
+        output.block_bytes = block_bytes;
+        output.counts.assign(N, 0);
+        output.active = 0;
+        output.overlapped = false;
+
+        int callbackResult = wh256_decoder_set_callback(decoder, OnPipelinedBlock, &output);
+        assert(0 == callbackResult);
+
+        int complete_result = -1;
+        int pipelineResult = wh256_decoder_pipeline(decoder, OnDecodeComplete, &complete_result);
+        assert(0 == pipelineResult);
+
+        // Keep reading while the solver runs on a worker
+        for (int ii = 0; ii < N * 2; ++ii)
+        {
+            // 25% packetloss
+            if (prng.Next() % 100 < 25)
+            {
+                continue;
+            }
+
+            const uint32_t id = ids[ii];
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+            assert(0 == writeResult);
+
+            // If decoder is ready:
+            if (0 == wh256_decoder_read(decoder, id, block))
+            {
+                break;
+            }
+        }
+
+        int waitResult = wh256_decoder_wait(decoder);
+        assert(0 == waitResult);
+        assert(0 == complete_result);
+
+        // Every block was handed back exactly once, one call at a time
+        bool once = true;
+        for (int ii = 0; ii < N; ++ii)
+        {
+            if (output.counts[ii] != 1)
+            {
+                once = false;
+            }
+        }
+
+        if (!once || output.overlapped || memcmp(message_in, message_out, bytes))
+        {
+            cout << "*** Pipelined progressive decode failure for N=" << N << endl;
+            assert(false);
+        }
+
+        cout << "Verified pipelined progressive decoding N=" << N << endl;
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    cout << "Verified that pipelined progressive decoding works" << endl;
+}
+
+static void TestDecodeSpeed()
+{
+    // Small blocks so that timing is dominated by the matrix solver
+    const int block_bytes = 4;
+
+    wh256_state encoder = 0, decoder = 0;
+    Abyssinian prng;
+
+    static const int NValues[] = {
+        1000, 10000, 64000
+    };
+    static const int Trials[] = {
+        200, 20, 5
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+        const int trials = Trials[Nindex];
+
+        const int bytes = block_bytes * N;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        encoder = wh256_encoder_init(encoder, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        // Pre-generate blocks with 50% packetloss so that only decoding is timed
+        const int max_blocks = N * 2;
+        uint32_t *ids = new uint32_t[max_blocks];
+        uint8_t *blocks = new uint8_t[max_blocks * block_bytes];
+        int block_count = 0;
+        for (uint32_t id = 0; block_count < max_blocks; ++id)
+        {
+            if (prng.Next() % 100 < 50)
+            {
+                continue;
+            }
+
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, blocks + block_count * block_bytes, &bytes_written);
+            assert(0 == writeResult);
+            ids[block_count++] = id;
+        }
+
+        double sum = 0, best = 0;
+        for (int trial = 0; trial < trials; ++trial)
+        {
+            double t0 = m_clock.usec();
+
+            decoder = wh256_decoder_init(decoder, bytes, block_bytes);
+            assert(decoder);
+
+            int ii;
+            for (ii = 0; ii < block_count; ++ii)
+            {
+                if (0 == wh256_decoder_read(decoder, ids[ii], blocks + ii * block_bytes))
+                {
+                    break;
+                }
+            }
+            assert(ii < block_count);
+
+            int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+            assert(0 == reconstructResult);
+
+            double t1 = m_clock.usec();
+
+            if (memcmp(message_in, message_out, bytes))
+            {
+                cout << "*** Decode failure for N=" << N << endl;
+                assert(false);
+            }
+
+            sum += t1 - t0;
+            if (trial == 0 || t1 - t0 < best)
+            {
+                best = t1 - t0;
+            }
+        }
+
+        cout << "Decode N=" << N << " : average " << sum / trials << " usec, best " << best << " usec over " << trials << " trials" << endl;
+
+        delete[]ids;
+        delete[]blocks;
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    wh256_free(encoder);
+    wh256_free(decoder);
+}
+
+static void TestBatchDecodeSpeed()
+{
+    // Small blocks so that timing is dominated by the matrix solver
+    const int block_bytes = 4;
+
+    // Blocks per batch, like one receive call for a burst of packets
+    const int batch_size = 64;
+
+    wh256_state encoder = 0, decoder = 0;
+    Abyssinian prng;
+
+    static const int NValues[] = {
+        1000, 10000, 64000
+    };
+    static const int Trials[] = {
+        200, 20, 5
+    };
+    static const int LossRates[] = {
+        10, 20, 30
+    };
+
+    for (int Nindex = 0; Nindex < (int)(sizeof(NValues) / sizeof(*NValues)); ++Nindex)
+    {
+        const int N = NValues[Nindex];
+        const int trials = Trials[Nindex];
+
+        const int bytes = block_bytes * N;
+        uint8_t *message_in = new uint8_t[bytes];
+        uint8_t *message_out = new uint8_t[bytes];
+
+        prng.Initialize(SEED);
+
+        // Fill input message with random data
+        for (int ii = 0; ii < bytes; ++ii)
+        {
+            message_in[ii] = (uint8_t)prng.Next();
+        }
+
+        encoder = wh256_encoder_init(encoder, message_in, bytes, block_bytes);
+        assert(encoder);
+
+        for (int Lindex = 0; Lindex < (int)(sizeof(LossRates) / sizeof(*LossRates)); ++Lindex)
+        {
+            const int loss = LossRates[Lindex];
+
+            // Pre-generate blocks so that only decoding is timed
+            const int max_blocks = N * 2;
+            unsigned int *ids = new unsigned int[max_blocks];
+            uint8_t *blocks = new uint8_t[max_blocks * block_bytes];
+            const void **block_ptrs = new const void*[max_blocks];
+            int block_count = 0;
+            for (uint32_t id = 0; block_count < max_blocks; ++id)
+            {
+                if (prng.Next() % 100 < (uint32_t)loss)
+                {
+                    continue;
+                }
+
+                int bytes_written;
+                int writeResult = wh256_encoder_write(encoder, id, blocks + block_count * block_bytes, &bytes_written);
+                assert(0 == writeResult);
+                block_ptrs[block_count] = blocks + block_count * block_bytes;
+                ids[block_count++] = id;
+            }
+
+            // Deferred columns left for Gaussian elimination in arrival order and in peeling order
+            uint32_t defer_counts[2];
+            for (int ordered = 0; ordered < 2; ++ordered)
+            {
+                wirehair::Codec codec;
+                wirehair::Result r = codec.InitializeDecoder(bytes, block_bytes, false, 0);
+                assert(r == wirehair::R_WIN);
+
+                r = wirehair::R_MORE_BLOCKS;
+                for (int offset = 0; offset < block_count && r == wirehair::R_MORE_BLOCKS; offset += batch_size)
+                {
+                    int order[batch_size];
+                    for (int ii = 0; ii < batch_size; ++ii)
+                    {
+                        order[ii] = ii;
+                    }
+
+                    // Same as wh256_decoder_read_batch(): only the batch that completes peeling is reordered
+                    const uint32_t needed = codec.PeelRowsNeeded();
+                    if (ordered && needed > 0 && needed < (uint32_t)batch_size)
+                    {
+                        codec.OrderForPeeling(ids + offset, batch_size, order);
+                    }
+
+                    for (int ii = 0; ii < batch_size && r == wirehair::R_MORE_BLOCKS; ++ii)
+                    {
+                        r = codec.DecodeFeed(ids[offset + order[ii]], block_ptrs[offset + order[ii]]);
+                    }
+                }
+                assert(r == wirehair::R_WIN);
+
+                defer_counts[ordered] = codec.DeferCount();
+            }
+
+            double sums[2] = { 0, 0 };
+            for (int trial = 0; trial < trials; ++trial)
+            {
+                for (int batched = 0; batched < 2; ++batched)
+                {
+                    double t0 = m_clock.usec();
+
+                    decoder = wh256_decoder_init(decoder, bytes, block_bytes);
+                    assert(decoder);
+
+                    int ii;
+                    for (ii = 0; ii < block_count; ii += batch_size)
+                    {
+                        if (batched)
+                        {
+                            if (0 == wh256_decoder_read_batch(decoder, ids + ii, block_ptrs + ii, batch_size))
+                            {
+                                break;
+                            }
+                        }
+                        else
+                        {
+                            int jj;
+                            for (jj = 0; jj < batch_size; ++jj)
+                            {
+                                if (0 == wh256_decoder_read(decoder, ids[ii + jj], block_ptrs[ii + jj]))
+                                {
+                                    break;
+                                }
+                            }
+                            if (jj < batch_size)
+                            {
+                                break;
+                            }
+                        }
+                    }
+                    assert(ii < block_count);
+
+                    int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+                    assert(0 == reconstructResult);
+
+                    double t1 = m_clock.usec();
+
+                    if (memcmp(message_in, message_out, bytes))
+                    {
+                        cout << "*** Batch decode failure for N=" << N << endl;
+                        assert(false);
+                    }
+
+                    sums[batched] += t1 - t0;
+                }
+            }
+
+            cout << "Decode N=" << N << " loss=" << loss << "% : deferred " << defer_counts[0] << " -> " << defer_counts[1]
+                << " columns, average " << sums[0] / trials << " -> " << sums[1] / trials << " usec batched" << endl;
+
+            delete[]ids;
+            delete[]blocks;
+            delete[]block_ptrs;
+        }
+
+        delete[]message_in;
+        delete[]message_out;
+    }
+
+    wh256_free(encoder);
+    wh256_free(decoder);
+}
+
+struct StreamOutput
+{
+    uint8_t *message;
+    uint64_t offset;
+    unsigned int next_generation;
+    std::atomic<unsigned int> delivered;
+};
+
+static void OnStreamGeneration(void* context, unsigned int generation, const void* data, uint64_t bytes)
+{
+    StreamOutput *output = reinterpret_cast<StreamOutput *>(context);
+
+    // Generations must arrive in order
+    assert(generation == output->next_generation);
+
+    memcpy(output->message + output->offset, data, (size_t)bytes);
+    output->offset += bytes;
+    output->next_generation = generation + 1;
+    output->delivered = output->next_generation;
+}
+
+static void TestStream()
+{
+    const int block_bytes = 1000;
+    const int generation_blocks = 2000;
+    const int window = 8;
+    const uint64_t bytes = 32000000 - 1;
+    uint8_t block[block_bytes];
+
+    Abyssinian prng;
+    prng.Initialize(SEED);
+
+    uint8_t *message_in = new uint8_t[bytes];
+    uint8_t *message_out = new uint8_t[bytes];
+
+    // Fill input message with random data
+    for (uint64_t ii = 0; ii < bytes; ++ii)
+    {
+        message_in[ii] = (uint8_t)prng.Next();
+    }
+
+    double t0 = m_clock.usec();
+
+    wh256_stream encoder = wh256_stream_encoder_create(bytes, block_bytes, generation_blocks, window);
+    assert(encoder);
+
+    StreamOutput output;
+    output.message = message_out;
+    output.offset = 0;
+    output.next_generation = 0;
+    output.delivered = 0;
+
+    wh256_stream decoder = wh256_stream_decoder_create(bytes, block_bytes, generation_blocks, window, OnStreamGeneration, &output);
+    assert(decoder);
+
+    const unsigned int generation_count = (unsigned int)wh256_stream_count(encoder);
+
+    // Simulate transmission with the receiver reporting decoded generations back to the sender
+    uint64_t pushed = 0;
+    unsigned int retired = 0;
+    while (output.delivered < generation_count)
+    {
+        if (pushed < bytes)
+        {
+            pushed += wh256_stream_encoder_push(encoder, message_in + pushed, bytes - pushed);
+        }
+
+        while (retired < output.delivered)
+        {
+            int retireResult = wh256_stream_encoder_retire(encoder, retired++);
+            assert(0 == retireResult);
+        }
+
+        unsigned int generation, id;
+        int bytes_written;
+        if (0 != wh256_stream_encoder_write(encoder, &generation, &id, block, &bytes_written))
+        {
+            continue;
+        }
+
+        // 10% packetloss
+        if (prng.Next() % 100 < 10)
+        {
+            continue;
+        }
+
+        int readResult = wh256_stream_decoder_read(decoder, generation, id, block);
+        assert(0 == readResult);
+    }
+
+    int waitResult = wh256_stream_decoder_wait(decoder);
+    assert(0 == waitResult);
+
+    double t1 = m_clock.usec();
+
+    if (output.offset != bytes || memcmp(message_in, message_out, (size_t)bytes))
+    {
+        cout << "*** Stream decode failure" << endl;
+        assert(false);
+    }
+
+    cout << "Streamed " << generation_count << " generations of " << generation_blocks << " blocks in " << (t1 - t0) / 1000 << " msec : "
+        << bytes / (t1 - t0) << " MB/s" << endl;
+
+    wh256_stream_free(encoder);
+    wh256_stream_free(decoder);
+
+    delete[]message_in;
+    delete[]message_out;
+
+    cout << "Verified that streaming works" << endl;
+}
+
+struct WindowOutput
+{
+    uint8_t *packets;
+    int packet_bytes;
+    uint32_t next_seq;
+    int recovered;
+};
+
+static void OnWindowPacket(void* context, uint32_t seq, const void* data, int bytes)
+{
+    WindowOutput *output = reinterpret_cast<WindowOutput *>(context);
+
+    // Packets must arrive in order
+    assert(seq == output->next_seq);
+    output->next_seq = seq + 1;
+
+    if (data)
+    {
+        assert(bytes == output->packet_bytes);
+        assert(!memcmp(output->packets + (size_t)seq * output->packet_bytes, data, bytes));
+        ++output->recovered;
+    }
+}
+
+static void OnWindowCount(void* context, uint32_t seq, const void* data, int bytes)
+{
+    int *count = reinterpret_cast<int *>(context);
+
+    ++*count;
+}
+
+static void TestSlidingWindow()
+{
+    const int packet_bytes = 1200;
+    const int packet_count = 100000;
+    const int repair_interval = 4;
+    uint8_t symbol[packet_bytes + 2];
+
+    Abyssinian prng;
+    prng.Initialize(SEED);
+
+    uint8_t *packets = new uint8_t[(size_t)packet_count * packet_bytes];
+
+    // Fill input packets with random data
+    for (size_t ii = 0; ii < (size_t)packet_count * packet_bytes; ++ii)
+    {
+        packets[ii] = (uint8_t)prng.Next();
+    }
+
+    for (int window = 8; window <= 128; window *= 4)
+    {
+        wh256_window encoder = wh256_window_encoder_create(window, packet_bytes);
+        assert(encoder);
+
+        WindowOutput output;
+        output.packets = packets;
+        output.packet_bytes = packet_bytes;
+        output.next_seq = 0;
+        output.recovered = 0;
+
+        wh256_window decoder = wh256_window_decoder_create(window, packet_bytes, OnWindowPacket, &output);
+        assert(decoder);
+        assert(wh256_window_symbol_bytes(encoder) == sizeof(symbol));
+
+        int lost = 0;
+
+        double t0 = m_clock.usec();
+
+        for (int ii = 0; ii < packet_count; ++ii)
+        {
+            uint32_t seq;
+            int addResult = wh256_window_encoder_add(encoder, packets + (size_t)ii * packet_bytes, packet_bytes, &seq);
+            assert(0 == addResult);
+
+            // 5% packetloss
+            if (prng.Next() % 100 >= 5)
+            {
+                int sourceResult = wh256_window_decoder_source(decoder, seq, packets + (size_t)ii * packet_bytes, packet_bytes);
+                assert(0 == sourceResult);
+            }
+            else
+            {
+                ++lost;
+            }
+
+            if (ii % repair_interval == repair_interval - 1)
+            {
+                uint32_t first, seed;
+                int count;
+                int repairResult = wh256_window_encoder_repair(encoder, symbol, &first, &count, &seed);
+                assert(0 == repairResult);
+
+                if (prng.Next() % 100 >= 5)
+                {
+                    repairResult = wh256_window_decoder_repair(decoder, first, count, seed, symbol);
+                    assert(0 == repairResult);
+                }
+            }
+        }
+
+        wh256_window_decoder_flush(decoder);
+
+        double t1 = m_clock.usec();
+
+        assert(output.next_seq == packet_count);
+
+        cout << "Window " << window << " : Lost " << lost << " packets, " << packet_count - output.recovered << " unrecovered : "
+            << (t1 - t0) / packet_count << " usec/packet" << endl;
+
+        wh256_window_free(encoder);
+        wh256_window_free(decoder);
+    }
+
+    // Join mid-stream and then jump far ahead, which must not report the gaps
+    {
+        const int window = 32;
+        int count = 0;
+
+        wh256_window decoder = wh256_window_decoder_create(window, packet_bytes, OnWindowCount, &count);
+        assert(decoder);
+
+        const uint32_t join_seq = 0xF0000000;
+        int sourceResult = wh256_window_decoder_source(decoder, join_seq, packets, packet_bytes);
+        assert(0 == sourceResult);
+        assert(count == 0);
+
+        sourceResult = wh256_window_decoder_source(decoder, join_seq + 0x08000000, packets, packet_bytes);
+        assert(0 == sourceResult);
+        assert(count <= window);
+
+        wh256_window_decoder_flush(decoder);
+        assert(count <= 2 * window);
+
+        wh256_window_free(decoder);
+    }
+
+    delete[]packets;
+
+    cout << "Verified that sliding window FEC works" << endl;
+}
+
+static void TestBatchCM256()
+{
+    const int message_count = 4096;
+    const int original_count = 8;
+    const int recovery_count = 4;
+    const int block_bytes = 200;
+    const int row_bytes = message_count * block_bytes;
+
+    cm256_encoder_params params;
+    params.OriginalCount = original_count;
+    params.RecoveryCount = recovery_count;
+    params.BlockBytes = block_bytes;
+
+    Abyssinian prng;
+    prng.Initialize(SEED);
+
+    // Interleaved original blocks, followed by interleaved recovery blocks
+    uint8_t *originals = new uint8_t[(original_count + recovery_count) * row_bytes];
+    uint8_t *recovery = originals + original_count * row_bytes;
+    uint8_t *expected = new uint8_t[message_count * recovery_count * block_bytes];
+    uint8_t *received = new uint8_t[original_count * row_bytes];
+
+    // Fill input messages with random data
+    for (int ii = 0; ii < original_count * row_bytes; ++ii)
+    {
+        originals[ii] = (uint8_t)prng.Next();
+    }
+
+    // Touch the output buffers so page faults are not timed
+    memset(recovery, 0, recovery_count * row_bytes);
+    memset(expected, 0, message_count * recovery_count * block_bytes);
+
+    // Encode each message separately for comparison
+    double t0 = m_clock.usec();
+
+    for (int m = 0; m < message_count; ++m)
+    {
+        cm256_block message_blocks[256];
+        for (int ii = 0; ii < original_count; ++ii)
+        {
+            message_blocks[ii].Data = originals + ii * row_bytes + m * block_bytes;
+        }
+
+        int encodeResult = cm256_encode(params, message_blocks, expected + m * recovery_count * block_bytes);
+        assert(0 == encodeResult);
+    }
+
+    double t1 = m_clock.usec();
+
+    cm256_block blocks[256];
+    for (int ii = 0; ii < original_count; ++ii)
+    {
+        blocks[ii].Data = originals + ii * row_bytes;
+    }
+
+    double t2 = m_clock.usec();
+
+    int encodeResult = cm256_encode_batch(params, blocks, message_count, recovery);
+    assert(0 == encodeResult);
+
+    double t3 = m_clock.usec();
+
+    for (int m = 0; m < message_count; ++m)
+    {
+        for (int ii = 0; ii < recovery_count; ++ii)
+        {
+            if (memcmp(expected + (m * recovery_count + ii) * block_bytes, recovery + ii * row_bytes + m * block_bytes, block_bytes))
+            {
+                cout << "*** Batch encode mismatch for message " << m << endl;
+                assert(false);
+            }
+        }
+    }
+
+    // Lose the first recovery_count original blocks of every message
+    for (int ii = 0; ii < original_count; ++ii)
+    {
+        const bool lost = ii < recovery_count;
+        const uint8_t *src = lost ? recovery + ii * row_bytes : originals + ii * row_bytes;
+
+        memcpy(received + ii * row_bytes, src, row_bytes);
+        blocks[ii].Data = received + ii * row_bytes;
+        blocks[ii].Index = lost ? cm256_get_recovery_block_index(params, ii) : cm256_get_original_block_index(params, ii);
+    }
+
+    double t4 = m_clock.usec();
+
+    int decodeResult = cm256_decode_batch(params, blocks, message_count);
+    assert(0 == decodeResult);
+
+    double t5 = m_clock.usec();
+
+    for (int ii = 0; ii < original_count; ++ii)
+    {
+        if (blocks[ii].Index != ii || memcmp(blocks[ii].Data, originals + ii * row_bytes, row_bytes))
+        {
+            cout << "*** Batch decode failure for block " << ii << endl;
+            assert(false);
+        }
+    }
+
+    cout << "Batch of " << message_count << " messages : Encoded in " << (t3 - t2) << " usec (vs " << (t1 - t0)
+        << " usec one at a time), decoded in " << (t5 - t4) << " usec" << endl;
+
+    delete[]originals;
+    delete[]expected;
+    delete[]received;
+
+    cout << "Verified that batched CM256 works" << endl;
+}
+
+static void TestStats()
+{
+    const int block_bytes = 1000;
+    const int N = 10000;
+    const int bytes = block_bytes * N;
+    uint8_t block[block_bytes];
+
+    static const char *PhaseNames[WH256_PHASE_COUNT] = {
+        "Peel", "Compress", "Triangle", "ColumnValues", "DenseValues", "Subdiagonal", "BackSubstitute", "Substitute"
+    };
+
+    Abyssinian prng;
+    prng.Initialize(SEED);
+
+    uint8_t *message_in = new uint8_t[bytes];
+    uint8_t *message_out = new uint8_t[bytes];
+
+    // Fill input message with random data
+    for (int ii = 0; ii < bytes; ++ii)
+    {
+        message_in[ii] = (uint8_t)prng.Next();
+    }
+
+    wh256_enable_stats(1);
+
+    wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+    assert(encoder);
+
+    wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+    assert(decoder);
+
+    wh256_enable_stats(0);
+
+    // Simulate transmission
+    for (uint32_t id = 0;; ++id)
+    {
+        // 10% packetloss
+        if (prng.Next() % 100 < 10)
+        {
+            continue;
+        }
+
+        int bytes_written;
+        int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+        assert(0 == writeResult);
+
+        // If decoder is ready:
+        if (0 == wh256_decoder_read(decoder, id, block))
+        {
+            break;
+        }
+    }
+
+    int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+    assert(0 == reconstructResult && !memcmp(message_in, message_out, bytes));
+
+    wh256_stats stats;
+    int statsResult = wh256_get_stats(decoder, &stats);
+    assert(0 == statsResult);
+    assert(stats.block_count == N && stats.peeled_columns + stats.deferred_columns == N);
+
+    cout << "Decoder stats for N=" << N << " : Peeled " << stats.peeled_columns << ", deferred " << stats.deferred_columns
+        << ", GE " << stats.ge_rows << "x" << stats.ge_columns << ", heavy pivots " << stats.heavy_pivots
+        << ", extra rows " << stats.extra_rows << endl;
+
+    for (int ii = 0; ii < WH256_PHASE_COUNT; ++ii)
+    {
+        cout << "  " << setw(16) << PhaseNames[ii] << " : " << setw(8) << stats.row_ops[ii] << " row ops, "
+            << setw(6) << stats.heavy_ops[ii] << " heavy ops, " << setw(10) << stats.cycles[ii] << " cycles" << endl;
+    }
+
+    // Collection was off when this state was initialized
+    wh256_state quiet = wh256_decoder_init(0, bytes, block_bytes);
+    statsResult = wh256_get_stats(quiet, &stats);
+    assert(0 == statsResult && stats.peeled_columns == 0);
+
+    wh256_free(encoder);
+    wh256_free(decoder);
+    wh256_free(quiet);
+
+    delete[]message_in;
+    delete[]message_out;
+
+    cout << "Verified that statistics work" << endl;
+}
+
+struct TraceCounts
+{
+    int begins;
+    int ends;
+    int solves;
+};
+
+static void OnTraceEvent(void* context, const char* name, int begin)
+{
+    TraceCounts *counts = reinterpret_cast<TraceCounts *>(context);
+
+    if (begin)
+    {
+        ++counts->begins;
+        if (!strcmp(name, "SolveMatrix"))
+        {
+            ++counts->solves;
+        }
+    }
+    else
+    {
+        ++counts->ends;
+    }
+}
+
+// Encode and decode a message with 10% loss
+static void TraceRoundTrip(int N, int block_bytes)
+{
+    const int bytes = block_bytes * N;
+    uint8_t *block = new uint8_t[block_bytes];
+    uint8_t *message_in = new uint8_t[bytes];
+    uint8_t *message_out = new uint8_t[bytes];
+
+    Abyssinian prng;
+    prng.Initialize(SEED);
+
+    // Fill input message with random data
+    for (int ii = 0; ii < bytes; ++ii)
+    {
+        message_in[ii] = (uint8_t)prng.Next();
+    }
+
+    wh256_state encoder = wh256_encoder_init(0, message_in, bytes, block_bytes);
+    assert(encoder);
+
+    wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+    assert(decoder);
+
+    for (uint32_t id = 0;; ++id)
+    {
+        // 10% packetloss
+        if (prng.Next() % 100 < 10)
+        {
+            continue;
+        }
+
+        int bytes_written;
+        int writeResult = wh256_encoder_write(encoder, id, block, &bytes_written);
+        assert(0 == writeResult);
+
+        // If decoder is ready:
+        if (0 == wh256_decoder_read(decoder, id, block))
+        {
+            break;
+        }
+    }
+
+    int reconstructResult = wh256_decoder_reconstruct(decoder, message_out);
+    assert(0 == reconstructResult && !memcmp(message_in, message_out, bytes));
+
+    wh256_free(encoder);
+    wh256_free(decoder);
+
+    delete[]block;
+    delete[]message_in;
+    delete[]message_out;
+}
+
+static void TestTracing()
+{
+    // Custom hook sees balanced events from the encoder and decoder solves
+    TraceCounts counts = {};
+    wh256_set_trace_hook(OnTraceEvent, &counts);
+
+    TraceRoundTrip(1000, 100);
+
+    wh256_set_trace_hook(0, 0);
+
+    if (counts.begins != counts.ends || counts.solves != 2)
+    {
+        cout << "*** Trace hook saw " << counts.begins << " begins, " << counts.ends << " ends and " << counts.solves << " solves" << endl;
+        assert(false);
+    }
+
+    // Built-in sink records Wirehair and CM256 phases
+    int startResult = wh256_trace_start(4096, 1);
+    assert(0 == startResult);
+
+    TraceRoundTrip(10000, 100);
+    TraceRoundTrip(20, 100);
+
+    wh256_trace_stop();
+
+    const char *path = "wh256_trace.json";
+    int writeResult = wh256_trace_write(path);
+    assert(0 == writeResult);
+
+    ifstream file(path);
+    string json((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    if (json.find("\"SolveMatrix\"") == string::npos ||
+        json.find("\"Substitute\"") == string::npos ||
+        json.find("\"EliminateUpper\"") == string::npos)
+    {
+        cout << "*** Trace file is missing phases" << endl;
+        assert(false);
+    }
+
+    cout << "Wrote " << json.size() << " bytes of trace events to " << path << endl;
+
+    cout << "Verified that tracing works" << endl;
+}
+
+static void TestLatencyHistograms()
+{
+    const int block_bytes = 1000;
+    const int transfers = 20;
+    const int counts[2] = { 20, 1000 }; // CM256 and Wirehair
+    uint8_t block[block_bytes];
+
+    static const char *OpNames[WH256_OP_COUNT] = {
+        "encoder_init", "encoder_write", "decoder_read", "decoder_solve", "reconstruct"
+    };
+
+    wh256_reset_histograms();
+    wh256_enable_histograms(1);
+
+    // Two threads each run transfers for both back ends
+    std::vector<std::thread> threads;
+    std::atomic<int> reads(0);
+    for (int tt = 0; tt < 2; ++tt)
+    {
+        threads.push_back(std::thread([tt, &counts, &reads]() {
+            Abyssinian prng;
+            prng.Initialize(SEED + tt);
+
+            for (int bb = 0; bb < 2; ++bb)
+            {
+                const int bytes = block_bytes * counts[bb];
+                std::vector<uint8_t> message_in(bytes), message_out(bytes), data(block_bytes);
+                for (int ii = 0; ii < bytes; ++ii)
+                {
+                    message_in[ii] = (uint8_t)prng.Next();
+                }
+
+                wh256_state encoder = 0, decoder = 0;
+                for (int transfer = 0; transfer < transfers; ++transfer)
+                {
+                    encoder = wh256_encoder_init(encoder, &message_in[0], bytes, block_bytes);
+                    decoder = wh256_decoder_init(decoder, bytes, block_bytes);
+                    assert(encoder && decoder);
+
+                    for (uint32_t id = 0;; ++id)
+                    {
+                        // 10% packetloss
+                        if (prng.Next() % 100 < 10)
+                        {
+                            continue;
+                        }
+
+                        int bytes_written;
+                        int writeResult = wh256_encoder_write(encoder, id, &data[0], &bytes_written);
+                        assert(0 == writeResult);
+
+                        ++reads;
+                        if (0 == wh256_decoder_read(decoder, id, &data[0]))
+                        {
+                            break;
+                        }
+                    }
+
+                    int reconstructResult = wh256_decoder_reconstruct(decoder, &message_out[0]);
+                    assert(0 == reconstructResult && message_in == message_out);
+                }
+
+                wh256_free(encoder);
+                wh256_free(decoder);
+            }
+        }));
+    }
+    for (size_t ii = 0; ii < threads.size(); ++ii)
+    {
+        threads[ii].join();
+    }
+
+    wh256_enable_histograms(0);
+
+    // Not recorded while off
+    int bytes_written;
+    wh256_state quiet = wh256_encoder_init(0, block, block_bytes, block_bytes);
+    wh256_encoder_write(quiet, 0, block, &bytes_written);
+    wh256_free(quiet);
+
+    uint64_t total_reads = 0;
+    for (int backend = 0; backend < WH256_BACKEND_COUNT; ++backend)
+    {
+        for (int op = 0; op < WH256_OP_COUNT; ++op)
+        {
+            wh256_latency latency;
+            int latencyResult = wh256_get_latency(op, backend, &latency);
+            assert(0 == latencyResult);
+            assert(latency.p50 <= latency.p99 && latency.p99 <= latency.p999 && latency.p999 <= latency.max);
+
+            if (op == WH256_OP_ENCODER_INIT || op == WH256_OP_RECONSTRUCT)
+            {
+                assert(latency.count == 2 * transfers);
+            }
+            if (op == WH256_OP_DECODER_SOLVE)
+            {
+                assert(latency.count >= 2 * transfers);
+            }
+            if (op == WH256_OP_DECODER_READ || op == WH256_OP_DECODER_SOLVE)
+            {
+                total_reads += latency.count;
+            }
+
+            cout << "  " << (backend == WH256_BACKEND_CM256 ? "cm256" : "wirehair") << " " << setw(14) << OpNames[op]
+                << " : " << setw(6) << latency.count << " calls, p50 " << setw(9) << latency.p50 << ", p99 " << setw(9)
+                << latency.p99 << ", p999 " << setw(9) << latency.p999 << ", max " << setw(9) << latency.max << " ticks" << endl;
+        }
+    }
+    assert(total_reads == (uint64_t)reads);
+
+    const char *path = "wh256_latency.txt";
+    int dumpResult = wh256_dump_histograms(path);
+    assert(0 == dumpResult);
+
+    wh256_reset_histograms();
+    wh256_latency latency;
+    wh256_get_latency(WH256_OP_ENCODER_WRITE, WH256_BACKEND_WIREHAIR, &latency);
+    assert(latency.count == 0);
+
+    cout << "Wrote latency histograms to " << path << endl;
+
+    // A pipelined decoder times every read as a read, and the solver on the worker
+    {
+        const int N = 1000;
+        const int bytes = block_bytes * N;
+        std::vector<uint8_t> message_in(bytes, 1), data(block_bytes);
+
+        wh256_enable_histograms(1);
+
+        wh256_state encoder = wh256_encoder_init(0, &message_in[0], bytes, block_bytes);
+        wh256_state decoder = wh256_decoder_init(0, bytes, block_bytes);
+        assert(encoder && decoder);
+
+        int complete_result = -1;
+        int pipelineResult = wh256_decoder_pipeline(decoder, OnDecodeComplete, &complete_result);
+        assert(0 == pipelineResult);
+
+        // Skip originals so the solver has work to do, and keep reading while it runs
+        uint64_t pipelined_reads = 0;
+        for (uint32_t id = N / 2; id < (uint32_t)N * 3; ++id)
+        {
+            int bytes_written;
+            int writeResult = wh256_encoder_write(encoder, id, &data[0], &bytes_written);
+            assert(0 == writeResult);
+
+            ++pipelined_reads;
+            if (0 == wh256_decoder_read(decoder, id, &data[0]))
+            {
+                break;
+            }
+        }
+
+        int waitResult = wh256_decoder_wait(decoder);
+        assert(0 == waitResult && 0 == complete_result);
+
+        wh256_enable_histograms(0);
+
+        wh256_latency read_latency, solve_latency;
+        wh256_get_latency(WH256_OP_DECODER_READ, WH256_BACKEND_WIREHAIR, &read_latency);
+        wh256_get_latency(WH256_OP_DECODER_SOLVE, WH256_BACKEND_WIREHAIR, &solve_latency);
+        assert(read_latency.count == pipelined_reads);
+        assert(solve_latency.count >= 1);
+
+        wh256_free(encoder);
+        wh256_free(decoder);
+        wh256_reset_histograms();
+    }
+
+    cout << "Verified that latency histograms work" << endl;
+}
+
 
 //// Entrypoint
 
@@ -170,6 +2100,24 @@ int main()
     m_clock.OnInitialize();
 
     //TestBlockSizes();
+    //TestLargeN();
+    //TestDecodeSpeed();
+    //TestArena();
+    //TestArenaSweep();
+    //TestZeroCopyDecoder();
+    //TestInPlaceDecode();
+    //TestDecodeIntoOutput();
+    //TestSegmentedEncoder();
+    //TestProgressiveDecode();
+    //TestPipelinedDecode();
+    //TestPipelinedProgressiveDecode();
+    //TestBatchDecodeSpeed();
+    //TestStream();
+    //TestSlidingWindow();
+    //TestBatchCM256();
+    //TestStats();
+    //TestTracing();
+    //TestLatencyHistograms();
 
     wh256_state encoder = 0, decoder = 0;
     Abyssinian prng;
@@ -0,0 +1,753 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../src/wh256.h"
+#include "../src/cm256.h"
+#include "../src/wh256_trace.h"
+
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+#include "BenchTools.hpp"
+#include "PerfCounters.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+using namespace std;
+using namespace cat;
+
+static Clock m_clock;
+
+
+/*
+    wh256_bench: End-to-end codec benchmark
+
+    Sweeps every combination of back end, N, block_bytes, loss rate and
+    thread count, and measures each stage of a transfer separately in
+    Clock::cycles():
+
+        encoder_init : wh256_encoder_init(), which solves the matrix
+        encode       : Average cycles per block written by the encoder
+        feed         : Average cycles per block read before the Nth block
+        solve        : Cycles spent reading the Nth block onward
+        reconstruct  : Cycles to write out the recovered message
+
+    For the cm256 back end there is no encoder setup and feeding is just
+    filling in the block array, so those metrics are left empty.  encode is
+    then the cost of each recovery block and solve is cm256_decode().
+
+    Each trial contributes one sample to every metric, and the report gives
+    the median, 99th percentile and mean of the samples for each metric.
+    With more than one thread the trials are shared between the threads,
+    which all run at the same time to show how the codec scales.
+
+    With --perf-json or --perf-csv, each thread also reads the hardware
+    performance counters (see PerfCounters.hpp) around each of the stages
+    above and around each solver phase reported through the trace hook,
+    such as GreedyPeeling, Compress, Triangle and Substitute for Wirehair or
+    EliminateOriginals for cm256.  The counter report has one row for each
+    configuration and phase, giving the counts summed over all calls with
+    the IPC and the bytes processed per L1 and LLC miss.  Bytes processed
+    are one block per call for encode and feed, and the whole message for
+    every other phase.  If the counters cannot be opened, a note is printed
+    and the benchmark runs without them.
+
+    Usage:
+
+        wh256_bench [--n 32,256,1000,10000] [--bytes 1300] [--loss 0,0.1]
+                    [--backend wirehair,cm256] [--threads 1,2]
+                    [--trials 100] [--seed 1] [--json out.json] [--csv out.csv]
+                    [--perf-json counters.json] [--perf-csv counters.csv]
+*/
+
+
+//// Benchmark configuration
+
+enum Backend
+{
+    BACKEND_WIREHAIR,
+    BACKEND_CM256
+};
+
+static const char *BackendName(Backend backend)
+{
+    return backend == BACKEND_CM256 ? "cm256" : "wirehair";
+}
+
+// Metrics measured for each trial
+enum Metric
+{
+    METRIC_ENCODER_INIT,
+    METRIC_ENCODE,
+    METRIC_FEED,
+    METRIC_SOLVE,
+    METRIC_RECONSTRUCT,
+
+    METRIC_COUNT
+};
+
+static const char *METRIC_NAMES[METRIC_COUNT] = {
+    "encoder_init",
+    "encode",
+    "feed",
+    "solve",
+    "reconstruct"
+};
+
+struct BenchConfig
+{
+    Backend Back;
+    int N;
+    int BlockBytes;
+    double Loss;
+    int Threads;
+    int Trials;
+    uint32_t Seed;
+};
+
+// Counter totals for one phase
+struct PhaseTotals
+{
+    PerfSample Counts;
+    uint64_t Calls;
+
+    PhaseTotals() : Calls(0) {}
+};
+
+typedef map<string, PhaseTotals> PhaseMap;
+
+// Results collected by one thread
+struct BenchResults
+{
+    Samples Metrics[METRIC_COUNT];
+    Samples Overhead;   // Blocks received beyond N
+    int Failures;
+    PhaseMap Phases;    // Only filled in when counting
+
+    BenchResults() : Failures(0) {}
+};
+
+
+//// Hardware counters
+
+static bool m_perf = false;
+
+// Reads the counters of one thread at the start and end of each phase
+class PhaseRecorder
+{
+    PerfCounters _counters;
+    vector<pair<const char *, PerfSample> > _stack;
+    PhaseMap &_phases;
+
+public:
+    explicit PhaseRecorder(PhaseMap &phases) : _phases(phases) {}
+
+    bool Open() { return _counters.Open(); }
+
+    void Begin(const char *name)
+    {
+        PerfSample sample;
+        _counters.Read(sample);
+        _stack.push_back(make_pair(name, sample));
+    }
+
+    void End(const char *name)
+    {
+        PerfSample sample;
+        _counters.Read(sample);
+        if (_stack.empty() || strcmp(_stack.back().first, name))
+            return;
+
+        PhaseTotals &totals = _phases[name];
+        totals.Counts.Accumulate(_stack.back().second, sample);
+        ++totals.Calls;
+        _stack.pop_back();
+    }
+};
+
+static mutex m_recorder_lock;
+static unordered_map<thread::id, PhaseRecorder *> m_recorders;
+
+// Routes the solver phases to the recorder of the thread running them
+static void PerfTraceHook(void *context, const char *name, int begin)
+{
+    (void)context;
+
+    PhaseRecorder *recorder = 0;
+    {
+        lock_guard<mutex> locker(m_recorder_lock);
+        unordered_map<thread::id, PhaseRecorder *>::iterator it = m_recorders.find(this_thread::get_id());
+        if (it != m_recorders.end())
+            recorder = it->second;
+    }
+
+    if (recorder)
+    {
+        if (begin)
+            recorder->Begin(name);
+        else
+            recorder->End(name);
+    }
+}
+
+// Counts the stages measured on this thread while it is in scope, if enabled
+class ThreadPerf
+{
+    PhaseRecorder _recorder;
+    bool _active;
+
+public:
+    explicit ThreadPerf(PhaseMap &phases) : _recorder(phases), _active(false)
+    {
+        if (m_perf && _recorder.Open())
+        {
+            _active = true;
+            lock_guard<mutex> locker(m_recorder_lock);
+            m_recorders[this_thread::get_id()] = &_recorder;
+        }
+    }
+    ~ThreadPerf()
+    {
+        if (_active)
+        {
+            lock_guard<mutex> locker(m_recorder_lock);
+            m_recorders.erase(this_thread::get_id());
+        }
+    }
+
+    void Begin(const char *name)
+    {
+        if (_active)
+            _recorder.Begin(name);
+    }
+    void End(const char *name)
+    {
+        if (_active)
+            _recorder.End(name);
+    }
+};
+
+
+//// Channel
+
+// Returns true if the next block should be dropped
+static bool DropBlock(Abyssinian &prng, double loss)
+{
+    if (loss <= 0.)
+        return false;
+    return (prng.Next() / 4294967296.) < loss;
+}
+
+
+//// Wirehair back end
+
+static void RunWirehairTrials(const BenchConfig &config, int trials, uint32_t seed, BenchResults &results)
+{
+    const int N = config.N;
+    const int block_bytes = config.BlockBytes;
+    const size_t message_bytes = (size_t)N * block_bytes;
+
+    Abyssinian prng;
+    prng.Initialize(seed);
+
+    vector<uint8_t> message(message_bytes), recovered(message_bytes), block(block_bytes);
+    for (size_t ii = 0; ii < message_bytes; ++ii)
+        message[ii] = (uint8_t)prng.Next();
+
+    wh256_state E = 0, D = 0;
+    ThreadPerf perf(results.Phases);
+
+    for (int trial = 0; trial < trials; ++trial)
+    {
+        // Vary the first byte so that every trial encodes a new message
+        message[0] = (uint8_t)trial;
+
+        perf.Begin("encoder_init");
+        u32 c0 = Clock::cycles();
+        E = wh256_encoder_init64(E, &message[0], message_bytes, block_bytes);
+        u32 c1 = Clock::cycles();
+        perf.End("encoder_init");
+        if (!E)
+        {
+            ++results.Failures;
+            continue;
+        }
+        results.Metrics[METRIC_ENCODER_INIT].Add((u32)(c1 - c0));
+
+        D = wh256_decoder_init64(D, message_bytes, block_bytes);
+        if (!D)
+        {
+            ++results.Failures;
+            continue;
+        }
+
+        double encode_cycles = 0., feed_cycles = 0., solve_cycles = 0.;
+        int encoded = 0, fed = 0, received = 0;
+        bool success = false;
+
+        // Give up on the trial if the loss rate is too high to ever finish
+        const uint32_t id_limit = (uint32_t)N * 20 + 1000;
+
+        for (uint32_t id = 0; id < id_limit; ++id)
+        {
+            if (DropBlock(prng, config.Loss))
+                continue;
+
+            int written = 0;
+            perf.Begin("encode");
+            c0 = Clock::cycles();
+            int r = wh256_encoder_write(E, id, &block[0], &written);
+            c1 = Clock::cycles();
+            perf.End("encode");
+            if (r)
+                break;
+            encode_cycles += (u32)(c1 - c0);
+            ++encoded;
+
+            const char *stage = ++received < N ? "feed" : "solve";
+            perf.Begin(stage);
+            c0 = Clock::cycles();
+            r = wh256_decoder_read(D, id, &block[0]);
+            c1 = Clock::cycles();
+            perf.End(stage);
+
+            if (received < N)
+            {
+                feed_cycles += (u32)(c1 - c0);
+                ++fed;
+            }
+            else
+                solve_cycles += (u32)(c1 - c0);
+
+            if (!r)
+            {
+                success = true;
+                break;
+            }
+        }
+
+        if (!success)
+        {
+            ++results.Failures;
+            continue;
+        }
+
+        perf.Begin("reconstruct");
+        c0 = Clock::cycles();
+        int r = wh256_decoder_reconstruct(D, &recovered[0]);
+        c1 = Clock::cycles();
+        perf.End("reconstruct");
+        if (r || memcmp(&recovered[0], &message[0], message_bytes))
+        {
+            ++results.Failures;
+            continue;
+        }
+
+        results.Metrics[METRIC_ENCODE].Add(encode_cycles / encoded);
+        if (fed > 0)
+            results.Metrics[METRIC_FEED].Add(feed_cycles / fed);
+        results.Metrics[METRIC_SOLVE].Add(solve_cycles);
+        results.Metrics[METRIC_RECONSTRUCT].Add((u32)(c1 - c0));
+        results.Overhead.Add(received - N);
+    }
+
+    wh256_free(E);
+    wh256_free(D);
+}
+
+
+//// CM256 back end
+
+static void RunCM256Trials(const BenchConfig &config, int trials, uint32_t seed, BenchResults &results)
+{
+    const int N = config.N;
+    const int block_bytes = config.BlockBytes;
+    const int R = 256 - N;
+
+    cm256_encoder_params params;
+    params.OriginalCount = N;
+    params.RecoveryCount = R;
+    params.BlockBytes = block_bytes;
+
+    Abyssinian prng;
+    prng.Initialize(seed);
+
+    vector<uint8_t> message(N * block_bytes), recovered(N * block_bytes);
+    vector<uint8_t> recovery(R * block_bytes);
+    for (int ii = 0; ii < N * block_bytes; ++ii)
+        message[ii] = (uint8_t)prng.Next();
+
+    vector<cm256_block> originals(N), blocks(N);
+    for (int ii = 0; ii < N; ++ii)
+    {
+        originals[ii].Data = &message[ii * block_bytes];
+        originals[ii].Index = cm256_get_original_block_index(params, ii);
+    }
+
+    ThreadPerf perf(results.Phases);
+
+    for (int trial = 0; trial < trials; ++trial)
+    {
+        message[0] = (uint8_t)trial;
+
+        // Pick the blocks that get through, as the decoder would see them
+        double encode_cycles = 0.;
+        int encoded = 0, received = 0;
+
+        for (int id = 0; id < N + R && received < N; ++id)
+        {
+            if (DropBlock(prng, config.Loss))
+                continue;
+
+            if (id < N)
+                blocks[received].Data = originals[id].Data;
+            else
+            {
+                uint8_t *recovery_block = &recovery[(id - N) * block_bytes];
+
+                perf.Begin("encode");
+                u32 c0 = Clock::cycles();
+                cm256_encode_block(params, &originals[0], id, recovery_block);
+                u32 c1 = Clock::cycles();
+                perf.End("encode");
+                encode_cycles += (u32)(c1 - c0);
+                ++encoded;
+
+                blocks[received].Data = recovery_block;
+            }
+            blocks[received].Index = (unsigned char)id;
+            ++received;
+        }
+
+        if (received < N)
+        {
+            ++results.Failures;
+            continue;
+        }
+
+        perf.Begin("solve");
+        u32 c0 = Clock::cycles();
+        int r = cm256_decode(params, &blocks[0]);
+        u32 c1 = Clock::cycles();
+        perf.End("solve");
+        if (r)
+        {
+            ++results.Failures;
+            continue;
+        }
+        results.Metrics[METRIC_SOLVE].Add((u32)(c1 - c0));
+
+        // Gather the original blocks back into message order
+        perf.Begin("reconstruct");
+        c0 = Clock::cycles();
+        for (int ii = 0; ii < N; ++ii)
+            memcpy(&recovered[blocks[ii].Index * block_bytes], blocks[ii].Data, block_bytes);
+        c1 = Clock::cycles();
+        perf.End("reconstruct");
+        results.Metrics[METRIC_RECONSTRUCT].Add((u32)(c1 - c0));
+
+        if (encoded > 0)
+            results.Metrics[METRIC_ENCODE].Add(encode_cycles / encoded);
+        results.Overhead.Add(0);
+
+        if (memcmp(&recovered[0], &message[0], N * block_bytes))
+            ++results.Failures;
+    }
+}
+
+
+//// Sweep
+
+static void RunConfig(const BenchConfig &config, BenchReport &report, double cycles_per_usec,
+    BenchReport &perf_report, const PerfCounters &perf_probe)
+{
+    vector<BenchResults> results(config.Threads);
+    vector<thread> threads;
+
+    double t0 = m_clock.usec();
+
+    for (int ii = 0; ii < config.Threads; ++ii)
+    {
+        // Share the trials out, giving the first threads any remainder
+        int trials = config.Trials / config.Threads;
+        if (ii < config.Trials % config.Threads)
+            ++trials;
+        uint32_t seed = config.Seed + ii * 1000003;
+        BenchResults *thread_results = &results[ii];
+
+        threads.push_back(thread([&config, trials, seed, thread_results]() {
+            if (config.Back == BACKEND_CM256)
+                RunCM256Trials(config, trials, seed, *thread_results);
+            else
+                RunWirehairTrials(config, trials, seed, *thread_results);
+        }));
+    }
+    for (size_t ii = 0; ii < threads.size(); ++ii)
+        threads[ii].join();
+
+    double t1 = m_clock.usec();
+
+    BenchResults total;
+    for (int ii = 0; ii < config.Threads; ++ii)
+    {
+        for (int jj = 0; jj < METRIC_COUNT; ++jj)
+            total.Metrics[jj].Append(results[ii].Metrics[jj]);
+        total.Overhead.Append(results[ii].Overhead);
+        total.Failures += results[ii].Failures;
+        for (PhaseMap::iterator it = results[ii].Phases.begin(); it != results[ii].Phases.end(); ++it)
+        {
+            total.Phases[it->first].Counts.Add(it->second.Counts);
+            total.Phases[it->first].Calls += it->second.Calls;
+        }
+    }
+
+    // Message bytes recovered per second, across all threads
+    const double message_bytes = (double)config.N * config.BlockBytes;
+    const int completed = config.Trials - total.Failures;
+    const double mbps = t1 > t0 ? (completed * message_bytes) / (t1 - t0) : 0.;
+
+    report.BeginRow();
+    report.AddText("backend", BackendName(config.Back));
+    report.AddNumber("N", config.N);
+    report.AddNumber("block_bytes", config.BlockBytes);
+    report.AddNumber("loss", config.Loss);
+    report.AddNumber("threads", config.Threads);
+    report.AddNumber("trials", config.Trials);
+    report.AddNumber("failures", total.Failures);
+    report.AddNumber("overhead_mean", total.Overhead.Mean());
+    report.AddNumber("throughput_MBps", mbps);
+    for (int jj = 0; jj < METRIC_COUNT; ++jj)
+        report.AddSamples(METRIC_NAMES[jj], total.Metrics[jj]);
+
+    cout << setw(8) << BackendName(config.Back) << setw(7) << config.N << setw(7) << config.BlockBytes
+        << setw(6) << config.Loss << setw(4) << config.Threads;
+    for (int jj = 0; jj < METRIC_COUNT; ++jj)
+    {
+        if (total.Metrics[jj].Count() <= 0)
+            cout << setw(12) << "-";
+        else
+            cout << setw(12) << (uint64_t)total.Metrics[jj].Median();
+    }
+    cout << setw(10) << setprecision(4) << mbps << " MB/s";
+    if (total.Failures > 0)
+        cout << "  (" << total.Failures << " failed)";
+    if (cycles_per_usec > 0. && total.Metrics[METRIC_SOLVE].Count() > 0)
+        cout << "  solve " << setprecision(4) << total.Metrics[METRIC_SOLVE].Median() / cycles_per_usec << " usec";
+    cout << endl;
+
+    for (PhaseMap::iterator it = total.Phases.begin(); it != total.Phases.end(); ++it)
+    {
+        const bool per_block = it->first == "encode" || it->first == "feed";
+        const double bytes = (double)it->second.Calls * (per_block ? config.BlockBytes : message_bytes);
+
+        perf_report.BeginRow();
+        perf_report.AddText("backend", BackendName(config.Back));
+        perf_report.AddNumber("N", config.N);
+        perf_report.AddNumber("block_bytes", config.BlockBytes);
+        perf_report.AddNumber("loss", config.Loss);
+        perf_report.AddNumber("threads", config.Threads);
+        perf_report.AddText("phase", it->first);
+        perf_report.AddNumber("calls", (double)it->second.Calls);
+        AddPerfColumns(perf_report, "", perf_probe, it->second.Counts, bytes);
+    }
+}
+
+static void PrintUsage()
+{
+    cout << "Usage: wh256_bench [--n list] [--bytes list] [--loss list] [--backend list]" << endl;
+    cout << "                   [--threads list] [--trials count] [--seed seed]" << endl;
+    cout << "                   [--json path] [--csv path]" << endl;
+    cout << "                   [--perf-json path] [--perf-csv path]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    m_clock.OnInitialize();
+
+    vector<int> n_list = ParseIntList("32,128,255,1000,10000");
+    vector<int> bytes_list = ParseIntList("1300");
+    vector<double> loss_list = ParseRealList("0,0.1");
+    vector<string> backend_list = ParseWordList("wirehair,cm256");
+    vector<int> thread_list = ParseIntList("1");
+    int trials = 100;
+    uint32_t seed = 1;
+    const char *json_path = 0, *csv_path = 0;
+    const char *perf_json_path = 0, *perf_csv_path = 0;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char *arg = argv[ii];
+        const char *value = ii + 1 < argc ? argv[ii + 1] : 0;
+
+        if (!value)
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++ii;
+
+        if (!strcmp(arg, "--n"))
+            n_list = ParseIntList(value);
+        else if (!strcmp(arg, "--bytes"))
+            bytes_list = ParseIntList(value);
+        else if (!strcmp(arg, "--loss"))
+            loss_list = ParseRealList(value);
+        else if (!strcmp(arg, "--backend"))
+            backend_list = ParseWordList(value);
+        else if (!strcmp(arg, "--threads"))
+            thread_list = ParseIntList(value);
+        else if (!strcmp(arg, "--trials"))
+            trials = atoi(value);
+        else if (!strcmp(arg, "--seed"))
+            seed = (uint32_t)atoi(value);
+        else if (!strcmp(arg, "--json"))
+            json_path = value;
+        else if (!strcmp(arg, "--csv"))
+            csv_path = value;
+        else if (!strcmp(arg, "--perf-json"))
+            perf_json_path = value;
+        else if (!strcmp(arg, "--perf-csv"))
+            perf_csv_path = value;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (wirehair_init() || cm256_init())
+    {
+        cout << "Codec initialization failed" << endl;
+        return 1;
+    }
+
+    const double cycles_per_usec = MeasureCyclesPerUsec(m_clock);
+
+    BenchReport report;
+    report.AddMeta("tool", "wh256_bench");
+    report.AddMeta("wh256_version", WH256_VERSION);
+    report.AddMeta("cycles_per_usec", cycles_per_usec);
+
+    // Check that the counters can be opened before asking each thread to
+    PerfCounters perf_probe;
+    BenchReport perf_report;
+    if (perf_json_path || perf_csv_path)
+    {
+        if (perf_probe.Open())
+        {
+            m_perf = true;
+            wh256_set_trace_hook(PerfTraceHook, 0);
+        }
+        else
+            cout << "Hardware performance counters are not available, so they will not be reported" << endl;
+
+        perf_report.AddMeta("tool", "wh256_bench");
+        perf_report.AddMeta("wh256_version", WH256_VERSION);
+        perf_report.AddMeta("counters", m_perf ? "available" : "unavailable");
+    }
+
+    cout << "Clock::cycles() runs at about " << setprecision(5) << cycles_per_usec << " cycles/usec" << endl;
+    cout << " backend      N  bytes  loss thr" << " encoder_init      encode        feed       solve reconstruct" << endl;
+
+    for (size_t bi = 0; bi < backend_list.size(); ++bi)
+    {
+        Backend back;
+        if (backend_list[bi] == "wirehair")
+            back = BACKEND_WIREHAIR;
+        else if (backend_list[bi] == "cm256")
+            back = BACKEND_CM256;
+        else
+        {
+            cout << "Unknown back end: " << backend_list[bi] << endl;
+            return 1;
+        }
+
+        for (size_t ni = 0; ni < n_list.size(); ++ni)
+        {
+            const int N = n_list[ni];
+
+            // wh256 hands messages with N < 28 to CM256, and CM256 needs N + R <= 256
+            if ((back == BACKEND_WIREHAIR && N < 28) ||
+                (back == BACKEND_CM256 && (N < 1 || N > 255)))
+                continue;
+
+            for (size_t bb = 0; bb < bytes_list.size(); ++bb)
+            {
+                for (size_t li = 0; li < loss_list.size(); ++li)
+                {
+                    for (size_t ti = 0; ti < thread_list.size(); ++ti)
+                    {
+                        BenchConfig config;
+                        config.Back = back;
+                        config.N = N;
+                        config.BlockBytes = bytes_list[bb];
+                        config.Loss = loss_list[li];
+                        config.Threads = thread_list[ti] > 0 ? thread_list[ti] : 1;
+                        config.Trials = trials;
+                        config.Seed = seed;
+
+                        if (config.BlockBytes < 1)
+                            continue;
+
+                        RunConfig(config, report, cycles_per_usec, perf_report, perf_probe);
+                    }
+                }
+            }
+        }
+    }
+
+    if (json_path && !report.WriteJSON(json_path))
+    {
+        cout << "Failed to write " << json_path << endl;
+        return 1;
+    }
+    if (csv_path && !report.WriteCSV(csv_path))
+    {
+        cout << "Failed to write " << csv_path << endl;
+        return 1;
+    }
+    if (perf_json_path && !perf_report.WriteJSON(perf_json_path))
+    {
+        cout << "Failed to write " << perf_json_path << endl;
+        return 1;
+    }
+    if (perf_csv_path && !perf_report.WriteCSV(perf_csv_path))
+    {
+        cout << "Failed to write " << perf_csv_path << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,528 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../src/wh256.h"
+
+#include "Clock.hpp"
+#include "BenchTools.hpp"
+#include "ChannelModel.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+using namespace std;
+using namespace cat;
+
+static Clock m_clock;
+
+
+/*
+    wh256_flows: Multi-flow transfer simulation
+
+    Runs many transfers at once, each through its own simulated channel
+    from ChannelModel.hpp, the way a server sending to many receivers
+    would.  Each flow sends --messages messages one after another: the
+    message is encoded with wh256, blocks are pushed through the channel one
+    at a time, and the receiver decodes whatever arrives until it has the
+    whole message.  The flows are split between the threads, and each
+    thread takes turns sending one block from each of its flows, as if they
+    shared one link.
+
+    With --rate-mbps each thread's link is paced to that many megabits per
+    second of block data, and a thread that is ahead of the link waits.
+    Without it the flows run as fast as the codec allows.
+
+    Reported for each configuration:
+
+        goodput_MBps          : Message bytes delivered per second, all threads
+        codec_cycles_per_byte : Clock::cycles() spent in wh256 calls on both
+                                sides, per message byte delivered
+        latency_usec          : Time from the start of a message to the end
+                                of reconstruction, with median, p99, p999
+        overhead_mean         : Blocks received beyond N
+
+    Blocks that the channel delays for reordering are kept in a small ring
+    until they arrive, so the encoder only runs once for each block sent.
+
+    With --histograms the per-call latency histograms inside wh256 are
+    turned on for the whole run and written to the given file at the end,
+    in the wh256_dump_histograms() format.
+
+    Usage:
+
+        wh256_flows [--n 100,1000] [--bytes 1300] [--flows 64] [--threads 1]
+                    [--messages 20] [--model iid,gilbert,outage] [--loss 0.1]
+                    [--burst 4] [--good-loss 0] [--bad-loss 1]
+                    [--outage-period 100] [--outage-length 10]
+                    [--reorder 0] [--reorder-depth 8] [--rate-mbps 0]
+                    [--seed 1] [--json out.json] [--csv out.csv]
+                    [--histograms latency.txt]
+*/
+
+
+//// Flows
+
+struct FlowConfig
+{
+    ChannelParams Channel;
+    int N;
+    int BlockBytes;
+    int Flows;
+    int Threads;
+    int Messages;
+    double RateMbps;
+    uint32_t Seed;
+};
+
+// Results collected by one thread
+struct FlowResults
+{
+    Samples Latency;
+    Samples Overhead;
+    uint64_t CodecCycles;
+    uint64_t DeliveredBytes;
+    int Failures;
+
+    FlowResults() : CodecCycles(0), DeliveredBytes(0), Failures(0) {}
+};
+
+class Flow
+{
+    const FlowConfig *_config;
+    ChannelSimulator _channel;
+    wh256_state _encoder, _decoder;
+    vector<uint8_t> _message, _recovered;
+    vector<uint8_t> _ring;      // Recently sent blocks, by id modulo the ring size
+    uint32_t _ring_size;
+    vector<uint32_t> _delivered;
+
+    uint64_t _message_bytes;
+    uint32_t _next_id;
+    uint32_t _id_limit;
+    int _received;
+    int _messages;
+    double _start_usec;
+
+    bool Fail(FlowResults &results)
+    {
+        ++results.Failures;
+        return StartMessage(results);
+    }
+
+public:
+    Flow() : _encoder(0), _decoder(0) {}
+    ~Flow()
+    {
+        wh256_free(_encoder);
+        wh256_free(_decoder);
+    }
+
+    void Initialize(const FlowConfig &config, uint32_t seed)
+    {
+        _config = &config;
+        _channel.Initialize(seed, config.Channel);
+
+        _message_bytes = (uint64_t)config.N * config.BlockBytes;
+        _message.resize((size_t)_message_bytes);
+        _recovered.resize((size_t)_message_bytes);
+        for (size_t ii = 0; ii < _message.size(); ++ii)
+            _message[ii] = (uint8_t)_channel.PRNG().Next();
+
+        // A held block arrives within ReorderDepth + 1 sends
+        _ring_size = (uint32_t)(config.Channel.ReorderDepth > 0 ? config.Channel.ReorderDepth : 0) + 2;
+        _ring.resize((size_t)_ring_size * config.BlockBytes);
+
+        // Give up on a message if the loss rate is too high to ever finish
+        _id_limit = (uint32_t)config.N * 20 + 1000;
+        _messages = 0;
+    }
+
+    // Set up the next message.  Returns false when the flow has sent them all
+    bool StartMessage(FlowResults &results)
+    {
+        if (++_messages > _config->Messages)
+            return false;
+
+        // Vary the first bytes so that every message is new
+        memcpy(&_message[0], &_messages, _message.size() < sizeof(_messages) ? _message.size() : sizeof(_messages));
+
+        _start_usec = m_clock.usec();
+
+        u32 c0 = Clock::cycles();
+        _encoder = wh256_encoder_init64(_encoder, &_message[0], _message_bytes, _config->BlockBytes);
+        _decoder = wh256_decoder_init64(_decoder, _message_bytes, _config->BlockBytes);
+        u32 c1 = Clock::cycles();
+        results.CodecCycles += (u32)(c1 - c0);
+
+        if (!_encoder || !_decoder)
+            return Fail(results);
+
+        _channel.Reset();
+        _next_id = 0;
+        _received = 0;
+        return true;
+    }
+
+    // Send one block.  Returns false when the flow has finished
+    bool SendBlock(FlowResults &results)
+    {
+        const uint32_t id = _next_id++;
+        if (id >= _id_limit)
+            return Fail(results);
+
+        const int block_bytes = _config->BlockBytes;
+        uint8_t *block = &_ring[(size_t)(id % _ring_size) * block_bytes];
+
+        int written = 0;
+        u32 c0 = Clock::cycles();
+        int r = wh256_encoder_write(_encoder, id, block, &written);
+        u32 c1 = Clock::cycles();
+        results.CodecCycles += (u32)(c1 - c0);
+        if (r)
+            return Fail(results);
+
+        _delivered.clear();
+        _channel.Send(id, _delivered);
+
+        for (size_t ii = 0; ii < _delivered.size(); ++ii)
+        {
+            const uint32_t arrived = _delivered[ii];
+            ++_received;
+
+            c0 = Clock::cycles();
+            r = wh256_decoder_read(_decoder, arrived, &_ring[(size_t)(arrived % _ring_size) * block_bytes]);
+            c1 = Clock::cycles();
+            results.CodecCycles += (u32)(c1 - c0);
+
+            if (!r)
+            {
+                c0 = Clock::cycles();
+                r = wh256_decoder_reconstruct(_decoder, &_recovered[0]);
+                c1 = Clock::cycles();
+                results.CodecCycles += (u32)(c1 - c0);
+
+                if (r || memcmp(&_recovered[0], &_message[0], (size_t)_message_bytes))
+                    return Fail(results);
+
+                results.Latency.Add(m_clock.usec() - _start_usec);
+                results.Overhead.Add(_received - _config->N);
+                results.DeliveredBytes += _message_bytes;
+                return StartMessage(results);
+            }
+        }
+
+        return true;
+    }
+};
+
+static void RunFlows(const FlowConfig &config, int first_flow, int flow_count, FlowResults &results)
+{
+    vector<Flow> flows(flow_count);
+    vector<int> active;
+    for (int ii = 0; ii < flow_count; ++ii)
+    {
+        // Seed each flow by its number so results do not depend on the thread count
+        flows[ii].Initialize(config, config.Seed + (uint32_t)(first_flow + ii) * 2654435761u);
+        if (flows[ii].StartMessage(results))
+            active.push_back(ii);
+    }
+
+    const double usec_per_block = config.RateMbps > 0. ? config.BlockBytes * 8. / config.RateMbps : 0.;
+    const double t0 = m_clock.usec();
+    uint64_t sent = 0;
+
+    // Take turns sending one block from each flow until they are all done
+    while (!active.empty())
+    {
+        for (size_t ii = 0; ii < active.size();)
+        {
+            if (usec_per_block > 0.)
+            {
+                const double due = t0 + sent * usec_per_block;
+                while (m_clock.usec() < due)
+                {
+                }
+            }
+            ++sent;
+
+            if (flows[active[ii]].SendBlock(results))
+                ++ii;
+            else
+            {
+                active[ii] = active.back();
+                active.pop_back();
+            }
+        }
+    }
+}
+
+
+//// Sweep
+
+static void RunConfig(const FlowConfig &config, BenchReport &report)
+{
+    vector<FlowResults> results(config.Threads);
+    vector<thread> threads;
+
+    double t0 = m_clock.usec();
+
+    int first_flow = 0;
+    for (int ii = 0; ii < config.Threads; ++ii)
+    {
+        // Share the flows out, giving the first threads any remainder
+        int flow_count = config.Flows / config.Threads;
+        if (ii < config.Flows % config.Threads)
+            ++flow_count;
+        FlowResults *thread_results = &results[ii];
+
+        threads.push_back(thread([&config, first_flow, flow_count, thread_results]() {
+            RunFlows(config, first_flow, flow_count, *thread_results);
+        }));
+        first_flow += flow_count;
+    }
+    for (size_t ii = 0; ii < threads.size(); ++ii)
+        threads[ii].join();
+
+    double t1 = m_clock.usec();
+
+    FlowResults total;
+    for (int ii = 0; ii < config.Threads; ++ii)
+    {
+        total.Latency.Append(results[ii].Latency);
+        total.Overhead.Append(results[ii].Overhead);
+        total.CodecCycles += results[ii].CodecCycles;
+        total.DeliveredBytes += results[ii].DeliveredBytes;
+        total.Failures += results[ii].Failures;
+    }
+
+    const double goodput = t1 > t0 ? total.DeliveredBytes / (t1 - t0) : 0.;
+    const double cycles_per_byte = total.DeliveredBytes > 0 ? total.CodecCycles / (double)total.DeliveredBytes : 0.;
+
+    const ChannelParams &channel = config.Channel;
+
+    report.BeginRow();
+    report.AddText("model", ChannelModelName(channel.Model));
+    report.AddNumber("N", config.N);
+    report.AddNumber("block_bytes", config.BlockBytes);
+    report.AddNumber("loss", channel.Model == CHANNEL_OUTAGE ? channel.OutageLength / (double)channel.OutagePeriod : channel.Loss);
+    report.AddNumber("burst", channel.Model == CHANNEL_GILBERT ? channel.Burst : channel.Model == CHANNEL_OUTAGE ? channel.OutageLength : 1.);
+    report.AddNumber("reorder", channel.Reorder);
+    report.AddNumber("flows", config.Flows);
+    report.AddNumber("threads", config.Threads);
+    report.AddNumber("rate_mbps", config.RateMbps);
+    report.AddNumber("messages", total.Latency.Count());
+    report.AddNumber("failures", total.Failures);
+    report.AddNumber("goodput_MBps", goodput);
+    report.AddNumber("codec_cycles_per_byte", cycles_per_byte);
+    report.AddNumber("overhead_mean", total.Overhead.Mean());
+    report.AddSamples("latency_usec", total.Latency);
+    if (total.Latency.Count() > 0)
+        report.AddNumber("latency_usec_p999", total.Latency.Percentile(99.9));
+    else
+        report.AddEmpty("latency_usec_p999");
+
+    cout << setw(8) << ChannelModelName(channel.Model) << setw(7) << config.N << setw(7) << config.BlockBytes
+        << setw(6) << config.Flows << setw(4) << config.Threads
+        << setw(11) << setprecision(4) << goodput
+        << setw(10) << setprecision(4) << cycles_per_byte
+        << setw(11) << (uint64_t)total.Latency.Median()
+        << setw(11) << (uint64_t)total.Latency.Percentile(99.)
+        << setw(12) << (uint64_t)total.Latency.Percentile(99.9);
+    if (total.Failures > 0)
+        cout << "  (" << total.Failures << " failed)";
+    cout << endl;
+}
+
+static void PrintUsage()
+{
+    cout << "Usage: wh256_flows [--n list] [--bytes list] [--flows list] [--threads list]" << endl;
+    cout << "                   [--messages count] [--model list] [--loss rate] [--burst length]" << endl;
+    cout << "                   [--good-loss rate] [--bad-loss rate]" << endl;
+    cout << "                   [--outage-period blocks] [--outage-length blocks]" << endl;
+    cout << "                   [--reorder rate] [--reorder-depth blocks] [--rate-mbps rate]" << endl;
+    cout << "                   [--seed seed] [--json path] [--csv path]" << endl;
+    cout << "                   [--histograms path]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    m_clock.OnInitialize();
+
+    vector<int> n_list = ParseIntList("100,1000");
+    vector<int> bytes_list = ParseIntList("1300");
+    vector<int> flow_list = ParseIntList("64");
+    vector<int> thread_list = ParseIntList("1");
+    vector<string> model_list = ParseWordList("iid,gilbert");
+    ChannelParams channel;
+    channel.Loss = 0.1;
+    int messages = 20;
+    double rate_mbps = 0.;
+    uint32_t seed = 1;
+    const char *json_path = 0, *csv_path = 0, *histogram_path = 0;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char *arg = argv[ii];
+        const char *value = ii + 1 < argc ? argv[ii + 1] : 0;
+
+        if (!value)
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++ii;
+
+        if (!strcmp(arg, "--n"))
+            n_list = ParseIntList(value);
+        else if (!strcmp(arg, "--bytes"))
+            bytes_list = ParseIntList(value);
+        else if (!strcmp(arg, "--flows"))
+            flow_list = ParseIntList(value);
+        else if (!strcmp(arg, "--threads"))
+            thread_list = ParseIntList(value);
+        else if (!strcmp(arg, "--messages"))
+            messages = atoi(value);
+        else if (!strcmp(arg, "--model"))
+            model_list = ParseWordList(value);
+        else if (!strcmp(arg, "--loss"))
+            channel.Loss = atof(value);
+        else if (!strcmp(arg, "--burst"))
+            channel.Burst = atof(value);
+        else if (!strcmp(arg, "--good-loss"))
+            channel.GoodLoss = atof(value);
+        else if (!strcmp(arg, "--bad-loss"))
+            channel.BadLoss = atof(value);
+        else if (!strcmp(arg, "--outage-period"))
+            channel.OutagePeriod = atoi(value);
+        else if (!strcmp(arg, "--outage-length"))
+            channel.OutageLength = atoi(value);
+        else if (!strcmp(arg, "--reorder"))
+            channel.Reorder = atof(value);
+        else if (!strcmp(arg, "--reorder-depth"))
+            channel.ReorderDepth = atoi(value);
+        else if (!strcmp(arg, "--rate-mbps"))
+            rate_mbps = atof(value);
+        else if (!strcmp(arg, "--seed"))
+            seed = (uint32_t)atoi(value);
+        else if (!strcmp(arg, "--json"))
+            json_path = value;
+        else if (!strcmp(arg, "--csv"))
+            csv_path = value;
+        else if (!strcmp(arg, "--histograms"))
+            histogram_path = value;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (messages < 1 || channel.Loss < 0. || channel.Loss >= 1. ||
+        channel.OutagePeriod < 1 || channel.OutageLength < 0 || channel.OutageLength >= channel.OutagePeriod ||
+        channel.ReorderDepth < 0 || rate_mbps < 0.)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (wirehair_init())
+    {
+        cout << "Codec initialization failed" << endl;
+        return 1;
+    }
+
+    if (histogram_path)
+        wh256_enable_histograms(1);
+
+    BenchReport report;
+    report.AddMeta("tool", "wh256_flows");
+    report.AddMeta("wh256_version", WH256_VERSION);
+    report.AddMeta("cycles_per_usec", MeasureCyclesPerUsec(m_clock));
+
+    cout << "   model      N  bytes flows thr  MB/s good cyc/byte lat p50 us lat p99 us lat p999 us" << endl;
+
+    for (size_t mi = 0; mi < model_list.size(); ++mi)
+    {
+        FlowConfig config;
+        config.Channel = channel;
+        if (!ParseChannelModel(model_list[mi], config.Channel.Model))
+        {
+            cout << "Unknown loss model: " << model_list[mi] << endl;
+            return 1;
+        }
+        config.Messages = messages;
+        config.RateMbps = rate_mbps;
+        config.Seed = seed;
+
+        for (size_t ni = 0; ni < n_list.size(); ++ni)
+        {
+            for (size_t bb = 0; bb < bytes_list.size(); ++bb)
+            {
+                for (size_t fi = 0; fi < flow_list.size(); ++fi)
+                {
+                    for (size_t ti = 0; ti < thread_list.size(); ++ti)
+                    {
+                        config.N = n_list[ni];
+                        config.BlockBytes = bytes_list[bb];
+                        config.Flows = flow_list[fi];
+                        config.Threads = thread_list[ti] > 0 ? thread_list[ti] : 1;
+
+                        if (config.N < 2 || config.N > 64000 || config.BlockBytes < 1 || config.Flows < 1)
+                            continue;
+                        if (config.Threads > config.Flows)
+                            config.Threads = config.Flows;
+
+                        RunConfig(config, report);
+                    }
+                }
+            }
+        }
+    }
+
+    if (json_path && !report.WriteJSON(json_path))
+    {
+        cout << "Failed to write " << json_path << endl;
+        return 1;
+    }
+    if (csv_path && !report.WriteCSV(csv_path))
+    {
+        cout << "Failed to write " << csv_path << endl;
+        return 1;
+    }
+    if (histogram_path && wh256_dump_histograms(histogram_path) != 0)
+    {
+        cout << "Failed to write " << histogram_path << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,426 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../src/wh256.h"
+
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+#include "BenchTools.hpp"
+#include "ChannelModel.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+using namespace std;
+using namespace cat;
+
+static Clock m_clock;
+
+
+/*
+    wh256_overhead: Reception overhead statistics
+
+    For each N in the requested range this sends the message over a lossy
+    channel many times and records how many blocks beyond N the decoder
+    needed each time.  It reports the full distribution as P(success at
+    N + k) for k = 0..10, which is the fraction of trials that finished
+    with at most k extra blocks, along with the mean overhead.
+
+    The loss models are those of ChannelModel.hpp:
+
+        iid     : Each block is lost independently with probability --loss
+        gilbert : Gilbert model where the channel alternates between a good
+                  state with no loss and a bad state where every block is
+                  lost, with bursts of --burst blocks on average and the
+                  same average loss rate as iid
+        outage  : The last --outage-length blocks of every --outage-period
+                  blocks are lost
+
+    N < 28 is handled by CM256 inside wh256 and larger N by Wirehair, so a
+    range starting below 28 covers both back ends.  The backend column in
+    the output says which one was used.
+
+    Each value of N is a separate work item, and the worker threads take
+    items from a shared counter, so the run time scales with the number of
+    cores.  Results are always written in order of N.
+
+    Usage:
+
+        wh256_overhead [--n-min 2] [--n-max 1000] [--n-step 1] [--n list]
+                       [--model iid,gilbert,outage] [--loss 0.5] [--burst 4]
+                       [--outage-period 100] [--outage-length 50]
+                       [--trials 1000] [--bytes 1] [--threads 0 = all cores]
+                       [--seed 1] [--json out.json] [--csv out.csv]
+*/
+
+
+//// Trials
+
+// Largest overhead tracked individually; larger overheads are counted together
+static const int MAX_TRACKED_OVERHEAD = 10;
+
+// A trial fails if the decoder still needs more blocks after this many extra
+static const int GIVE_UP_OVERHEAD = 64;
+
+
+//// Work items
+
+struct OverheadConfig
+{
+    ChannelParams Channel;
+    int Trials;
+    int BlockBytes;
+    uint32_t Seed;
+};
+
+struct OverheadResult
+{
+    int N;
+    bool EncoderFailed;
+    int Failures;
+    uint64_t OverheadSum;
+    int Counts[MAX_TRACKED_OVERHEAD + 2]; // Last entry counts overhead beyond MAX_TRACKED_OVERHEAD
+};
+
+static void RunOverheadTrials(const OverheadConfig &config, OverheadResult &result, wh256_state &E, wh256_state &D)
+{
+    const int N = result.N;
+    const uint64_t message_bytes = (uint64_t)N * config.BlockBytes;
+
+    result.EncoderFailed = false;
+    result.Failures = 0;
+    result.OverheadSum = 0;
+    memset(result.Counts, 0, sizeof(result.Counts));
+
+    // Seed each N separately so results do not depend on the thread count
+    ChannelSimulator channel;
+    channel.Initialize(config.Seed + (uint32_t)N * 2654435761u, config.Channel);
+
+    vector<uint8_t> message((size_t)message_bytes), recovered((size_t)message_bytes), block(config.BlockBytes);
+    for (size_t ii = 0; ii < message.size(); ++ii)
+        message[ii] = (uint8_t)channel.PRNG().Next();
+
+    E = wh256_encoder_init64(E, &message[0], message_bytes, config.BlockBytes);
+    if (!E)
+    {
+        result.EncoderFailed = true;
+        return;
+    }
+
+    for (int trial = 0; trial < config.Trials; ++trial)
+    {
+        D = wh256_decoder_init64(D, message_bytes, config.BlockBytes);
+        if (!D)
+        {
+            ++result.Failures;
+            continue;
+        }
+
+        channel.Reset();
+
+        int received = 0;
+        bool success = false;
+
+        for (uint32_t id = 0; received < N + GIVE_UP_OVERHEAD; ++id)
+        {
+            if (channel.Drop())
+                continue;
+
+            int written = 0;
+            if (wh256_encoder_write(E, id, &block[0], &written))
+                break;
+
+            ++received;
+
+            if (!wh256_decoder_read(D, id, &block[0]))
+            {
+                success = true;
+                break;
+            }
+        }
+
+        if (!success ||
+            wh256_decoder_reconstruct(D, &recovered[0]) ||
+            memcmp(&recovered[0], &message[0], (size_t)message_bytes))
+        {
+            ++result.Failures;
+            continue;
+        }
+
+        const int overhead = received - N;
+        result.OverheadSum += overhead;
+        ++result.Counts[overhead <= MAX_TRACKED_OVERHEAD ? overhead : MAX_TRACKED_OVERHEAD + 1];
+    }
+}
+
+
+//// Entrypoint
+
+static void PrintUsage()
+{
+    cout << "Usage: wh256_overhead [--n-min N] [--n-max N] [--n-step step] [--n list]" << endl;
+    cout << "                      [--model list] [--loss rate] [--burst length]" << endl;
+    cout << "                      [--outage-period blocks] [--outage-length blocks]" << endl;
+    cout << "                      [--trials count] [--bytes block_bytes] [--threads count]" << endl;
+    cout << "                      [--seed seed] [--json path] [--csv path]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    m_clock.OnInitialize();
+
+    int n_min = 2, n_max = 1000, n_step = 1;
+    vector<int> n_list;
+    vector<string> model_list = ParseWordList("iid,gilbert");
+    double loss = 0.5, burst = 4.;
+    int outage_period = 100, outage_length = 50;
+    int trials = 1000, block_bytes = 1, thread_count = 0;
+    uint32_t seed = 1;
+    const char *json_path = 0, *csv_path = 0;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char *arg = argv[ii];
+        const char *value = ii + 1 < argc ? argv[ii + 1] : 0;
+
+        if (!value)
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++ii;
+
+        if (!strcmp(arg, "--n-min"))
+            n_min = atoi(value);
+        else if (!strcmp(arg, "--n-max"))
+            n_max = atoi(value);
+        else if (!strcmp(arg, "--n-step"))
+            n_step = atoi(value);
+        else if (!strcmp(arg, "--n"))
+            n_list = ParseIntList(value);
+        else if (!strcmp(arg, "--model"))
+            model_list = ParseWordList(value);
+        else if (!strcmp(arg, "--loss"))
+            loss = atof(value);
+        else if (!strcmp(arg, "--burst"))
+            burst = atof(value);
+        else if (!strcmp(arg, "--outage-period"))
+            outage_period = atoi(value);
+        else if (!strcmp(arg, "--outage-length"))
+            outage_length = atoi(value);
+        else if (!strcmp(arg, "--trials"))
+            trials = atoi(value);
+        else if (!strcmp(arg, "--bytes"))
+            block_bytes = atoi(value);
+        else if (!strcmp(arg, "--threads"))
+            thread_count = atoi(value);
+        else if (!strcmp(arg, "--seed"))
+            seed = (uint32_t)atoi(value);
+        else if (!strcmp(arg, "--json"))
+            json_path = value;
+        else if (!strcmp(arg, "--csv"))
+            csv_path = value;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (n_list.empty())
+    {
+        if (n_step < 1)
+            n_step = 1;
+        for (int N = n_min; N <= n_max; N += n_step)
+            n_list.push_back(N);
+    }
+
+    if (n_list.empty() || trials < 1 || block_bytes < 1 || loss < 0. || loss >= 1. ||
+        outage_period < 1 || outage_length < 0 || outage_length >= outage_period)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (thread_count <= 0)
+    {
+        thread_count = (int)thread::hardware_concurrency();
+        if (thread_count <= 0)
+            thread_count = 1;
+    }
+
+    if (wirehair_init())
+    {
+        cout << "Codec initialization failed" << endl;
+        return 1;
+    }
+
+    BenchReport report;
+    report.AddMeta("tool", "wh256_overhead");
+    report.AddMeta("wh256_version", WH256_VERSION);
+    report.AddMeta("threads", thread_count);
+
+    for (size_t mi = 0; mi < model_list.size(); ++mi)
+    {
+        OverheadConfig config;
+        if (!ParseChannelModel(model_list[mi], config.Channel.Model))
+        {
+            cout << "Unknown loss model: " << model_list[mi] << endl;
+            return 1;
+        }
+        config.Channel.Loss = loss;
+        config.Channel.Burst = burst;
+        config.Channel.OutagePeriod = outage_period;
+        config.Channel.OutageLength = outage_length;
+        config.Trials = trials;
+        config.BlockBytes = block_bytes;
+        config.Seed = seed;
+
+        vector<OverheadResult> results(n_list.size());
+        atomic<size_t> next_item(0);
+        atomic<size_t> done_items(0);
+
+        double t0 = m_clock.usec();
+
+        vector<thread> threads;
+        for (int ti = 0; ti < thread_count; ++ti)
+        {
+            threads.push_back(thread([&]() {
+                wh256_state E = 0, D = 0;
+                for (;;)
+                {
+                    size_t item = next_item++;
+                    if (item >= results.size())
+                        break;
+                    results[item].N = n_list[item];
+                    RunOverheadTrials(config, results[item], E, D);
+                    ++done_items;
+                }
+                wh256_free(E);
+                wh256_free(D);
+            }));
+        }
+
+        // Report progress about once a second while the workers run
+        size_t done = 0;
+        double last_report = t0;
+        while (done < results.size())
+        {
+            Clock::sleep(100);
+            done = done_items;
+            double now = m_clock.usec();
+            if (now - last_report >= 1000000.)
+            {
+                cout << "  " << model_list[mi] << ": " << done << " / " << results.size() << " values of N" << endl;
+                last_report = now;
+            }
+        }
+
+        for (size_t ti = 0; ti < threads.size(); ++ti)
+            threads[ti].join();
+
+        double t1 = m_clock.usec();
+
+        int encoder_failures = 0, worst_N = 0;
+        double worst_mean = -1.;
+
+        for (size_t ii = 0; ii < results.size(); ++ii)
+        {
+            const OverheadResult &result = results[ii];
+            const int completed = trials - result.Failures;
+            const double mean = completed > 0 ? result.OverheadSum / (double)completed : 0.;
+
+            report.BeginRow();
+            report.AddNumber("N", result.N);
+            report.AddText("backend", result.N < 28 ? "cm256" : "wirehair");
+            report.AddText("model", model_list[mi]);
+            if (config.Channel.Model == CHANNEL_OUTAGE)
+            {
+                report.AddNumber("loss", outage_length / (double)outage_period);
+                report.AddNumber("burst", outage_length);
+            }
+            else
+            {
+                report.AddNumber("loss", loss);
+                report.AddNumber("burst", config.Channel.Model == CHANNEL_GILBERT ? burst : 1.);
+            }
+            report.AddNumber("trials", trials);
+            report.AddNumber("encoder_failed", result.EncoderFailed ? 1 : 0);
+            report.AddNumber("failures", result.Failures);
+            report.AddNumber("overhead_mean", mean);
+
+            // Cumulative success probability over all trials, counting failures
+            int successes = 0;
+            for (int k = 0; k <= MAX_TRACKED_OVERHEAD; ++k)
+            {
+                successes += result.Counts[k];
+                ostringstream name;
+                name << "p_success_k" << k;
+                report.AddNumber(name.str(), result.EncoderFailed ? 0. : successes / (double)trials);
+            }
+
+            if (result.EncoderFailed)
+            {
+                ++encoder_failures;
+                cout << "*** Encoder initialization failed for N=" << result.N << endl;
+            }
+            else if (mean > worst_mean)
+            {
+                worst_mean = mean;
+                worst_N = result.N;
+            }
+        }
+
+        const double seconds = (t1 - t0) / 1000000.;
+        cout << model_list[mi] << " loss: " << results.size() << " values of N x " << trials << " trials in "
+            << setprecision(4) << seconds << " s on " << thread_count << " threads";
+        if (worst_N > 0)
+            cout << ", worst mean overhead " << worst_mean << " at N=" << worst_N;
+        if (encoder_failures > 0)
+            cout << ", " << encoder_failures << " encoder failures";
+        cout << endl;
+    }
+
+    if (json_path && !report.WriteJSON(json_path))
+    {
+        cout << "Failed to write " << json_path << endl;
+        return 1;
+    }
+    if (csv_path && !report.WriteCSV(csv_path))
+    {
+        cout << "Failed to write " << csv_path << endl;
+        return 1;
+    }
+
+    return 0;
+}
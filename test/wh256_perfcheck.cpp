@@ -0,0 +1,631 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BenchTools.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <string>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+using namespace std;
+using namespace cat;
+
+
+/*
+    wh256_perfcheck: Performance regression check between two builds
+
+    Compares the JSON reports written by wh256_bench and gf256_bench for a
+    baseline build against a new build.  Each build should be run several
+    times, and every run gives one sample for each metric of each row.  The
+    two sets of samples are compared with a two-sided Mann-Whitney U test,
+    which does not assume the timings are normally distributed.
+
+    Rows are matched on their configuration columns, such as (backend, N,
+    block_bytes, loss, threads) or (kernel, backend, bytes, alignment, cache).
+    The compared metrics are the per-phase *_median columns and the
+    throughput columns.  A metric is a regression when the median of the new
+    runs is worse than the baseline by more than --threshold percent and the
+    test gives p < --alpha.  Cycle counts are worse when higher and
+    throughput is worse when lower.
+
+    Compare existing reports:
+
+        wh256_perfcheck --base a1.json,a2.json,a3.json,a4.json --new b1.json,b2.json,b3.json,b4.json
+
+    Or run both builds back to back on this machine and compare them.  The
+    directories hold the wh256_bench and gf256_bench binaries of each build.
+    The runs alternate between the builds, so that drift in clock speed or
+    background load affects both builds the same way:
+
+        wh256_perfcheck --base-dir old/bin --new-dir new/bin [--runs 5]
+                        [--bench-args "--n 1000,10000 --trials 50"]
+                        [--kernel-args "--kernel muladd,add --max-bytes 65536"]
+
+    Both modes take [--threshold 5] [--alpha 0.05] [--csv summary.csv].  The
+    exit code is 2 if any regression was found, so the check can gate a build.
+
+    The exact test cannot give p below 2 / C(n1 + n2, n1), which is 0.1 for
+    3 runs of each build and 0.029 for 4.  Metrics whose run counts cannot
+    reach p < --alpha are reported as "insufficient runs", and the exit code
+    is 3 if there are any and no regression was found.  The run mode needs
+    at least 4 runs.
+*/
+
+
+//// JSON report reader
+
+// One result row: column name -> value, with numbers kept as text
+typedef map<string, string> ReportRow;
+
+// Reads the flat JSON written by BenchReport::WriteJSON()
+class ReportReader
+{
+    const char *_p;
+
+    void SkipSpace()
+    {
+        while (*_p == ' ' || *_p == '\t' || *_p == '\r' || *_p == '\n')
+            ++_p;
+    }
+
+    bool ReadString(string &text)
+    {
+        SkipSpace();
+        if (*_p != '"')
+            return false;
+        ++_p;
+        text.clear();
+        while (*_p && *_p != '"')
+        {
+            if (*_p == '\\' && _p[1])
+                ++_p;
+            text += *_p++;
+        }
+        if (*_p != '"')
+            return false;
+        ++_p;
+        return true;
+    }
+
+    // Reads a string, number or null; returns false on anything else
+    bool ReadValue(string &text, bool &quoted)
+    {
+        SkipSpace();
+        quoted = *_p == '"';
+        if (quoted)
+            return ReadString(text);
+
+        text.clear();
+        while (*_p && *_p != ',' && *_p != '}' && *_p != ']' && *_p != ' ' && *_p != '\n' && *_p != '\r')
+            text += *_p++;
+        return !text.empty();
+    }
+
+    bool Expect(char ch)
+    {
+        SkipSpace();
+        if (*_p != ch)
+            return false;
+        ++_p;
+        return true;
+    }
+
+public:
+    bool Read(const string &json, vector<ReportRow> &rows, vector<string> &text_columns)
+    {
+        size_t start = json.find("\"results\"");
+        if (start == string::npos)
+            return false;
+        _p = json.c_str() + start;
+
+        string name, value;
+        bool quoted = false;
+        if (!ReadString(name) || !Expect(':') || !Expect('['))
+            return false;
+
+        SkipSpace();
+        while (*_p == '{')
+        {
+            ++_p;
+            ReportRow row;
+            SkipSpace();
+            while (*_p != '}')
+            {
+                if (!ReadString(name) || !Expect(':') || !ReadValue(value, quoted))
+                    return false;
+                row[name] = value;
+                if (quoted && find(text_columns.begin(), text_columns.end(), name) == text_columns.end())
+                    text_columns.push_back(name);
+                SkipSpace();
+                if (*_p == ',')
+                    ++_p;
+                SkipSpace();
+            }
+            ++_p;
+            rows.push_back(row);
+
+            SkipSpace();
+            if (*_p == ',')
+                ++_p;
+            SkipSpace();
+        }
+
+        return Expect(']');
+    }
+};
+
+static bool ReadReportFile(const string &path, vector<ReportRow> &rows, vector<string> &text_columns)
+{
+    ifstream file(path.c_str());
+    if (!file)
+        return false;
+    stringstream ss;
+    ss << file.rdbuf();
+
+    ReportReader reader;
+    return reader.Read(ss.str(), rows, text_columns);
+}
+
+
+//// Columns
+
+// Columns that are measurements rather than configuration
+static bool IsMeasured(const string &name)
+{
+    const char *suffixes[] = { "_median", "_p99", "_mean", "MBps", "GBps" };
+    for (int ii = 0; ii < 5; ++ii)
+    {
+        const size_t len = strlen(suffixes[ii]);
+        if (name.size() >= len && name.compare(name.size() - len, len, suffixes[ii]) == 0)
+            return true;
+    }
+    // Hardware counter columns from gf256_bench --perf
+    if (name.compare(0, 3, "hw_") == 0)
+        return true;
+    return name == "failures";
+}
+
+// Columns that are compared between builds
+static bool IsCompared(const string &name)
+{
+    if (name.find("MBps") != string::npos || name.find("GBps") != string::npos)
+        return true;
+    const size_t len = strlen("_median");
+    return name.size() > len && name.compare(name.size() - len, len, "_median") == 0;
+}
+
+// Throughput is better when higher, and everything else when lower
+static bool HigherIsBetter(const string &name)
+{
+    return name.find("MBps") != string::npos || name.find("GBps") != string::npos;
+}
+
+// Key naming the configuration of a row, such as "backend=wirehair N=1000 ..."
+static string RowKey(const ReportRow &row)
+{
+    string key;
+    for (ReportRow::const_iterator it = row.begin(); it != row.end(); ++it)
+    {
+        if (IsMeasured(it->first))
+            continue;
+        if (!key.empty())
+            key += " ";
+        key += it->first + "=" + it->second;
+    }
+    return key;
+}
+
+
+//// Mann-Whitney U test
+
+/*
+    Returns the two-sided p-value for the hypothesis that both samples come
+    from the same distribution.  For small samples without ties the exact
+    distribution of U is counted, and otherwise the normal approximation
+    with tie and continuity corrections is used.
+*/
+static double MannWhitneyP(const vector<double> &a, const vector<double> &b)
+{
+    const int n1 = (int)a.size(), n2 = (int)b.size();
+    if (n1 < 1 || n2 < 1)
+        return 1.;
+
+    // Rank the pooled samples, giving ties the average rank
+    vector<pair<double, int> > pooled;
+    for (int ii = 0; ii < n1; ++ii)
+        pooled.push_back(make_pair(a[ii], 0));
+    for (int ii = 0; ii < n2; ++ii)
+        pooled.push_back(make_pair(b[ii], 1));
+    sort(pooled.begin(), pooled.end());
+
+    const int n = n1 + n2;
+    double rank_sum_a = 0., tie_term = 0.;
+    bool ties = false;
+    for (int ii = 0; ii < n;)
+    {
+        int jj = ii;
+        while (jj < n && pooled[jj].first == pooled[ii].first)
+            ++jj;
+        const double rank = (ii + 1 + jj) / 2.;
+        for (int kk = ii; kk < jj; ++kk)
+        {
+            if (pooled[kk].second == 0)
+                rank_sum_a += rank;
+        }
+        const double t = jj - ii;
+        if (t > 1)
+        {
+            ties = true;
+            tie_term += t * t * t - t;
+        }
+        ii = jj;
+    }
+
+    const double u = rank_sum_a - n1 * (n1 + 1) / 2.;
+    const double u_small = u < n1 * (double)n2 - u ? u : n1 * (double)n2 - u;
+
+    if (!ties && n1 * n2 <= 400)
+    {
+        /*
+            f[i][j][k] = number of orderings of i a's and j b's with U = k.
+            The largest element is either an a, which is above all j b's,
+            or a b, which adds nothing: f[i][j][k] = f[i-1][j][k-j] + f[i][j-1][k]
+        */
+        const int u_max = n1 * n2;
+        vector<vector<vector<double> > > f(n1 + 1, vector<vector<double> >(n2 + 1, vector<double>(u_max + 1, 0.)));
+        for (int i = 0; i <= n1; ++i)
+        {
+            for (int j = 0; j <= n2; ++j)
+            {
+                if (i == 0 || j == 0)
+                {
+                    f[i][j][0] = 1.;
+                    continue;
+                }
+                for (int k = 0; k <= i * j; ++k)
+                    f[i][j][k] = (k >= j ? f[i - 1][j][k - j] : 0.) + f[i][j - 1][k];
+            }
+        }
+        const vector<double> &counts = f[n1][n2];
+
+        double total = 0., tail = 0.;
+        for (int k = 0; k <= u_max; ++k)
+        {
+            total += counts[k];
+            if (k <= u_small)
+                tail += counts[k];
+        }
+        double p = 2. * tail / total;
+        return p > 1. ? 1. : p;
+    }
+
+    const double mean = n1 * (double)n2 / 2.;
+    const double variance = n1 * (double)n2 / 12. * ((n + 1) - tie_term / ((double)n * (n - 1)));
+    if (variance <= 0.)
+        return 1.;
+
+    const double z = (mean - u_small - 0.5) / sqrt(variance);
+    if (z <= 0.)
+        return 1.;
+    double p = erfc(z / sqrt(2.));
+    return p > 1. ? 1. : p;
+}
+
+/*
+    Returns the smallest two-sided p-value the test can give for these
+    sample sizes, which is when every sample of one side is below every
+    sample of the other: 2 / C(n1 + n2, n1).  If this is not below alpha,
+    no difference can be significant however large it is.
+*/
+static double MannWhitneyMinimumP(int n1, int n2)
+{
+    if (n1 < 1 || n2 < 1)
+        return 1.;
+
+    double orderings = 1.;
+    for (int ii = 1; ii <= n1; ++ii)
+        orderings = orderings * (n2 + ii) / ii;
+
+    const double p = 2. / orderings;
+    return p > 1. ? 1. : p;
+}
+
+
+//// Comparison
+
+struct MetricSamples
+{
+    vector<double> Base, New;
+};
+
+static double MedianOf(vector<double> values)
+{
+    if (values.empty())
+        return 0.;
+    sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return (values.size() & 1) ? values[mid] : (values[mid - 1] + values[mid]) / 2.;
+}
+
+static bool LoadRuns(const vector<string> &paths, int which, map<string, map<string, MetricSamples> > &table)
+{
+    for (size_t ii = 0; ii < paths.size(); ++ii)
+    {
+        vector<ReportRow> rows;
+        vector<string> text_columns;
+        if (!ReadReportFile(paths[ii], rows, text_columns))
+        {
+            cout << "Failed to read report " << paths[ii] << endl;
+            return false;
+        }
+
+        for (size_t ri = 0; ri < rows.size(); ++ri)
+        {
+            const string key = RowKey(rows[ri]);
+            for (ReportRow::const_iterator it = rows[ri].begin(); it != rows[ri].end(); ++it)
+            {
+                if (!IsCompared(it->first) || it->second == "null")
+                    continue;
+                MetricSamples &samples = table[key][it->first];
+                (which == 0 ? samples.Base : samples.New).push_back(atof(it->second.c_str()));
+            }
+        }
+    }
+    return true;
+}
+
+// Returns the number of regressions found, and counts the metrics with too few runs to test
+static int Compare(const vector<string> &base_paths, const vector<string> &new_paths,
+    double threshold, double alpha, const char *csv_path, int &insufficient)
+{
+    insufficient = 0;
+
+    map<string, map<string, MetricSamples> > table;
+    if (!LoadRuns(base_paths, 0, table) || !LoadRuns(new_paths, 1, table))
+        return -1;
+
+    BenchReport report;
+    int regressions = 0, improvements = 0, compared = 0;
+
+    cout << left << setw(64) << "configuration" << setw(22) << "metric" << right
+        << setw(14) << "base" << setw(14) << "new" << setw(9) << "change" << setw(9) << "p" << "  verdict" << endl;
+
+    for (map<string, map<string, MetricSamples> >::iterator row = table.begin(); row != table.end(); ++row)
+    {
+        for (map<string, MetricSamples>::iterator metric = row->second.begin(); metric != row->second.end(); ++metric)
+        {
+            const MetricSamples &samples = metric->second;
+            if (samples.Base.empty() || samples.New.empty())
+                continue;
+            ++compared;
+
+            const double base_median = MedianOf(samples.Base);
+            const double new_median = MedianOf(samples.New);
+            const double change = base_median != 0. ? (new_median - base_median) / base_median * 100. : 0.;
+            const double worse = HigherIsBetter(metric->first) ? -change : change;
+            const double p = MannWhitneyP(samples.Base, samples.New);
+
+            const char *verdict = "";
+            if (MannWhitneyMinimumP((int)samples.Base.size(), (int)samples.New.size()) >= alpha)
+            {
+                verdict = "insufficient runs";
+                ++insufficient;
+            }
+            else if (p < alpha && worse > threshold)
+            {
+                verdict = "REGRESSION";
+                ++regressions;
+            }
+            else if (p < alpha && worse < -threshold)
+            {
+                verdict = "improved";
+                ++improvements;
+            }
+
+            report.BeginRow();
+            report.AddText("configuration", row->first);
+            report.AddText("metric", metric->first);
+            report.AddNumber("base_runs", (double)samples.Base.size());
+            report.AddNumber("new_runs", (double)samples.New.size());
+            report.AddNumber("base_median", base_median);
+            report.AddNumber("new_median", new_median);
+            report.AddNumber("change_percent", change);
+            report.AddNumber("p_value", p);
+            report.AddText("verdict", *verdict ? verdict : "same");
+
+            // Only print the metrics that changed, to keep the summary short
+            if (*verdict)
+            {
+                cout << left << setw(64) << row->first.substr(0, 63) << setw(22) << metric->first << right
+                    << setw(14) << setprecision(6) << base_median << setw(14) << new_median
+                    << setw(8) << setprecision(3) << change << "%" << setw(9) << setprecision(2) << p
+                    << "  " << verdict << endl;
+            }
+        }
+    }
+
+    cout << compared << " metrics compared: " << regressions << " regressions, " << improvements
+        << " improvements beyond " << threshold << "% at alpha = " << alpha << endl;
+
+    if (insufficient > 0)
+    {
+        int needed = 1;
+        while (needed < 100 && MannWhitneyMinimumP(needed, needed) >= alpha)
+            ++needed;
+
+        cout << insufficient << " metrics have too few runs for p < " << alpha
+            << " to be possible, so they cannot be checked.  Use at least " << needed << " runs of each build." << endl;
+    }
+
+    if (csv_path && !report.WriteCSV(csv_path))
+    {
+        cout << "Failed to write " << csv_path << endl;
+        return -1;
+    }
+
+    return regressions;
+}
+
+
+//// Running both builds
+
+static string QuotePath(const string &path)
+{
+    return "\"" + path + "\"";
+}
+
+static bool RunTool(const string &dir, const char *tool, const string &args, const string &json_path)
+{
+#ifdef _WIN32
+    const string command = QuotePath(dir + "\\" + tool + ".exe") + " " + args + " --json " + QuotePath(json_path) + " > NUL";
+#else
+    const string command = QuotePath(dir + "/" + tool) + " " + args + " --json " + QuotePath(json_path) + " > /dev/null";
+#endif
+    cout << "  " << command << endl;
+    return system(command.c_str()) == 0;
+}
+
+static void PrintUsage()
+{
+    cout << "Usage: wh256_perfcheck --base a.json,... --new b.json,..." << endl;
+    cout << "       wh256_perfcheck --base-dir path --new-dir path [--runs count]" << endl;
+    cout << "                       [--bench-args args] [--kernel-args args]" << endl;
+    cout << "       Either form takes [--threshold percent] [--alpha p] [--csv path]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    vector<string> base_paths, new_paths;
+    string base_dir, new_dir;
+    string bench_args = "--n 1000,10000 --loss 0.1 --backend wirehair --trials 50";
+    string kernel_args = "--kernel add,muladd,mul --max-bytes 65536";
+    int runs = 5;
+    double threshold = 5., alpha = 0.05;
+    const char *csv_path = 0;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char *arg = argv[ii];
+        const char *value = ii + 1 < argc ? argv[ii + 1] : 0;
+
+        if (!value)
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++ii;
+
+        if (!strcmp(arg, "--base"))
+            base_paths = ParseWordList(value);
+        else if (!strcmp(arg, "--new"))
+            new_paths = ParseWordList(value);
+        else if (!strcmp(arg, "--base-dir"))
+            base_dir = value;
+        else if (!strcmp(arg, "--new-dir"))
+            new_dir = value;
+        else if (!strcmp(arg, "--runs"))
+            runs = atoi(value);
+        else if (!strcmp(arg, "--bench-args"))
+            bench_args = value;
+        else if (!strcmp(arg, "--kernel-args"))
+            kernel_args = value;
+        else if (!strcmp(arg, "--threshold"))
+            threshold = atof(value);
+        else if (!strcmp(arg, "--alpha"))
+            alpha = atof(value);
+        else if (!strcmp(arg, "--csv"))
+            csv_path = value;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!base_dir.empty() || !new_dir.empty())
+    {
+        if (base_dir.empty() || new_dir.empty() || runs < 1)
+        {
+            PrintUsage();
+            return 1;
+        }
+
+        // With 3 runs of each build the smallest possible p is 0.1
+        if (runs < 4)
+        {
+            cout << "At least 4 runs of each build are needed for the test to reach p < 0.05" << endl;
+            return 1;
+        }
+
+        // Alternate between the builds so that both see the same conditions
+        for (int run = 0; run < runs; ++run)
+        {
+            for (int which = 0; which < 2; ++which)
+            {
+                const string &dir = which == 0 ? base_dir : new_dir;
+                ostringstream prefix;
+                prefix << "perfcheck_" << (which == 0 ? "base" : "new") << "_" << run;
+
+                const string bench_json = prefix.str() + "_wh256.json";
+                const string kernel_json = prefix.str() + "_gf256.json";
+
+                if (!RunTool(dir, "wh256_bench", bench_args, bench_json) ||
+                    !RunTool(dir, "gf256_bench", kernel_args, kernel_json))
+                {
+                    cout << "Benchmark run failed" << endl;
+                    return 1;
+                }
+
+                vector<string> &paths = which == 0 ? base_paths : new_paths;
+                paths.push_back(bench_json);
+                paths.push_back(kernel_json);
+            }
+        }
+    }
+
+    if (base_paths.empty() || new_paths.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    int insufficient = 0;
+    int regressions = Compare(base_paths, new_paths, threshold, alpha, csv_path, insufficient);
+    if (regressions < 0)
+        return 1;
+    if (regressions > 0)
+        return 2;
+    return insufficient > 0 ? 3 : 0;
+}
@@ -0,0 +1,770 @@
+/*
+    Copyright (c) 2012-2016 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of WH256 nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../src/wh256.h"
+#include "../src/wirehair_codec_8.hpp"
+
+#include "Clock.hpp"
+#include "AbyssinianPRNG.hpp"
+#include "BenchTools.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+using namespace std;
+using namespace cat;
+using namespace wirehair;
+
+static Clock m_clock;
+
+
+/*
+    wh256_seeds: Offline seed search for the Wirehair check matrix tables
+
+    ChooseMatrix() picks its seeds from three hand-searched tables in
+    wirehair_codec_8.cpp.  This tool searches them again and prints new
+    tables that can be pasted over the old ones:
+
+        dense  : DENSE_SEEDS[119], the dense row seed for each D = 14..486
+                 in steps of 4.  Candidates are scored on how often the
+                 encoder solves for a sample of the N that use each D, and
+                 then on reception overhead at those N.
+
+        peel   : SMALL_PEEL_SEEDS[262], the peel seed for each N <= 261.
+                 Candidates must let the encoder solve, and are then scored
+                 on reception overhead.
+
+        except : EXCEPT_TABLE[1000], a bit for each 261 < N < 64000 where the
+                 default peel seed (N itself) fails.  Either the encoder does
+                 not solve, or the mean overhead is above --except-overhead
+                 when --except-trials is nonzero.  For each flagged N it finds
+                 a backup seed, and prints the switch cases in TablePeelSeed()
+                 for the N that need a seed other than the secondary seed 1.
+                 N outside --n-min..--n-max keep their current entries, so a
+                 partial run still prints a complete table.  N where no
+                 backup seed meets the limits are listed on the console.
+
+    The seed currently in the table is always scored too, and a candidate
+    only replaces it when it scores strictly better, both in the search and
+    in a longer confirmation run.  So a short search never makes the tables
+    worse.
+
+    Overhead is measured by sending each message over a channel with 50%
+    random loss.  Every work item gets its own PRNG seed, so the output does
+    not depend on the number of threads.  Worker threads take work items
+    from a shared counter.
+
+    Usage:
+
+        wh256_seeds [--table dense,peel,except] [--candidates 256]
+                    [--samples 16] [--trials 20] [--confirm-trials 200]
+                    [--except-trials 0] [--except-overhead 0.04]
+                    [--n-min 262] [--n-max 63999] [--threads 0 = all cores]
+                    [--out tables.txt] [--csv scores.csv]
+*/
+
+
+//// Scoring
+
+// Score for a candidate seed; higher invertibility wins, then lower overhead
+struct SeedScore
+{
+    double Invertible;  // Fraction of sampled N where the encoder solved
+    double Overhead;    // Mean extra blocks needed over all decode trials
+
+    bool BetterThan(const SeedScore &other) const
+    {
+        if (Invertible != other.Invertible)
+            return Invertible > other.Invertible;
+        return Overhead < other.Overhead;
+    }
+};
+
+// Blocks to give up after when measuring overhead
+static const int GIVE_UP_OVERHEAD = 64;
+
+static const int BLOCK_BYTES = 1;
+
+class SeedTester
+{
+    Codec _encoder, _decoder;
+    vector<uint8_t> _message;
+
+public:
+    // Returns true if the encoder solves for N with these seeds
+    bool Encode(uint32_t N, uint32_t p_seed, uint32_t d_seed)
+    {
+        if (_message.size() < N)
+        {
+            _message.resize(N);
+            for (uint32_t ii = 0; ii < N; ++ii)
+                _message[ii] = (uint8_t)(ii * 151 + 7);
+        }
+
+        _encoder.SetSeedOverride(p_seed, d_seed);
+        if (_encoder.InitializeEncoder(N * BLOCK_BYTES, BLOCK_BYTES) != R_WIN)
+            return false;
+        return _encoder.EncodeFeed(&_message[0]) == R_WIN;
+    }
+
+    // Mean overhead over trials transfers using the last encoded message
+    double MeasureOverhead(uint32_t N, uint32_t p_seed, uint32_t d_seed, int trials, uint32_t seed)
+    {
+        Abyssinian prng;
+        prng.Initialize(seed);
+
+        uint8_t block[BLOCK_BYTES];
+        uint64_t overhead_sum = 0;
+
+        _decoder.SetSeedOverride(p_seed, d_seed);
+
+        for (int trial = 0; trial < trials; ++trial)
+        {
+            if (_decoder.InitializeDecoder(N * BLOCK_BYTES, BLOCK_BYTES, false, 0) != R_WIN)
+            {
+                overhead_sum += GIVE_UP_OVERHEAD;
+                continue;
+            }
+
+            uint32_t received = 0;
+            bool success = false;
+
+            for (uint32_t id = 0; received < N + GIVE_UP_OVERHEAD; ++id)
+            {
+                if (prng.Next() & 1)
+                    continue;
+
+                _encoder.Encode(id, block);
+                ++received;
+
+                Result r = _decoder.DecodeFeed(id, block);
+                if (r == R_WIN)
+                {
+                    success = true;
+                    break;
+                }
+                if (r != R_MORE_BLOCKS)
+                    break;
+            }
+
+            overhead_sum += success ? received - N : GIVE_UP_OVERHEAD;
+        }
+
+        return trials > 0 ? overhead_sum / (double)trials : 0.;
+    }
+
+    // Score a seed pair over a list of N values
+    SeedScore Score(const vector<uint32_t> &n_list, uint32_t p_seed, uint32_t d_seed, int trials, uint32_t seed)
+    {
+        SeedScore score = { 0., 0. };
+        int solved = 0;
+        double overhead = 0.;
+
+        for (size_t ii = 0; ii < n_list.size(); ++ii)
+        {
+            const uint32_t N = n_list[ii];
+
+            // With p_seed = SEED_FROM_TABLE each N keeps its own peel seed
+            if (!Encode(N, p_seed, d_seed))
+            {
+                overhead += GIVE_UP_OVERHEAD;
+                continue;
+            }
+            ++solved;
+
+            if (trials > 0)
+                overhead += MeasureOverhead(N, p_seed, d_seed, trials, seed + (uint32_t)ii * 7919);
+        }
+
+        if (!n_list.empty())
+        {
+            score.Invertible = solved / (double)n_list.size();
+            score.Overhead = overhead / n_list.size();
+        }
+        return score;
+    }
+
+    // Seeds that ChooseMatrix() picks from the current tables
+    bool TableSeeds(uint32_t N, uint32_t &p_seed, uint32_t &d_seed)
+    {
+        _encoder.SetSeedOverride(Codec::SEED_FROM_TABLE, Codec::SEED_FROM_TABLE);
+        Result r = _encoder.InitializeEncoder(N * BLOCK_BYTES, BLOCK_BYTES);
+        p_seed = _encoder.PSeed();
+        d_seed = _encoder.CSeed();
+        return r == R_WIN;
+    }
+};
+
+
+//// Work queue
+
+/*
+    Runs item_count work items on thread_count threads, where each thread
+    calls work(tester, item).  Items are handed out in order from a shared
+    counter, so long items do not hold up the other threads.
+*/
+template<typename WorkT>
+static void RunParallel(int thread_count, size_t item_count, const char *label, WorkT work)
+{
+    atomic<size_t> next_item(0), done_items(0);
+    vector<thread> threads;
+
+    for (int ti = 0; ti < thread_count; ++ti)
+    {
+        threads.push_back(thread([&]() {
+            SeedTester tester;
+            for (;;)
+            {
+                size_t item = next_item++;
+                if (item >= item_count)
+                    break;
+                work(tester, item);
+                ++done_items;
+            }
+        }));
+    }
+
+    double last_report = m_clock.usec();
+    size_t done = 0;
+    while (done < item_count)
+    {
+        Clock::sleep(100);
+        done = done_items;
+        double now = m_clock.usec();
+        if (now - last_report >= 10000000.)
+        {
+            cout << "  " << label << ": " << done << " / " << item_count << " work items" << endl;
+            last_report = now;
+        }
+    }
+
+    for (size_t ti = 0; ti < threads.size(); ++ti)
+        threads[ti].join();
+}
+
+
+//// Table output
+
+template<typename T>
+static void WriteTable(ostream &out, const char *type, const char *name, const vector<T> &values, int per_line)
+{
+    out << "static const " << type << " " << name << "[" << values.size() << "] = {";
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        if (ii % per_line == 0)
+            out << endl << "    ";
+        out << values[ii];
+        if (ii + 1 < values.size())
+            out << (ii % per_line == (size_t)per_line - 1 ? "," : ", ");
+    }
+    out << endl << "};" << endl << endl;
+}
+
+static void WriteExceptTable(ostream &out, const vector<uint64_t> &table)
+{
+    out << "static const uint64_t EXCEPT_TABLE[" << table.size() << "] = {";
+    for (size_t ii = 0; ii < table.size(); ++ii)
+    {
+        if (ii % 4 == 0)
+            out << endl << "    ";
+        out << "0x" << hex << setw(16) << setfill('0') << table[ii] << dec << setfill(' ') << "ULL";
+        if (ii + 1 < table.size())
+            out << (ii % 4 == 3 ? "," : ", ");
+    }
+    out << endl << "};" << endl << endl;
+}
+
+
+//// Searches
+
+struct SearchOptions
+{
+    int Candidates;
+    int Samples;
+    int Trials;
+    int ConfirmTrials;
+    int ExceptTrials;
+    double ExceptOverhead;
+    uint32_t NMin, NMax;
+    int Threads;
+};
+
+// Evenly spaced sample of up to count values from the list
+static vector<uint32_t> SampleList(const vector<uint32_t> &list, int count)
+{
+    if ((int)list.size() <= count)
+        return list;
+
+    vector<uint32_t> sample;
+    for (int ii = 0; ii < count; ++ii)
+        sample.push_back(list[(size_t)ii * (list.size() - 1) / (count - 1)]);
+    return sample;
+}
+
+/*
+    Scores every candidate seed for every entry of a table, where candidate 0
+    is the current seed and candidate c > 0 is seed c - 1.  Searching many
+    candidates with a few trials each tends to pick seeds that were lucky, so
+    each winner is scored again against the current seed with a fresh PRNG
+    seed and --confirm-trials trials, and only replaces it if it still wins.
+
+    score(tester, entry, seed, trials, prng_seed) returns the SeedScore.
+*/
+template<typename ScoreT>
+static vector<uint32_t> SearchTable(const SearchOptions &options, const char *label,
+    const vector<uint32_t> &current, const vector<bool> &active, ScoreT score,
+    vector<SeedScore> &old_scores, vector<SeedScore> &new_scores)
+{
+    const size_t entry_count = current.size();
+    const size_t per_entry = (size_t)options.Candidates + 1;
+    vector<SeedScore> scores(entry_count * per_entry);
+
+    RunParallel(options.Threads, scores.size(), label, [&](SeedTester &tester, size_t item) {
+        const size_t entry = item / per_entry, candidate = item % per_entry;
+        if (!active[entry])
+            return;
+        const uint32_t seed = candidate == 0 ? current[entry] : (uint32_t)(candidate - 1);
+        scores[item] = score(tester, entry, seed, options.Trials, (uint32_t)item * 2654435761u + 1);
+    });
+
+    vector<uint32_t> seeds(current);
+    for (size_t entry = 0; entry < entry_count; ++entry)
+    {
+        size_t best = 0;
+        for (size_t c = 1; c < per_entry; ++c)
+        {
+            if (scores[entry * per_entry + c].BetterThan(scores[entry * per_entry + best]))
+                best = c;
+        }
+        if (active[entry] && best != 0)
+            seeds[entry] = (uint32_t)(best - 1);
+    }
+
+    // Confirm the winners with longer runs on a different channel sequence
+    old_scores.assign(entry_count, SeedScore());
+    new_scores.assign(entry_count, SeedScore());
+
+    RunParallel(options.Threads, entry_count * 2, label, [&](SeedTester &tester, size_t item) {
+        const size_t entry = item / 2;
+        if (!active[entry])
+            return;
+        const uint32_t prng_seed = (uint32_t)entry * 40503u + 0x9e3779b9u;
+        if (item & 1)
+        {
+            if (seeds[entry] != current[entry])
+                new_scores[entry] = score(tester, entry, seeds[entry], options.ConfirmTrials, prng_seed);
+        }
+        else
+            old_scores[entry] = score(tester, entry, current[entry], options.ConfirmTrials, prng_seed);
+    });
+
+    for (size_t entry = 0; entry < entry_count; ++entry)
+    {
+        if (seeds[entry] == current[entry])
+            new_scores[entry] = old_scores[entry];
+        else if (!new_scores[entry].BetterThan(old_scores[entry]))
+        {
+            seeds[entry] = current[entry];
+            new_scores[entry] = old_scores[entry];
+        }
+    }
+
+    return seeds;
+}
+
+static void ReportEntry(BenchReport &report, const char *table, uint32_t entry, uint32_t old_seed, uint32_t new_seed,
+    const SeedScore &old_score, const SeedScore &new_score)
+{
+    report.BeginRow();
+    report.AddText("table", table);
+    report.AddNumber("entry", entry);
+    report.AddNumber("old_seed", old_seed);
+    report.AddNumber("new_seed", new_seed);
+    report.AddNumber("old_invertible", old_score.Invertible);
+    report.AddNumber("new_invertible", new_score.Invertible);
+    report.AddNumber("old_overhead", old_score.Overhead);
+    report.AddNumber("new_overhead", new_score.Overhead);
+
+    if (old_seed != new_seed)
+    {
+        cout << table << " " << entry << ": seed " << old_seed << " -> " << new_seed
+            << ", invertible " << old_score.Invertible << " -> " << new_score.Invertible
+            << ", overhead " << old_score.Overhead << " -> " << new_score.Overhead << endl;
+    }
+}
+
+static void SearchDenseSeeds(const SearchOptions &options, ostream &out, BenchReport &report)
+{
+    const int entry_count = 119;
+
+    // Find the N values that use each D
+    vector<vector<uint32_t> > n_lists(entry_count);
+    for (uint32_t N = CAT_WIREHAIR_MIN_N; N <= CAT_WIREHAIR_MAX_N; ++N)
+    {
+        uint32_t D = Codec::DenseRowCount(N);
+        if (D >= 14 && D <= 486)
+            n_lists[(D - 14) / 4].push_back(N);
+    }
+
+    vector<uint32_t> current(entry_count, 0);
+    vector<bool> active(entry_count, false);
+    {
+        SeedTester tester;
+        for (int ii = 0; ii < entry_count; ++ii)
+        {
+            n_lists[ii] = SampleList(n_lists[ii], options.Samples);
+
+            uint32_t p_seed = 0;
+            if (!n_lists[ii].empty())
+            {
+                tester.TableSeeds(n_lists[ii][0], p_seed, current[ii]);
+                active[ii] = true;
+            }
+        }
+    }
+
+    vector<SeedScore> old_scores, new_scores;
+    vector<uint32_t> seeds = SearchTable(options, "dense", current, active,
+        [&](SeedTester &tester, size_t entry, uint32_t seed, int trials, uint32_t prng_seed) {
+            return tester.Score(n_lists[entry], Codec::SEED_FROM_TABLE, seed, trials, prng_seed);
+        }, old_scores, new_scores);
+
+    for (int ii = 0; ii < entry_count; ++ii)
+    {
+        if (active[ii])
+            ReportEntry(report, "dense", 14 + ii * 4, current[ii], seeds[ii], old_scores[ii], new_scores[ii]);
+    }
+
+    WriteTable(out, "uint16_t", "DENSE_SEEDS", seeds, 8);
+}
+
+static void SearchPeelSeeds(const SearchOptions &options, ostream &out, BenchReport &report)
+{
+    const int entry_count = 262;
+
+    // N < 2 are unused and keep their current values
+    vector<uint32_t> current(entry_count, 0);
+    vector<bool> active(entry_count, false);
+    {
+        SeedTester tester;
+        for (uint32_t N = CAT_WIREHAIR_MIN_N; N < (uint32_t)entry_count; ++N)
+        {
+            uint32_t d_seed = 0;
+            tester.TableSeeds(N, current[N], d_seed);
+            active[N] = true;
+        }
+    }
+
+    vector<SeedScore> old_scores, new_scores;
+    vector<uint32_t> seeds = SearchTable(options, "peel", current, active,
+        [&](SeedTester &tester, size_t entry, uint32_t seed, int trials, uint32_t prng_seed) {
+            vector<uint32_t> n_list(1, (uint32_t)entry);
+            return tester.Score(n_list, seed, Codec::SEED_FROM_TABLE, trials, prng_seed);
+        }, old_scores, new_scores);
+
+    for (uint32_t N = CAT_WIREHAIR_MIN_N; N < (uint32_t)entry_count; ++N)
+        ReportEntry(report, "peel", N, current[N], seeds[N], old_scores[N], new_scores[N]);
+
+    WriteTable(out, "uint16_t", "SMALL_PEEL_SEEDS", seeds, 18);
+}
+
+// Backup seeds to try in order, starting with the secondary seed ChooseMatrix() defaults to
+static const uint32_t BACKUP_SEEDS[] = { 1, 3, 2, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+static const int BACKUP_SEED_COUNT = (int)(sizeof(BACKUP_SEEDS) / sizeof(BACKUP_SEEDS[0]));
+
+static void SearchExceptions(const SearchOptions &options, ostream &out, BenchReport &report)
+{
+    const uint32_t n_min = options.NMin > 262 ? options.NMin : 262;
+    const uint32_t n_max = options.NMax < CAT_WIREHAIR_MAX_N - 1 ? options.NMax : CAT_WIREHAIR_MAX_N - 1;
+    if (n_min > n_max)
+        return;
+
+    // Backup seed chosen for each N, or 0 if the default seed is fine
+    vector<uint32_t> backups(n_max - n_min + 1, 0);
+    vector<SeedScore> default_scores(backups.size()), backup_scores(backups.size());
+
+    RunParallel(options.Threads, backups.size(), "except", [&](SeedTester &tester, size_t item) {
+        const uint32_t N = n_min + (uint32_t)item;
+        vector<uint32_t> n_list(1, N);
+
+        SeedScore score = tester.Score(n_list, N, Codec::SEED_FROM_TABLE,
+            options.ExceptTrials, N * 2654435761u + 1);
+        default_scores[item] = score;
+
+        if (score.Invertible >= 1. && (options.ExceptTrials <= 0 || score.Overhead <= options.ExceptOverhead))
+            return;
+
+        // Take the first backup seed that solves and meets the overhead limit,
+        // or else the best one found
+        SeedScore best_score = score;
+        uint32_t best_seed = BACKUP_SEEDS[0];
+        for (int bi = 0; bi < BACKUP_SEED_COUNT; ++bi)
+        {
+            SeedScore backup = tester.Score(n_list, BACKUP_SEEDS[bi], Codec::SEED_FROM_TABLE,
+                options.ExceptTrials, N * 2654435761u + 1);
+            if (backup.Invertible >= 1. && (options.ExceptTrials <= 0 || backup.Overhead <= options.ExceptOverhead))
+            {
+                best_seed = BACKUP_SEEDS[bi];
+                best_score = backup;
+                break;
+            }
+            if (backup.BetterThan(best_score))
+            {
+                best_seed = BACKUP_SEEDS[bi];
+                best_score = backup;
+            }
+        }
+        backups[item] = best_seed;
+        backup_scores[item] = best_score;
+    });
+
+    // The table only covers N below CAT_WIREHAIR_MAX_N, as in TablePeelSeed()
+    vector<uint64_t> table(1000, 0);
+    vector<vector<uint32_t> > cases(BACKUP_SEED_COUNT);
+    int exception_count = 0, unsolved_count = 0;
+
+    for (uint32_t N = 262; N < CAT_WIREHAIR_MAX_N; ++N)
+    {
+        // Keep the current seed for N outside the searched range, so the table stays a drop-in
+        uint32_t seed;
+        if (N < n_min || N > n_max)
+            seed = Codec::TablePeelSeed(N);
+        else
+            seed = backups[N - n_min] ? backups[N - n_min] : N;
+        if (seed == N)
+            continue;
+
+        table[N >> 6] |= (uint64_t)1 << (N & 63);
+
+        bool listed = false;
+        for (int bi = 0; bi < BACKUP_SEED_COUNT; ++bi)
+        {
+            if (BACKUP_SEEDS[bi] == seed)
+            {
+                cases[bi].push_back(N);
+                listed = true;
+            }
+        }
+        if (!listed)
+            cout << "except " << N << ": current seed " << seed << " is not a backup seed and is replaced by 1" << endl;
+    }
+
+    for (size_t item = 0; item < backups.size(); ++item)
+    {
+        if (backups[item] == 0)
+            continue;
+
+        const uint32_t N = n_min + (uint32_t)item;
+        ++exception_count;
+
+        // Even the best backup seed did not solve or stays above the overhead limit
+        const SeedScore &best_score = backup_scores[item];
+        if (best_score.Invertible < 1. || (options.ExceptTrials > 0 && best_score.Overhead > options.ExceptOverhead))
+        {
+            cout << "except " << N << ": no backup seed meets the limits, using seed " << backups[item]
+                << " with invertible " << best_score.Invertible << ", overhead " << best_score.Overhead << endl;
+            ++unsolved_count;
+        }
+
+        report.BeginRow();
+        report.AddText("table", "except");
+        report.AddNumber("entry", N);
+        report.AddNumber("old_seed", N);
+        report.AddNumber("new_seed", backups[item]);
+        report.AddNumber("old_invertible", default_scores[item].Invertible);
+        report.AddNumber("new_invertible", best_score.Invertible);
+        report.AddNumber("old_overhead", default_scores[item].Overhead);
+        report.AddNumber("new_overhead", best_score.Overhead);
+    }
+
+    cout << exception_count << " values of N in " << n_min << ".." << n_max << " need a backup peel seed";
+    if (unsolved_count > 0)
+        cout << ", and " << unsolved_count << " of them have none that meets the limits";
+    cout << endl;
+
+    WriteExceptTable(out, table);
+
+    // Switch cases for TablePeelSeed(), where seed 1 is the default case
+    out << "            switch (block_count)" << endl << "            {" << endl;
+    for (int bi = 1; bi < BACKUP_SEED_COUNT; ++bi)
+    {
+        if (cases[bi].empty())
+            continue;
+        for (size_t ii = 0; ii < cases[bi].size(); ++ii)
+            out << "            case " << cases[bi][ii] << ":" << endl;
+        out << "                // Use backup seed " << BACKUP_SEEDS[bi] << endl;
+        out << "                return " << BACKUP_SEEDS[bi] << ";" << endl;
+    }
+    out << "            default:" << endl;
+    out << "                // Use secondary backup seed" << endl;
+    out << "                return 1;" << endl;
+    out << "            }" << endl << endl;
+}
+
+
+//// Entrypoint
+
+static void PrintUsage()
+{
+    cout << "Usage: wh256_seeds [--table list] [--candidates count] [--samples count]" << endl;
+    cout << "                   [--trials count] [--confirm-trials count]" << endl;
+    cout << "                   [--except-trials count] [--except-overhead blocks]" << endl;
+    cout << "                   [--n-min N] [--n-max N] [--threads count]" << endl;
+    cout << "                   [--out path] [--csv path]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    m_clock.OnInitialize();
+
+    vector<string> table_list = ParseWordList("dense,peel,except");
+    SearchOptions options;
+    options.Candidates = 256;
+    options.Samples = 16;
+    options.Trials = 20;
+    options.ConfirmTrials = 200;
+    options.ExceptTrials = 0;
+    options.ExceptOverhead = 0.04;
+    options.NMin = 262;
+    options.NMax = CAT_WIREHAIR_MAX_N - 1;
+    options.Threads = 0;
+    const char *out_path = 0, *csv_path = 0;
+
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char *arg = argv[ii];
+        const char *value = ii + 1 < argc ? argv[ii + 1] : 0;
+
+        if (!value)
+        {
+            PrintUsage();
+            return 1;
+        }
+        ++ii;
+
+        if (!strcmp(arg, "--table"))
+            table_list = ParseWordList(value);
+        else if (!strcmp(arg, "--candidates"))
+            options.Candidates = atoi(value);
+        else if (!strcmp(arg, "--samples"))
+            options.Samples = atoi(value);
+        else if (!strcmp(arg, "--trials"))
+            options.Trials = atoi(value);
+        else if (!strcmp(arg, "--confirm-trials"))
+            options.ConfirmTrials = atoi(value);
+        else if (!strcmp(arg, "--except-trials"))
+            options.ExceptTrials = atoi(value);
+        else if (!strcmp(arg, "--except-overhead"))
+            options.ExceptOverhead = atof(value);
+        else if (!strcmp(arg, "--n-min"))
+            options.NMin = (uint32_t)atoi(value);
+        else if (!strcmp(arg, "--n-max"))
+            options.NMax = (uint32_t)atoi(value);
+        else if (!strcmp(arg, "--threads"))
+            options.Threads = atoi(value);
+        else if (!strcmp(arg, "--out"))
+            out_path = value;
+        else if (!strcmp(arg, "--csv"))
+            csv_path = value;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.Candidates < 0 || options.Samples < 2 || options.Trials < 0 ||
+        options.ConfirmTrials < 0 || options.ExceptTrials < 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (options.Threads <= 0)
+    {
+        options.Threads = (int)thread::hardware_concurrency();
+        if (options.Threads <= 0)
+            options.Threads = 1;
+    }
+
+    if (wirehair_init())
+    {
+        cout << "Codec initialization failed" << endl;
+        return 1;
+    }
+
+    ofstream file;
+    if (out_path)
+    {
+        file.open(out_path);
+        if (!file)
+        {
+            cout << "Failed to open " << out_path << endl;
+            return 1;
+        }
+    }
+    ostream &out = out_path ? file : cout;
+
+    BenchReport report;
+    report.AddMeta("tool", "wh256_seeds");
+
+    for (size_t ti = 0; ti < table_list.size(); ++ti)
+    {
+        double t0 = m_clock.usec();
+
+        if (table_list[ti] == "dense")
+            SearchDenseSeeds(options, out, report);
+        else if (table_list[ti] == "peel")
+            SearchPeelSeeds(options, out, report);
+        else if (table_list[ti] == "except")
+            SearchExceptions(options, out, report);
+        else
+        {
+            cout << "Unknown table: " << table_list[ti] << endl;
+            return 1;
+        }
+
+        double t1 = m_clock.usec();
+        cout << table_list[ti] << " search took " << setprecision(4) << (t1 - t0) / 1000000. << " s on "
+            << options.Threads << " threads" << endl;
+    }
+
+    if (csv_path && !report.WriteCSV(csv_path))
+    {
+        cout << "Failed to write " << csv_path << endl;
+        return 1;
+    }
+
+    return 0;
+}